@@ -31,6 +31,10 @@ extern "C" {
  * An example for a compatible change would be
  *   - assignment of the reserved 'res3' field
  *     for a specific purpose.
+ *
+ * Minor versions:
+ *   1: initial version
+ *   2: added 16-bit and 64-bit integer element types
  */
 
 #define FCOM_PROTO_CATCAT(maj,min) 0x##maj##min
@@ -38,13 +42,15 @@ extern "C" {
 
 #define FCOM_PROTO_MAJ_1      1
 #define FCOM_PROTO_MIN_1      1
+#define FCOM_PROTO_MIN_2      2
 
 #define FCOM_PROTO_VERSION_11 FCOM_PROTO_CAT(FCOM_PROTO_MAJ_1,FCOM_PROTO_MIN_1)
+#define FCOM_PROTO_VERSION_12 FCOM_PROTO_CAT(FCOM_PROTO_MAJ_1,FCOM_PROTO_MIN_2)
 #define FCOM_PROTO_VERSION_1x FCOM_PROTO_CAT(FCOM_PROTO_MAJ_1,0)
 
-#define FCOM_PROTO_VERSION    FCOM_PROTO_VERSION_11
+#define FCOM_PROTO_VERSION    FCOM_PROTO_VERSION_12
 #define FCOM_PROTO_MAJ        FCOM_PROTO_MAJ_1
-#define FCOM_PROTO_MIN        FCOM_PROTO_MIN_1
+#define FCOM_PROTO_MIN        FCOM_PROTO_MIN_2
 
 #define FCOM_PROTO_MAJ_GET(x) ( (x) & ~0xf )
 #define FCOM_PROTO_MIN_GET(x) ( (x) &  0xf )
@@ -142,6 +148,12 @@ typedef uint32_t FcomGID;
  * ALWAYS use symbolic names when referring
  * to the type -- this may change if more
  * types are added.
+ *
+ * The 16-bit and 64-bit integer types require
+ * protocol minor version 2 (receivers built
+ * before these types were added reject them).
+ * 16-bit integers are packed two per 32-bit
+ * word on the wire.
  */
 #define FCOM_EL_NONE    0
 #define FCOM_EL_FLOAT   1
@@ -149,17 +161,52 @@ typedef uint32_t FcomGID;
 #define FCOM_EL_UINT32  3
 #define FCOM_EL_INT32   4
 #define FCOM_EL_INT8    5
-#define FCOM_EL_INVAL   6
+#define FCOM_EL_INT16   6
+#define FCOM_EL_UINT16  7
+#define FCOM_EL_INT64   8
+#define FCOM_EL_UINT64  9
+#define FCOM_EL_INVAL  10
+
+/*
+ * A sender may OR FCOM_EL_PACKED into the type
+ * of a blob with a large array of 32- or 64-bit
+ * elements (e.g., FCOM_EL_FLOAT | FCOM_EL_PACKED)
+ * to request lossless compression of the payload
+ * (differences of successive integers or XOR of
+ * successive floating-point numbers, bit-packed).
+ * This pays off for slowly varying waveforms;
+ * if it does not then the blob is sent raw.
+ * The blob must have protocol minor version 2
+ * (receivers built before packing was supported
+ * reject packed blobs).
+ *
+ * FCOM hands received blobs to the application
+ * with the flag cleared. Use FCOM_EL_TYPE() to
+ * strip the flag from a type.
+ *
+ * Packing is ignored by prepared groups
+ * (fcomPrepareGroup()).
+ */
+#define FCOM_EL_PACKED 0x10
 
 #define FCOM_EL_TYPE(t) ((t) & 0xf)
 #define FCOM_EL_SIZE(t) (  \
-	FCOM_EL_FLOAT  == (t) ? sizeof(float)    : \
-	FCOM_EL_DOUBLE == (t) ? sizeof(double)   : \
-	FCOM_EL_UINT32 == (t) ? sizeof(uint32_t) : \
-	FCOM_EL_INT32  == (t) ? sizeof(int32_t)  : \
-	FCOM_EL_INT8   == (t) ? sizeof(int8_t)   : \
+	((t) & ~(0xf | FCOM_EL_PACKED)) ? -1 :   \
+	FCOM_EL_FLOAT  == FCOM_EL_TYPE(t) ? sizeof(float)    : \
+	FCOM_EL_DOUBLE == FCOM_EL_TYPE(t) ? sizeof(double)   : \
+	FCOM_EL_UINT32 == FCOM_EL_TYPE(t) ? sizeof(uint32_t) : \
+	FCOM_EL_INT32  == FCOM_EL_TYPE(t) ? sizeof(int32_t)  : \
+	FCOM_EL_INT8   == FCOM_EL_TYPE(t) ? sizeof(int8_t)   : \
+	FCOM_EL_INT16  == FCOM_EL_TYPE(t) ? sizeof(int16_t)  : \
+	FCOM_EL_UINT16 == FCOM_EL_TYPE(t) ? sizeof(uint16_t) : \
+	FCOM_EL_INT64  == FCOM_EL_TYPE(t) ? sizeof(int64_t)  : \
+	FCOM_EL_UINT64 == FCOM_EL_TYPE(t) ? sizeof(uint64_t) : \
     -1 )
 
+/* Min. protocol minor version required by a type */
+#define FCOM_EL_MIN_VERS(t) ( \
+	FCOM_EL_TYPE(t) >= FCOM_EL_INT16 ? FCOM_PROTO_MIN_2 : FCOM_PROTO_MIN_1 )
+
 /*
  * A blob of data.
  */
@@ -184,6 +231,10 @@ typedef struct FcomBlob_ {
 	uint32_t	*p_u32;
 	int32_t     *p_i32;
 	int8_t      *p_i08;
+	int16_t     *p_i16;
+	uint16_t    *p_u16;
+	int64_t     *p_i64;
+	uint64_t    *p_u64;
 	}           dref;  /* ptr to data    */
 /*	uint8_t     pad[32 - sizeof(FcomID) - 5*4 - sizeof(void*)]; */
 } FcomBlob, *FcomBlobRef;
@@ -236,6 +287,10 @@ typedef struct FcomBlob_ {
 #define fc_u32    dref.p_u32
 #define fc_i32    dref.p_i32
 #define fc_i08    dref.p_i08
+#define fc_i16    dref.p_i16
+#define fc_u16    dref.p_u16
+#define fc_i64    dref.p_i64
+#define fc_u64    dref.p_u64
 #define fc_flt    dref.p_flt
 #define fc_dbl    dref.p_dbl
 
@@ -293,6 +348,13 @@ fcomStrerror(int fcom_error_status);
  *           same for all applications). If this is omitted then
  *           FCOM_PORT_DEFLT is used.
  *
+ *           With a "loop:" prefix (e.g., "loop:239.255.0.0") no
+ *           network is used: messages are passed in memory between
+ *           the contexts of this process which use "loop:" and the
+ *           same port (no other process nor node sees them). This
+ *           is intended for testing and benchmarking FCOM itself
+ *           on machines without (routed) multicast.
+ *
  *  n_bufs:  Number of buffers for blobs to create. This should be a
  *           multiple of the max. # of blobs the application plans
  *           to subscribe to. If different threads 'hold' references
@@ -306,7 +368,6 @@ fcomStrerror(int fcom_error_status);
 int
 fcomInit(const char *mcast_g_prefix, unsigned n_bufs);
 
-
 /** GROUPS ***********************************************************/
 
 /*
@@ -323,11 +384,27 @@ typedef void *FcomGroup;
  * by the first blob with a GID different
  * from FCOM_GID_ANY.
  *
+ * The group may grow up to the max. message
+ * size (fcomSetTxMsgSize()) in effect when
+ * it is allocated.
+ *
  * RETURNS: zero on success, nonzero on error.
  */
 int
 fcomAllocGroup(FcomID id, FcomGroup *p_group);
 
+/*
+ * Obtain an empty group which may grow up to
+ * 'size' bytes (at most FCOM_MSG_SIZE_MAX).
+ * A group exceeding the max. message size is
+ * sent as a sequence of fragments (see
+ * LARGE BLOBS).
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomAllocGroupSize(FcomID id, uint32_t size, FcomGroup *p_group);
+
 /*
  * Add a blob of data to a group. The data
  * are copied into the 'group' container.
@@ -373,6 +450,22 @@ fcomFreeGroup(FcomGroup group);
 int
 fcomPutGroup(FcomGroup group);
 
+/*
+ * Send out an array of groups. This is equivalent to
+ * calling fcomPutGroup() for every element but is more
+ * efficient because (where the OS supports it) many
+ * messages are handed to the TCP/IP stack with a single
+ * system call. This helps producers which fan out to
+ * many GIDs at the same time.
+ *
+ * All groups are consumed (even if an error occurs).
+ *
+ * RETURNS: zero if all groups were sent successfully or
+ *          the status of the first failure.
+ */
+int
+fcomPutGroups(FcomGroup groups[], unsigned n_groups);
+
 /*
  * Write a blob of data.
  * This routine may only be used for blobs
@@ -387,6 +480,318 @@ fcomPutGroup(FcomGroup group);
 int
 fcomPutBlob(FcomBlobRef p_blob);
 
+/*
+ * Send a 'sparse' update of a blob, i.e., only the elements
+ * within 'n_ranges' index ranges. 'p_blob' holds the complete
+ * array (only the data covered by the ranges are read).
+ *
+ * A receiver applies the update to a copy of the blob it holds
+ * for this ID, i.e., fcomGetBlob() still returns the complete
+ * array (with timestamp and status of the update). Receivers
+ * which hold no blob of the same type and element count (e.g.,
+ * because they just subscribed) drop the update and count it
+ * in their statistics. So do receivers which detected a lost
+ * message of the group (or a new or restarted sender) since
+ * the complete blob arrived; they resume applying updates
+ * with the next complete blob. Producers should therefore
+ * send the complete blob (fcomPutBlob()) periodically.
+ *
+ * Ranges may overlap and are applied in order. The complete
+ * blob is sent instead if the sparse encoding would not be
+ * smaller or if the minor protocol version of the blob is
+ * less than FCOM_PROTO_MIN_2 (older receivers reject sparse
+ * updates). FCOM_EL_PACKED is ignored.
+ *
+ * RETURNS: zero on success, nonzero on error (FCOM_ERR_INVALID_COUNT
+ *          if a range is empty or exceeds the element count).
+ *
+ * NOTE:    Blobs of the same ID which are held for coalescing
+ *          are flushed first so that the update is not overtaken
+ *          by older data.
+ */
+typedef struct FcomRange {
+	uint16_t start;   /* index of the first element */
+	uint16_t count;   /* number of elements         */
+} FcomRange;
+
+int
+fcomPutBlobSparse(FcomBlobRef p_blob, const FcomRange ranges[], unsigned n_ranges);
+
+/** PREPARED TRANSMISSION ********************************************/
+
+/*
+ * Producers which periodically send the same IDs with
+ * the same types and element counts may 'prepare' a
+ * group (or a single blob) once. Preparing encodes the
+ * message and keeps it; every subsequent fcomPutPrepared()
+ * only re-encodes timestamp, status and payload and sends
+ * the message. No memory is allocated on that path.
+ */
+typedef struct FcomPreparedRec_ *FcomPrepared;
+
+/*
+ * Prepare a group consisting of 'n_blobs' blobs (or a single
+ * blob if 'n_blobs' == 1). All blobs must belong to the same
+ * group (GID) and the encoded message must fit into a single
+ * udpComm packet (UDPCOMM_PKTSZ); it is never fragmented.
+ * fcomPutPrepared() fails (FCOM_ERR_NO_SPACE) if the message
+ * exceeds a smaller datagram size set by fcomSetTxMsgSize().
+ *
+ * The FCOM library keeps the pointers p_blobs[i] (but not the
+ * array itself) and reads the blobs on every fcomPutPrepared().
+ * Hence, the blobs (and the data they reference) must remain
+ * valid until fcomFreePrepared() is called.
+ *
+ * The application may modify the timestamp, status and the
+ * payload data of the blobs between transmissions but NOT
+ * the ID, type, element count or data pointer.
+ *
+ * RETURNS: zero on success, nonzero on error (FCOM_ERR_NO_SPACE
+ *          if the message does not fit into a single packet).
+ *          The prepared object is returned in *p_prep.
+ */
+int
+fcomPrepareGroup(FcomBlobRef p_blobs[], unsigned n_blobs, FcomPrepared *p_prep);
+
+/*
+ * Prepare a single blob (convenience wrapper).
+ */
+int
+fcomPrepareBlob(FcomBlobRef p_blob, FcomPrepared *p_prep);
+
+/*
+ * Update and send a prepared group.
+ *
+ * RETURNS: zero on success, nonzero on error. FCOM_ERR_INVALID_ARG
+ *          is returned (and nothing is sent) if the ID, type or
+ *          element count of any blob was changed after preparing,
+ *          FCOM_ERR_ID_IN_USE if the prepared group is currently
+ *          queued for asynchronous transmission (fcomPutPreparedAsync()).
+ *
+ * NOTE:    Unlike fcomPutGroup() this does NOT consume the
+ *          prepared object. A prepared object must not be used
+ *          by multiple threads simultaneously.
+ */
+int
+fcomPutPrepared(FcomPrepared prep);
+
+/*
+ * Release a prepared object.
+ */
+void
+fcomFreePrepared(FcomPrepared prep);
+
+/** ASYNCHRONOUS TRANSMISSION ****************************************/
+
+/*
+ * Time-critical producers may hand blobs or prepared groups
+ * to a dedicated TX thread instead of encoding and sending
+ * them in their own context. Submission only copies data into
+ * a lock-free queue (safe for multiple producer threads) and
+ * wakes up the TX thread.
+ *
+ * Enable asynchronous transmission by creating the TX thread
+ * and a queue with (at least) 'queue_depth' slots. Passing a
+ * depth of zero stops the TX thread after it has sent all
+ * pending submissions.
+ *
+ * RETURNS: zero on success, nonzero on error (FCOM_ERR_UNSUPP if
+ *          this feature was not compiled).
+ *
+ * NOTE:    This routine is NOT thread-safe; it must not execute
+ *          while other threads submit asynchronously.
+ *          The TX thread inherits the scheduling attributes of
+ *          the thread calling this routine.
+ */
+int
+fcomSetTxAsync(unsigned queue_depth);
+
+/*
+ * Submit a blob for asynchronous transmission. The blob
+ * header and payload are copied; the caller may reuse the
+ * blob as soon as this routine returns.
+ *
+ * RETURNS: zero on success, FCOM_ERR_NO_SPACE if the queue
+ *          is full (the blob is dropped and counted in the
+ *          statistics) or another error status.
+ *
+ * NOTE:    Errors which occur while the TX thread encodes
+ *          or sends are only recorded in the statistics.
+ */
+int
+fcomPutBlobAsync(FcomBlobRef p_blob);
+
+/*
+ * Submit a prepared group for asynchronous transmission.
+ * Only a reference is queued; the TX thread reads the
+ * blobs of the prepared group when it sends it. Hence
+ * the application should not modify these blobs while
+ * the submission is in flight (see below).
+ *
+ * RETURNS: zero on success, FCOM_ERR_ID_IN_USE if the same
+ *          prepared group is still in flight, FCOM_ERR_NO_SPACE
+ *          if the queue is full or another error status.
+ */
+int
+fcomPutPreparedAsync(FcomPrepared prep);
+
+/*
+ * Check if a prepared group is still queued for
+ * asynchronous transmission.
+ *
+ * RETURNS: nonzero if still in flight, zero otherwise.
+ */
+int
+fcomPreparedInFlight(FcomPrepared prep);
+
+/** COALESCING *******************************************************/
+
+/*
+ * Producers which send many individual blobs with IDs that
+ * share a GID may let FCOM pack these blobs into a single
+ * message per GID. This reduces the packet rate on the sender
+ * and on every receiver.
+ *
+ * When coalescing is enabled, fcomPutBlob() (and blobs submitted
+ * with fcomPutBlobAsync()) are appended to an 'open' message for
+ * their GID. An open message is sent
+ *  - when the next blob for the same GID does not fit into
+ *    'max_bytes' (which is clipped to the max. message size),
+ *  - when it is older than 'max_usecs' microseconds (zero
+ *    disables this check); a timer thread sends expired
+ *    messages so that this bounds the latency added by
+ *    coalescing. Without pthreads there is no timer thread
+ *    and the window is only checked when a blob is put,
+ *  - by fcomFlush(),
+ *  - by the TX thread when it finds its queue empty (if
+ *    asynchronous transmission is enabled),
+ *  - before any other message for the same GID (a group, a
+ *    prepared group, a sparse update etc.) is sent so that
+ *    receivers never see an older value after a newer one.
+ *
+ * Hence, an application should call fcomFlush() once it has
+ * published everything for a cycle (unless asynchronous
+ * transmission is used); otherwise the last blobs remain
+ * in an open message until the time window expires (or,
+ * if 'max_usecs' is zero or there is no timer thread,
+ * until more blobs are put).
+ *
+ * Passing 'max_bytes' == 0 flushes all open messages and
+ * disables coalescing (the default).
+ *
+ * RETURNS: zero on success, nonzero on error.
+ *
+ * NOTE:    This routine is NOT thread-safe; it must not execute
+ *          while other threads put blobs. Putting and flushing
+ *          however may be done by multiple threads.
+ *          Errors which occur while sending an open message
+ *          are only recorded in the statistics unless they
+ *          happen in fcomFlush().
+ */
+int
+fcomSetTxCoalesce(unsigned max_bytes, unsigned max_usecs);
+
+/*
+ * Send all open (coalescing) messages.
+ *
+ * RETURNS: zero on success or the status of the first failure.
+ */
+int
+fcomFlush(void);
+
+/** LARGE BLOBS ******************************************************/
+
+/*
+ * A blob which does not fit into a single packet is
+ * transparently sent by fcomPutBlob() as a sequence of
+ * fragments which the receivers reassemble. Such blobs
+ * may hold up to 65535 elements (of any type).
+ *
+ * Fragmented messages cannot be decoded by old receivers
+ * (which count them as messages with a bad version).
+ *
+ * Receivers collect the fragments in a buffer and then
+ * decode into a second one; both come from pools of large
+ * buffers which are NOT populated by fcomInit(). An
+ * application subscribing to large blobs must add
+ * buffers (at least two per large blob that may be
+ * received at the same time plus one for every blob
+ * the application holds on to with fcomGetBlob()).
+ * Reassemblies which do not complete within a short
+ * time (lost fragments) are dropped.
+ *
+ * Add 'n_bufs' receive buffers which can hold blobs with
+ * (at most) 'blob_size' bytes of payload.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ *
+ * NOTE:    Blobs submitted with fcomPutBlobAsync() are
+ *          still limited to a single packet.
+ */
+int
+fcomAddRxBufs(uint32_t blob_size, unsigned n_bufs);
+
+/*
+ * Max. size of a message (group) in bytes; messages
+ * exceeding the datagram size are fragmented.
+ */
+#define FCOM_MSG_SIZE_MAX 65504
+
+/*
+ * Min. datagram size (fcomSetTxMsgSize())
+ */
+#define FCOM_MSG_SIZE_MIN 512
+
+/*
+ * Set the max. size of the datagrams sent by
+ * this node (default: the size of a udpComm
+ * packet, UDPCOMM_PKTSZ).
+ *
+ * Receivers read every datagram into a udpComm
+ * packet; anything beyond UDPCOMM_PKTSZ is lost.
+ * Hence, 'bytes' must be in the range of
+ * FCOM_MSG_SIZE_MIN and UDPCOMM_PKTSZ; it is
+ * rounded down to a multiple of four. Jumbo
+ * frames require udpComm to be built with a
+ * larger UDPCOMM_PKTSZ on all nodes; a smaller
+ * size lets such a node talk to receivers using
+ * standard frames.
+ *
+ * This should be called during initialization;
+ * groups already allocated retain their size.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomSetTxMsgSize(unsigned bytes);
+
+/*
+ * Enable (on != 0) or disable the 'compact'
+ * encoding of groups allocated by this node
+ * (including messages built by coalescing).
+ * A compact message carries timestamp, status
+ * and type only once (in the message header);
+ * blobs which differ from these defaults still
+ * carry their own values. Groups of many small
+ * blobs sharing a timestamp shrink substantially.
+ *
+ * Individually sent blobs and prepared groups
+ * (fcomPrepareGroup()) always use the standard
+ * encoding.
+ *
+ * NOTE: Receivers built before compact messages
+ *       were supported reject them (bad version);
+ *       only enable this once all receivers have
+ *       been upgraded.
+ *
+ * This should be called during initialization;
+ * groups already allocated retain their encoding.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomSetTxCompact(int on);
+
 
 /** SUBSCRIPTION *****************************************************/
 
@@ -586,6 +991,301 @@ fcomGetBlobSet(
 );
 
 
+/** RX THREAD SCHEDULING *********************************************/
+
+/*
+ * Scheduling policies for the FCOM receiver thread.
+ */
+#define FCOM_SCHED_OTHER   0
+#define FCOM_SCHED_FIFO    1
+#define FCOM_SCHED_RR      2
+
+/*
+ * Set scheduling policy and priority of the FCOM receiver
+ * thread. The priority is given in percent of the range
+ * supported by 'policy' (0: lowest, 100: highest).
+ *
+ * If this routine is called before fcomInit() then the
+ * settings are used when the receiver thread is created
+ * (the default is FCOM_SCHED_FIFO at 80%). Otherwise, the
+ * running receiver thread is reconfigured.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ *          FCOM_ERR_UNSUPP is returned if the threading
+ *          API FCOM was built with does not support
+ *          the requested operation.
+ *
+ * NOTE:    If the receiver thread is created without
+ *          privilege to use a real-time policy then FCOM
+ *          falls back to the inherited policy (a warning
+ *          is printed). A run-time change to a real-time
+ *          policy without privilege fails, however.
+ *          fcomDumpStats() reports the effective settings.
+ */
+int
+fcomSetRxSched(int policy, int prio_pcnt);
+
+/*
+ * Restrict the FCOM receiver thread to a set of CPUs.
+ * The set is passed as a string listing CPU numbers
+ * and ranges, e.g., "0-3,6". A NULL or empty string
+ * removes any restriction (i.e., all CPUs).
+ *
+ * Like fcomSetRxSched() this may be called before
+ * fcomInit() or at run-time.
+ *
+ * RETURNS: zero on success, nonzero on error
+ *          (FCOM_ERR_INVALID_ARG if the list cannot be parsed,
+ *          FCOM_ERR_UNSUPP if CPU affinity is not supported
+ *          on this system).
+ */
+int
+fcomSetRxAffinity(const char *cpu_list);
+
+/*
+ * Senders number the messages of every GID (the sequence
+ * number is stored in the 'res3' field of the first blob
+ * of a message). Receivers track the numbers per sender and
+ * GID and count missing, duplicate and late messages in the
+ * statistics.
+ *
+ * If 'on' is nonzero then duplicate and late messages are
+ * dropped, i.e., older data never replace newer data
+ * (e.g., in the presence of multiple network paths).
+ * Dropping is disabled by default.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ *
+ * NOTE:    Messages from senders which do not number their
+ *          messages (older FCOM versions) are never dropped.
+ *          A message which is more than 31 behind the newest
+ *          one from its sender is taken as a sign that the
+ *          sender restarted (with the same address and port);
+ *          tracking then starts over from this message. If a
+ *          sender restarts after fewer messages then its first
+ *          new ones look like duplicates and are dropped.
+ */
+int
+fcomSetRxDropStale(int on);
+
+/*
+ * Latency statistics. If enabled then the time a message
+ * arrives is recorded with every blob and two latencies
+ * are accumulated in (log-scale) histograms:
+ *
+ *  'net':  arrival time minus the blob timestamp (fc_tsHi:
+ *          seconds past the EPICS epoch (1990), fc_tsLo:
+ *          nanoseconds), i.e., the age of the data when
+ *          they arrive. Blobs with a zero timestamp are
+ *          ignored. Sender and receiver clocks must be
+ *          synchronized; negative latencies are counted
+ *          separately.
+ *  'app':  time of fcomGetBlob() minus the arrival time,
+ *          i.e., how long data wait for consumers.
+ *
+ * Histograms are kept for all blobs (FCOM_STAT_RX_LAT_xxx
+ * statistics keys) and for every ID subscribed while latency
+ * statistics are enabled (fcomGetIDLatency(), fcomDumpIDStats()).
+ *
+ * Latency statistics are disabled by default.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomSetRxLatencyStats(int on);
+
+#define FCOM_LAT_BINS 24
+
+/* A latency histogram; bin[0] counts latencies < 1us,
+ * bin[i] those in [2^(i-1), 2^i) us and the last bin
+ * all larger ones.
+ */
+typedef struct FcomLatHist {
+	uint32_t count;              /* # of (non-negative) samples */
+	uint32_t neg;                /* # of negative samples       */
+	uint32_t max_us;             /* largest sample              */
+	uint64_t sum_us;             /* sum of all samples          */
+	uint32_t bin[FCOM_LAT_BINS];
+} FcomLatHist;
+
+/*
+ * Obtain the latency histograms of a subscribed ID.
+ * Either pointer may be NULL.
+ *
+ * RETURNS: zero on success, FCOM_ERR_NOT_SUBSCRIBED if 'idnt'
+ *          is not subscribed or FCOM_ERR_NO_DATA if no
+ *          histograms are kept for 'idnt' (it was subscribed
+ *          while latency statistics were disabled).
+ */
+int
+fcomGetIDLatency(FcomID idnt, FcomLatHist *p_net, FcomLatHist *p_app);
+
+/* Update rate and inter-arrival statistics of an ID */
+typedef struct FcomIDRate {
+	uint32_t updates;    /* # of updates received                  */
+	uint32_t intervals;  /* # of inter-arrival times measured      */
+	double   rate_hz;    /* recent update rate (0 if unknown)      */
+	double   mean_us;    /* mean inter-arrival time                */
+	double   stddev_us;  /* jitter (std. deviation) of the same    */
+	uint32_t max_us;     /* longest inter-arrival time             */
+	uint64_t age_us;     /* time since the last update (0: none)   */
+} FcomIDRate;
+
+/*
+ * Obtain the update rate and inter-arrival statistics of a
+ * subscribed ID. The statistics are always kept. Arrival is
+ * the time the RX thread receives the message (not the blob
+ * timestamp). Mean, standard deviation and max. cover all
+ * updates since the ID was subscribed; 'rate_hz' is derived
+ * from a moving average over roughly the last 8 updates and
+ * follows changes of the producer's rate.
+ *
+ * RETURNS: zero on success, FCOM_ERR_NOT_SUBSCRIBED if 'idnt'
+ *          is not subscribed.
+ */
+int
+fcomGetIDRate(FcomID idnt, FcomIDRate *p_rate);
+
+/* State and allocation statistics of a RX buffer pool */
+typedef struct FcomBufPoolStats {
+	uint32_t size;        /* buffer size (bytes, incl. header)      */
+	uint32_t tot;         /* buffers in the pool                    */
+	uint32_t avail;       /* buffers currently available            */
+	uint32_t max_used;    /* high-water mark of buffers in use; the
+	                       * low-water mark of 'avail' is
+	                       * 'tot - max_used'
+	                       */
+	uint64_t n_alloc;     /* buffers allocated from this pool       */
+	uint64_t n_fallback;  /* requests for this size which were
+	                       * served by a larger pool (this one
+	                       * was empty)
+	                       */
+	uint64_t n_fail;      /* requests for this size which failed
+	                       * (this and all larger pools empty)
+	                       */
+} FcomBufPoolStats;
+
+/*
+ * Obtain the statistics of (at most 'n') RX buffer pools,
+ * smallest buffer size first. Requests are attributed to
+ * the smallest pool with buffers large enough.
+ *
+ * RETURNS: total number of pools (may be more than 'n') or
+ *          a (negative) error status.
+ */
+int
+fcomGetRxBufStats(FcomBufPoolStats *p_pools, unsigned n);
+
+/*
+ * Obtain a histogram of the time consumers hold on to blobs,
+ * i.e., from fcomGetBlob() to fcomReleaseBlob(). If several
+ * references to a blob are held at the same time then every
+ * release is timed from the earliest of the corresponding
+ * fcomGetBlob() calls. The ID of the blob held for the longest
+ * time ('max_us') is stored in '*p_max_idnt' (unless NULL);
+ * this helps to identify a slow consumer which starves the
+ * buffer pools.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomGetRxHoldTime(FcomLatHist *p_hist, FcomID *p_max_idnt);
+
+/*
+ * Lock statistics. FCOM uses two mutexes on the receiving side:
+ *
+ *  'tbl':  protects the buffer table and pools; it is taken by
+ *          the RX thread for every blob received, by fcomGetBlob(),
+ *          fcomReleaseBlob(), blob sets and (un)subscription.
+ *          Synchronous gets and blob sets wait on condition
+ *          variables associated with this mutex.
+ *  'grp':  serializes fcomSubscribe()/fcomUnsubscribe().
+ *
+ * If lock statistics are enabled then every acquisition is
+ * counted; if the mutex is busy the acquisition is counted as
+ * contended and the time spent waiting for the mutex is recorded.
+ * The time the mutex is held is recorded on every release (a
+ * condition-variable wait ends one hold period and the wake-up
+ * begins a new one). In addition, the total time the RX thread
+ * holds the 'tbl' mutex while processing one message is
+ * recorded (one sample per message).
+ *
+ * Lock statistics are disabled by default; the overhead is
+ * negligible then. Enabling clears the accumulated data.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomSetLockStats(int on);
+
+typedef struct FcomLockStats {
+	uint64_t    n_acq;    /* # of acquisitions                  */
+	uint64_t    n_cont;   /* # of acquisitions which found the
+	                       * mutex busy
+	                       */
+	FcomLatHist wait;     /* time spent waiting (contended
+	                       * acquisitions only)
+	                       */
+	FcomLatHist hold;     /* time the mutex was held            */
+} FcomLockStats;
+
+/*
+ * Obtain the lock statistics (see fcomSetLockStats()) of the
+ * 'tbl' and 'grp' mutexes and the histogram of the time the RX
+ * thread holds 'tbl' per message. Any pointer may be NULL.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomGetLockStats(FcomLockStats *p_tbl, FcomLockStats *p_grp, FcomLatHist *p_rx_msg);
+
+/*
+ * Enable (on != 0) or disable the stage profiler. The RX
+ * and TX paths are divided into stages; when profiling is
+ * enabled the time spent in every stage is measured (with
+ * the monotonic clock) and min/avg/max and percentiles are
+ * kept (FCOM_STAT_RX_PROF_xxx, FCOM_STAT_TX_PROF_xxx keys,
+ * fcomDumpProfile()). Enabling clears the accumulated data.
+ *
+ * RX stages (RX thread):
+ *
+ *  RECV:    packet handed over by udpComm (reassembly of
+ *           fragments) until the message header is decoded.
+ *  PEEK:    sequence number check and extraction of the ID
+ *           and size of a blob.
+ *  LOOKUP:  hash table lookup and buffer allocation.
+ *  DECODE:  XDR decoding of a blob.
+ *  PUBLISH: replacing the old data, waking up synchronous
+ *           readers and blob sets.
+ *  WAKE:    the wake-up part of PUBLISH alone.
+ *
+ * TX stages (fcomPutBlob(), fcomPutGroup()):
+ *
+ *  ENCODE:  buffer allocation and XDR encoding (completing
+ *           the message in case of fcomPutGroup()).
+ *  SEND:    handing the message to udpComm.
+ *
+ * Profiling is disabled by default; the overhead is negligible
+ * then.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomSetProfiling(int on);
+
+#define FCOM_PROF_RX_RECV     0
+#define FCOM_PROF_RX_PEEK     1
+#define FCOM_PROF_RX_LOOKUP   2
+#define FCOM_PROF_RX_DECODE   3
+#define FCOM_PROF_RX_PUBLISH  4
+#define FCOM_PROF_RX_WAKE     5
+#define FCOM_PROF_RX_STAGES   6
+
+#define FCOM_PROF_TX_ENCODE   0
+#define FCOM_PROF_TX_SEND     1
+#define FCOM_PROF_TX_STAGES   2
+
+
 /** STATISTICS *******************************************************/
 
 /*
@@ -598,13 +1298,23 @@ fcomDumpStats(FILE *f);
 /*
  * Dump statistics and data associated with a ID to 'f' (stdout if
  * NULL). If 'level' is nonzero then more verbose information is
- * printed (including payload data).
+ * printed (including payload data). The update rate and inter-
+ * arrival statistics (see fcomGetIDRate()) are included as well as
+ * latency histograms (see fcomSetRxLatencyStats()) if they are
+ * kept for 'idnt'.
  *
  * RETURNS: Number of characters printed or (negative) error status.
  */
 int
 fcomDumpIDStats(FcomID idnt, int level, FILE *f);
 
+/*
+ * Dump the stage profiles (see fcomSetProfiling()) to
+ * 'f' (stdout if NULL).
+ */
+void
+fcomDumpProfile(FILE *f);
+
 /*
  * Like fcomDumpIDStats but dump info about a given blob.
  */
@@ -614,23 +1324,119 @@ fcomDumpBlob(FcomBlobRef blob, int level, FILE *f);
 /*
  * Obtain statistics information.
  * 
- * Note that most if not all counters are internally only 32-bits.
- * The 64-bit exchange data type is used for future enhancements.
+ * All event counters are 64-bits wide (FCOM_STAT_IS_64()); some
+ * other quantities (sizes, high-water marks, per-GID counters)
+ * are 32-bits.
  *
  * RETURNS: 0 on success, FCOM_ERR_UNSUPP when asking for an
  *          unknown key.
  *
- * NOTE:    There might be no locking implemented, i.e., values
- *          belonging to two different keys might be inconsistent;
- *          it is assumed that 32-bit quantities can be accessed
- *          atomically by the CPU provided that they are properly
- *          aligned.
+ * NOTE:    Every value is read consistently (never 'torn') but
+ *          values belonging to two different keys might be
+ *          inconsistent. Use fcomGetStatsSnapshot() to obtain
+ *          a consistent copy of all counters.
  *          This facility is intended for informational/diagnostic
  *          purposes only.
  */
 int
 fcomGetStats(int n_keys, uint32_t key_arr[], uint64_t value_arr[]);
 
+/* RX event counters (see the corresponding FCOM_STAT_RX_xxx
+ * keys for their meaning). New members are only ever
+ * appended.
+ */
+typedef struct FcomRxStats {
+	uint64_t bad_msg_version;  /* FCOM_STAT_RX_ERR_BAD_MVERS   */
+	uint64_t bad_blb_version;  /* FCOM_STAT_RX_ERR_BAD_BVERS   */
+	uint64_t no_bufs;          /* FCOM_STAT_RX_ERR_NOBUF       */
+	uint64_t dec_errs;         /* FCOM_STAT_RX_ERR_XDRDEC      */
+	uint64_t n_msg;            /* FCOM_STAT_RX_NUM_MESGS_RECV  */
+	uint64_t n_blb;            /* FCOM_STAT_RX_NUM_BLOBS_RECV  */
+	uint64_t bad_cond_bcst;    /* FCOM_STAT_RX_ERR_BAD_BCST    */
+	uint64_t n_frag;           /* FCOM_STAT_RX_NUM_FRAGS       */
+	uint64_t n_reasm;          /* FCOM_STAT_RX_NUM_REASM       */
+	uint64_t reasm_tmo;        /* FCOM_STAT_RX_ERR_REASM_TMO   */
+	uint64_t reasm_err;        /* FCOM_STAT_RX_ERR_FRAG        */
+	uint64_t n_pack;           /* FCOM_STAT_RX_NUM_PACKED      */
+	uint64_t pack_raw_words;   /* FCOM_STAT_RX_PACK_RAW_WORDS  */
+	uint64_t pack_words;       /* FCOM_STAT_RX_PACK_WORDS      */
+	uint64_t n_sparse;         /* FCOM_STAT_RX_NUM_SPARSE      */
+	uint64_t sparse_miss;      /* FCOM_STAT_RX_ERR_SPARSE      */
+	uint64_t seq_gaps;         /* FCOM_STAT_RX_ERR_SEQ_GAPS    */
+	uint64_t seq_dups;         /* FCOM_STAT_RX_ERR_SEQ_DUPS    */
+	uint64_t seq_reord;        /* FCOM_STAT_RX_ERR_SEQ_REORD   */
+	uint64_t seq_stale;        /* FCOM_STAT_RX_NUM_SEQ_STALE   */
+	uint64_t rec_drop;         /* FCOM_STAT_RX_ERR_REC_DROP    */
+} FcomRxStats;
+
+/* TX event counters and high-water marks */
+typedef struct FcomTxStats {
+	uint64_t n_msg;            /* FCOM_STAT_TX_NUM_MESGS_SENT      */
+	uint64_t n_blb;            /* FCOM_STAT_TX_NUM_BLOBS_SENT      */
+	uint64_t n_snderr;         /* FCOM_STAT_TX_ERR_SEND            */
+	uint64_t n_batch;          /* FCOM_STAT_TX_NUM_BATCHES         */
+	uint64_t n_batch_msg;      /* FCOM_STAT_TX_NUM_BATCH_MESGS     */
+	uint64_t n_batch_sysc;     /* FCOM_STAT_TX_NUM_BATCH_SYSCALLS  */
+	uint64_t max_batch;        /* FCOM_STAT_TX_MAX_BATCH           */
+	uint64_t n_async;          /* FCOM_STAT_TX_NUM_ASYNC           */
+	uint64_t n_async_drop;     /* FCOM_STAT_TX_ERR_ASYNC_DROP      */
+	uint64_t n_async_err;      /* FCOM_STAT_TX_ERR_ASYNC           */
+	uint64_t max_qdepth;       /* FCOM_STAT_TX_ASYNC_QDEPTH_MAX    */
+	uint64_t n_coal;           /* FCOM_STAT_TX_NUM_COALESCED       */
+	uint64_t n_coal_msg;       /* FCOM_STAT_TX_NUM_COALESCED_MESGS */
+	uint64_t n_coal_tmo;       /* FCOM_STAT_TX_NUM_COALESCE_TMO    */
+	uint64_t n_frag_msg;       /* FCOM_STAT_TX_NUM_FRAG_MESGS      */
+	uint64_t n_frag;           /* FCOM_STAT_TX_NUM_FRAGS           */
+	uint64_t n_sparse;         /* FCOM_STAT_TX_NUM_SPARSE          */
+	uint64_t n_sparse_full;    /* FCOM_STAT_TX_NUM_SPARSE_FULL     */
+	/* process-wide */
+	uint64_t n_packed;         /* FCOM_STAT_TX_NUM_PACKED          */
+	uint64_t n_pack_raw;       /* FCOM_STAT_TX_NUM_PACK_RAW        */
+	uint64_t pack_raw_words;   /* FCOM_STAT_TX_PACK_RAW_WORDS      */
+	uint64_t pack_words;       /* FCOM_STAT_TX_PACK_WORDS          */
+} FcomTxStats;
+
+/*
+ * Obtain a copy of all RX and/or TX counters in a single
+ * operation (cheap enough for high-frequency monitoring).
+ * Either pointer may be NULL; the part of a context which
+ * is not enabled (e.g., RX in a sender-only application)
+ * is returned as all zeros.
+ *
+ * The RX counters are consistent with each other (they
+ * are all taken at the same instant). The TX counters are
+ * updated by all sending threads; each one is read
+ * atomically but operations in progress may be partially
+ * accounted for.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomGetStatsSnapshot(FcomRxStats *p_rx, FcomTxStats *p_tx);
+
+/*
+ * Publish all statistics (RX/TX counters, buffer pools and
+ * the update rates of up to 'max_ids' subscribed IDs) in the
+ * POSIX shared-memory segment 'name' (FCOM_SHM_NAME_DFLT if
+ * NULL) every 'period_ms' milliseconds. The layout of the
+ * segment is defined in <fcom_shm.h>; external monitors (e.g.,
+ * the 'fcomstat' utility) read it without any interaction
+ * with the publishing process.
+ *
+ * Updates are performed by a (low-priority) thread. Every
+ * update holds the RX lock once for the time needed to
+ * collect the per-ID data, i.e., 'max_ids' should be kept
+ * reasonably small.
+ *
+ * Calling fcomShmPublish() again replaces the segment;
+ * a 'period_ms' of zero stops publishing and removes it.
+ *
+ * RETURNS: zero on success, nonzero on error (FCOM_ERR_UNSUPP
+ *          if POSIX shared memory is not available).
+ */
+int
+fcomShmPublish(const char *name, unsigned period_ms, unsigned max_ids);
+
 /* Test if a given key gives 32 or 64-bit values           */
 #define FCOM_STAT_IS_32(key)   (0 == ((key) & (4<<24)))
 #define FCOM_STAT_IS_64(key)   (0 != ((key) & (4<<24)))
@@ -644,23 +1450,25 @@ fcomGetStats(int n_keys, uint32_t key_arr[], uint64_t value_arr[]);
 
 #define FCOM_RX_32_STAT(n) ((FCOM_PROTO_MAJ_1<<28)|(1<<24)|((n)<<16))
 #define FCOM_TX_32_STAT(n) ((FCOM_PROTO_MAJ_1<<28)|(2<<24)|((n)<<16))
+#define FCOM_RX_64_STAT(n) (FCOM_RX_32_STAT(n)|(4<<24))
+#define FCOM_TX_64_STAT(n) (FCOM_TX_32_STAT(n)|(4<<24))
 
 /* Keys for RX statistics         */
 
 /* Number of blobs received                                */
-#define FCOM_STAT_RX_NUM_BLOBS_RECV       FCOM_RX_32_STAT(1)
+#define FCOM_STAT_RX_NUM_BLOBS_RECV       FCOM_RX_64_STAT(1)
 /* Number of messages/groups received                      */
-#define FCOM_STAT_RX_NUM_MESGS_RECV       FCOM_RX_32_STAT(2)
+#define FCOM_STAT_RX_NUM_MESGS_RECV       FCOM_RX_64_STAT(2)
 /* Failed attempts to allocate buffer (lack of buffers)    */
-#define FCOM_STAT_RX_ERR_NOBUF            FCOM_RX_32_STAT(3)
+#define FCOM_STAT_RX_ERR_NOBUF            FCOM_RX_64_STAT(3)
 /* XDR decoder errors                                      */
-#define FCOM_STAT_RX_ERR_XDRDEC           FCOM_RX_32_STAT(4)
+#define FCOM_STAT_RX_ERR_XDRDEC           FCOM_RX_64_STAT(4)
 /* Number of blobs with bad/unknown version received       */
-#define FCOM_STAT_RX_ERR_BAD_BVERS        FCOM_RX_32_STAT(5)
+#define FCOM_STAT_RX_ERR_BAD_BVERS        FCOM_RX_64_STAT(5)
 /* Number of msgs/groups with bad/unknown version received */
-#define FCOM_STAT_RX_ERR_BAD_MVERS        FCOM_RX_32_STAT(6)
+#define FCOM_STAT_RX_ERR_BAD_MVERS        FCOM_RX_64_STAT(6)
 /* Number of failed synchronous or set member broadcasts   */
-#define FCOM_STAT_RX_ERR_BAD_BCST         FCOM_RX_32_STAT(7)
+#define FCOM_STAT_RX_ERR_BAD_BCST         FCOM_RX_64_STAT(7)
 /* Number of subscribed blobs                              */
 #define FCOM_STAT_RX_NUM_BLOBS_SUBS       FCOM_RX_32_STAT(8)
 /* Max. supported number of subscribed blobs               */
@@ -679,16 +1487,422 @@ fcomGetStats(int n_keys, uint32_t key_arr[], uint64_t value_arr[]);
 /* Guaranteed alignment of payload of a buffer kind        */
 #define FCOM_STAT_RX_BUF_ALIGNED(kind)    (FCOM_RX_32_STAT(14) | FCOM_STAT_KIND(kind))
 
+/* Keys for RX reassembly statistics */
+
+/* Number of fragments received                            */
+#define FCOM_STAT_RX_NUM_FRAGS            FCOM_RX_64_STAT(15)
+/* Number of messages reassembled from fragments           */
+#define FCOM_STAT_RX_NUM_REASM            FCOM_RX_64_STAT(16)
+/* Number of incomplete reassemblies which were dropped    */
+#define FCOM_STAT_RX_ERR_REASM_TMO        FCOM_RX_64_STAT(17)
+/* Number of inconsistent or malformed fragments           */
+#define FCOM_STAT_RX_ERR_FRAG             FCOM_RX_64_STAT(18)
+
+/* Keys for RX packing statistics (FCOM_EL_PACKED) */
+
+/* Number of packed blobs decoded                          */
+#define FCOM_STAT_RX_NUM_PACKED           FCOM_RX_64_STAT(19)
+/* Payload size (32-bit words) of these blobs when raw     */
+#define FCOM_STAT_RX_PACK_RAW_WORDS       FCOM_RX_64_STAT(20)
+/* Payload size (32-bit words) of these blobs as received  */
+#define FCOM_STAT_RX_PACK_WORDS           FCOM_RX_64_STAT(21)
+
+/* Keys for RX statistics of sparse updates                */
+
+/* Number of sparse updates applied                        */
+#define FCOM_STAT_RX_NUM_SPARSE           FCOM_RX_64_STAT(22)
+/* Number of sparse updates dropped (no matching blob or   */
+/* messages lost since it arrived)                         */
+#define FCOM_STAT_RX_ERR_SPARSE           FCOM_RX_64_STAT(23)
+
+/* Keys for RX statistics of message sequence numbers; a
+ * message which arrives late was counted as missing before.
+ */
+
+/* Number of messages missing in sequence (counted when
+ * the gap is seen; a message arriving late to fill it is
+ * counted as out of order).
+ */
+#define FCOM_STAT_RX_ERR_SEQ_GAPS         FCOM_RX_64_STAT(24)
+/* Number of duplicate messages                            */
+#define FCOM_STAT_RX_ERR_SEQ_DUPS         FCOM_RX_64_STAT(25)
+/* Number of messages received out of order (late)         */
+#define FCOM_STAT_RX_ERR_SEQ_REORD        FCOM_RX_64_STAT(26)
+/* Number of duplicate/late messages dropped               */
+#define FCOM_STAT_RX_NUM_SEQ_STALE        FCOM_RX_64_STAT(27)
+/* The same for a single GID                               */
+#define FCOM_STAT_RX_GID_SEQ_GAPS(gid)    (FCOM_RX_32_STAT(28) | FCOM_STAT_KIND(gid))
+#define FCOM_STAT_RX_GID_SEQ_DUPS(gid)    (FCOM_RX_32_STAT(29) | FCOM_STAT_KIND(gid))
+#define FCOM_STAT_RX_GID_SEQ_REORD(gid)   (FCOM_RX_32_STAT(30) | FCOM_STAT_KIND(gid))
+#define FCOM_STAT_RX_GID_SEQ_STALE(gid)   (FCOM_RX_32_STAT(31) | FCOM_STAT_KIND(gid))
+
+/* Keys for RX latency statistics of all blobs (see
+ * fcomSetRxLatencyStats()); 'NET' is arrival time minus
+ * blob timestamp, 'APP' is fcomGetBlob() time minus
+ * arrival time.
+ */
+
+/* Number of (non-negative) samples                        */
+#define FCOM_STAT_RX_LAT_NET_NUM          FCOM_RX_32_STAT(32)
+/* Number of negative samples (clocks not synchronized)    */
+#define FCOM_STAT_RX_LAT_NET_NEG          FCOM_RX_32_STAT(33)
+/* Largest sample (us)                                     */
+#define FCOM_STAT_RX_LAT_NET_MAX_US       FCOM_RX_32_STAT(34)
+/* Sum of all samples (us)                                 */
+#define FCOM_STAT_RX_LAT_NET_SUM_US       FCOM_RX_64_STAT(35)
+/* Histogram bin 'bin' (0..FCOM_LAT_BINS-1)                */
+#define FCOM_STAT_RX_LAT_NET_HIST(bin)    (FCOM_RX_32_STAT(36) | FCOM_STAT_KIND(bin))
+/* The same for the 'APP' latency                          */
+#define FCOM_STAT_RX_LAT_APP_NUM          FCOM_RX_32_STAT(37)
+#define FCOM_STAT_RX_LAT_APP_NEG          FCOM_RX_32_STAT(38)
+#define FCOM_STAT_RX_LAT_APP_MAX_US       FCOM_RX_32_STAT(39)
+#define FCOM_STAT_RX_LAT_APP_SUM_US       FCOM_RX_64_STAT(40)
+#define FCOM_STAT_RX_LAT_APP_HIST(bin)    (FCOM_RX_32_STAT(41) | FCOM_STAT_KIND(bin))
+
+/* Keys for the RX stage profile (see fcomSetProfiling());
+ * 'stage' is one of FCOM_PROF_RX_xxx.
+ */
+
+/* Number of samples                                       */
+#define FCOM_STAT_RX_PROF_NUM(stage)      (FCOM_RX_32_STAT(42) | FCOM_STAT_KIND(stage))
+/* Shortest, average and longest time spent (ns)           */
+#define FCOM_STAT_RX_PROF_MIN_NS(stage)   (FCOM_RX_32_STAT(43) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_RX_PROF_AVG_NS(stage)   (FCOM_RX_32_STAT(44) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_RX_PROF_MAX_NS(stage)   (FCOM_RX_32_STAT(45) | FCOM_STAT_KIND(stage))
+/* Median and 99th percentile (ns; accurate to 12.5%)      */
+#define FCOM_STAT_RX_PROF_P50_NS(stage)   (FCOM_RX_32_STAT(46) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_RX_PROF_P99_NS(stage)   (FCOM_RX_32_STAT(47) | FCOM_STAT_KIND(stage))
+
+/* Number of messages not recorded (fcomRecordStart()) because
+ * the file could not be written fast enough
+ */
+#define FCOM_STAT_RX_ERR_REC_DROP         FCOM_RX_64_STAT(48)
+
 /* Keys for TX statistics         */
 
 /* Number of blobs sent                                    */
-#define FCOM_STAT_TX_NUM_BLOBS_SENT       FCOM_TX_32_STAT(1)
+#define FCOM_STAT_TX_NUM_BLOBS_SENT       FCOM_TX_64_STAT(1)
 /* Number of messages/groups sent                          */
-#define FCOM_STAT_TX_NUM_MESGS_SENT       FCOM_TX_32_STAT(2)
+#define FCOM_STAT_TX_NUM_MESGS_SENT       FCOM_TX_64_STAT(2)
 /* Number of failed attempts to send (TCP/IP stack errors) */
-#define FCOM_STAT_TX_ERR_SEND             FCOM_TX_32_STAT(3)
+#define FCOM_STAT_TX_ERR_SEND             FCOM_TX_64_STAT(3)
+/* Number of batches submitted with fcomPutGroups()        */
+#define FCOM_STAT_TX_NUM_BATCHES          FCOM_TX_64_STAT(4)
+/* Number of messages/groups sent as part of a batch       */
+#define FCOM_STAT_TX_NUM_BATCH_MESGS      FCOM_TX_64_STAT(5)
+/* Number of system calls used to send batches             */
+#define FCOM_STAT_TX_NUM_BATCH_SYSCALLS   FCOM_TX_64_STAT(6)
+/* Largest number of groups submitted in a single batch    */
+#define FCOM_STAT_TX_MAX_BATCH            FCOM_TX_64_STAT(7)
+/* Number of asynchronous submissions accepted              */
+#define FCOM_STAT_TX_NUM_ASYNC            FCOM_TX_64_STAT(8)
+/* Number of asynchronous submissions dropped (queue full)  */
+#define FCOM_STAT_TX_ERR_ASYNC_DROP       FCOM_TX_64_STAT(9)
+/* Number of asynchronous submissions the TX thread failed
+ * to encode or send
+ */
+#define FCOM_STAT_TX_ERR_ASYNC            FCOM_TX_64_STAT(10)
+/* Current number of queued asynchronous submissions        */
+#define FCOM_STAT_TX_ASYNC_QDEPTH         FCOM_TX_32_STAT(11)
+/* Max. number of queued asynchronous submissions           */
+#define FCOM_STAT_TX_ASYNC_QDEPTH_MAX     FCOM_TX_64_STAT(12)
+/* Number of blobs appended to coalescing messages          */
+#define FCOM_STAT_TX_NUM_COALESCED        FCOM_TX_64_STAT(13)
+/* Number of coalescing messages sent                       */
+#define FCOM_STAT_TX_NUM_COALESCED_MESGS  FCOM_TX_64_STAT(14)
+/* Number of coalescing messages sent due to the time window */
+#define FCOM_STAT_TX_NUM_COALESCE_TMO     FCOM_TX_64_STAT(15)
+/* Number of messages sent in fragments                     */
+#define FCOM_STAT_TX_NUM_FRAG_MESGS       FCOM_TX_64_STAT(16)
+/* Number of fragments sent (also counted as messages)      */
+#define FCOM_STAT_TX_NUM_FRAGS            FCOM_TX_64_STAT(17)
+
+/* Keys for TX packing statistics (FCOM_EL_PACKED); these
+ * are process-wide, i.e., shared by all contexts.
+ */
+
+/* Number of packed blobs encoded                           */
+#define FCOM_STAT_TX_NUM_PACKED           FCOM_TX_64_STAT(18)
+/* Number of blobs requesting packing which were sent raw   */
+#define FCOM_STAT_TX_NUM_PACK_RAW         FCOM_TX_64_STAT(19)
+/* Payload size (32-bit words) of the packed blobs when raw */
+#define FCOM_STAT_TX_PACK_RAW_WORDS       FCOM_TX_64_STAT(20)
+/* Payload size (32-bit words) of the packed blobs as sent  */
+#define FCOM_STAT_TX_PACK_WORDS           FCOM_TX_64_STAT(21)
+
+/* Number of sparse updates sent                            */
+#define FCOM_STAT_TX_NUM_SPARSE           FCOM_TX_64_STAT(22)
+/* Number of sparse updates sent as complete blobs          */
+#define FCOM_STAT_TX_NUM_SPARSE_FULL      FCOM_TX_64_STAT(23)
+
+/* Keys for the TX stage profile (see fcomSetProfiling());
+ * 'stage' is one of FCOM_PROF_TX_xxx. The same items as
+ * for FCOM_STAT_RX_PROF_xxx.
+ */
+#define FCOM_STAT_TX_PROF_NUM(stage)      (FCOM_TX_32_STAT(24) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_TX_PROF_MIN_NS(stage)   (FCOM_TX_32_STAT(25) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_TX_PROF_AVG_NS(stage)   (FCOM_TX_32_STAT(26) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_TX_PROF_MAX_NS(stage)   (FCOM_TX_32_STAT(27) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_TX_PROF_P50_NS(stage)   (FCOM_TX_32_STAT(28) | FCOM_STAT_KIND(stage))
+#define FCOM_STAT_TX_PROF_P99_NS(stage)   (FCOM_TX_32_STAT(29) | FCOM_STAT_KIND(stage))
+
+
+/** RECORDING AND REPLAY *********************************************/
+
+/*
+ * Record all messages received (i.e., of all GIDs this node
+ * subscribes to, whether or not the individual IDs are
+ * subscribed) in file 'path' (the layout is defined in
+ * <fcom_rec.h>). Every message is stored as received together
+ * with its arrival time and GID; fragmented messages are
+ * recorded once reassembled.
+ *
+ * The RX thread only queues the messages; the file is written
+ * by a separate thread. Messages arriving while the queue
+ * (a few MB) is full are not recorded and are counted in the
+ * statistics (FCOM_STAT_RX_ERR_REC_DROP). Recording is intended
+ * for diagnosis, not for continuous operation. A recording in
+ * progress is stopped first.
+ *
+ * RETURNS: zero on success, nonzero on error.
+ */
+int
+fcomRecordStart(const char *path);
+
+/*
+ * Stop recording and close the file.
+ *
+ * RETURNS: number of messages recorded (>= 0) or a negative
+ *          error status if writing failed (or no recording
+ *          was in progress: FCOM_ERR_INVALID_ARG).
+ */
+int
+fcomRecordStop(void);
+
+/*
+ * Send a complete, XDR-encoded message (e.g., a message
+ * from a recording) of 'nbytes'. The message is sent to
+ * the multicast group of the GID of its first blob or, if
+ * FCOM_SEND_LOCAL is set in 'flags', to the receivers on
+ * this host (the local loopback address and the FCOM port),
+ * i.e., it is injected without reaching other nodes.
+ * Messages exceeding the datagram size are fragmented.
+ *
+ * NOTE:    The message is numbered like any other message
+ *          sent by this node, i.e., the sequence number in
+ *          'msg' is overwritten.
+ *
+ * RETURNS: zero on success, nonzero on error (FCOM_ERR_INVALID_ARG
+ *          if 'msg' does not hold a valid message of 'nbytes').
+ */
+int
+fcomSendMsg(void *msg, unsigned nbytes, unsigned flags);
+
+#define FCOM_SEND_LOCAL     (1<<0)
+
+/*
+ * Replay a recording made with fcomRecordStart(). Every
+ * message is sent with fcomSendMsg() (FCOM_SEND_LOCAL if
+ * FCOM_REPLAY_LOCAL is set in 'flags'), i.e., the node must
+ * be initialized for sending. The messages are sent with the
+ * recorded timing unless FCOM_REPLAY_FAST is set in which
+ * case they are sent as fast as possible.
+ *
+ * The calling thread is blocked until all messages are sent.
+ *
+ * RETURNS: number of messages replayed (>= 0) or a negative
+ *          error status (the file could not be read, is not a
+ *          recording or sending failed).
+ */
+int
+fcomReplay(const char *path, unsigned flags);
+
+#define FCOM_REPLAY_FAST    (1<<0)
+#define FCOM_REPLAY_LOCAL   (1<<1)
 
 
+/** CONTEXTS *********************************************************/
+
+/*
+ * All FCOM state (sockets, buffers, subscriptions, RX thread,
+ * statistics) is held in a 'context'. fcomInit() creates a
+ * 'default' context which is used by all API routines that
+ * take no explicit context argument.
+ *
+ * Applications which need independent FCOM instances in one
+ * process (e.g., to talk to separate multicast prefixes or
+ * ports, or to keep test harnesses apart) may create additional
+ * contexts and use the 'Ctx' variants of the API routines.
+ *
+ * NOTE: Every context binds its own RX port. Two contexts which
+ *       both receive must therefore use different ports.
+ *       The multicast interface setting of udpComm is global,
+ *       i.e., shared by all contexts.
+ */
+typedef struct FcomCtxRec_ *FcomCtx;
+
+/*
+ * Create a new context. The arguments have the same meaning
+ * as for fcomInit(). If 'n_bufs' is zero then the context has
+ * no RX part (and no RX thread); it can only be used for sending.
+ *
+ * RETURNS:  Zero on success, nonzero on error. The new context
+ *           is stored in *p_ctx.
+ *
+ * NOTE:     This routine is thread-safe but the caller must make
+ *           sure that the context is not used before this routine
+ *           returns.
+ */
+int
+fcomCreateContext(const char *mcast_g_prefix, unsigned n_bufs, FcomCtx *p_ctx);
+
+/*
+ * Destroy a context, stopping its RX thread and releasing
+ * all resources.
+ *
+ * RETURNS:  Zero on success, nonzero on error. FCOM_ERR_ID_IN_USE
+ *           if the application still holds references to blobs
+ *           (fcomGetBlob()) or blob sets which were obtained from
+ *           this context; the context is left intact and usable
+ *           in this case so that the call may be retried.
+ *
+ * NOTE:     The caller must make sure that no other thread uses
+ *           the context while it is destroyed.
+ */
+int
+fcomDestroyContext(FcomCtx ctx);
+
+/*
+ * Variants of the API routines which operate on an explicit
+ * context. The semantics are identical to the routines
+ * without the 'Ctx' suffix (which operate on the default
+ * context). A NULL context or a context lacking the RX or TX
+ * part yields FCOM_ERR_INVALID_ARG.
+ *
+ * Routines which operate on a blob or blob set that was obtained
+ * from a context (fcomReleaseBlob(), fcomDumpBlob(), fcomFreeBlobSet()
+ * and fcomGetBlobSet()) find that context automatically. Groups
+ * are not associated with a context until they are sent.
+ */
+int
+fcomPutGroupCtx(FcomCtx ctx, FcomGroup group);
+
+int
+fcomPutGroupsCtx(FcomCtx ctx, FcomGroup groups[], unsigned n_groups);
+
+int
+fcomPutBlobCtx(FcomCtx ctx, FcomBlobRef p_blob);
+
+int
+fcomPutBlobSparseCtx(FcomCtx ctx, FcomBlobRef p_blob, const FcomRange ranges[], unsigned n_ranges);
+
+int
+fcomPutPreparedCtx(FcomCtx ctx, FcomPrepared prep);
+
+int
+fcomSetTxAsyncCtx(FcomCtx ctx, unsigned queue_depth);
+
+int
+fcomPutBlobAsyncCtx(FcomCtx ctx, FcomBlobRef p_blob);
+
+int
+fcomPutPreparedAsyncCtx(FcomCtx ctx, FcomPrepared prep);
+
+int
+fcomSetTxCoalesceCtx(FcomCtx ctx, unsigned max_bytes, unsigned max_usecs);
+
+int
+fcomFlushCtx(FcomCtx ctx);
+
+int
+fcomSetTxMsgSizeCtx(FcomCtx ctx, unsigned bytes);
+
+int
+fcomAllocGroupCtx(FcomCtx ctx, FcomID id, FcomGroup *p_group);
+
+int
+fcomSetTxCompactCtx(FcomCtx ctx, int on);
+
+int
+fcomAddRxBufsCtx(FcomCtx ctx, uint32_t blob_size, unsigned n_bufs);
+
+int
+fcomSubscribeCtx(FcomCtx ctx, FcomID id, int mode);
+
+int
+fcomUnsubscribeCtx(FcomCtx ctx, FcomID id);
+
+int
+fcomGetBlobCtx(FcomCtx ctx, FcomID id, FcomBlobRef *pp_blob, uint32_t timeout_ms);
+
+int
+fcomAllocBlobSetCtx(FcomCtx ctx, FcomID member_id[], unsigned num_members, FcomBlobSetRef *pp_set);
+
+int
+fcomSetRxSchedCtx(FcomCtx ctx, int policy, int prio_pcnt);
+
+int
+fcomSetRxAffinityCtx(FcomCtx ctx, const char *cpu_list);
+
+int
+fcomSetRxDropStaleCtx(FcomCtx ctx, int on);
+
+int
+fcomSetRxLatencyStatsCtx(FcomCtx ctx, int on);
+
+int
+fcomGetIDLatencyCtx(FcomCtx ctx, FcomID idnt, FcomLatHist *p_net, FcomLatHist *p_app);
+
+int
+fcomGetIDRateCtx(FcomCtx ctx, FcomID idnt, FcomIDRate *p_rate);
+
+int
+fcomGetRxBufStatsCtx(FcomCtx ctx, FcomBufPoolStats *p_pools, unsigned n);
+
+int
+fcomGetRxHoldTimeCtx(FcomCtx ctx, FcomLatHist *p_hist, FcomID *p_max_idnt);
+
+int
+fcomSetLockStatsCtx(FcomCtx ctx, int on);
+
+int
+fcomGetLockStatsCtx(FcomCtx ctx, FcomLockStats *p_tbl, FcomLockStats *p_grp, FcomLatHist *p_rx_msg);
+
+int
+fcomGetStatsCtx(FcomCtx ctx, int n_keys, uint32_t key_arr[], uint64_t value_arr[]);
+
+int
+fcomGetStatsSnapshotCtx(FcomCtx ctx, FcomRxStats *p_rx, FcomTxStats *p_tx);
+
+int
+fcomShmPublishCtx(FcomCtx ctx, const char *name, unsigned period_ms, unsigned max_ids);
+
+int
+fcomRecordStartCtx(FcomCtx ctx, const char *path);
+
+int
+fcomRecordStopCtx(FcomCtx ctx);
+
+int
+fcomSendMsgCtx(FcomCtx ctx, void *msg, unsigned nbytes, unsigned flags);
+
+int
+fcomReplayCtx(FcomCtx ctx, const char *path, unsigned flags);
+
+int
+fcomSetProfilingCtx(FcomCtx ctx, int on);
+
+void
+fcomDumpStatsCtx(FcomCtx ctx, FILE *f);
+
+int
+fcomDumpIDStatsCtx(FcomCtx ctx, FcomID idnt, int level, FILE *f);
+
+void
+fcomDumpProfileCtx(FcomCtx ctx, FILE *f);
+
+
+
 /** EXAMPLES *********************************************************/
 
 /*
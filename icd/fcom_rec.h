@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef FCOM_REC_H
+#define FCOM_REC_H
+
+/* Layout of the files written by fcomRecordStart() and
+ * read by fcomReplay().
+ *
+ * A recording consists of a FcomRecFileHdr followed by any
+ * number of records. Every record is a FcomRecHdr followed
+ * by 'nbytes' of message data exactly as received, i.e.,
+ * an XDR-encoded (ordinary or compact) message. Fragmented
+ * messages are recorded once they are reassembled.
+ *
+ * All header members are stored in network byte order (big
+ * endian); 64-bit quantities as two 32-bit words, most
+ * significant first. Files can thus be replayed/analyzed on
+ * a machine of different endianness. Readers must use
+ * 'hdr_size' and 'rec_size' to skip headers; new members are
+ * only ever appended to either structure. Incompatible changes
+ * bump FCOM_REC_VERSION.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FCOM_REC_MAGIC      0x46435243 /* 'FCRC' */
+#define FCOM_REC_VERSION    1
+
+typedef struct FcomRecFileHdr {
+	uint32_t    magic;     /* FCOM_REC_MAGIC                      */
+	uint32_t    version;   /* FCOM_REC_VERSION                    */
+	uint32_t    hdr_size;  /* sizeof(FcomRecFileHdr)              */
+	uint32_t    rec_size;  /* sizeof(FcomRecHdr)                  */
+	uint32_t    t0_hi;     /* wall-clock time when recording      */
+	uint32_t    t0_lo;     /* started (us since 1970)             */
+	uint32_t    t0_mono_hi;/* the same on the monotonic clock     */
+	uint32_t    t0_mono_lo;/* ('t_hi/t_lo' of records)            */
+} FcomRecFileHdr;
+
+typedef struct FcomRecHdr {
+	uint32_t    t_hi;      /* arrival of the message (monotonic   */
+	uint32_t    t_lo;      /* clock; us)                          */
+	uint32_t    gid;       /* GID of the message                  */
+	uint32_t    nbytes;    /* size of the message                 */
+} FcomRecHdr;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef FCOM_SHM_H
+#define FCOM_SHM_H
+
+/* Layout of the statistics segment published by fcomShmPublish().
+ *
+ * The segment is a POSIX shared-memory object which an external
+ * monitor (e.g., 'fcomstat') maps read-only. The publishing process
+ * never blocks on and never calls into a monitor.
+ *
+ * The segment consists of a FcomShmHdr followed by 'max_ids'
+ * FcomShmID records ('n_ids' of which are valid). Readers must
+ * use the 'hdr_size' and 'id_size' members to locate the records
+ * (FCOM_SHM_ID()); new members are only ever appended to either
+ * structure. Incompatible changes bump FCOM_SHM_VERSION; this
+ * includes any change to the size of the structures embedded
+ * in FcomShmHdr (FcomRxStats, FcomShmPool etc.) since members
+ * following them would move.
+ *
+ * Versions:
+ *   1: initial layout.
+ *   2: FcomShmPool became FcomBufPoolStats (was 16 bytes);
+ *      'hold', 'hold_max_idnt' and the lock statistics added.
+ *   3: 'rec_drop' appended to FcomRxStats.
+ *
+ * All members following 'seq' are protected by a sequence lock:
+ * 'seq' is odd while an update is in progress. A reader
+ *
+ *   1. reads 'seq' (retry later if it is odd),
+ *   2. copies what it needs,
+ *   3. reads 'seq' again and discards the copy if it changed.
+ *
+ * Readers must use acquire semantics for both reads of 'seq'
+ * (e.g., __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE)).
+ */
+
+#include <stdint.h>
+
+#include <fcom_api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FCOM_SHM_MAGIC      0x46434f53 /* 'FCOS' */
+#define FCOM_SHM_VERSION    3
+
+/* Segment name used if none is given */
+#define FCOM_SHM_NAME_DFLT  "/fcom-stats"
+
+/* Max. number of buffer pools described */
+#define FCOM_SHM_POOLS_MAX  8
+
+/* Flags: which parts of the context are present */
+#define FCOM_SHM_HAVE_RX    (1<<0)
+#define FCOM_SHM_HAVE_TX    (1<<1)
+
+/* Buffer pool (one per buffer size; see fcomGetRxBufStats()) */
+typedef FcomBufPoolStats FcomShmPool;
+
+/* Subscribed ID */
+typedef struct FcomShmID {
+	FcomID      idnt;
+	uint32_t    pad;
+	FcomIDRate  rate;      /* see fcomGetIDRate()                 */
+} FcomShmID;
+
+typedef struct FcomShmHdr {
+	/* constant while the segment exists */
+	uint32_t    magic;     /* FCOM_SHM_MAGIC                      */
+	uint32_t    version;   /* FCOM_SHM_VERSION                    */
+	uint32_t    hdr_size;  /* sizeof(FcomShmHdr)                  */
+	uint32_t    id_size;   /* sizeof(FcomShmID)                   */
+	uint32_t    seg_size;  /* size of the segment                 */
+	uint32_t    max_ids;   /* # of FcomShmID records              */
+	uint32_t    pid;       /* publishing process                  */
+	uint32_t    period_ms; /* update period                       */
+	/* sequence lock */
+	uint32_t    seq;
+	uint32_t    flags;     /* FCOM_SHM_HAVE_xxx                   */
+	uint64_t    n_upd;     /* # of updates published so far       */
+	uint64_t    time_us;   /* time of last update (us since epoch) */
+	uint32_t    n_pools;   /* # of valid entries in 'pool'        */
+	uint32_t    n_ids;     /* # of valid FcomShmID records        */
+	uint32_t    n_subs;    /* # of subscribed IDs (may exceed
+	                        * 'max_ids')
+	                        */
+	uint32_t    pad;
+	FcomRxStats rx;
+	FcomTxStats tx;
+	FcomShmPool pool[FCOM_SHM_POOLS_MAX];
+	FcomLatHist hold;      /* see fcomGetRxHoldTime()             */
+	FcomID      hold_max_idnt;
+	uint32_t    pad1;
+	/* see fcomGetLockStats() */
+	FcomLockStats lock_tbl;
+	FcomLockStats lock_grp;
+	FcomLatHist lock_rx_msg;
+} FcomShmHdr;
+
+/* Locate FcomShmID record 'i' */
+#define FCOM_SHM_ID(hdr, i) \
+	((FcomShmID*)((char*)(hdr) + (hdr)->hdr_size + (unsigned long)(i) * (hdr)->id_size))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,7 +23,8 @@
  *   tl <tstmpLo>
  *   st <status >
  *   ty <type   > <count>
- *      0: none, 1: float, 2: ddouble, 3: uint32, 4: int32, 5: int8
+ *      0: none, 1: float, 2: ddouble, 3: uint32, 4: int32, 5: int8,
+ *      6: int16, 7: uint16, 8: int64, 9: uint64
  *   <element>
  *   <element>
  *   ...
@@ -34,6 +35,9 @@
  * This code is intended FOR TESTING PURPOSES.
  *
  * The ASCII file format is described in <fcomP.h>
+ *
+ * A binary, memory-mappable format (also described in <fcomP.h>)
+ * is supported for large test vectors.
  */
 
 #include <stdio.h>
@@ -42,6 +46,15 @@
 
 #include <ctype.h>
 #include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0
+#define FC_BINF_MMAP
+#include <sys/mman.h>
+#endif
 
 #define __INSIDE_FCOM__
 #include <fcom_api.h>
@@ -81,6 +94,31 @@ int64_t val;
 	return rval;
 }
 
+/* Scan a uint64_t number; like convl() the base may
+ * be specified by a prefix. A leading '-' sign is
+ * accepted (the value is negated modulo 2^64).
+ *
+ * RETURNS: 1 on success, 0 if no number could be
+ *          scanned and <0 on error.
+ */
+static int
+convll(FILE *f, uint64_t *pv)
+{
+int     rval;
+char    buf[40];
+char    *end;
+
+	rval = fscanf(f,"%39s",buf);
+	if ( rval < 0 )
+		perror("fscanf");
+	if ( 1 == rval ) {
+		*pv = strtoull(buf, &end, 0);
+		if ( end == buf || *end )
+			rval = 0;
+	}
+	return rval;
+}
+
 /* Scan a 'key' 'uint32_t-value' pair storing 'key'
  * (a string) into 'fld' and the value into *pv.
  * Only the first two characters are stored into
@@ -146,6 +184,10 @@ tsz(FcomBlobRef pb)
 		case FCOM_EL_UINT32: return sizeof(uint32_t);
 		case FCOM_EL_INT32:  return sizeof(int32_t);
 		case FCOM_EL_INT8:   return sizeof(int8_t);
+		case FCOM_EL_INT16:  return sizeof(int16_t);
+		case FCOM_EL_UINT16: return sizeof(uint16_t);
+		case FCOM_EL_INT64:  return sizeof(int64_t);
+		case FCOM_EL_UINT64: return sizeof(uint64_t);
 	}
 	return -1;
 }
@@ -164,6 +206,7 @@ fcom_get_blob_from_file(FILE *f, FcomBlobRef pb, int avail)
 {
 uint32_t u;
 int      k,sz=0,err;
+uint64_t ull;
 char     key[10];
 int      rval;
 
@@ -192,6 +235,10 @@ int      rval;
 				case FCOM_EL_TYPE(FCOM_EL_UINT32): u = FCOM_EL_UINT32; break;
 				case FCOM_EL_TYPE(FCOM_EL_INT32):  u = FCOM_EL_INT32;  break;
 				case FCOM_EL_TYPE(FCOM_EL_INT8):   u = FCOM_EL_INT8;   break;
+				case FCOM_EL_TYPE(FCOM_EL_INT16):  u = FCOM_EL_INT16;  break;
+				case FCOM_EL_TYPE(FCOM_EL_UINT16): u = FCOM_EL_UINT16; break;
+				case FCOM_EL_TYPE(FCOM_EL_INT64):  u = FCOM_EL_INT64;  break;
+				case FCOM_EL_TYPE(FCOM_EL_UINT64): u = FCOM_EL_UINT64; break;
 				default:
 					fprintf(stderr,"Bad element type %"PRIu32"\n", u);
 					return -1;
@@ -237,6 +284,16 @@ int      rval;
 					case FCOM_EL_INT8:
 						err = fscanf(f,"%"SCNi8, &pb->fc_i08[k]);
 					break;
+					case FCOM_EL_INT16:
+					case FCOM_EL_UINT16:
+						if ( 1 == (err = convl(f,&u)) )
+							pb->fc_u16[k] = (uint16_t)u;
+					break;
+					case FCOM_EL_INT64:
+					case FCOM_EL_UINT64:
+						if ( 1 == (err = convll(f,&ull)) )
+							pb->fc_u64[k] = ull;
+					break;
 				}
 				if ( 1 != err ) {
 					fprintf(stderr,"Read bad element #%i (type %"PRIu32")\n", k, (uint32_t)FCOM_EL_TYPE(pb->fc_type));
@@ -285,6 +342,10 @@ int     k;
 			case FCOM_EL_UINT32: fprintf(f, "   0x%08"PRIx32"\n", pb->fc_u32[k]); break;
 			case FCOM_EL_INT32:  fprintf(f, "   0x%08"PRIx32"\n", pb->fc_i32[k]); break;
 			case FCOM_EL_INT8:   fprintf(f, "   0x%02"PRIx8"\n", (uint8_t)pb->fc_i08[k]); break;
+			case FCOM_EL_INT16:
+			case FCOM_EL_UINT16: fprintf(f, "   0x%04"PRIx16"\n", pb->fc_u16[k]); break;
+			case FCOM_EL_INT64:
+			case FCOM_EL_UINT64: fprintf(f, "   0x%016"PRIx64"\n", pb->fc_u64[k]); break;
 		}
 	}
 
@@ -292,3 +353,295 @@ int     k;
 
 	return 0;
 }
+
+struct FcomBinFile_ {
+	/* writer */
+	FILE           *f;
+	uint32_t        n_alloc;
+	uint64_t        off;     /* current end of file             */
+	int             err;     /* first write error (errno)       */
+	/* reader */
+	const char     *base;    /* file contents                   */
+	size_t          size;
+	int             mapped;
+	int             own_idx; /* 'idx' was built (malloc()ed)    */
+	/* both */
+	uint64_t       *idx;
+	uint32_t        n;
+};
+
+#define BINF_PAD(x) ( ((x) + FCOM_BINF_ALIGN - 1) & ~(uint64_t)(FCOM_BINF_ALIGN - 1) )
+
+static const char binf_zeros[FCOM_BINF_ALIGN] = { 0 };
+
+static void
+binf_write(FcomBinFileRef bf, const void *p, size_t len)
+{
+	if ( len && ! bf->err && 1 != fwrite( p, len, 1, bf->f ) )
+		bf->err = errno ? errno : EIO;
+	bf->off += len;
+}
+
+int
+fcom_binf_create(FcomBinFileRef *p_bf, const char *path)
+{
+FcomBinFileRef bf;
+FcomBinFileHdr h;
+int            err;
+
+	if ( ! (bf = calloc(1, sizeof(*bf))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	if ( ! (bf->f = fopen(path, "wb")) ) {
+		err = errno;
+		free( bf );
+		return FCOM_ERR_SYS(err);
+	}
+
+	/* the header is rewritten when the file is closed */
+	memset( &h, 0, sizeof(h) );
+	h.magic    = FCOM_BINF_MAGIC;
+	h.version  = FCOM_BINF_VERSION;
+	h.hdr_size = BINF_PAD(sizeof(h));
+	binf_write( bf, &h, sizeof(h) );
+	binf_write( bf, binf_zeros, h.hdr_size - sizeof(h) );
+
+	*p_bf = bf;
+	return 0;
+}
+
+int
+fcom_put_blob_to_binf(FcomBinFileRef bf, FcomBlobRef pb)
+{
+FcomBinRecHdr r;
+uint64_t      *nidx;
+int           sz;
+
+	if ( ! bf->f )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( (sz = FCOM_EL_SIZE(pb->fc_type)) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( bf->n >= bf->n_alloc ) {
+		if ( ! (nidx = realloc( bf->idx, (bf->n_alloc ? 2*bf->n_alloc : 1024) * sizeof(*nidx) )) )
+			return FCOM_ERR_NO_MEMORY;
+		bf->idx      = nidx;
+		bf->n_alloc  = bf->n_alloc ? 2*bf->n_alloc : 1024;
+	}
+
+	r.pld_size = sz * pb->fc_nelm;
+	r.rec_size = BINF_PAD(sizeof(r) + r.pld_size);
+	r.blob     = pb->hdr;
+
+	bf->idx[bf->n++] = bf->off;
+
+	binf_write( bf, &r, sizeof(r) );
+	binf_write( bf, pb->fc_raw, r.pld_size );
+	binf_write( bf, binf_zeros, r.rec_size - sizeof(r) - r.pld_size );
+
+	return bf->err ? FCOM_ERR_SYS(bf->err) : 0;
+}
+
+static int
+binf_finish(FcomBinFileRef bf)
+{
+FcomBinFileHdr h;
+int            rval;
+
+	memset( &h, 0, sizeof(h) );
+	h.magic    = FCOM_BINF_MAGIC;
+	h.version  = FCOM_BINF_VERSION;
+	h.hdr_size = BINF_PAD(sizeof(h));
+	h.n_blobs  = bf->n;
+	h.idx_off  = bf->off;
+
+	binf_write( bf, bf->idx, bf->n * sizeof(*bf->idx) );
+
+	if ( ! bf->err && (fseek( bf->f, 0, SEEK_SET ) || 1 != fwrite( &h, sizeof(h), 1, bf->f )) )
+		bf->err = errno ? errno : EIO;
+
+	if ( fclose( bf->f ) && ! bf->err )
+		bf->err = errno;
+
+	rval = bf->err ? FCOM_ERR_SYS(bf->err) : (int)bf->n;
+
+	free( bf->idx );
+	return rval;
+}
+
+/* Locate the records of a file without (valid) index */
+static int
+binf_scan(FcomBinFileRef bf, uint64_t off, uint64_t end)
+{
+const FcomBinRecHdr *r;
+uint64_t            *nidx;
+uint32_t             n_alloc = 0;
+int                  sz;
+
+	bf->own_idx = 1;
+	bf->n       = 0;
+	while ( end - off >= sizeof(*r) ) {
+		r = (const FcomBinRecHdr*)(bf->base + off);
+		if (   r->rec_size > end - off
+		    || r->rec_size != BINF_PAD(sizeof(*r) + r->pld_size)
+		    || (sz = FCOM_EL_SIZE(r->blob.type)) < 0
+		    || r->pld_size != sz * r->blob.nelm )
+			break;
+		if ( bf->n >= n_alloc ) {
+			n_alloc = n_alloc ? 2*n_alloc : 1024;
+			if ( ! (nidx = realloc( bf->idx, n_alloc * sizeof(*nidx) )) )
+				return FCOM_ERR_NO_MEMORY;
+			bf->idx = nidx;
+		}
+		bf->idx[bf->n++] = off;
+		off += r->rec_size;
+	}
+	return 0;
+}
+
+static void
+binf_unmap(FcomBinFileRef bf)
+{
+#ifdef FC_BINF_MMAP
+	if ( bf->mapped ) {
+		munmap( (void*)bf->base, bf->size );
+		return;
+	}
+#endif
+	free( (void*)bf->base );
+}
+
+int
+fcom_binf_open(FcomBinFileRef *p_bf, const char *path)
+{
+FcomBinFileRef       bf;
+const FcomBinFileHdr *h;
+struct stat          sb;
+int                  fd, err;
+void                 *p = 0;
+ssize_t              got;
+size_t               n;
+
+	if ( (fd = open(path, O_RDONLY)) < 0 )
+		return FCOM_ERR_SYS(errno);
+
+	if ( fstat( fd, &sb ) ) {
+		err = FCOM_ERR_SYS(errno);
+		close( fd );
+		return err;
+	}
+
+	if ( sb.st_size < sizeof(*h) ) {
+		close( fd );
+		return FCOM_ERR_BAD_VERSION;
+	}
+
+	if ( ! (bf = calloc(1, sizeof(*bf))) ) {
+		close( fd );
+		return FCOM_ERR_NO_MEMORY;
+	}
+	bf->size = sb.st_size;
+
+#ifdef FC_BINF_MMAP
+	if ( MAP_FAILED != (p = mmap( 0, bf->size, PROT_READ, MAP_PRIVATE, fd, 0 )) ) {
+		bf->mapped = 1;
+	} else
+#endif
+	{
+		/* no mmap(); read the entire file */
+		if ( (p = malloc( bf->size )) ) {
+			for ( n = 0; n < bf->size; n += got ) {
+				if ( (got = read( fd, (char*)p + n, bf->size - n )) <= 0 ) {
+					free( p );
+					p = 0;
+					break;
+				}
+			}
+		}
+	}
+	close( fd );
+
+	if ( ! (bf->base = p) ) {
+		free( bf );
+		return FCOM_ERR_NO_MEMORY;
+	}
+
+	h   = (const FcomBinFileHdr*)bf->base;
+	err = 0;
+
+	if (   FCOM_BINF_MAGIC   != h->magic
+	    || FCOM_BINF_VERSION != h->version
+	    || h->hdr_size < sizeof(*h)
+	    || h->hdr_size > bf->size ) {
+		/* also rejects a file written on a host of different endianness */
+		err = FCOM_ERR_BAD_VERSION;
+	} else if (   h->idx_off >= h->hdr_size
+	           && ! (h->idx_off & (sizeof(*bf->idx) - 1))
+	           && h->idx_off <= bf->size
+	           && (bf->size - h->idx_off) / sizeof(*bf->idx) >= h->n_blobs ) {
+		bf->idx = (uint64_t*)(bf->base + h->idx_off);
+		bf->n   = h->n_blobs;
+	} else {
+		/* index missing (writer did not close the file) */
+		err = binf_scan( bf, h->hdr_size, bf->size );
+	}
+
+	if ( err ) {
+		fcom_binf_close( bf );
+		return err;
+	}
+
+	*p_bf = bf;
+	return 0;
+}
+
+int
+fcom_binf_count(FcomBinFileRef bf)
+{
+	return bf->n;
+}
+
+int
+fcom_get_blob_from_binf(FcomBinFileRef bf, unsigned i, FcomBlobRef pb)
+{
+const FcomBinRecHdr *r;
+uint64_t             off;
+int                  sz;
+
+	if ( ! bf->base || i >= bf->n )
+		return FCOM_ERR_INVALID_ARG;
+
+	off = bf->idx[i];
+	if ( off > bf->size || bf->size - off < sizeof(*r) || (off & (FCOM_BINF_ALIGN - 1)) )
+		return FCOM_ERR_INVALID_ARG;
+
+	r = (const FcomBinRecHdr*)(bf->base + off);
+
+	if (   (sz = FCOM_EL_SIZE(r->blob.type)) < 0
+	    || r->pld_size != sz * r->blob.nelm
+	    || r->pld_size > bf->size - off - sizeof(*r) )
+		return FCOM_ERR_INVALID_TYPE;
+
+	pb->hdr    = r->blob;
+	pb->fc_raw = (void*)(r + 1);
+
+	return 0;
+}
+
+int
+fcom_binf_close(FcomBinFileRef bf)
+{
+int rval;
+
+	if ( bf->f ) {
+		rval = binf_finish( bf );
+	} else {
+		rval = bf->n;
+		if ( bf->own_idx )
+			free( bf->idx );
+		binf_unmap( bf );
+	}
+	free( bf );
+	return rval;
+}
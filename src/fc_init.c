@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include <netinet/in.h>
 
@@ -37,17 +38,71 @@
 #define __BSD_VISIBLE 1
 #include <arpa/inet.h>
 
-uint32_t fcom_g_prefix = 0;
+/* Context created by fcomInit() */
+FcomCtx  fcom_dflt_ctx = 0;
 
-int      fcom_xsd      = -1;
-int      fcom_rsd      = -1;
-
-/* Tunable parameters */
-int      fcom_port     = FCOM_PORT_DEFLT;
+/* Tunable parameters; defaults for new contexts */
 int      fcom_rx_priority_percent = 80;
+int      fcom_rx_sched_policy     = FCOM_SCHED_FIFO;
+char    *fcom_rx_cpu_list         = 0;
 
 int      fcom_silent_mode = 0;
 
+/* The udpComm transport */
+static int
+udp_socket(int port)
+{
+	return udpCommSocket(port);
+}
+
+static int
+udp_close(int sd)
+{
+	return udpCommClose(sd);
+}
+
+static UdpCommPkt
+udp_recv_from(int sd, int timeout_ms, uint32_t *p_peer_ip, uint16_t *p_peer_port)
+{
+	return udpCommRecvFrom(sd, timeout_ms, p_peer_ip, p_peer_port);
+}
+
+static int
+udp_send_to(int sd, void *buf, int len, uint32_t dipaddr, int dport)
+{
+	return udpCommSendTo(sd, buf, len, dipaddr, dport);
+}
+
+static int
+udp_send_pkt_to(int sd, UdpCommPkt pkt, int len, uint32_t dipaddr, int dport)
+{
+	return udpCommSendPktTo(sd, pkt, len, dipaddr, dport);
+}
+
+static int
+udp_join_mcast(int sd, uint32_t mcaddr)
+{
+	return udpCommJoinMcast(sd, mcaddr);
+}
+
+static int
+udp_leave_mcast(int sd, uint32_t mcaddr)
+{
+	return udpCommLeaveMcast(sd, mcaddr);
+}
+
+const FcomXport fcom_xport_udp = {
+	"udpComm",
+	1,
+	udp_socket,
+	udp_close,
+	udp_recv_from,
+	udp_send_to,
+	udp_send_pkt_to,
+	udp_join_mcast,
+	udp_leave_mcast
+};
+
 static uint32_t m[] = {
 	0xffff0000,
 	0xff00ff00,
@@ -72,25 +127,75 @@ int      i,j,v;
 	return v;
 }
 
+/* Release everything a (possibly partially
+ * initialized) context holds. Nothing is released
+ * if the application still uses the RX part.
+ */
+static int
+fc_ctx_cleanup(FcomCtx ctx)
+{
+int rval;
+
+	if ( fcom_recv_busy ) {
+		if ( (rval = fcom_recv_busy(ctx)) ) {
+			return rval;
+		}
+	}
+
+	fcom_shm_fini(ctx);
+
+	if ( fcom_send_fini ) {
+		if ( (rval = fcom_send_fini(ctx)) ) {
+			return rval;
+		}
+	}
+	if ( ctx->xsd >= 0 ) {
+		if ( (rval = ctx->xp->close(ctx->xsd)) ) {
+			return rval;
+		}
+		ctx->xsd = -1;
+	}
+
+	if ( fcom_recv_fini ) {
+		if ( (rval = fcom_recv_fini(ctx)) ) {
+			return rval;
+		}
+	}
+	if ( ctx->rsd >= 0 ) {
+		if ( (rval = ctx->xp->close(ctx->rsd)) ) {
+			return rval;
+		}
+		ctx->rsd = -1;
+	}
+
+	free(ctx->rx_cpu_list);
+	free(ctx);
+
+	return 0;
+}
+
 int
-fcomInit(const char *ip_group, unsigned n_bufs)
+fcomCreateContext(const char *ip_group, unsigned n_bufs, FcomCtx *p_ctx)
 {
 struct in_addr ina;
 uint32_t       h; /* in host-order */
 char           str[100];
 char          *col;
 int            err;
+int            port = FCOM_PORT_DEFLT;
+FcomCtx        ctx;
+const FcomXport *xp = &fcom_xport_udp;
 
-	if ( fcom_xsd >= 0 || fcom_rsd >= 0 ) {
-		fprintf(stderr,"Warning: FCOM already initialized\n");
-		return 0;
-	}
-
-	if ( !ip_group ) {
+	if ( !ip_group || !p_ctx ) {
 		fprintf(stderr,"Need a <mcast_prefix>[:<port>] argument\n");
 		return FCOM_ERR_INVALID_ARG;
 	}
 
+	if ( ! strncmp(ip_group, FCOM_XPORT_LOOP_PREFIX, strlen(FCOM_XPORT_LOOP_PREFIX)) ) {
+		xp        = &fcom_xport_loop;
+		ip_group += strlen(FCOM_XPORT_LOOP_PREFIX);
+	}
+
 	strncpy(str, ip_group, sizeof(str)-1);
 	str[sizeof(str)-1] = 0;
 
@@ -106,7 +211,7 @@ int            err;
 	h = ntohl(ina.s_addr);
 
 	if ( col ) {
-		if ( 1 != sscanf(col,"%i",&fcom_port) ) {
+		if ( 1 != sscanf(col,"%i",&port) ) {
 			fprintf(stderr,"Unable to scan port number\n");
 			return FCOM_ERR_INVALID_ARG;
 		}
@@ -122,7 +227,21 @@ int            err;
 		return FCOM_ERR_INVALID_ARG;
 	}
 
-	fcom_g_prefix = ina.s_addr;
+	if ( ! (ctx = calloc(1, sizeof(*ctx))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	ctx->g_prefix            = ina.s_addr;
+	ctx->port                = port;
+	ctx->xp                  = xp;
+	ctx->xsd                 = -1;
+	ctx->rsd                 = -1;
+	ctx->rx_priority_percent = fcom_rx_priority_percent;
+	ctx->rx_sched_policy     = fcom_rx_sched_policy;
+
+	if ( fcom_rx_cpu_list && ! (ctx->rx_cpu_list = strdup(fcom_rx_cpu_list)) ) {
+		err = FCOM_ERR_NO_MEMORY;
+		goto bail;
+	}
 
 	/* Initialize RX and TX parts if they are linked
 	 * (fcom_recv_init/fcom_send_init are weak symbols)
@@ -133,77 +252,147 @@ int            err;
 	 * creating the TX socket.
 	 */
 	if ( fcom_recv_init && n_bufs > 0 ) {
-		if ( (fcom_rsd = udpCommSocket(fcom_port)) < 0 ) {
-			return FCOM_ERR_SYS(-fcom_rsd);
+		if ( (ctx->rsd = ctx->xp->socket(ctx->port)) < 0 ) {
+			err = FCOM_ERR_SYS(-ctx->rsd);
+			ctx->rsd = -1;
+			goto bail;
 		}
-		if ( ( err = fcom_recv_init(n_bufs)) ) {
-			return err;
+		if ( ( err = fcom_recv_init(ctx, n_bufs)) ) {
+			goto bail;
 		}
 	}
 
 	if ( fcom_send_init ) {
-		if ( (fcom_xsd = udpCommSocket(0)) < 0 ) {
-			return FCOM_ERR_SYS(-fcom_xsd);
+		if ( (ctx->xsd = ctx->xp->socket(0)) < 0 ) {
+			err = FCOM_ERR_SYS(-ctx->xsd);
+			ctx->xsd = -1;
+			goto bail;
 		}
-		if ( (err = fcom_send_init()) ) {
-			return err;
+		if ( (err = fcom_send_init(ctx)) ) {
+			goto bail;
 		}
 	}
 
+	*p_ctx = ctx;
 	return 0;
+
+bail:
+	fc_ctx_cleanup(ctx);
+	return err;
 }
 
 int
-fcom_exit()
+fcomDestroyContext(FcomCtx ctx)
 {
-int rval;
+	if ( ! ctx )
+		return FCOM_ERR_INVALID_ARG;
 
-	if ( fcom_send_fini ) {
-		if ( (rval = fcom_send_fini()) ) {
-			return rval;
-		}
-		if ( (rval = udpCommClose(fcom_xsd)) ) {
-			return rval;
-		}
+	return fc_ctx_cleanup(ctx);
+}
+
+int
+fcomInit(const char *ip_group, unsigned n_bufs)
+{
+	if ( fcom_dflt_ctx ) {
+		fprintf(stderr,"Warning: FCOM already initialized\n");
+		return 0;
 	}
 
-	if ( fcom_recv_fini ) {
-		if ( (rval = fcom_recv_fini()) ) {
-			return rval;
-		}
-		if ( (rval = udpCommClose(fcom_rsd)) ) {
+	return fcomCreateContext(ip_group, n_bufs, &fcom_dflt_ctx);
+}
+
+int
+fcom_exit()
+{
+int rval;
+
+	if ( fcom_dflt_ctx ) {
+		if ( (rval = fcomDestroyContext(fcom_dflt_ctx)) ) {
 			return rval;
 		}
+		fcom_dflt_ctx = 0;
 	}
 
-	fcom_xsd      = -1;
-	fcom_rsd      = -1;
-	fcom_port     = FCOM_PORT_DEFLT;
-	fcom_g_prefix = 0;
-
 	return 0;
 }
 
 void
-fcomDumpStats(FILE *f)
+fcomDumpStatsCtx(FcomCtx ctx, FILE *f)
 {
+	if ( ! ctx )
+		return;
 	if ( fcom_recv_stats )
-		fcom_recv_stats(f);
+		fcom_recv_stats(ctx, f);
 	if ( fcom_send_stats )
-		fcom_send_stats(f);
+		fcom_send_stats(ctx, f);
 }
 
+void
+fcomDumpStats(FILE *f)
+{
+	fcomDumpStatsCtx(fcom_dflt_ctx, f);
+}
+
+static const char * const fc_prof_rx_names[FCOM_PROF_RX_STAGES] = {
+	[FCOM_PROF_RX_RECV]    = "recv",
+	[FCOM_PROF_RX_PEEK]    = "peek",
+	[FCOM_PROF_RX_LOOKUP]  = "lookup",
+	[FCOM_PROF_RX_DECODE]  = "decode",
+	[FCOM_PROF_RX_PUBLISH] = "publish",
+	[FCOM_PROF_RX_WAKE]    = "wake",
+};
+
+static const char * const fc_prof_tx_names[FCOM_PROF_TX_STAGES] = {
+	[FCOM_PROF_TX_ENCODE]  = "encode",
+	[FCOM_PROF_TX_SEND]    = "send",
+};
+
 int
-fcomGetState(int n_keys, uint32_t key_arr[], uint64_t value_arr[])
+fcomSetProfilingCtx(FcomCtx ctx, int on)
+{
+	if ( ! ctx )
+		return FCOM_ERR_INVALID_ARG;
+	fcom_prof_enable( &ctx->rx_prof, on );
+	fcom_prof_enable( &ctx->tx_prof, on );
+	return 0;
+}
+
+int
+fcomSetProfiling(int on)
+{
+	return fcomSetProfilingCtx(fcom_dflt_ctx, on);
+}
+
+void
+fcomDumpProfileCtx(FcomCtx ctx, FILE *f)
+{
+	if ( ! ctx )
+		return;
+	if ( ctx->rx )
+		fcom_prof_dump(f, "FCOM Rx Profile", &ctx->rx_prof, fc_prof_rx_names, FCOM_PROF_RX_STAGES);
+	if ( ctx->tx )
+		fcom_prof_dump(f, "FCOM Tx Profile", &ctx->tx_prof, fc_prof_tx_names, FCOM_PROF_TX_STAGES);
+}
+
+void
+fcomDumpProfile(FILE *f)
+{
+	fcomDumpProfileCtx(fcom_dflt_ctx, f);
+}
+
+int
+fcomGetStatsCtx(FcomCtx ctx, int n_keys, uint32_t key_arr[], uint64_t value_arr[])
 {
 int i;
 int rval;
+	if ( ! ctx )
+		return FCOM_ERR_INVALID_ARG;
 	for ( i = 0; i<n_keys; i++ ) {
 		if ( FCOM_STAT_IS_RX(key_arr[i]) && fcom_get_rx_stat ) {
-			if ( (rval = fcom_get_rx_stat(key_arr[i], value_arr+i)) )
+			if ( (rval = fcom_get_rx_stat(ctx, key_arr[i], value_arr+i)) )
 				return rval;
 		} else if ( FCOM_STAT_IS_TX(key_arr[i]) && fcom_get_tx_stat ) {
-			if ( (rval = fcom_get_tx_stat(key_arr[i], value_arr+i)) )
+			if ( (rval = fcom_get_tx_stat(ctx, key_arr[i], value_arr+i)) )
 				return rval;
 		} else {
 			return FCOM_ERR_UNSUPP;
@@ -211,3 +400,46 @@ int rval;
 	}
 	return 0;
 }
+
+int
+fcomGetStats(int n_keys, uint32_t key_arr[], uint64_t value_arr[])
+{
+	return fcomGetStatsCtx(fcom_dflt_ctx, n_keys, key_arr, value_arr);
+}
+
+/* Misspelled name under which fcomGetStats() used to be
+ * implemented; kept for existing binaries.
+ */
+int
+fcomGetState(int n_keys, uint32_t key_arr[], uint64_t value_arr[]);
+
+int
+fcomGetState(int n_keys, uint32_t key_arr[], uint64_t value_arr[])
+{
+	return fcomGetStats(n_keys, key_arr, value_arr);
+}
+
+int
+fcomGetStatsSnapshotCtx(FcomCtx ctx, FcomRxStats *p_rx, FcomTxStats *p_tx)
+{
+int rval;
+	if ( ! ctx )
+		return FCOM_ERR_INVALID_ARG;
+	if ( p_rx ) {
+		memset( p_rx, 0, sizeof(*p_rx) );
+		if ( ctx->rx && fcom_get_rx_counters && (rval = fcom_get_rx_counters(ctx, p_rx)) )
+			return rval;
+	}
+	if ( p_tx ) {
+		memset( p_tx, 0, sizeof(*p_tx) );
+		if ( ctx->tx && fcom_get_tx_counters && (rval = fcom_get_tx_counters(ctx, p_tx)) )
+			return rval;
+	}
+	return 0;
+}
+
+int
+fcomGetStatsSnapshot(FcomRxStats *p_rx, FcomTxStats *p_tx)
+{
+	return fcomGetStatsSnapshotCtx(fcom_dflt_ctx, p_rx, p_tx);
+}
@@ -0,0 +1,334 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+
+/* In-process loopback transport (selected by a "loop:" prefix
+ * to the multicast group passed to fcomCreateContext()).
+ *
+ * Every 'socket' is an endpoint in a table; a datagram 'sent'
+ * to a multicast group is queued on all endpoints bound to the
+ * destination port which have joined the group, a datagram sent
+ * to a unicast address on the first endpoint bound to the port.
+ * Packets are handed over without copying (unless there is more
+ * than one receiver). Like UDP, the transport drops datagrams
+ * if a receiver's queue is full (these show up as sequence
+ * errors in the RX statistics) or if nobody listens.
+ *
+ * Delivery goes through the queue rather than calling into the
+ * receiver directly so that the RX side still runs in the RX
+ * thread (with its locking and scheduling) exactly as it does
+ * with a network underneath.
+ */
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+#include <fcomP.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h> /* for htonl & friends only */
+
+#ifdef USE_PTHREADS
+#include <pthread.h>
+#endif
+
+/* Max. number of endpoints (in the entire process) */
+#ifndef FC_LOOP_EPS_MAX
+#define FC_LOOP_EPS_MAX   64
+#endif
+
+/* Max. number of datagrams queued on an endpoint; must be power of two */
+#ifndef FC_LOOP_QDEPTH
+#define FC_LOOP_QDEPTH    1024
+#endif
+
+/* Ports assigned to endpoints created with port 0 */
+#define FC_LOOP_PORT_EPH  40000
+
+typedef struct FcLoopPkt {
+	UdpCommPkt       pkt;
+	uint16_t         port;      /* sender */
+} FcLoopPkt;
+
+typedef struct FcLoopEp {
+	uint16_t         port;
+	unsigned         head, tail;
+	/* joined group at the slot of the GID it maps to */
+	uint32_t         groups[FCOM_GID_MAX + 1];
+	FcLoopPkt        q[FC_LOOP_QDEPTH];
+#ifdef USE_PTHREADS
+	pthread_cond_t   cnd;
+#endif
+} FcLoopEp;
+
+static FcLoopEp *fc_loop_eps[FC_LOOP_EPS_MAX];
+
+#ifdef USE_PTHREADS
+static pthread_mutex_t fc_loop_mtx = PTHREAD_MUTEX_INITIALIZER;
+#define __FC_LOOP_LOCK()   do { pthread_mutex_lock( &fc_loop_mtx );   } while (0)
+#define __FC_LOOP_UNLOCK() do { pthread_mutex_unlock( &fc_loop_mtx ); } while (0)
+#else
+#define __FC_LOOP_LOCK()   do {} while (0)
+#define __FC_LOOP_UNLOCK() do {} while (0)
+#endif
+
+/* Return endpoint 'sd' (called with the lock held) */
+static FcLoopEp *
+fc_loop_ep(int sd)
+{
+	if ( sd < 0 || sd >= FC_LOOP_EPS_MAX )
+		return 0;
+	return fc_loop_eps[sd];
+}
+
+static int
+fc_loop_socket(int port)
+{
+int       sd;
+FcLoopEp *ep;
+
+#if ! defined(USE_PTHREADS) && defined(USE_EPICS)
+	/* the RX task could not block in 'recv_from' */
+	return -ENOTSUP;
+#endif
+
+	if ( port < 0 || port > 0xffff )
+		return -EINVAL;
+
+	if ( ! (ep = calloc(1, sizeof(*ep))) )
+		return -ENOMEM;
+
+#ifdef USE_PTHREADS
+	{
+	pthread_condattr_t catts;
+	int                err;
+		pthread_condattr_init( &catts );
+		pthread_condattr_setclock( &catts, CLOCK_MONOTONIC );
+		err = pthread_cond_init( &ep->cnd, &catts );
+		pthread_condattr_destroy( &catts );
+		if ( err ) {
+			free( ep );
+			return -err;
+		}
+	}
+#endif
+
+	__FC_LOOP_LOCK();
+	for ( sd = 0; sd < FC_LOOP_EPS_MAX && fc_loop_eps[sd]; sd++ )
+		/* find a free slot */;
+	if ( sd < FC_LOOP_EPS_MAX ) {
+		ep->port        = port ? port : FC_LOOP_PORT_EPH + sd;
+		fc_loop_eps[sd] = ep;
+	}
+	__FC_LOOP_UNLOCK();
+
+	if ( sd >= FC_LOOP_EPS_MAX ) {
+#ifdef USE_PTHREADS
+		pthread_cond_destroy( &ep->cnd );
+#endif
+		free( ep );
+		return -EMFILE;
+	}
+
+	return sd;
+}
+
+static int
+fc_loop_close(int sd)
+{
+FcLoopEp *ep;
+
+	__FC_LOOP_LOCK();
+	if ( (ep = fc_loop_ep(sd)) )
+		fc_loop_eps[sd] = 0;
+	__FC_LOOP_UNLOCK();
+
+	if ( ! ep )
+		return -EBADF;
+
+	while ( ep->tail != ep->head )
+		udpCommFreePacket( ep->q[ep->tail++ & (FC_LOOP_QDEPTH - 1)].pkt );
+
+#ifdef USE_PTHREADS
+	pthread_cond_destroy( &ep->cnd );
+#endif
+	free( ep );
+	return 0;
+}
+
+static UdpCommPkt
+fc_loop_recv_from(int sd, int timeout_ms, uint32_t *p_peer_ip, uint16_t *p_peer_port)
+{
+FcLoopEp   *ep;
+FcLoopPkt  *lp;
+UdpCommPkt  p = 0;
+#ifdef USE_PTHREADS
+struct timespec t;
+
+	if ( timeout_ms > 0 ) {
+		clock_gettime( CLOCK_MONOTONIC, &t );
+		t.tv_sec  += timeout_ms / 1000;
+		t.tv_nsec += (timeout_ms % 1000) * 1000000L;
+		if ( t.tv_nsec >= 1000000000L ) {
+			t.tv_nsec -= 1000000000L;
+			t.tv_sec++;
+		}
+	}
+#endif
+
+	__FC_LOOP_LOCK();
+	if ( (ep = fc_loop_ep(sd)) ) {
+#ifdef USE_PTHREADS
+		while ( ep->tail == ep->head && timeout_ms ) {
+			if ( timeout_ms < 0 ) {
+				pthread_cond_wait( &ep->cnd, &fc_loop_mtx );
+			} else if ( ETIMEDOUT == pthread_cond_timedwait( &ep->cnd, &fc_loop_mtx, &t ) ) {
+				break;
+			}
+		}
+#endif
+		if ( ep->tail != ep->head ) {
+			lp = &ep->q[ep->tail++ & (FC_LOOP_QDEPTH - 1)];
+			p  = lp->pkt;
+			if ( p_peer_ip )
+				*p_peer_ip   = htonl( INADDR_LOOPBACK );
+			if ( p_peer_port )
+				*p_peer_port = lp->port;
+		}
+	}
+	__FC_LOOP_UNLOCK();
+
+	return p;
+}
+
+/* Queue 'p' on 'ep' (called with the lock held); the packet
+ * is consumed in any case.
+ */
+static void
+fc_loop_enq(FcLoopEp *ep, UdpCommPkt p, uint16_t port)
+{
+FcLoopPkt *lp;
+
+	if ( ep->head - ep->tail >= FC_LOOP_QDEPTH ) {
+		udpCommFreePacket( p );
+		return;
+	}
+	lp       = &ep->q[ep->head++ & (FC_LOOP_QDEPTH - 1)];
+	lp->pkt  = p;
+	lp->port = port;
+#ifdef USE_PTHREADS
+	pthread_cond_signal( &ep->cnd );
+#endif
+}
+
+static int
+fc_loop_send_pkt_to(int sd, UdpCommPkt pkt, int len, uint32_t dipaddr, int dport)
+{
+FcLoopEp   *src, *ep, *prv = 0;
+UdpCommPkt  p;
+int         i, mc;
+uint32_t    slot;
+int         rval = len;
+
+	mc   = IN_MULTICAST( ntohl(dipaddr) );
+	slot = ntohl(dipaddr) & FCOM_GID_MAX;
+
+	__FC_LOOP_LOCK();
+	if ( ! (src = fc_loop_ep(sd)) ) {
+		rval = -EBADF;
+	} else if ( len < 0 || len > UDPCOMM_PKTSZ ) {
+		rval = -EMSGSIZE;
+	} else {
+		for ( i = 0; i < FC_LOOP_EPS_MAX; i++ ) {
+			if ( ! (ep = fc_loop_ep(i)) || ep->port != dport )
+				continue;
+			if ( mc && ep->groups[slot] != dipaddr )
+				continue;
+			/* every receiver but the last one gets a copy */
+			if ( prv ) {
+				if ( ! (p = udpCommAllocPacket()) ) {
+					rval = -ENOMEM;
+					break;
+				}
+				memcpy( udpCommBufPtr(p), udpCommBufPtr(pkt), len );
+				fc_loop_enq( prv, p, src->port );
+			}
+			prv = ep;
+			if ( ! mc )
+				break;
+		}
+		if ( prv ) {
+			fc_loop_enq( prv, pkt, src->port );
+			pkt = 0;
+		}
+	}
+	__FC_LOOP_UNLOCK();
+
+	if ( pkt )
+		udpCommFreePacket( pkt );
+
+	return rval;
+}
+
+static int
+fc_loop_send_to(int sd, void *buf, int len, uint32_t dipaddr, int dport)
+{
+UdpCommPkt p;
+
+	if ( len < 0 || len > UDPCOMM_PKTSZ )
+		return -EMSGSIZE;
+
+	if ( ! (p = udpCommAllocPacket()) )
+		return -ENOMEM;
+
+	memcpy( udpCommBufPtr(p), buf, len );
+
+	return fc_loop_send_pkt_to(sd, p, len, dipaddr, dport);
+}
+
+static int
+fc_loop_join_mcast(int sd, uint32_t mcaddr)
+{
+FcLoopEp *ep;
+
+	__FC_LOOP_LOCK();
+	if ( (ep = fc_loop_ep(sd)) )
+		ep->groups[ ntohl(mcaddr) & FCOM_GID_MAX ] = mcaddr;
+	__FC_LOOP_UNLOCK();
+
+	return ep ? 0 : -EBADF;
+}
+
+static int
+fc_loop_leave_mcast(int sd, uint32_t mcaddr)
+{
+FcLoopEp *ep;
+uint32_t  slot = ntohl(mcaddr) & FCOM_GID_MAX;
+
+	__FC_LOOP_LOCK();
+	if ( (ep = fc_loop_ep(sd)) && ep->groups[slot] == mcaddr )
+		ep->groups[slot] = 0;
+	__FC_LOOP_UNLOCK();
+
+	return ep ? 0 : -EBADF;
+}
+
+const FcomXport fcom_xport_loop = {
+	"loop",
+	0,
+	fc_loop_socket,
+	fc_loop_close,
+	fc_loop_recv_from,
+	fc_loop_send_to,
+	fc_loop_send_pkt_to,
+	fc_loop_join_mcast,
+	fc_loop_leave_mcast
+};
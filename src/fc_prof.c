@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'fcom', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+/* Stage profiler; see fc_prof.h */
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+#include <fcomP.h>
+
+#include <string.h>
+#include <inttypes.h>
+
+/* Histogram bin of a sample */
+static unsigned
+fc_prof_bin(uint32_t v)
+{
+int e;
+	if ( v < 8 )
+		return v;
+	e = fcom_nzbits(v) - 1;
+	return (e - 2) * 8 + ((v >> (e - 3)) & 7);
+}
+
+/* Largest value falling into bin 'b' */
+static uint32_t
+fc_prof_bin_top(unsigned b)
+{
+unsigned e;
+	if ( b < 8 )
+		return b;
+	e = b/8 + 2;
+	return (((uint64_t)(8 + b%8) + 1) << (e - 3)) - 1;
+}
+
+void
+fcom_prof_add(FcomProfStage *s, uint64_t ns)
+{
+uint32_t v = ns > 0xffffffffULL ? 0xffffffff : (uint32_t)ns;
+
+	if ( 0 == s->n || v < s->min_ns )
+		s->min_ns = v;
+	if ( v > s->max_ns )
+		s->max_ns = v;
+	s->sum_ns += v;
+	s->bin[fc_prof_bin(v)]++;
+	s->n++;
+}
+
+void
+fcom_prof_enable(FcomProf *p, int on)
+{
+	p->on = 0;
+	if ( on ) {
+		memset( p->st, 0, sizeof(p->st) );
+		p->on = 1;
+	}
+}
+
+/* Value below which a fraction 'pcnt'/100 of the samples
+ * lie (upper edge of the bin; never more than the max.)
+ */
+static uint32_t
+fc_prof_pcnt(FcomProfStage *s, unsigned pcnt)
+{
+uint64_t lim, cum;
+unsigned b;
+uint32_t v;
+
+	if ( 0 == s->n )
+		return 0;
+	lim = ((uint64_t)s->n * pcnt + 99)/100;
+	for ( b = 0, cum = 0; b < FCOM_PROF_BINS - 1; b++ ) {
+		if ( (cum += s->bin[b]) >= lim )
+			break;
+	}
+	v = fc_prof_bin_top(b);
+	return v > s->max_ns ? s->max_ns : v;
+}
+
+int
+fcom_prof_get(FcomProf *p, unsigned s, unsigned what, uint64_t *p_val)
+{
+FcomProfStage *st;
+
+	if ( s >= FCOM_PROF_STAGES_MAX )
+		return FCOM_ERR_UNSUPP;
+	st = &p->st[s];
+	switch ( what ) {
+		case FCOM_PROF_NUM: *p_val = st->n;                           break;
+		case FCOM_PROF_MIN: *p_val = st->min_ns;                      break;
+		case FCOM_PROF_AVG: *p_val = st->n ? st->sum_ns/st->n : 0;    break;
+		case FCOM_PROF_MAX: *p_val = st->max_ns;                      break;
+		case FCOM_PROF_P50: *p_val = fc_prof_pcnt(st, 50);            break;
+		case FCOM_PROF_P99: *p_val = fc_prof_pcnt(st, 99);            break;
+		default:
+		return FCOM_ERR_UNSUPP;
+	}
+	return 0;
+}
+
+void
+fcom_prof_dump(FILE *f, const char *title, FcomProf *p, const char * const names[], unsigned nstages)
+{
+unsigned       i;
+FcomProfStage *st;
+
+	if ( ! f )
+		f = stdout;
+	fprintf(f, "%s (%s):\n", title, p->on ? "enabled" : "disabled");
+	fprintf(f, "  %-8s %10s %9s %9s %9s %9s %9s\n",
+	           "stage", "samples", "min/ns", "avg/ns", "p50/ns", "p99/ns", "max/ns");
+	for ( i = 0; i < nstages && i < FCOM_PROF_STAGES_MAX; i++ ) {
+		st = &p->st[i];
+		fprintf(f, "  %-8s %10"PRIu32" %9"PRIu32" %9"PRIu64" %9"PRIu32" %9"PRIu32" %9"PRIu32"\n",
+		           names[i], st->n, st->min_ns, st->n ? st->sum_ns/st->n : (uint64_t)0,
+		           fc_prof_pcnt(st, 50), fc_prof_pcnt(st, 99), st->max_ns);
+	}
+}
@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'fcom', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef FCOM_PROF_H
+#define FCOM_PROF_H
+
+/* Stage profiler (internal).
+ *
+ * The RX and TX paths are divided into 'stages' (see
+ * FCOM_PROF_RX_xxx, FCOM_PROF_TX_xxx in fcom_api.h). When
+ * profiling is enabled the time spent in each stage is
+ * measured with the monotonic clock and accumulated into
+ * a histogram; min/avg/max and percentiles are derived
+ * from that.
+ *
+ * When profiling is disabled each probe costs a single
+ * test of the 'on' flag.
+ *
+ * Samples are accumulated w/o locking; concurrent senders
+ * may occasionally lose a sample (informational only).
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* Max. number of stages of a profile */
+#define FCOM_PROF_STAGES_MAX 8
+
+/* Histogram: values < 8ns have a bin each; beyond that every
+ * octave is split into 8 bins (< 12.5% resolution). Samples
+ * are clipped to 32 bits (~4.3s).
+ */
+#define FCOM_PROF_BINS       240
+
+typedef struct FcomProfStage {
+	uint32_t n;
+	uint32_t min_ns;
+	uint32_t max_ns;
+	uint64_t sum_ns;
+	uint32_t bin[FCOM_PROF_BINS];
+} FcomProfStage;
+
+typedef struct FcomProf {
+	volatile int  on;
+	FcomProfStage st[FCOM_PROF_STAGES_MAX];
+} FcomProf;
+
+/* Items of a stage which can be read (fcom_prof_get()) */
+#define FCOM_PROF_NUM  0
+#define FCOM_PROF_MIN  1
+#define FCOM_PROF_AVG  2
+#define FCOM_PROF_MAX  3
+#define FCOM_PROF_P50  4
+#define FCOM_PROF_P99  5
+
+/* Monotonic time in nanoseconds */
+static __inline__
+uint64_t fcom_prof_now(void)
+{
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0 && defined(CLOCK_MONOTONIC)
+struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#else
+struct timeval  now;
+	gettimeofday( &now, 0 );
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_usec * 1000ULL;
+#endif
+}
+
+/* Add a sample to a stage */
+void
+fcom_prof_add(FcomProfStage *s, uint64_t ns);
+
+/* Begin timing; '*t' holds the start of the next stage
+ * (zero if profiling is off).
+ */
+static __inline__ void
+fcom_prof_start(FcomProf *p, uint64_t *t)
+{
+	*t = p->on ? fcom_prof_now() : 0;
+}
+
+/* Account the time since '*t' to stage 's' and start
+ * the next stage.
+ */
+static __inline__ void
+fcom_prof_stage(FcomProf *p, unsigned s, uint64_t *t)
+{
+uint64_t now;
+	if ( p->on && *t ) {
+		now = fcom_prof_now();
+		fcom_prof_add( &p->st[s], now - *t );
+		*t  = now;
+	}
+}
+
+/* Enable/disable profiling; counters are cleared when enabling */
+void
+fcom_prof_enable(FcomProf *p, int on);
+
+/* Read item 'what' (FCOM_PROF_xxx) of stage 's'
+ *
+ * RETURNS: zero on success, FCOM_ERR_UNSUPP if 's' or
+ *          'what' are out of range.
+ */
+int
+fcom_prof_get(FcomProf *p, unsigned s, unsigned what, uint64_t *p_val);
+
+/* Print the stages of a profile to 'f' */
+void
+fcom_prof_dump(FILE *f, const char *title, FcomProf *p, const char * const names[], unsigned nstages);
+
+#endif
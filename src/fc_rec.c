@@ -0,0 +1,389 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+
+/* Recording of received messages and replay of recordings
+ * (see fcom_rec.h for the file layout).
+ *
+ * The receiver (fc_recv.c) serializes access to a recording.
+ * With pthreads, messages are only copied into a ring by the
+ * RX thread and written to the file by a separate thread, i.e.,
+ * the RX thread never blocks on disk I/O; messages which do not
+ * fit into the ring are dropped.
+ */
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+#include <fcom_rec.h>
+#include <fcomP.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h> /* for htonl & friends only */
+
+#ifdef USE_PTHREADS
+#include <pthread.h>
+#endif
+
+/* Write buffer; messages are small compared to this */
+#define FC_REC_BUFSZ   65536
+
+/* Ring holding the records (i.e., the file contents) not
+ * written yet; must be a power of two.
+ */
+#define FC_REC_RINGSZ  (4*1024*1024)
+
+struct FcRec {
+	FILE     *f;
+	uint64_t  n_rec;
+	int       err;     /* first write error (errno) */
+#ifdef USE_PTHREADS
+	/* 'head', 'err' and 'stop' are protected by 'mtx'; only
+	 * the writer modifies 'tail' (also with 'mtx' held).
+	 */
+	pthread_t       tid;
+	pthread_mutex_t mtx;
+	pthread_cond_t  cnd;
+	uint8_t         *ring;
+	uint32_t        head;   /* bytes queued (modulo 2^32)     */
+	uint32_t        tail;   /* bytes written (modulo 2^32)    */
+	int             stop;
+#endif
+};
+
+static void
+fc_rec_put64(uint32_t *p_hi, uint32_t *p_lo, uint64_t v)
+{
+	*p_hi = htonl( (uint32_t)(v >> 32) );
+	*p_lo = htonl( (uint32_t)v );
+}
+
+static uint64_t
+fc_rec_get64(uint32_t hi, uint32_t lo)
+{
+	return ((uint64_t)ntohl(hi) << 32) | ntohl(lo);
+}
+
+#ifdef USE_PTHREADS
+/* Copy 'n' bytes to position 'pos' of the ring */
+static void
+fc_rec_copy(FcRecRef r, uint32_t pos, const void *src, uint32_t n)
+{
+uint32_t off = pos & (FC_REC_RINGSZ - 1);
+uint32_t k   = n < FC_REC_RINGSZ - off ? n : FC_REC_RINGSZ - off;
+
+	memcpy( r->ring + off, src, k );
+	memcpy( r->ring, (const uint8_t*)src + k, n - k );
+}
+
+/* Write the ring's contents to the file; the file is flushed
+ * whenever the ring runs empty. After a write error the data
+ * are discarded.
+ */
+static void *
+fc_rec_writer(void *arg)
+{
+FcRecRef r = arg;
+uint32_t head, tail, off, n;
+int      err;
+
+	pthread_mutex_lock( &r->mtx );
+	while ( r->head != r->tail || ! r->stop ) {
+		if ( r->head == r->tail ) {
+			pthread_cond_wait( &r->cnd, &r->mtx );
+			continue;
+		}
+		head = r->head;
+		err  = r->err;
+		pthread_mutex_unlock( &r->mtx );
+
+		/* at most two pieces (the ring wraps around) */
+		for ( tail = r->tail; tail != head && ! err; tail += n ) {
+			off = tail & (FC_REC_RINGSZ - 1);
+			n   = head - tail < FC_REC_RINGSZ - off ? head - tail : FC_REC_RINGSZ - off;
+			if ( n != fwrite( r->ring + off, 1, n, r->f ) )
+				err = errno ? errno : EIO;
+		}
+
+		pthread_mutex_lock( &r->mtx );
+		if ( ! err && r->head == head ) {
+			pthread_mutex_unlock( &r->mtx );
+			if ( fflush( r->f ) )
+				err = errno ? errno : EIO;
+			pthread_mutex_lock( &r->mtx );
+		}
+		r->tail = head;
+		if ( err && ! r->err )
+			r->err = err;
+	}
+	pthread_mutex_unlock( &r->mtx );
+	return 0;
+}
+
+static int
+fc_rec_writer_start(FcRecRef r)
+{
+int err;
+
+	if ( ! (r->ring = malloc( FC_REC_RINGSZ )) )
+		return FCOM_ERR_NO_MEMORY;
+
+	if ( (err = pthread_mutex_init( &r->mtx, 0 )) )
+		goto bail;
+
+	if ( (err = pthread_cond_init( &r->cnd, 0 )) ) {
+		pthread_mutex_destroy( &r->mtx );
+		goto bail;
+	}
+
+	if ( (err = pthread_create( &r->tid, 0, fc_rec_writer, r )) ) {
+		pthread_cond_destroy( &r->cnd );
+		pthread_mutex_destroy( &r->mtx );
+		goto bail;
+	}
+	return 0;
+
+bail:
+	free( r->ring );
+	r->ring = 0;
+	return FCOM_ERR_SYS(err);
+}
+
+/* Write what is queued and terminate the writer */
+static void
+fc_rec_writer_stop(FcRecRef r)
+{
+	pthread_mutex_lock( &r->mtx );
+		r->stop = 1;
+		pthread_cond_signal( &r->cnd );
+	pthread_mutex_unlock( &r->mtx );
+
+	pthread_join( r->tid, 0 );
+	pthread_cond_destroy( &r->cnd );
+	pthread_mutex_destroy( &r->mtx );
+	free( r->ring );
+}
+#endif
+
+int
+fcom_rec_open(FcRecRef *p_rec, const char *path)
+{
+FcRecRef       r;
+FcomRecFileHdr h;
+struct timeval now;
+int            err;
+
+	if ( ! path || ! *path )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( ! (r = calloc(1, sizeof(*r))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	if ( ! (r->f = fopen(path, "wb")) ) {
+		err = errno;
+		free( r );
+		return FCOM_ERR_SYS(err);
+	}
+	setvbuf( r->f, 0, _IOFBF, FC_REC_BUFSZ );
+
+	h.magic    = htonl( FCOM_REC_MAGIC );
+	h.version  = htonl( FCOM_REC_VERSION );
+	h.hdr_size = htonl( sizeof(FcomRecFileHdr) );
+	h.rec_size = htonl( sizeof(FcomRecHdr) );
+	gettimeofday( &now, 0 );
+	fc_rec_put64( &h.t0_hi, &h.t0_lo, (uint64_t)now.tv_sec * 1000000ULL + now.tv_usec );
+	fc_rec_put64( &h.t0_mono_hi, &h.t0_mono_lo, fcom_now_us() );
+
+	if ( 1 != fwrite( &h, sizeof(h), 1, r->f ) || fflush( r->f ) ) {
+		err = FCOM_ERR_SYS(errno);
+		goto bail;
+	}
+
+#ifdef USE_PTHREADS
+	if ( (err = fc_rec_writer_start( r )) )
+		goto bail;
+#endif
+
+	*p_rec = r;
+	return 0;
+
+bail:
+	fclose( r->f );
+	remove( path );
+	free( r );
+	return err;
+}
+
+int
+fcom_rec_write(FcRecRef r, uint64_t t_us, uint32_t gid, const uint32_t *xmem, uint32_t nints)
+{
+FcomRecHdr h;
+#ifdef USE_PTHREADS
+uint32_t   head, room;
+int        err;
+#endif
+
+	fc_rec_put64( &h.t_hi, &h.t_lo, t_us );
+	h.gid    = htonl( gid );
+	h.nbytes = htonl( nints * sizeof(*xmem) );
+
+	/* message data are XDR, i.e., already in network byte order */
+#ifdef USE_PTHREADS
+	pthread_mutex_lock( &r->mtx );
+		head = r->head;
+		room = FC_REC_RINGSZ - (head - r->tail);
+		err  = r->err;
+	pthread_mutex_unlock( &r->mtx );
+
+	if ( err )
+		return FCOM_ERR_SYS(err);
+
+	if ( room < sizeof(h) + nints * sizeof(*xmem) )
+		return FCOM_ERR_NO_SPACE;
+
+	/* the writer doesn't touch the free part of the ring */
+	fc_rec_copy( r, head, &h, sizeof(h) );
+	fc_rec_copy( r, head + sizeof(h), xmem, nints * sizeof(*xmem) );
+
+	pthread_mutex_lock( &r->mtx );
+		r->head = head + sizeof(h) + nints * sizeof(*xmem);
+		pthread_cond_signal( &r->cnd );
+	pthread_mutex_unlock( &r->mtx );
+#else
+	if (   1     != fwrite( &h, sizeof(h), 1, r->f )
+	    || nints != fwrite( xmem, sizeof(*xmem), nints, r->f ) ) {
+		if ( ! r->err )
+			r->err = errno ? errno : EIO;
+		return FCOM_ERR_SYS(r->err);
+	}
+#endif
+	r->n_rec++;
+	return 0;
+}
+
+int
+fcom_rec_close(FcRecRef r)
+{
+int rval;
+
+#ifdef USE_PTHREADS
+	fc_rec_writer_stop( r );
+#endif
+
+	if ( fclose( r->f ) && ! r->err )
+		r->err = errno;
+
+	rval = r->err ? FCOM_ERR_SYS(r->err) : (r->n_rec > 0x7fffffff ? 0x7fffffff : (int)r->n_rec);
+	free( r );
+	return rval;
+}
+
+/* Sleep until 't_us' (fcom_now_us()) */
+static void
+fc_sleep_until(uint64_t t_us)
+{
+uint64_t        now;
+struct timespec d;
+
+	while ( (now = fcom_now_us()) < t_us ) {
+		d.tv_sec  = (t_us - now) / 1000000;
+		d.tv_nsec = ((t_us - now) % 1000000) * 1000;
+		if ( nanosleep( &d, 0 ) && EINTR != errno )
+			break;
+	}
+}
+
+int
+fcomReplay(const char *path, unsigned flags)
+{
+	return fcomReplayCtx(fcom_dflt_ctx, path, flags);
+}
+
+int
+fcomReplayCtx(FcomCtx ctx, const char *path, unsigned flags)
+{
+FILE           *f;
+FcomRecFileHdr fh;
+FcomRecHdr     rh;
+uint32_t       hsz, rsz, nbytes;
+uint64_t       t, t_first = 0, t_start = 0;
+void           *buf   = 0, *nbuf;
+uint32_t       bufsz  = 0;
+int            n      = 0;
+int            rval   = 0;
+
+	if ( ! ctx || ! ctx->tx || ! path )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( ! (f = fopen(path, "rb")) )
+		return FCOM_ERR_SYS(errno);
+
+	if ( 1 != fread( &fh, sizeof(fh), 1, f ) ) {
+		rval = FCOM_ERR_INVALID_ARG;
+		goto bail;
+	}
+	hsz = ntohl( fh.hdr_size );
+	rsz = ntohl( fh.rec_size );
+	if (   FCOM_REC_MAGIC != ntohl( fh.magic )
+	    || FCOM_REC_VERSION != ntohl( fh.version )
+	    || hsz < sizeof(fh)
+	    || rsz < sizeof(rh) ) {
+		rval = FCOM_ERR_BAD_VERSION;
+		goto bail;
+	}
+	if ( hsz > sizeof(fh) && fseek( f, hsz, SEEK_SET ) ) {
+		rval = FCOM_ERR_SYS(errno);
+		goto bail;
+	}
+
+	while ( 1 == fread( &rh, sizeof(rh), 1, f ) ) {
+
+		if ( rsz > sizeof(rh) && fseek( f, rsz - sizeof(rh), SEEK_CUR ) ) {
+			rval = FCOM_ERR_SYS(errno);
+			goto bail;
+		}
+
+		nbytes = ntohl( rh.nbytes );
+		if ( nbytes > bufsz ) {
+			if ( ! (nbuf = realloc( buf, nbytes )) ) {
+				rval = FCOM_ERR_NO_MEMORY;
+				goto bail;
+			}
+			buf   = nbuf;
+			bufsz = nbytes;
+		}
+		if ( nbytes && 1 != fread( buf, nbytes, 1, f ) ) {
+			/* truncated recording (e.g., still being written) */
+			break;
+		}
+
+		t = fc_rec_get64( rh.t_hi, rh.t_lo );
+		if ( 0 == n ) {
+			t_first = t;
+			t_start = fcom_now_us();
+		} else if ( ! (flags & FCOM_REPLAY_FAST) && t > t_first ) {
+			fc_sleep_until( t_start + (t - t_first) );
+		}
+
+		if ( (rval = fcomSendMsgCtx( ctx, buf, nbytes, (flags & FCOM_REPLAY_LOCAL) ? FCOM_SEND_LOCAL : 0 )) )
+			goto bail;
+
+		n++;
+	}
+
+	rval = n;
+
+bail:
+	free( buf );
+	fclose( f );
+	return rval;
+}
@@ -65,6 +65,8 @@
 
 #ifdef USE_PTHREADS
 #define _XOPEN_SOURCE 500
+/* for pthread_setaffinity_np() & friends */
+#define _GNU_SOURCE
 #endif
 
 #define __INSIDE_FCOM__
@@ -74,6 +76,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
 #include <shtbl.h>
 #include <udpComm.h>
 #include <fcomP.h>
@@ -90,8 +93,11 @@
 #include <pthread.h>
 #include <sched.h>
 
+/* Locks are members of the RX context; the macros
+ * take a pointer to the context as an argument.
+ */
 #define __FC_LOCK_DECL(x) \
-static pthread_mutex_t fcl_##x;
+pthread_mutex_t fcl_##x;
 
 static void fc_lock_create(pthread_mutex_t *p_l)
 {
@@ -147,14 +153,27 @@ int err;
 	} 
 }
 
-#define __FC_LOCK_CRE(x)  do { fc_lock_create(&fcl_##x);        } while (0)
-#define __FC_LOCK_DEL(x)  do { pthread_mutex_destroy(&fcl_##x); } while (0)
+/* RETURNS: zero if the mutex was acquired, nonzero if it is busy */
+static __inline__ int
+fc_trylock(pthread_mutex_t *p_l)
+{
+int err;
+	if ( (err = pthread_mutex_trylock( p_l )) && EBUSY != err ) {
+		/* be paranoid and check return value */
+		fprintf(stderr,
+		        "FATAL (FCOM): Unable to lock mutex: %s\n",
+                strerror(err));
+		abort();
+	}
+	return err;
+}
 
-#define __FC_LOCK()       do { fc_lock(&fcl_tbl);   } while (0)
-#define __FC_UNLOCK()     do { fc_unlock(&fcl_tbl); } while (0)
+#define __FC_LOCK_CRE(r,x)  do { fc_lock_create(&(r)->fcl_##x);        } while (0)
+#define __FC_LOCK_DEL(r,x)  do { pthread_mutex_destroy(&(r)->fcl_##x); } while (0)
 
-#define __FC_LOCK_GRP()   do { fc_lock(&fcl_grp);   } while (0)
-#define __FC_UNLOCK_GRP() do { fc_unlock(&fcl_grp); } while (0)
+#define __FC_MTX_LOCK(r,x)      fc_lock(&(r)->fcl_##x)
+#define __FC_MTX_TRYLOCK(r,x)   fc_trylock(&(r)->fcl_##x)
+#define __FC_MTX_UNLOCK(r,x)    fc_unlock(&(r)->fcl_##x)
 
 #elif defined(USE_EPICS)
 
@@ -163,16 +182,14 @@ int err;
 #include <epicsEvent.h>
 
 #define __FC_LOCK_DECL(x) \
-static epicsMutexId fcl_##x;
+epicsMutexId fcl_##x;
 
-#define __FC_LOCK_CRE(x)  do { fcl_##x = epicsMutexMustCreate(); } while (0)
-#define __FC_LOCK_DEL(x)  do { epicsMutexDestroy( fcl_##x );     } while (0)
+#define __FC_LOCK_CRE(r,x)  do { (r)->fcl_##x = epicsMutexMustCreate(); } while (0)
+#define __FC_LOCK_DEL(r,x)  do { epicsMutexDestroy( (r)->fcl_##x );     } while (0)
 
-#define __FC_LOCK()       do { epicsMutexMustLock( fcl_tbl );    } while (0)
-#define __FC_UNLOCK()     do { epicsMutexUnlock  ( fcl_tbl );    } while (0)
-
-#define __FC_LOCK_GRP()   do { epicsMutexMustLock( fcl_grp );    } while (0)
-#define __FC_UNLOCK_GRP() do { epicsMutexUnlock  ( fcl_grp );    } while (0)
+#define __FC_MTX_LOCK(r,x)      epicsMutexMustLock( (r)->fcl_##x )
+#define __FC_MTX_TRYLOCK(r,x)   ( epicsMutexLockOK != epicsMutexTryLock( (r)->fcl_##x ) )
+#define __FC_MTX_UNLOCK(r,x)    epicsMutexUnlock( (r)->fcl_##x )
 
 #else /* no multithreading support */
 
@@ -180,14 +197,63 @@ static epicsMutexId fcl_##x;
 
 #define __FC_LOCK_DECL(x)
 
-#define __FC_LOCK_CRE(x)  do {} while (0)
-#define __FC_LOCK_DEL(x)  do {} while (0)
+#define __FC_LOCK_CRE(r,x)  do {} while (0)
+#define __FC_LOCK_DEL(r,x)  do {} while (0)
+
+#define __FC_LOCK(r)        do { (void)(r); } while (0)
+#define __FC_UNLOCK(r)      do { (void)(r); } while (0)
+
+#define __FC_LOCK_RX(r)     do { (void)(r); } while (0)
+#define __FC_UNLOCK_RX(r)   do { (void)(r); } while (0)
+
+#define __FC_LOCK_GRP(r)    do {} while (0)
+#define __FC_UNLOCK_GRP(r)  do {} while (0)
+
+#define __FC_LOCK_REC(r)    do {} while (0)
+#define __FC_UNLOCK_REC(r)  do {} while (0)
+#endif
+
+#if defined(USE_PTHREADS) || defined(USE_EPICS)
+/* Lock and unlock mutex 'x' of RX context 'r' and gather
+ * lock statistics if enabled (fcomSetLockStats()). The
+ * statistics of a mutex are protected by the mutex itself.
+ * A release is timed if the acquisition was ('t_acq' set)
+ * so that enabling/disabling never produces bogus samples.
+ */
+#define __FC_LOCK_X(r,x) do {                      \
+	if ( (r)->lks_on ) {                           \
+		uint64_t __fc_t0 = 0;                      \
+		if ( __FC_MTX_TRYLOCK(r,x) ) {             \
+			__fc_t0 = fcom_now_ns();               \
+			__FC_MTX_LOCK(r,x);                    \
+		}                                          \
+		fc_lks_acquired( &(r)->lks_##x, __fc_t0 ); \
+	} else {                                       \
+		__FC_MTX_LOCK(r,x);                        \
+	}                                              \
+} while (0)
+
+#define __FC_UNLOCK_X(r,x,p_acc) do {              \
+	if ( (r)->lks_##x.t_acq )                      \
+		fc_lks_released( &(r)->lks_##x, p_acc );   \
+	__FC_MTX_UNLOCK(r,x);                          \
+} while (0)
+
+#define __FC_LOCK(r)        __FC_LOCK_X(r,tbl)
+#define __FC_UNLOCK(r)      __FC_UNLOCK_X(r,tbl,0)
+
+/* Used by the RX thread; the hold time is also accounted
+ * to the message being processed.
+ */
+#define __FC_LOCK_RX(r)     __FC_LOCK_X(r,tbl)
+#define __FC_UNLOCK_RX(r)   __FC_UNLOCK_X(r,tbl,&(r)->lks_msg_ns)
 
-#define __FC_LOCK()       do {} while (0)
-#define __FC_UNLOCK()     do {} while (0)
+#define __FC_LOCK_GRP(r)    __FC_LOCK_X(r,grp)
+#define __FC_UNLOCK_GRP(r)  __FC_UNLOCK_X(r,grp,0)
 
-#define __FC_LOCK_GRP()   do {} while (0)
-#define __FC_UNLOCK_GRP() do {} while (0)
+/* Recording (not instrumented) */
+#define __FC_LOCK_REC(r)    do { __FC_MTX_LOCK(r,rec);   } while (0)
+#define __FC_UNLOCK_REC(r)  do { __FC_MTX_UNLOCK(r,rec); } while (0)
 #endif
 
 #if defined(SUPPORT_SYNCGET) && !defined(USE_PTHREADS)
@@ -208,19 +274,6 @@ static epicsMutexId fcl_##x;
 /* Macro to verify that an FCOM id is of major protocol version 1 */
 #define NOT_V1(idnt) ( FCOM_GET_MAJ(idnt) != FCOM_PROTO_MAJ_1 )
 
-/* Maintain a reference count for multicast groups.
- * The rationale is that any given BSD socket (and
- * udpComm largely emulates BSD semantics) cannot
- * join the same MC group more than once. Hence,
- * in order to implement nesting fcomSubscribe()/fcomUnsubscribe()
- * routines we need to maintain a reference count
- * for MC groups and join only when we subscribe to
- * a given GID for the first time. fcomUnsubscribe()
- * decrements the reference count and leaves the MC
- * group when a reference count of zero is reached.
- */
-static uint16_t fc_gid_refcnt[FCOM_GID_MAX+1] = {0};
-
 /*
  * Buffer management.
  * 
@@ -230,11 +283,46 @@ static uint16_t fc_gid_refcnt[FCOM_GID_MAX+1] = {0};
 
 typedef struct Buf *BufRef;
 
+/* Latency histograms (fcomSetRxLatencyStats()) */
+typedef struct FcLatStats {
+	FcomLatHist    net;            /* arrival - blob timestamp          */
+	FcomLatHist    app;            /* fcomGetBlob() - arrival           */
+} FcLatStats;
+
+/* Statistics of a mutex (fcomSetLockStats()) */
+typedef struct FcLockStats {
+	FcomLockStats  s;
+	uint64_t       t_acq;          /* fcom_now_ns() of acquisition; 0 if
+	                                * the current hold is not timed
+	                                */
+} FcLockStats;
+
+/* Inter-arrival statistics of an ID; mean and variance
+ * are accumulated with Welford's method, 'ewma_us' follows
+ * recent changes of the rate.
+ */
+typedef struct FcArrStats {
+	uint64_t       last_us;        /* last arrival (fcom_now_us(); 0: none) */
+	uint32_t       n;              /* number of intervals               */
+	uint32_t       max_us;         /* longest interval                  */
+	double         mean_us;        /* mean interval                     */
+	double         m2;             /* sum of squared deviations         */
+	double         ewma_us;        /* recent mean interval              */
+} FcArrStats;
+
 /* A buffer 'header' for maintaining internal data;
  * the 'ptr' member is used to keep buffers on a linked
  * 'free' list while not in use. If the buffer is in-use
  * then the 'ptr' member points to a pthread condition
  * variable which supports synchronous FCOM operation.
+ * The 'rx' member identifies the RX context which owns
+ * the buffer. The 'lat' member (latency histograms of the
+ * ID) is handed on to the buffer with the next update
+ * (like the condition variable) and so are the inter-
+ * arrival statistics ('arr').
+ * 'usrCnt' counts the references held by fcomGetBlob()
+ * callers; 'getTime' is when the first of them was
+ * obtained (for the hold-time histogram).
  */
 typedef struct BufHdr {
 	union {
@@ -244,11 +332,19 @@ typedef struct BufHdr {
 	pthread_cond_t *cond;          /* cond. var. (while buf in use)     */
 #endif
 	}              ptr;            /* multi-use pointer                 */
+	struct FcomRxCtx *rx;          /* owning RX context                 */
 	uint16_t       subCnt, refCnt; /* subscription and reference counts */
-	uint16_t       size;           /* size of this buffer               */
+	uint32_t       size;           /* size of this buffer               */
 	uint8_t        type;           /* type of this buffer               */
 	uint8_t        setNodeIdx;     /* idx into set node table (if != 0) */
+	uint16_t       usrCnt;         /* references held by the user       */
 	uint32_t       updCnt;         /* statistics; # of received blobs   */
+	uint64_t       rxTime;         /* arrival (ns past EPICS epoch; 0:  */
+	                               /* latency statistics disabled)      */
+	FcLatStats     *lat;           /* latency histograms of this ID     */
+	FcArrStats     *arr;           /* inter-arrival times of this ID    */
+	uint32_t       getTime;        /* fcom_now_us() of first user ref.  */
+	uint32_t       seqEpoch;       /* FcSeqGid 'epoch' when data stored */
 } BufHdr, *BufHdrRef;
 
 /* A buffer consists of a 'header' and 'payload'-data
@@ -278,80 +374,396 @@ typedef struct FcomBlobSetHdr {
 	FcomBlobSetMask  gotsofar;
 	int              waitforall;
 	pthread_cond_t   cond;      /* cond. var. (while buf in use)     */
+	struct FcomRxCtx *rx;       /* RX context the set belongs to     */
 	FcomBlobSet      set;
 } FcomBlobSetHdr;
 
 /* Vector table for BlobSetNodes so that we only
  * need 1 byte in a BufHdr
  */
-static union {
+typedef union SetNode {
 	FcomBlobSetMemb *node;
 	unsigned         next;	/* for linking on a 'free' list */
-} setNodeTbl[ 1 << (8*sizeof(((BufHdrRef)0)->setNodeIdx)) ] = {{0}};
+} SetNode;
 
-#define SET_NODE_TOTAL ((int)(sizeof(setNodeTbl)/sizeof(setNodeTbl[0]) - 1))
+#define SET_NODE_TOTAL ((int)((1 << (8*sizeof(((BufHdrRef)0)->setNodeIdx))) - 1))
 
-static int setNodeAvail = SET_NODE_TOTAL;
-
-#define SET_NODE_FREE_LIST setNodeTbl[0].next
+#define SET_NODE_FREE_LIST(r) (r)->setNodeTbl[0].next
 
 #endif /* SUPPORT_SETS for blob sets */
 
-/* Pools of buffers of different sizes */
-static struct {
+/* Pool of buffers of a given size */
+typedef struct BufPool {
 	BufRef      free_list;
 	BufChunkRef chunks;		/* linked-list of chunks of buffers */
-	uint16_t    sz;         /* size of this buffer pool         */
+	uint32_t    sz;         /* size of this buffer pool         */
 	unsigned    tot;        /* stats: tot. # of bufs of this sz */
 	unsigned    avail;      /* stats: avail. bufs of this size  */
 	unsigned    wght;       /* relative amount at startup       */
-} fc_free [] =  {
+	unsigned    max_used;   /* stats: high-water mark in use    */
+	uint64_t    n_alloc;    /* stats: allocations from this sz  */
+	uint64_t    n_fallback; /* stats: requests for this sz      */
+	                        /* served by a bigger one           */
+	uint64_t    n_fail;     /* stats: failed requests (this sz) */
+} BufPool;
+
+/* Sizes and relative amounts of the buffer pools;
+ * every RX context is initialized from this template.
+ * The large buffers (for reassembled messages) are
+ * not populated at startup (fcomAddRxBufs()) unless
+ * udpComm was built for jumbo frames: a blob from a
+ * single datagram must always find a buffer. The
+ * largest class holds 65535 doubles.
+ */
+static const BufPool fc_free_tmpl [] =  {
 	{ wght: 4, free_list: 0, chunks: 0, sz:    64, tot: 0, avail: 0 },
 	{ wght: 2, free_list: 0, chunks: 0, sz:   128, tot: 0, avail: 0 },
 	{ wght: 1, free_list: 0, chunks: 0, sz:   512, tot: 0, avail: 0 },
 	{ wght: 1, free_list: 0, chunks: 0, sz:  2048, tot: 0, avail: 0 },
+	{ wght: UDPCOMM_PKTSZ > 2048, free_list: 0, chunks: 0, sz:  9216, tot: 0, avail: 0 },
+	{ wght: 0, free_list: 0, chunks: 0, sz: 65536, tot: 0, avail: 0 },
+	{ wght: 0, free_list: 0, chunks: 0, sz:528384, tot: 0, avail: 0 },
 };
 
-#define NBUFKINDS (sizeof(fc_free)/sizeof(fc_free[0]))
-
-/* Some statistics */
-static volatile struct {
-	uint32_t	bad_msg_version;	/* messages with bad/unknown/unsupported version received */
-	uint32_t	bad_blb_version;	/* blobs with bad/unknown/unsupported version received    */
-	uint32_t    no_bufs;            /* fc_getb() failed due to lack of free buffers           */
-	uint32_t    dec_errs;			/* xdr decoder errors encountered                         */
-	uint32_t    n_msg;              /* # of messages/groups received so far                   */
-	uint32_t    n_blb;              /* # of blobs received so far                             */
-	uint32_t    bad_cond_bcst;		/* # of failed pthread_cond_broadcast()s                  */
+#define NBUFKINDS (sizeof(fc_free_tmpl)/sizeof(fc_free_tmpl[0]))
+
+/* Reassembly of fragmented messages. A fragmented message
+ * is collected in a (large) buffer from the pool.
+ */
+#define FC_REASM_SLOTS   8         /* max. # of concurrent reassemblies     */
+/* max. payload of a fragment (it must fit into a received datagram) */
+#define FC_FRAG_LEN_MAX  (UDPCOMM_PKTSZ/sizeof(uint32_t) - FCOM_XDR_FRAG_HDRSZ)
+#ifndef FC_REASM_TMO_US
+#define FC_REASM_TMO_US  200000    /* drop incomplete reassemblies after... */
+#endif
+
+typedef struct FcReasm {
+	uint32_t         xid;          /* transfer ID                           */
+	uint32_t         nints;        /* size of the message                   */
+	uint16_t         nfrags;       /* # of fragments (0: slot unused)       */
+	uint16_t         ngot;         /* # of fragments received so far        */
+	uint32_t         flen;         /* length of all but the last fragment   */
+	uint64_t         t_start;      /* when first fragment was received      */
+	BufRef           buf;          /* holds message (NULL: not wanted)      */
+	uint32_t         got[FCOM_MSG_MAX_FRAGS/32];
+} FcReasm;
+
+/* Sequence numbers of the messages of every sender
+ * to a GID are tracked in order to detect loss,
+ * duplication and reordering.
+ *
+ * The 'epoch' of a GID is advanced whenever messages may
+ * have been lost (gap, new or restarted sender). A sparse
+ * update is only applied to data stored in the current
+ * epoch, i.e., after a loss a complete blob must arrive
+ * first.
+ */
+#define FC_SEQ_SRCS      4         /* max. # of senders tracked per GID      */
+#define FC_SEQ_RESYNC    32        /* steps back beyond the 'seen' window:   */
+                                   /* sender restarted                       */
+
+typedef struct FcSeqSrc {
+	uint32_t         ip;           /* sender address and port               */
+	uint16_t         port;
+	uint32_t         last;         /* highest sequence number (0: unused)   */
+	uint32_t         seen;         /* bitmap of last, last-1, ... received  */
+	uint32_t         used;         /* when last heard from (LRU)            */
+} FcSeqSrc;
+
+typedef struct FcSeqGid {
+	uint32_t         gaps;         /* statistics of this GID                */
+	uint32_t         dups;
+	uint32_t         reord;
+	uint32_t         stale;
+	uint32_t         epoch;
+	FcSeqSrc         src[FC_SEQ_SRCS];
+} FcSeqGid;
+
+/* All state of the receiving part of a FCOM context.
+ * Formerly, this was held in file-scope variables.
+ */
+typedef struct FcomRxCtx {
+	FcomCtx          ctx;           /* context we belong to                 */
+
+	/* Hash table for received buffers indexed by BLOB ID. */
+	SHTbl            bTbl;
+
+	/* Pools of buffers of different sizes */
+	BufPool          fc_free[NBUFKINDS];
+
+	/* Time consumers hold references (protected by fcl_tbl) */
+	FcomLatHist      hold;
+	FcomID           hold_max_idnt; /* ID held for 'hold.max_us'            */
+	uint32_t         n_usr;         /* # of fcomGetBlob() refs. outstanding */
+
+	/* Statistics; 'fc_stats' is private to the RX thread which
+	 * copies it to 'fc_stats_pub' after every message. Only this
+	 * copy is done under the sequence lock 'stats_seq'
+	 * (fcom_seq_xxx()) so that readers never wait for a message
+	 * to be processed.
+	 */
+	FcomRxStats      fc_stats;
+	FcomRxStats      fc_stats_pub;
+	volatile uint32_t stats_seq;
+#if defined(SUPPORT_SETS)
+	uint32_t         n_set;         /* # of sets currently in use           */
+#endif
+
+	/* A lock for protecting the hash table */
+	__FC_LOCK_DECL(tbl)
+	/* A lock for protecting the GID reference count
+	 * --- this also serializes all subscribe/unsubscribe
+	 * operations (which don't have to be deterministic)
+	 */
+	__FC_LOCK_DECL(grp)
+
+	/* Lock statistics; 'lks_tbl' and 'lks_grp' are protected
+	 * by the respective lock, the others are written by the
+	 * RX thread only ('lks_msg' is read under 'stats_seq').
+	 */
+	int              lks_on;
+	FcLockStats      lks_tbl;
+	FcLockStats      lks_grp;
+	FcomLatHist      lks_msg;       /* 'tbl' held per message (RX thread)  */
+	uint64_t         lks_msg_ns;    /* the same for the current message    */
+	volatile int     lks_msg_clr;   /* request to clear 'lks_msg'          */
+
+	/* Recording of received messages (fcomRecordStart());
+	 * 'rec' is only changed with 'fcl_rec' held.
+	 */
+	FcRecRef         rec;
+	__FC_LOCK_DECL(rec)
+
+	/* Maintain a reference count for multicast groups.
+	 * The rationale is that any given BSD socket (and
+	 * udpComm largely emulates BSD semantics) cannot
+	 * join the same MC group more than once. Hence,
+	 * in order to implement nesting fcomSubscribe()/fcomUnsubscribe()
+	 * routines we need to maintain a reference count
+	 * for MC groups and join only when we subscribe to
+	 * a given GID for the first time. fcomUnsubscribe()
+	 * decrements the reference count and leaves the MC
+	 * group when a reference count of zero is reached.
+	 */
+	uint16_t         fc_gid_refcnt[FCOM_GID_MAX+1];
+
 #if defined(SUPPORT_SETS)
-	uint32_t    n_set;              /* # of sets currently in use                             */
+	SetNode          setNodeTbl[SET_NODE_TOTAL + 1];
+	int              setNodeAvail;
+#endif
+
+	/* Reassembly of fragmented messages (RX thread only) */
+	FcReasm          reasm[FC_REASM_SLOTS];
+	int              reasm_busy;
+
+	/* Sequence number tracking (RX thread only; created
+	 * when the first numbered message of a GID arrives).
+	 */
+	FcSeqGid         *seq[FCOM_GID_MAX+1];
+	uint32_t         seq_clock;
+	int              seq_drop;      /* drop stale messages                  */
+	uint32_t         peer_ip;       /* sender of the current message        */
+	uint16_t         peer_port;
+
+	/* Latency statistics of all blobs (protected by fcl_tbl) */
+	FcLatStats       lat;
+	int              lat_on;
+	uint64_t         rx_time;       /* arrival of the current message       */
+	uint64_t         arr_us;        /* the same (fcom_now_us())             */
+
+	/* Start of the current profiling stage (RX thread only) */
+	uint64_t         prof_t;
+
+	/* RX thread control */
+	volatile int     running;
+	int              started;
+#if defined(USE_PTHREADS)
+	pthread_t        tid;
+#elif defined(USE_EPICS)
+	epicsThreadId    tid;
+	epicsEventId     term_sync;
+#endif
+} FcomRxCtxRec, *FcomRxCtxRef;
+
+/* Obtain RX context of a FCOM context (NULL if none) */
+#define FC_RX(c) ( (c) ? (c)->rx : 0 )
+
+/* Offset of the EPICS epoch (1990) from the POSIX epoch (seconds) */
+#define FC_EPICS_EPOCH 631152000ULL
+
+/* Wall-clock time in nanoseconds past the EPICS epoch */
+static __inline__ uint64_t
+fc_wallclock_ns(void)
+{
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0
+struct timespec now;
+	clock_gettime( CLOCK_REALTIME, &now );
+	return ((uint64_t)now.tv_sec - FC_EPICS_EPOCH) * 1000000000ULL + now.tv_nsec;
+#else
+struct timeval  now;
+	gettimeofday( &now, 0 );
+	return ((uint64_t)now.tv_sec - FC_EPICS_EPOCH) * 1000000000ULL + now.tv_usec * 1000ULL;
 #endif
-} fc_stats = {0};
+}
+
+/* Add a latency sample (ns) to a histogram */
+static void
+fc_lat_add(FcomLatHist *h, int64_t d_ns)
+{
+uint32_t us;
+int      b;
+
+	if ( d_ns < 0 ) {
+		h->neg++;
+		return;
+	}
+	us = d_ns/1000 > 0xffffffffLL ? 0xffffffff : (uint32_t)(d_ns/1000);
+	if ( (b = us ? fcom_nzbits(us) : 0) >= FCOM_LAT_BINS )
+		b = FCOM_LAT_BINS - 1;
+	h->bin[b]++;
+	h->count++;
+	h->sum_us += us;
+	if ( us > h->max_us )
+		h->max_us = us;
+}
+
+/* Account for an update of an ID arriving at 't_us' */
+static void
+fc_arr_add(FcArrStats *a, uint64_t t_us)
+{
+double iv, d;
+
+	if ( a->last_us && t_us >= a->last_us ) {
+		iv = (double)(t_us - a->last_us);
+		a->n++;
+		d           = iv - a->mean_us;
+		a->mean_us += d / a->n;
+		a->m2      += d * (iv - a->mean_us);
+		a->ewma_us  = 1 == a->n ? iv : a->ewma_us + (iv - a->ewma_us) / 8.;
+		if ( iv > a->max_us )
+			a->max_us = iv > 4294967295. ? 0xffffffff : (uint32_t)iv;
+	}
+	a->last_us = t_us;
+}
+
+/* Convert inter-arrival statistics for the user ('now'
+ * as obtained from fcom_now_us())
+ */
+static void
+fc_arr_get(FcomIDRate *r, const FcArrStats *a, uint32_t updCnt, uint64_t now)
+{
+	r->updates   = updCnt;
+	r->intervals = a->n;
+	r->rate_hz   = a->n && a->ewma_us > 0. ? 1.0E6 / a->ewma_us : 0.;
+	r->mean_us   = a->mean_us;
+	r->stddev_us = a->n > 1 ? sqrt( a->m2 / (a->n - 1) ) : 0.;
+	r->max_us    = a->max_us;
+	r->age_us    = a->last_us && now > a->last_us ? now - a->last_us : 0;
+}
+
+#if defined(USE_PTHREADS) || defined(USE_EPICS)
+/* Account for acquisition of a mutex; 't0' is the time
+ * waiting started if the mutex was busy (zero otherwise).
+ */
+static void
+fc_lks_acquired(FcLockStats *l, uint64_t t0)
+{
+uint64_t now = fcom_now_ns();
 
+	l->s.n_acq++;
+	if ( t0 ) {
+		l->s.n_cont++;
+		fc_lat_add( &l->s.wait, (int64_t)(now - t0) );
+	}
+	l->t_acq = now;
+}
 
-/* A lock for protecting the hash table */
-__FC_LOCK_DECL(tbl)
-/* A lock for protecting the GID reference count
- * --- this also serializes all subscribe/unsubscribe
- * operations (which don't have to be deterministic)
+/* Account for release of a mutex; the hold time is
+ * also added to '*p_acc' (unless NULL).
  */
-__FC_LOCK_DECL(grp)
+static void
+fc_lks_released(FcLockStats *l, uint64_t *p_acc)
+{
+uint64_t d = fcom_now_ns() - l->t_acq;
+
+	fc_lat_add( &l->s.hold, (int64_t)d );
+	if ( p_acc )
+		*p_acc += d;
+	l->t_acq = 0;
+}
+#endif
+
+/* Dump a latency histogram (nonempty bins only) */
+static int
+fc_lat_dump(FILE *f, const char *title, FcomLatHist *h)
+{
+int           i, rval;
+unsigned long lo;
+
+	rval = fprintf(f, "  %s: %"PRIu32" samples", title, h->count);
+	if ( h->count ) {
+		rval += fprintf(f, ", mean %.1f us, max %"PRIu32" us",
+		                (double)h->sum_us/(double)h->count, h->max_us);
+	}
+	rval += fprintf(f, ", %"PRIu32" negative\n", h->neg);
+	for ( i=0; i<FCOM_LAT_BINS; i++ ) {
+		if ( 0 == h->bin[i] )
+			continue;
+		lo = i ? 1UL << (i-1) : 0;
+		if ( i < FCOM_LAT_BINS - 1 )
+			rval += fprintf(f, "    %8lu .. %8lu us: %9"PRIu32"\n", lo, (1UL << i) - 1, h->bin[i]);
+		else
+			rval += fprintf(f, "    %8lu .. %8s us: %9"PRIu32"\n", lo, "", h->bin[i]);
+	}
+	return rval;
+}
 
-/* Hash table for received buffers indexed by BLOB ID. */
-static SHTbl bTbl = 0;
+/* Copy the statistics of (at most 'n') buffer pools.
+ *
+ * RETURNS: total number of pools.
+ *
+ * NOTE:    'fcl_tbl' lock must be held by caller.
+ */
+static unsigned
+fc_pool_stats(FcomRxCtxRef rx, FcomBufPoolStats *p, unsigned n)
+{
+unsigned i;
+	for ( i=0; i<NBUFKINDS && i<n; i++ ) {
+		p[i].size       = rx->fc_free[i].sz;
+		p[i].tot        = rx->fc_free[i].tot;
+		p[i].avail      = rx->fc_free[i].avail;
+		p[i].max_used   = rx->fc_free[i].max_used;
+		p[i].n_alloc    = rx->fc_free[i].n_alloc;
+		p[i].n_fallback = rx->fc_free[i].n_fallback;
+		p[i].n_fail     = rx->fc_free[i].n_fail;
+	}
+	return NBUFKINDS;
+}
 
 /* Dump buffer-pool statistics to FILE 'f' (must not be NULL) */
-static void fc_statb(FILE *f)
+static void fc_statb(FcomRxCtxRef rx, FILE *f)
 {
-int i;
-unsigned t,a;
+int              i;
+FcomBufPoolStats p[NBUFKINDS];
+FcomLatHist      hold;
+FcomID           idnt;
+
+	__FC_LOCK(rx);
+		fc_pool_stats(rx, p, NBUFKINDS);
+		hold = rx->hold;
+		idnt = rx->hold_max_idnt;
+	__FC_UNLOCK(rx);
+
 	fprintf(f,"FCOM Buffer Statistics:\n");
 	for ( i=0; i<NBUFKINDS; i++ ) {
-		t = fc_free[i].tot;
-		a = fc_free[i].avail;
-		fprintf(stderr,"Size %4u: Tot %4u -- Available %4u -- Used %4u\n",
-			fc_free[i].sz, t, a, t-a);
+		fprintf(f,"Size %6"PRIu32": Tot %4"PRIu32" -- Available %4"PRIu32" -- Used %4"PRIu32" (max. %4"PRIu32")"
+		          " -- Fallbacks %6"PRIu64" -- Failed %6"PRIu64"\n",
+			p[i].size, p[i].tot, p[i].avail, p[i].tot - p[i].avail, p[i].max_used,
+			p[i].n_fallback, p[i].n_fail);
 	}
+	fc_lat_dump( f, "hold time get - release      ", &hold );
+	if ( hold.count )
+		fprintf(f, "  longest held: ID 0x%08"PRIx32"\n", idnt);
 }
 
 static __inline__ BufRef
@@ -371,26 +783,43 @@ BLOB2BUFR(FcomBlobRef p_blob)
  *          - pointer member in header is set to NULL.
  */
 static BufRef
-fc_getb(uint16_t sz)
+fc_getb(FcomRxCtxRef rx, uint32_t sz)
 {
-int i;
-BufRef rval;
+int     i;
+int     req = -1;
+unsigned used;
+BufRef  rval;
 
 	sz += sizeof(Buf);
 
 	for ( i=0; i<NBUFKINDS; i++ ) {
-		if ( sz <= fc_free[i].sz ) {
-			if ( (rval = fc_free[i].free_list) ) {
-				fc_free[i].free_list = rval->hdr.ptr.next;
-				fc_free[i].avail--;
+		if ( sz <= rx->fc_free[i].sz ) {
+			if ( req < 0 )
+				req = i;
+			if ( (rval = rx->fc_free[i].free_list) ) {
+				rx->fc_free[i].free_list = rval->hdr.ptr.next;
+				rx->fc_free[i].avail--;
+				rx->fc_free[i].n_alloc++;
+				used = rx->fc_free[i].tot - rx->fc_free[i].avail;
+				if ( used > rx->fc_free[i].max_used )
+					rx->fc_free[i].max_used = used;
+				if ( i != req )
+					rx->fc_free[req].n_fallback++;
 				rval->hdr.refCnt     = 1;
+				rval->hdr.usrCnt     = 0;
 				rval->hdr.ptr.ptr    = 0;
 				rval->hdr.setNodeIdx = 0;
+				rval->hdr.rxTime     = 0;
+				rval->hdr.lat        = 0;
+				rval->hdr.arr        = 0;
+				rval->hdr.seqEpoch   = 0;
 				return rval;
 			}
 			/* If no buffer is available try a bigger size */
 		}
 	}
+	/* (too big for any pool is accounted to the biggest one) */
+	rx->fc_free[ req < 0 ? NBUFKINDS - 1 : req ].n_fail++;
 	return 0;
 }
 
@@ -414,10 +843,12 @@ fc_refb(BufRef b)
 static void
 fc_relb(BufRef b)
 {
+FcomRxCtxRef rx = b->hdr.rx;
+
 	if ( 0 == --b->hdr.refCnt ) {
-		b->hdr.ptr.next                = fc_free[b->hdr.type].free_list;
-		fc_free[b->hdr.type].free_list = b;
-		fc_free[b->hdr.type].avail++;
+		b->hdr.ptr.next                = rx->fc_free[b->hdr.type].free_list;
+		rx->fc_free[b->hdr.type].free_list = b;
+		rx->fc_free[b->hdr.type].avail++;
 	}
 }
 
@@ -428,10 +859,14 @@ fc_relb(BufRef b)
  * NOTE: This routine is thread-safe.
  */
 int
-fcom_add_bufs(unsigned t, unsigned n)
+fcom_add_bufs(FcomCtx ctx, unsigned t, unsigned n)
 {
-int       i;
-uint16_t sz;
+int          i;
+uint32_t     sz;
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
 
 	if ( 0 == n )
 		return 0;
@@ -443,7 +878,7 @@ uint16_t sz;
 		void       *ptr;
 		BufRef      hd, tl;
 
-		sz = fc_free[t].sz;
+		sz = rx->fc_free[t].sz;
 
 		if ( ! (new_chunk = malloc( sizeof(*new_chunk) + n * sz + FC_ALIGNMENT )) ) {
 			return FCOM_ERR_NO_MEMORY;
@@ -461,6 +896,7 @@ uint16_t sz;
 
 			memset(tl, 0, sizeof(tl->hdr));
 			tl->hdr.ptr.next   = ptr;
+			tl->hdr.rx         = rx;
 			tl->hdr.size       = sz;
 			tl->hdr.type       = t;
 			tl->hdr.setNodeIdx = 0;
@@ -472,22 +908,64 @@ uint16_t sz;
 		/* insert chunk and buffers into lists -- this is fast because
 		 * the individual buffers have been linked together already...
 		 */
-		__FC_LOCK();
-			new_chunk->next   = fc_free[t].chunks;
-			fc_free[t].chunks = new_chunk;
-			fc_free[t].avail += n;
-			fc_free[t].tot   += n;
+		__FC_LOCK(rx);
+			new_chunk->next   = rx->fc_free[t].chunks;
+			rx->fc_free[t].chunks = new_chunk;
+			rx->fc_free[t].avail += n;
+			rx->fc_free[t].tot   += n;
 
 			/* enq buffers */
-			tl->hdr.ptr.next     = fc_free[t].free_list;
-			fc_free[t].free_list = hd;
-		__FC_UNLOCK();
+			tl->hdr.ptr.next     = rx->fc_free[t].free_list;
+			rx->fc_free[t].free_list = hd;
+		__FC_UNLOCK(rx);
 
 		return 0;
 	}
 	return FCOM_ERR_INTERNAL;
 }
 
+int
+fcomAddRxBufs(uint32_t blob_size, unsigned n_bufs)
+{
+	return fcomAddRxBufsCtx(fcom_dflt_ctx, blob_size, n_bufs);
+}
+
+int
+fcomAddRxBufsCtx(FcomCtx ctx, uint32_t blob_size, unsigned n_bufs)
+{
+int      i;
+uint32_t sz;
+
+	/* Large enough for the blob and for its XDR representation
+	 * (which is collected during reassembly).
+	 */
+	sz =   blob_size + sizeof(Buf) + FC_ALIGN(sizeof(FcomBlobHdr))
+	     + (2 + FCOM_XDR_BLOB_HDRSZ) * sizeof(uint32_t);
+
+	for ( i=0; i<NBUFKINDS; i++ ) {
+		if ( sz <= fc_free_tmpl[i].sz )
+			return fcom_add_bufs(ctx, i, n_bufs);
+	}
+	return FCOM_ERR_NO_SPACE;
+}
+
+
+/* Memory released by fc_rmbuf() which the caller must
+ * free (fc_garb_free()) outside of the locked area.
+ */
+typedef struct FcGarb {
+	void *cond;
+	void *lat;
+	void *arr;
+} FcGarb;
+
+static void
+fc_garb_free(FcGarb *p_garb)
+{
+	free(p_garb->cond);
+	free(p_garb->lat);
+	free(p_garb->arr);
+}
 
 /* Remove a buffer subscription.
  *
@@ -497,6 +975,8 @@ uint16_t sz;
  *   o destroy condition variable which supports
  *     synchronous operation if such a variable
  *     had been created.
+ *   o release latency histograms and inter-arrival
+ *     statistics of the ID.
  *   o remove buffer from hash table
  *   o decrement buffer reference count (matching
  *     initial count of one given by fc_getb()).
@@ -513,14 +993,16 @@ uint16_t sz;
  *          routine.
  */
 static int
-fc_rmbuf(FcomID idnt, void **p_to_free)
+fc_rmbuf(FcomRxCtxRef rx, FcomID idnt, FcGarb *p_garb)
 {
 BufRef buf;
 int    err;
 
-	*p_to_free = 0;
+	p_garb->cond = 0;
+	p_garb->lat  = 0;
+	p_garb->arr  = 0;
 
-	if ( ! (buf = shtblFind( bTbl, idnt )) ) {
+	if ( ! (buf = shtblFind( rx->bTbl, idnt )) ) {
 		return FCOM_ERR_INVALID_ID;			
 	}
 
@@ -548,7 +1030,7 @@ int    err;
 				return FCOM_ERR_SYS(err);
 			}
 			/* defer 'free()' until after fcl_tbl lock is released */
-			*p_to_free = buf->hdr.ptr.cond;
+			p_garb->cond = buf->hdr.ptr.cond;
 			buf->hdr.ptr.cond = 0;
 		}
 #endif
@@ -557,11 +1039,16 @@ int    err;
 		 * that the entry exists - otherwise
 		 * the condvar may be lost...
 		 */
-		err = shtblDel( bTbl, buf );
+		err = shtblDel( rx->bTbl, buf );
 		if ( err ) {
 			return FCOM_ERR_INTERNAL;
 		}
 
+		p_garb->lat  = buf->hdr.lat;
+		buf->hdr.lat = 0;
+		p_garb->arr  = buf->hdr.arr;
+		buf->hdr.arr = 0;
+
 		fc_relb(buf);
 	}
 
@@ -581,18 +1068,18 @@ int    err;
  *          - 'fcl_grp' lock must be held by caller.
  */
 static int
-fc_relmc(uint32_t gid)
+fc_relmc(FcomRxCtxRef rx, uint32_t gid)
 {
 int      err, rval;
 uint32_t mcaddr;
 
 	rval = 0;
 
-	if ( 0 == --fc_gid_refcnt[gid] ) {
-		mcaddr = fcom_g_prefix | htonl(gid);
+	if ( 0 == --rx->fc_gid_refcnt[gid] ) {
+		mcaddr = rx->ctx->g_prefix | htonl(gid);
 
-		if ( (err = udpCommLeaveMcast(fcom_rsd, mcaddr)) ) {
-			fc_gid_refcnt[gid] = 1;
+		if ( (err = rx->ctx->xp->leave_mcast(rx->ctx->rsd, mcaddr)) ) {
+			rx->fc_gid_refcnt[gid] = 1;
 			rval               = FCOM_ERR_SYS(-err);
 		}
 	}
@@ -603,21 +1090,32 @@ uint32_t mcaddr;
 /* Subscription as defined by API */
 int
 fcomSubscribe(FcomID idnt, int supp_sync)
+{
+	if ( ! FC_RX(fcom_dflt_ctx) ) {
+		fprintf(stderr,"fcomSubscribe error: FCOM uninitialized!\nCall fcomInit in st.cmd!\n");
+		abort();
+	}
+	return fcomSubscribeCtx(fcom_dflt_ctx, idnt, supp_sync);
+}
+
+int
+fcomSubscribeCtx(FcomCtx ctx, FcomID idnt, int supp_sync)
 {
 int           err;
 uint32_t      gid, mcaddr;
 BufRef        buf;
 FcomBlobRef   pbv1;
-void          *garb;
+FcGarb        garb;
+FcLatStats    *lat = 0;
+FcArrStats    *arr;
+FcomRxCtxRef  rx = FC_RX(ctx);
 
 #if !defined(SUPPORT_SYNCGET)
 	if ( supp_sync )
 		return FCOM_ERR_UNSUPP;
 #endif	
-	if ( fcom_rsd < 0 ) {
-		fprintf(stderr,"fcomSubscribe error: FCOM uninitialized!\nCall fcomInit in st.cmd!\n");
-		abort();
-	}
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
 
 	/* hashtable assumes blob V1 layout to locate key */
 	if ( NOT_V1(idnt) )
@@ -631,34 +1129,45 @@ void          *garb;
 
 	err = 0;
 
+	/* pre-allocate latency histograms of this ID */
+	if ( rx->lat_on && ! (lat = calloc(1, sizeof(*lat))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	/* ... and its inter-arrival statistics (always kept) */
+	if ( ! (arr = calloc(1, sizeof(*arr))) ) {
+		free(lat);
+		return FCOM_ERR_NO_MEMORY;
+	}
+
 	/* 'fcl_grp' lock serializes all fcomSubscribe/fcomUnsubscribe
 	 * operations. This simplifies the design and has no impact
 	 * on latency. Subscription/unsubscription are not deterministic
 	 * anyways. Note that the time-critical lock fcl_tbl is
 	 * acquired on a more fine-grained basis.
 	 */
-	__FC_LOCK_GRP();
+	__FC_LOCK_GRP(rx);
 
-		__FC_LOCK();
-			buf = shtblFind(bTbl, idnt);
+		__FC_LOCK(rx);
+			buf = shtblFind(rx->bTbl, idnt);
 			if ( buf ) {
 				/* paranoia */
-				if ( 0 == fc_gid_refcnt[gid] || 0 == buf->hdr.subCnt ) {
+				if ( 0 == rx->fc_gid_refcnt[gid] || 0 == buf->hdr.subCnt ) {
 					err = FCOM_ERR_INTERNAL;
 				}
 			} else {
 				/* new entry; must add a empty dummy buffer */
-				if ( ( buf = fc_getb(sizeof(FcomBlob)) ) ) {
+				if ( ( buf = fc_getb(rx, sizeof(FcomBlob)) ) ) {
 #ifdef PARANOIA
 					memset( &buf->pld, 0, sizeof(FcomBlob) );
 #endif
 					buf->hdr.subCnt = 0;
+					buf->hdr.updCnt = 0;
 					pbv1            = &buf->pld;
 					pbv1->fc_vers   = FCOM_PROTO_VERSION;
 					pbv1->fc_idnt   = idnt;
 					pbv1->fc_type   = FCOM_EL_NONE;
 
-					if ( (err = shtblAdd( bTbl, buf )) ) {
+					if ( (err = shtblAdd( rx->bTbl, buf )) ) {
 						fc_relb(buf);
 						err = FCOM_ERR_NO_MEMORY;
 					}
@@ -670,6 +1179,15 @@ void          *garb;
 			/* increment subscription count */
 			if ( !err ) {
 				buf->hdr.subCnt++;
+				/* attach latency histograms unless there are some */
+				if ( ! buf->hdr.lat ) {
+					buf->hdr.lat = lat;
+					lat          = 0;
+				}
+				if ( ! buf->hdr.arr ) {
+					buf->hdr.arr = arr;
+					arr          = 0;
+				}
 #if defined(SUPPORT_SYNCGET)
 				if ( buf->hdr.ptr.cond ) {
 					/* if we already have a condvar then there
@@ -679,10 +1197,14 @@ void          *garb;
 				}
 #endif
 			}
-		__FC_UNLOCK();
+		__FC_UNLOCK(rx);
+
+		/* not used */
+		free(lat);
+		free(arr);
 
 		if ( err ) {
-			__FC_UNLOCK_GRP();
+			__FC_UNLOCK_GRP(rx);
 			return err;
 		}
 
@@ -703,22 +1225,22 @@ void          *garb;
 				}
 			}
 
-			garb = 0;
+			garb.cond = garb.lat = garb.arr = 0;
 
 			/* lock buffers and attach condvar */
-			__FC_LOCK();
+			__FC_LOCK(rx);
 				if ( err ) {
 					/* if an error had occurred during creation we
 					 * revert the subscription and return with an error.
 					 */
-					fc_rmbuf(idnt, &garb);
+					fc_rmbuf(rx, idnt, &garb);
 				} else {
 					/* must lookup 'buf' again; it might
 					 * have been swapped since we released
 					 * the fcl_tbl lock during creation of
 					 * the condvar.
 					 */
-					if ( ! (buf = shtblFind(bTbl, idnt)) || buf->hdr.ptr.cond ) {
+					if ( ! (buf = shtblFind(rx->bTbl, idnt)) || buf->hdr.ptr.cond ) {
 						/* this should never happen -- nobody could remove
 						 * 'idnt' since we still hold the fcl_grp lock and
 						 * for the same reason nobody could have attached a
@@ -731,7 +1253,7 @@ void          *garb;
 						cond = 0;
 					}
 				}
-			__FC_UNLOCK();
+			__FC_UNLOCK(rx);
 
 			/* release left-over garbage outside the locked area;
 			 * this can't really happen since IF there is already
@@ -739,7 +1261,7 @@ void          *garb;
 			 * subscription count must have been at least 2 on
 			 * entry to fc_rmbuf()...
 			 */
-			free(garb);
+			fc_garb_free(&garb);
 
 			if ( err ) {
 				if ( cond ) {
@@ -751,26 +1273,26 @@ void          *garb;
 		}
 #endif
 
-		if ( 0 == fc_gid_refcnt[gid] ) {
+		if ( 0 == rx->fc_gid_refcnt[gid] ) {
 			/* must join MC group */
 
-			mcaddr = fcom_g_prefix | htonl(gid);
-			if ( (err = udpCommJoinMcast(fcom_rsd, mcaddr)) ) {
+			mcaddr = rx->ctx->g_prefix | htonl(gid);
+			if ( (err = rx->ctx->xp->join_mcast(rx->ctx->rsd, mcaddr)) ) {
 
-				__FC_LOCK();
-					fc_rmbuf(idnt, &garb);
-				__FC_UNLOCK();
+				__FC_LOCK(rx);
+					fc_rmbuf(rx, idnt, &garb);
+				__FC_UNLOCK(rx);
 
 				/* release left-over garbage outside the locked area */
-				free(garb);
+				fc_garb_free(&garb);
 
-				__FC_UNLOCK_GRP();
+				__FC_UNLOCK_GRP(rx);
 				return FCOM_ERR_SYS(-err);
 			}
 		}
-		fc_gid_refcnt[gid]++;
+		rx->fc_gid_refcnt[gid]++;
 
-	__FC_UNLOCK_GRP();
+	__FC_UNLOCK_GRP(rx);
 
 	return 0;
 }
@@ -779,9 +1301,19 @@ void          *garb;
 int
 fcomUnsubscribe(FcomID idnt)
 {
-int      rval;
-uint32_t gid;
-void     *garb;
+	return fcomUnsubscribeCtx(fcom_dflt_ctx, idnt);
+}
+
+int
+fcomUnsubscribeCtx(FcomCtx ctx, FcomID idnt)
+{
+int          rval;
+uint32_t     gid;
+FcGarb       garb;
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
 
 	/* hashtable assumes blob V1 layout to locate key */
 	if ( NOT_V1(idnt) )
@@ -799,72 +1331,26 @@ void     *garb;
 	 * anyways. Note that the time-critical lock fcl_tbl is
 	 * acquired on a more fine-grained basis.
 	 */
-	__FC_LOCK_GRP();
-		__FC_LOCK();
-			rval = fc_rmbuf(idnt, &garb);
-		__FC_UNLOCK();
+	__FC_LOCK_GRP(rx);
+		__FC_LOCK(rx);
+			rval = fc_rmbuf(rx, idnt, &garb);
+		__FC_UNLOCK(rx);
 
 		/* release left-over garbage outside the locked area */
-		free(garb);
+		fc_garb_free(&garb);
 
 		if ( rval ) {
-			__FC_UNLOCK_GRP();
+			__FC_UNLOCK_GRP(rx);
 			return rval;
 		}
 
-		rval = fc_relmc(gid);
-
-	__FC_UNLOCK_GRP();
+		rval = fc_relmc(rx, gid);
 
-	return rval;
-}
-
-#if !defined(__rtems__)
-#undef ENABLE_PROFILE
-#endif
+	__FC_UNLOCK_GRP(rx);
 
-#if defined(ENABLE_PROFILE)
-/* Assume difference is always less than 1s */
-static __inline__ uint32_t tsdiff(struct timespec *a, struct timespec *b)
-{
-uint32_t rval = 0;
-	if ( a->tv_nsec < b->tv_nsec )
-		rval += 1000000000L;
-	rval += a->tv_nsec - b->tv_nsec;
 	return rval;
 }
 
-/* NOTE: lanIpBasic must be built with ENABLE_PROFILE defined, too */
-extern void lanIpBscGetBufTstmp(void *b, struct timespec *ts) __attribute__((weak));
-
-#define ADDPROF(i,ts) \
-	do {              \
-		rtems_clock_get_uptime(&ts); \
-		rtems_task_ident(RTEMS_SELF, RTEMS_SEARCH_ALL_NODES, &rx_tid[i]); \
-		rx_prof[i] = tsdiff(&ts,&rx_prbs);     \
-		rx_prbs = ts;	 \
-		i++;             \
-	} while (0)
-#define PROFBAS(i,b) \
-	do {                \
-		i = 0;          \
-		if ( lanIpBscGetBufTstmp ) { \
-			lanIpBscGetBufTstmp(b, &rx_prbs); \
-		} else  {       \
-			rtems_clock_get_uptime(&rx_prbs); \
-		}               \
-	} while (0)
-
-struct timespec rx_prbs;
-rtems_id rx_tid[20] = {0};
-uint32_t rx_prof[20] = {0};
-int      rx_prdx     =  0;
-
-#else
-#define PROFBAS(i,b)  do {} while(0)
-#define ADDPROF(i,ts) do {} while(0)
-#endif
-
 static int
 ms2timeout(struct timespec *tout, uint32_t timeout_ms)
 {
@@ -900,16 +1386,49 @@ struct timeval  now;
 	return 0;
 }
 
+#if defined(SUPPORT_SYNCGET) || defined(SUPPORT_SETS)
+/* Wait on a condition variable associated with 'fcl_tbl'
+ * (which the caller holds). For the lock statistics the
+ * wait ends a hold period and the wake-up starts a new one.
+ */
+static int
+fc_tbl_timedwait(FcomRxCtxRef rx, pthread_cond_t *cond, const struct timespec *tout)
+{
+int rval;
+
+	if ( rx->lks_tbl.t_acq )
+		fc_lks_released( &rx->lks_tbl, 0 );
+
+	rval = pthread_cond_timedwait( cond, &rx->fcl_tbl, tout );
+
+	if ( rx->lks_on )
+		rx->lks_tbl.t_acq = fcom_now_ns();
+
+	return rval;
+}
+#endif
+
 
 /* Fetch data as defined by API */
 int
 fcomGetBlob(FcomID idnt, FcomBlobRef *pp_blob, uint32_t timeout_ms)
+{
+	return fcomGetBlobCtx(fcom_dflt_ctx, idnt, pp_blob, timeout_ms);
+}
+
+int
+fcomGetBlobCtx(FcomCtx ctx, FcomID idnt, FcomBlobRef *pp_blob, uint32_t timeout_ms)
 {
 BufRef          buf;
 int             rval;
+int64_t         d_ns;
 #if defined(SUPPORT_SYNCGET)
 struct timespec tout;
 #endif
+FcomRxCtxRef    rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
 
 	/* hashtable assumes blob V1 layout to locate key */
 	if ( NOT_V1(idnt) )
@@ -930,43 +1449,38 @@ struct timespec tout;
 #endif
 	}
 
-	__FC_LOCK();
+	__FC_LOCK(rx);
 #if defined(SUPPORT_SYNCGET)
 		if ( timeout_ms ) {
-			if ( ! (buf = shtblFind(bTbl, idnt)) ) {
-				__FC_UNLOCK();
+			if ( ! (buf = shtblFind(rx->bTbl, idnt)) ) {
+				__FC_UNLOCK(rx);
 				return FCOM_ERR_NOT_SUBSCRIBED;
 			}
 			if ( ! buf->hdr.ptr.cond ) {
-				__FC_UNLOCK();
+				__FC_UNLOCK(rx);
 				return FCOM_ERR_NOT_SUBSCRIBED;
 			}
 			/* block for new data - see the note in fc_rmbuf
 			 * for why the buffer/slot we're blocking on here
 			 * cannot disappear while we are waiting.
              */
-			rval = pthread_cond_timedwait( buf->hdr.ptr.cond, &fcl_tbl, &tout);
-
-			ADDPROF(rx_prdx, tout);
+			rval = fc_tbl_timedwait( rx, buf->hdr.ptr.cond, &tout );
 
 			if ( rval ) {
 				rval = ETIMEDOUT == rval ? FCOM_ERR_TIMEDOUT : FCOM_ERR_SYS(rval);
-				__FC_UNLOCK();
+				__FC_UNLOCK(rx);
 				return rval;
 			}
 
-			/* pthread_cond_timedwait() releases 'fcl_tbl' while blocking;
+			/* fc_tbl_timedwait() releases 'fcl_tbl' while blocking;
 			 * therefore we must re-fetch 'buf' as done below.
 			 */
 		}
 #endif
-		if ( (buf = shtblFind( bTbl, idnt )) ) {
+		if ( (buf = shtblFind( rx->bTbl, idnt )) ) {
 			/* is this a placeholder that was produced
 			 * by subscription ?
 			 */
-
-			ADDPROF(rx_prdx, tout);
-
 			if ( FCOM_EL_NONE == buf->pld.fc_type ) {
 				*pp_blob = 0;
 				rval     = FCOM_ERR_NO_DATA;
@@ -977,13 +1491,23 @@ struct timespec tout;
 				fc_refb(buf);
 				*pp_blob = &buf->pld;
 				rval     = 0;
+
+				if ( 0 == buf->hdr.usrCnt++ )
+					buf->hdr.getTime = (uint32_t)fcom_now_us();
+				rx->n_usr++;
+
+				/* how long the data waited for us */
+				if ( buf->hdr.rxTime ) {
+					d_ns = fc_wallclock_ns() - buf->hdr.rxTime;
+					fc_lat_add( &rx->lat.app, d_ns );
+					if ( buf->hdr.lat )
+						fc_lat_add( &buf->hdr.lat->app, d_ns );
+				}
 			}
-			ADDPROF(rx_prdx, tout);
 		} else {
 			rval = FCOM_ERR_NOT_SUBSCRIBED;
 		}
-	__FC_UNLOCK();
-	ADDPROF(rx_prdx, tout);
+	__FC_UNLOCK(rx);
 
 	return rval;
 }
@@ -992,17 +1516,31 @@ struct timespec tout;
 int
 fcomReleaseBlob(FcomBlobRef *pp_blob)
 {
-BufRef buf;
+BufRef       buf;
+FcomRxCtxRef rx;
+uint32_t     now;
+uint32_t     held;
 
 	if ( 0 == *pp_blob )
 		return 0;
 
 	/* use some magic to compute the 'buf' pointer */
 	buf = BLOB2BUFR(*pp_blob);
-
-	__FC_LOCK();
+	rx  = buf->hdr.rx;
+	now = (uint32_t)fcom_now_us();
+
+	__FC_LOCK(rx);
+		if ( buf->hdr.usrCnt ) {
+			/* modulo 2^32 us */
+			held = now - buf->hdr.getTime;
+			if ( held > rx->hold.max_us || 0 == rx->hold.count )
+				rx->hold_max_idnt = buf->pld.fc_idnt;
+			fc_lat_add( &rx->hold, (int64_t)held * 1000 );
+			buf->hdr.usrCnt--;
+			rx->n_usr--;
+		}
 		fc_relb(buf);
-	__FC_UNLOCK();
+	__FC_UNLOCK(rx);
 
 	*pp_blob = 0;
 	return 0;
@@ -1010,6 +1548,12 @@ BufRef buf;
 
 int
 fcomAllocBlobSet(FcomID member_id[], unsigned num_members, FcomBlobSetRef *pp_set)
+{
+	return fcomAllocBlobSetCtx(fcom_dflt_ctx, member_id, num_members, pp_set);
+}
+
+int
+fcomAllocBlobSetCtx(FcomCtx ctx, FcomID member_id[], unsigned num_members, FcomBlobSetRef *pp_set)
 {
 int                rval = 0;
 #if defined(SUPPORT_SETS)
@@ -1017,10 +1561,11 @@ int                i, j;
 int                nodes_needed;
 FcomBlobSetHdrRef  aset = 0;
 BufHdrRef          buf;
+FcomRxCtxRef       rx = FC_RX(ctx);
 
 	/* basic check on arguments */
 
-	if ( ! pp_set )
+	if ( ! pp_set || ! rx )
 		return FCOM_ERR_INVALID_ARG;
 
 	*pp_set = 0; /* paranoia setting */
@@ -1054,6 +1599,8 @@ BufHdrRef          buf;
 
 	memset(aset, 0, i);
 
+	aset->rx = rx;
+
 	rval = pthread_cond_init(&aset->cond, 0);
 
 	if ( rval ) {
@@ -1066,32 +1613,32 @@ BufHdrRef          buf;
 	 */
 	nodes_needed = 0;
 
-	__FC_LOCK_GRP();
+	__FC_LOCK_GRP(rx);
 			/* Verify that all IDs are subscribed and count
 			 * number of nodes required. Nobody else can mess
 			 * with nodes since we're holding the group lock!
 			 */
 			for ( i=0; i<num_members; i++ ) {
-					__FC_LOCK();
-					buf = shtblFind(bTbl, member_id[i]);
+					__FC_LOCK(rx);
+					buf = shtblFind(rx->bTbl, member_id[i]);
 					if ( buf ) {
 						if ( 0 == buf->setNodeIdx )
 							nodes_needed++;
 						/* else: a node table slot has already been allocated for this buf */
-						__FC_UNLOCK();
+						__FC_UNLOCK(rx);
 					} else {
-						__FC_UNLOCK();
+						__FC_UNLOCK(rx);
 						rval = FCOM_ERR_NOT_SUBSCRIBED;
 						goto bail;
 					}
 			}
 
-			if ( nodes_needed > setNodeAvail ) {
+			if ( nodes_needed > rx->setNodeAvail ) {
 				rval = FCOM_ERR_NO_SPACE;
 				goto bail;
 			}
 
-			setNodeAvail    -= nodes_needed;
+			rx->setNodeAvail    -= nodes_needed;
 
 			aset->waitfor    = 0;
 			aset->gotsofar   = 0;
@@ -1104,34 +1651,34 @@ BufHdrRef          buf;
 					aset->set.memb[i].blob = 0;
 					aset->set.memb[i].head = aset;
 					/* Enqueue in member list */
-					__FC_LOCK();
-					buf = shtblFind(bTbl, member_id[i]);
+					__FC_LOCK(rx);
+					buf = shtblFind(rx->bTbl, member_id[i]);
 					if ( buf ) {
 							if ( 0 == buf->setNodeIdx ) {
 									/* Not yet member of any group; allocate
 									 * a pointer from the vector table.
 									 */
-									buf->setNodeIdx    = SET_NODE_FREE_LIST;
-									SET_NODE_FREE_LIST = setNodeTbl[SET_NODE_FREE_LIST].next;
-									setNodeTbl[buf->setNodeIdx].node = 0;
+									buf->setNodeIdx    = SET_NODE_FREE_LIST(rx);
+									SET_NODE_FREE_LIST(rx) = rx->setNodeTbl[SET_NODE_FREE_LIST(rx)].next;
+									rx->setNodeTbl[buf->setNodeIdx].node = 0;
 							}
 							/* enqueue into list of memberships of this buf */
-							aset->set.memb[i].next           = setNodeTbl[buf->setNodeIdx].node;
-							setNodeTbl[buf->setNodeIdx].node = &aset->set.memb[i];
+							aset->set.memb[i].next           = rx->setNodeTbl[buf->setNodeIdx].node;
+							rx->setNodeTbl[buf->setNodeIdx].node = &aset->set.memb[i];
 					} else {
 							fprintf(stderr,"FATAL (FCOM): BUF DISAPPEARED??\n");
 							fflush(stderr);
 							abort();
 					}
-					__FC_UNLOCK();
+					__FC_UNLOCK(rx);
 			}
 
-			fc_stats.n_set++;
+			rx->n_set++;
 
 			*pp_set = &aset->set;
 			aset    = 0;
 bail:
-	__FC_UNLOCK_GRP();
+	__FC_UNLOCK_GRP(rx);
 
 	if ( aset ) {
 		pthread_cond_destroy( &aset->cond );
@@ -1152,31 +1699,33 @@ int                i;
 FcomBlobSetHdrRef  aset;
 BufHdrRef          buf;
 FcomBlobSetMembRef *p_m;
+FcomRxCtxRef       rx;
 
 	if ( ! p_set )
 		return 0;
 
 	aset = p_set->memb[0].head; /* There must be at least one member */
+	rx   = aset->rx;
 
-	__FC_LOCK_GRP();
+	__FC_LOCK_GRP(rx);
 
-	__FC_LOCK();
+	__FC_LOCK(rx);
 	/* If a 'fcomGetBlobSet()' operation is in progress this fails with EBUSY */
 	rval = pthread_cond_destroy( &aset->cond );
-	__FC_UNLOCK();
+	__FC_UNLOCK(rx);
 
 	if ( rval ) {
-		__FC_UNLOCK_GRP();
+		__FC_UNLOCK_GRP(rx);
 		return FCOM_ERR_SYS(rval);
 	}
 	
 	for ( i=0; i<aset->set.nmemb; i++ ) {
-		__FC_LOCK();
+		__FC_LOCK(rx);
 			/* If there is still blob attached then release it */
 			if ( aset->set.memb[i].blob ) {
 				fc_relb( BLOB2BUFR( aset->set.memb[i].blob ) );
 			}
-			buf = shtblFind(bTbl, aset->set.memb[i].idnt);
+			buf = shtblFind(rx->bTbl, aset->set.memb[i].idnt);
 			if ( ! buf ) {
 				fprintf(stderr,"FATAL (FCOM): MEMBER OF A SET DISAPPEARED??\n");
 				fflush(stderr);
@@ -1188,7 +1737,7 @@ FcomBlobSetMembRef *p_m;
 				abort();
 			}
 			/* Look for this member and remove */
-			for ( p_m = &setNodeTbl[buf->setNodeIdx].node; *p_m; p_m = &(*p_m)->next ) {
+			for ( p_m = &rx->setNodeTbl[buf->setNodeIdx].node; *p_m; p_m = &(*p_m)->next ) {
 				if ( *p_m == &aset->set.memb[i] ) {
 					/* found */
 					*p_m = aset->set.memb[i].next;
@@ -1198,18 +1747,18 @@ FcomBlobSetMembRef *p_m;
 				}
 			}
 			/* If this is the last set membership release vector table slot */
-			if ( 0 == setNodeTbl[buf->setNodeIdx].node ) {
-				setNodeTbl[buf->setNodeIdx].next = SET_NODE_FREE_LIST;
-				SET_NODE_FREE_LIST               = buf->setNodeIdx;
-				setNodeAvail++;
+			if ( 0 == rx->setNodeTbl[buf->setNodeIdx].node ) {
+				rx->setNodeTbl[buf->setNodeIdx].next = SET_NODE_FREE_LIST(rx);
+				SET_NODE_FREE_LIST(rx)               = buf->setNodeIdx;
+				rx->setNodeAvail++;
 				buf->setNodeIdx                  = 0;
 			}
-		__FC_UNLOCK();
+		__FC_UNLOCK(rx);
 	}
 
-	fc_stats.n_set--;
+	rx->n_set--;
 
-	__FC_UNLOCK_GRP();
+	__FC_UNLOCK_GRP(rx);
 
 	free( aset );
 
@@ -1227,6 +1776,7 @@ int               rval;
 #if defined(SUPPORT_SETS)
 FcomBlobSetHdrRef aset;
 struct timespec   tout;
+FcomRxCtxRef      rx;
 
 	if ( ! p_set || ! waitfor || 0 == timeout_ms ) {
 		return FCOM_ERR_INVALID_ARG;
@@ -1234,26 +1784,27 @@ struct timespec   tout;
 
 	/* There is at least one member */
 	aset = p_set->memb[0].head;
+	rx   = aset->rx;
 
 	/* pre-compute timeout */
 	if ( (rval = ms2timeout( &tout, timeout_ms )) ) {
 		return rval;
 	}
 
-	__FC_LOCK();
+	__FC_LOCK(rx);
 
 		aset->waitfor    = waitfor;
 		aset->waitforall = (FCOM_SET_WAIT_ALL & flags);
 		aset->gotsofar   = 0;
 
-		rval = pthread_cond_timedwait( &aset->cond, &fcl_tbl, &tout);
+		rval = fc_tbl_timedwait( rx, &aset->cond, &tout );
 
 		/* reset 'waitfor'. If we timed out we don't want to
 		 * get any 'late' data.
 		 */
 		aset->waitfor    = 0;
 
-	__FC_UNLOCK();
+	__FC_UNLOCK(rx);
 
 	if ( p_res )
 		*p_res = aset->gotsofar;
@@ -1276,6 +1827,10 @@ static const char *t2s(uint8_t t)
 		case FCOM_EL_UINT32: return "u32";
 		case FCOM_EL_INT32:  return "i32";
 		case FCOM_EL_INT8:   return "i08";
+		case FCOM_EL_INT16:  return "i16";
+		case FCOM_EL_UINT16: return "u16";
+		case FCOM_EL_INT64:  return "i64";
+		case FCOM_EL_UINT64: return "u64";
 		default:
 		break;
 	}
@@ -1302,7 +1857,7 @@ int    rval = 0;
 	rval += fprintf(f,"  Subscriptions :       %4u\n",           buf->hdr.subCnt);
 	rval += fprintf(f,"  Buffer updates:       %4"PRIu32"\n",    buf->hdr.updCnt);
 	if ( level > 0 ) {
-		rval += fprintf(f,"  Buffer size   :       %4u\n",           buf->hdr.size);
+		rval += fprintf(f,"  Buffer size   :       %4"PRIu32"\n",    buf->hdr.size);
 		rval += fprintf(f,"  Buffer refcnt :       %4u\n",           buf->hdr.refCnt);
 	}
 	if ( level > 0 || buf->hdr.setNodeIdx ) {
@@ -1357,6 +1912,30 @@ int    rval = 0;
 												           buf->pld.fc_i08[i]
 											            );
 					break;
+
+					case FCOM_EL_INT16:  rval += fprintf(f,"    0x%04"PRIx16"(%6"PRIi16")\n",
+												           buf->pld.fc_u16[i],
+												           buf->pld.fc_i16[i]
+											            );
+					break;
+
+					case FCOM_EL_UINT16: rval += fprintf(f,"    0x%04"PRIx16"(%5"PRIu16")\n",
+												           buf->pld.fc_u16[i],
+												           buf->pld.fc_u16[i]
+											            );
+					break;
+
+					case FCOM_EL_INT64:  rval += fprintf(f,"    0x%016"PRIx64"(%20"PRIi64")\n",
+												           buf->pld.fc_u64[i],
+												           buf->pld.fc_i64[i]
+											            );
+					break;
+
+					case FCOM_EL_UINT64: rval += fprintf(f,"    0x%016"PRIx64"(%20"PRIu64")\n",
+												           buf->pld.fc_u64[i],
+												           buf->pld.fc_u64[i]
+											            );
+					break;
 				}
 			}
 		}
@@ -1368,19 +1947,39 @@ int    rval = 0;
 int
 fcomDumpIDStats(FcomID idnt, int level, FILE *f)
 {
-BufRef buf;
-int    rval = 0;
+	return fcomDumpIDStatsCtx(fcom_dflt_ctx, idnt, level, f);
+}
+
+int
+fcomDumpIDStatsCtx(FcomCtx ctx, FcomID idnt, int level, FILE *f)
+{
+BufRef       buf;
+int          rval = 0;
+FcLatStats   lat;
+int          have_lat = 0;
+FcArrStats   arr;
+int          have_arr = 0;
+FcomIDRate   r;
+FcomRxCtxRef rx = FC_RX(ctx);
 
 	if ( ! f )
 		f = stdout;
 
-	__FC_LOCK();
+	if ( ! rx )
+		return fprintf(f,"fcomDumpIDStats: %s\n", fcomStrerror(FCOM_ERR_INVALID_ARG));
 
-	if ( (buf = shtblFind( bTbl, idnt )) ) {
+	__FC_LOCK(rx);
+
+	if ( (buf = shtblFind( rx->bTbl, idnt )) ) {
 		fc_refb(buf);
+		/* the histograms may go away once we unlock */
+		if ( (have_lat = !!buf->hdr.lat) )
+			lat = *buf->hdr.lat;
+		if ( (have_arr = !!buf->hdr.arr) )
+			arr = *buf->hdr.arr;
 	} 
 
-	__FC_UNLOCK();
+	__FC_UNLOCK(rx);
 
 	if ( ! buf ) {
 		return fprintf(f,"fcomDumpIDStats: %s\n", fcomStrerror(FCOM_ERR_NOT_SUBSCRIBED));
@@ -1388,95 +1987,212 @@ int    rval = 0;
 
 	rval = fcomDumpBlob( &buf->pld, level, f );
 
-	__FC_LOCK();
+	if ( have_arr && arr.n ) {
+		fc_arr_get( &r, &arr, buf->hdr.updCnt, fcom_now_us() );
+		rval += fprintf(f,"  Update rate   :   %8.2f Hz\n",         r.rate_hz);
+		rval += fprintf(f,"  Interarrival  :   mean %.1f us, stddev %.1f us, max %"PRIu32" us\n",
+		                r.mean_us, r.stddev_us, r.max_us);
+		rval += fprintf(f,"  Last update   :   %.6f s ago\n",       (double)r.age_us/1.0E6);
+	}
+
+	if ( have_lat ) {
+		rval += fc_lat_dump( f, "Latency arrival - timestamp  ", &lat.net );
+		rval += fc_lat_dump( f, "Latency fcomGetBlob - arrival", &lat.app );
+	}
+
+	__FC_LOCK(rx);
 		fc_relb(buf);
-	__FC_UNLOCK();
+	__FC_UNLOCK(rx);
 
 	return rval;
 }
 
-volatile int fcom_recv_running = 1;
+/* Copy the counters (consistently) */
+static void
+fc_stats_get(FcomRxCtxRef rx, FcomRxStats *p_stats)
+{
+uint32_t s0;
+unsigned i;
+
+	for ( i=0; ; i++ ) {
+		s0       = fcom_seq_rbegin( &rx->stats_seq );
+		*p_stats = rx->fc_stats_pub;
+		if ( ! fcom_seq_rretry( &rx->stats_seq, s0, i ) )
+			break;
+	}
+}
+
+int
+fcom_get_rx_counters(FcomCtx ctx, FcomRxStats *p_stats)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+	fc_stats_get(rx, p_stats);
+	return 0;
+}
+
+/* Dump RX thread settings (defined below) */
+static void
+fc_recvr_stats(FcomRxCtxRef rx, FILE *f);
 
 void
-fcom_recv_stats(FILE *f)
+fcom_recv_stats(FcomCtx ctx, FILE *f)
 {
-unsigned sz,n;
+unsigned     sz,n,i;
+FcSeqGid     *g;
+FcLatStats   lat;
+FcomRxStats  st;
+FcomLockStats lks_tbl, lks_grp;
+FcomLatHist  lks_msg;
+FcomRxCtxRef rx = FC_RX(ctx);
 
 	if ( !f )
 		f = stdout;
-	fc_statb(f);
+	if ( ! rx )
+		return;
+	fc_statb(rx, f);
+	fc_stats_get(rx, &st);
 	fprintf(f, "FCOM Rx Statistics:\n");
-	fprintf(f, "  messages with unsupported version received: %4"PRIu32"\n",
-               fc_stats.bad_msg_version);
-	fprintf(f, "  blobs with unsupported version received:  %6"PRIu32"\n",
-               fc_stats.bad_blb_version);
-	fprintf(f, "  failed to allocate buffer:                %6"PRIu32"\n",
-               fc_stats.no_bufs);
-	fprintf(f, "  XDR decoding errors:                      %6"PRIu32"\n",
-               fc_stats.dec_errs);
-	fprintf(f, "  messages processed:                    %9"PRIu32"\n",
-               fc_stats.n_msg);
-	fprintf(f, "  blobs processed:                       %9"PRIu32"\n",
-               fc_stats.n_blb);
-	fprintf(f, "  failed syncget or set member bcasts:   %9"PRIu32"\n",
-               fc_stats.bad_cond_bcst);
+	fprintf(f, "  messages with unsupported version received: %4"PRIu64"\n",
+               st.bad_msg_version);
+	fprintf(f, "  blobs with unsupported version received:  %6"PRIu64"\n",
+               st.bad_blb_version);
+	fprintf(f, "  failed to allocate buffer:                %6"PRIu64"\n",
+               st.no_bufs);
+	fprintf(f, "  XDR decoding errors:                      %6"PRIu64"\n",
+               st.dec_errs);
+	fprintf(f, "  messages processed:                    %9"PRIu64"\n",
+               st.n_msg);
+	fprintf(f, "  blobs processed:                       %9"PRIu64"\n",
+               st.n_blb);
+	fprintf(f, "  failed syncget or set member bcasts:   %9"PRIu64"\n",
+               st.bad_cond_bcst);
+	fprintf(f, "  fragments received:                    %9"PRIu64"\n",
+               st.n_frag);
+	fprintf(f, "  messages reassembled:                  %9"PRIu64"\n",
+               st.n_reasm);
+	fprintf(f, "  incomplete reassemblies dropped:       %9"PRIu64"\n",
+               st.reasm_tmo);
+	fprintf(f, "  inconsistent fragments:                %9"PRIu64"\n",
+               st.reasm_err);
+	fprintf(f, "  packed blobs decoded:                  %9"PRIu64"\n",
+               st.n_pack);
+	if ( st.pack_words ) {
+	fprintf(f, "  packed payload:  %"PRIu64" words (raw %"PRIu64"; ratio %.2f)\n",
+               st.pack_words, st.pack_raw_words,
+               (double)st.pack_raw_words/(double)st.pack_words);
+	}
+	fprintf(f, "  sparse updates applied:                %9"PRIu64"\n",
+               st.n_sparse);
+	fprintf(f, "  sparse updates dropped (no/old blob):  %9"PRIu64"\n",
+               st.sparse_miss);
+	fprintf(f, "  messages missing in sequence:          %9"PRIu64"\n",
+               st.seq_gaps);
+	fprintf(f, "  duplicate messages:                    %9"PRIu64"\n",
+               st.seq_dups);
+	fprintf(f, "  messages out of order:                 %9"PRIu64"\n",
+               st.seq_reord);
+	fprintf(f, "  stale messages dropped:                %9"PRIu64" (dropping %s)\n",
+               st.seq_stale, rx->seq_drop ? "enabled" : "disabled");
+	fprintf(f, "  messages not recorded (writer busy):   %9"PRIu64"\n",
+               st.rec_drop);
+	for ( i=0; i<=FCOM_GID_MAX; i++ ) {
+		if ( (g = rx->seq[i]) && (g->gaps || g->dups || g->reord) ) {
+	fprintf(f, "    GID %4u: missing %"PRIu32", duplicate %"PRIu32", out of order %"PRIu32", dropped %"PRIu32"\n",
+               i, g->gaps, g->dups, g->reord, g->stale);
+		}
+	}
+	fprintf(f, "  latency statistics:                     %s\n",
+               rx->lat_on ? " enabled" : "disabled");
+	if ( rx->lat_on || rx->lat.net.count || rx->lat.app.count ) {
+		__FC_LOCK(rx);
+			lat = rx->lat;
+		__FC_UNLOCK(rx);
+		fc_lat_dump( f, "latency arrival - timestamp  ", &lat.net );
+		fc_lat_dump( f, "latency fcomGetBlob - arrival", &lat.app );
+	}
+	fprintf(f, "  lock statistics:                        %s\n",
+               rx->lks_on ? " enabled" : "disabled");
+	if ( rx->lks_on || rx->lks_tbl.s.n_acq || rx->lks_grp.s.n_acq ) {
+		fcomGetLockStatsCtx( ctx, &lks_tbl, &lks_grp, &lks_msg );
+	fprintf(f, "  'tbl' lock acquired/contended: %9"PRIu64"/%"PRIu64"\n",
+               lks_tbl.n_acq, lks_tbl.n_cont);
+		fc_lat_dump( f, "'tbl' wait time              ", &lks_tbl.wait );
+		fc_lat_dump( f, "'tbl' hold time              ", &lks_tbl.hold );
+		fc_lat_dump( f, "'tbl' held by RX per message ", &lks_msg );
+	fprintf(f, "  'grp' lock acquired/contended: %9"PRIu64"/%"PRIu64"\n",
+               lks_grp.n_acq, lks_grp.n_cont);
+		fc_lat_dump( f, "'grp' wait time              ", &lks_grp.wait );
+		fc_lat_dump( f, "'grp' hold time              ", &lks_grp.hold );
+	}
 #if defined(SUPPORT_SETS)
 	fprintf(f, "  set vector table entries available: %3u (of %3u)\n",
-	           setNodeAvail, SET_NODE_TOTAL);
+	           rx->setNodeAvail, SET_NODE_TOTAL);
 	fprintf(f, "  allocated blob sets:                   %9"PRIu32"\n",
-	           fc_stats.n_set);
+	           rx->n_set);
 #else
 	fprintf(f, "  allocated blob sets:  UNSUPPORTED (NOT COMPILED)\n");
 #endif
-	if ( bTbl ) {
-		shtblStats(bTbl, &sz, &n);
+	if ( rx->bTbl ) {
+		shtblStats(rx->bTbl, &sz, &n);
 	fprintf(f, "  hash table size/entries/load: %u/%u/%.0f%%\n",
 	           sz, n, (float)n/(float)sz*100.0);
 	}
+	fc_recvr_stats(rx, f);
 }
 
 int
-fcom_get_rx_stat(uint32_t key, uint64_t *p_val)
+fcom_get_rx_stat(FcomCtx ctx, uint32_t key, uint64_t *p_val)
 {
-uint32_t v;
-unsigned sz, nused;
-unsigned kind = FCOM_STAT_KIND(key);
+uint64_t     v;
+unsigned     sz, nused;
+unsigned     kind = FCOM_STAT_KIND(key);
+FcomRxStats  st;
+FcomRxCtxRef rx   = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	fc_stats_get(rx, &st);
+
 	switch ( key & ~kind ) {
 		case FCOM_STAT_RX_NUM_BLOBS_RECV:
-			v = fc_stats.n_blb;
+			v = st.n_blb;
 		break;
 
 		case FCOM_STAT_RX_NUM_MESGS_RECV:
-			v = fc_stats.n_msg;
+			v = st.n_msg;
 		break;
 
 		case FCOM_STAT_RX_ERR_NOBUF:
-			v = fc_stats.no_bufs;
+			v = st.no_bufs;
 		break;
 
 		case FCOM_STAT_RX_ERR_XDRDEC:
-			v = fc_stats.dec_errs;
+			v = st.dec_errs;
 		break;
 
 		case FCOM_STAT_RX_ERR_BAD_BVERS:
-			v = fc_stats.bad_blb_version;
+			v = st.bad_blb_version;
 		break;
 
 		case FCOM_STAT_RX_ERR_BAD_MVERS:
-			v = fc_stats.bad_msg_version;
+			v = st.bad_msg_version;
 		break;
 
 		case FCOM_STAT_RX_ERR_BAD_BCST:
-			v = fc_stats.bad_cond_bcst;
+			v = st.bad_cond_bcst;
 		break;
 
 		case FCOM_STAT_RX_NUM_BLOBS_SUBS:
-			shtblStats(bTbl, &sz, &nused);
+			shtblStats(rx->bTbl, &sz, &nused);
 			v = nused;
 		break;
 
 		case FCOM_STAT_RX_NUM_BLOBS_MAX:
-			shtblStats(bTbl, &sz, &nused);
+			shtblStats(rx->bTbl, &sz, &nused);
 			v = sz;
 		break;
 
@@ -1486,17 +2202,17 @@ unsigned kind = FCOM_STAT_KIND(key);
 
 		case FCOM_STAT_RX_BUF_SIZE(0):
 			if ( kind >= NBUFKINDS ) return FCOM_ERR_UNSUPP;
-			v = fc_free[kind].sz;
+			v = rx->fc_free[kind].sz;
 		break;
 
 		case FCOM_STAT_RX_BUF_NUM_TOT(0):
 			if ( kind >= NBUFKINDS ) return FCOM_ERR_UNSUPP;
-			v = fc_free[kind].tot;
+			v = rx->fc_free[kind].tot;
 		break;
 
 		case FCOM_STAT_RX_BUF_NUM_AVL(0):
 			if ( kind >= NBUFKINDS ) return FCOM_ERR_UNSUPP;
-			v = fc_free[kind].avail;
+			v = rx->fc_free[kind].avail;
 		break;
 
 		case FCOM_STAT_RX_BUF_ALIGNED(0):
@@ -1504,100 +2220,412 @@ unsigned kind = FCOM_STAT_KIND(key);
 			v = FC_ALIGNMENT;
 		break;
 
-		default: 
-		return FCOM_ERR_UNSUPP;
-	}
-	*p_val = v;
-	return 0;
-}
+		case FCOM_STAT_RX_NUM_FRAGS:
+			v = st.n_frag;
+		break;
 
-/* Receive and process a single message/group
- * 
- * RETURNS: number of blobs decoded (0 if timed out).
- */
-int
-fcom_receive(unsigned timeout_ms)
-{
-UdpCommPkt         p;
-uint32_t           *xmemp;
-int                i,nblobs,sz,xsz;
-BufRef             buf,obuf;
+		case FCOM_STAT_RX_NUM_REASM:
+			v = st.n_reasm;
+		break;
+
+		case FCOM_STAT_RX_ERR_REASM_TMO:
+			v = st.reasm_tmo;
+		break;
+
+		case FCOM_STAT_RX_ERR_FRAG:
+			v = st.reasm_err;
+		break;
+
+		case FCOM_STAT_RX_NUM_PACKED:
+			v = st.n_pack;
+		break;
+
+		case FCOM_STAT_RX_PACK_RAW_WORDS:
+			v = st.pack_raw_words;
+		break;
+
+		case FCOM_STAT_RX_PACK_WORDS:
+			v = st.pack_words;
+		break;
+
+		case FCOM_STAT_RX_NUM_SPARSE:
+			v = st.n_sparse;
+		break;
+
+		case FCOM_STAT_RX_ERR_SPARSE:
+			v = st.sparse_miss;
+		break;
+
+		case FCOM_STAT_RX_ERR_SEQ_GAPS:
+			v = st.seq_gaps;
+		break;
+
+		case FCOM_STAT_RX_ERR_SEQ_DUPS:
+			v = st.seq_dups;
+		break;
+
+		case FCOM_STAT_RX_ERR_SEQ_REORD:
+			v = st.seq_reord;
+		break;
+
+		case FCOM_STAT_RX_NUM_SEQ_STALE:
+			v = st.seq_stale;
+		break;
+
+		case FCOM_STAT_RX_ERR_REC_DROP:
+			v = st.rec_drop;
+		break;
+
+		case FCOM_STAT_RX_GID_SEQ_GAPS(0):
+			if ( kind > FCOM_GID_MAX ) return FCOM_ERR_UNSUPP;
+			v = rx->seq[kind] ? rx->seq[kind]->gaps : 0;
+		break;
+
+		case FCOM_STAT_RX_GID_SEQ_DUPS(0):
+			if ( kind > FCOM_GID_MAX ) return FCOM_ERR_UNSUPP;
+			v = rx->seq[kind] ? rx->seq[kind]->dups : 0;
+		break;
+
+		case FCOM_STAT_RX_GID_SEQ_REORD(0):
+			if ( kind > FCOM_GID_MAX ) return FCOM_ERR_UNSUPP;
+			v = rx->seq[kind] ? rx->seq[kind]->reord : 0;
+		break;
+
+		case FCOM_STAT_RX_GID_SEQ_STALE(0):
+			if ( kind > FCOM_GID_MAX ) return FCOM_ERR_UNSUPP;
+			v = rx->seq[kind] ? rx->seq[kind]->stale : 0;
+		break;
+
+		case FCOM_STAT_RX_LAT_NET_NUM:
+			v = rx->lat.net.count;
+		break;
+
+		case FCOM_STAT_RX_LAT_NET_NEG:
+			v = rx->lat.net.neg;
+		break;
+
+		case FCOM_STAT_RX_LAT_NET_MAX_US:
+			v = rx->lat.net.max_us;
+		break;
+
+		case FCOM_STAT_RX_LAT_NET_SUM_US:
+			__FC_LOCK(rx);
+				v = rx->lat.net.sum_us;
+			__FC_UNLOCK(rx);
+		break;
+
+		case FCOM_STAT_RX_LAT_NET_HIST(0):
+			if ( kind >= FCOM_LAT_BINS ) return FCOM_ERR_UNSUPP;
+			v = rx->lat.net.bin[kind];
+		break;
+
+		case FCOM_STAT_RX_LAT_APP_NUM:
+			v = rx->lat.app.count;
+		break;
+
+		case FCOM_STAT_RX_LAT_APP_NEG:
+			v = rx->lat.app.neg;
+		break;
+
+		case FCOM_STAT_RX_LAT_APP_MAX_US:
+			v = rx->lat.app.max_us;
+		break;
+
+		case FCOM_STAT_RX_LAT_APP_SUM_US:
+			__FC_LOCK(rx);
+				v = rx->lat.app.sum_us;
+			__FC_UNLOCK(rx);
+		break;
+
+		case FCOM_STAT_RX_LAT_APP_HIST(0):
+			if ( kind >= FCOM_LAT_BINS ) return FCOM_ERR_UNSUPP;
+			v = rx->lat.app.bin[kind];
+		break;
+
+		case FCOM_STAT_RX_PROF_NUM(0):
+			return fcom_prof_get( &ctx->rx_prof, kind, FCOM_PROF_NUM, p_val );
+
+		case FCOM_STAT_RX_PROF_MIN_NS(0):
+			return fcom_prof_get( &ctx->rx_prof, kind, FCOM_PROF_MIN, p_val );
+
+		case FCOM_STAT_RX_PROF_AVG_NS(0):
+			return fcom_prof_get( &ctx->rx_prof, kind, FCOM_PROF_AVG, p_val );
+
+		case FCOM_STAT_RX_PROF_MAX_NS(0):
+			return fcom_prof_get( &ctx->rx_prof, kind, FCOM_PROF_MAX, p_val );
+
+		case FCOM_STAT_RX_PROF_P50_NS(0):
+			return fcom_prof_get( &ctx->rx_prof, kind, FCOM_PROF_P50, p_val );
+
+		case FCOM_STAT_RX_PROF_P99_NS(0):
+			return fcom_prof_get( &ctx->rx_prof, kind, FCOM_PROF_P99, p_val );
+
+		default: 
+			/* counters used to be 32-bit; accept the old keys */
+			if ( FCOM_STAT_IS_32(key) )
+				return fcom_get_rx_stat(ctx, key | (4<<24), p_val);
+		return FCOM_ERR_UNSUPP;
+	}
+	*p_val = v;
+	return 0;
+}
+
+/* Check the sequence number of a message from the current
+ * sender (rx->peer_ip/peer_port) to 'gid'. Zero means the
+ * message is not numbered.
+ *
+ * RETURNS: nonzero if the message is a duplicate or arrived
+ *          out of order and stale messages are to be dropped.
+ */
+static int
+fc_seq_check(FcomRxCtxRef rx, uint32_t gid, uint32_t seq)
+{
+FcSeqGid *g;
+FcSeqSrc *s, *lru;
+int32_t  d;
+int      i;
+
+	if ( 0 == seq || ! FCOM_GID_VALID(gid) )
+		return 0;
+
+	if ( ! (g = rx->seq[gid]) && ! (g = rx->seq[gid] = calloc(1, sizeof(*g))) )
+		return 0;
+
+	rx->seq_clock++;
+
+	for ( i=0, s=lru=g->src; i<FC_SEQ_SRCS; i++, s++ ) {
+		if ( s->last && s->ip == rx->peer_ip && s->port == rx->peer_port )
+			break;
+		if ( s->used < lru->used )
+			lru = s;
+	}
+
+	if ( FC_SEQ_SRCS == i ) {
+		/* new sender; replace the least recently heard from */
+		s       = lru;
+		s->ip   = rx->peer_ip;
+		s->port = rx->peer_port;
+		s->last = seq;
+		s->seen = 1;
+		s->used = rx->seq_clock;
+		g->epoch++;
+		return 0;
+	}
+
+	s->used = rx->seq_clock;
+
+	d = (int32_t)(seq - s->last);
+
+	if ( d > 0 ) {
+		if ( d > 1 ) {
+			g->gaps              += d - 1;
+			rx->fc_stats.seq_gaps += d - 1;
+			g->epoch++;
+		}
+		s->seen = d < 32 ? (s->seen << d) | 1u : 1u;
+		s->last = seq;
+		return 0;
+	}
+
+	if ( d <= -FC_SEQ_RESYNC ) {
+		s->last = seq;
+		s->seen = 1;
+		g->epoch++;
+		return 0;
+	}
+
+	if ( (s->seen & (1u << -d)) ) {
+		g->dups++;
+		rx->fc_stats.seq_dups++;
+	} else {
+		/* a late message (which was counted as a gap) */
+		g->reord++;
+		rx->fc_stats.seq_reord++;
+		s->seen |= (1u << -d);
+	}
+
+	if ( ! rx->seq_drop )
+		return 0;
+
+	g->stale++;
+	rx->fc_stats.seq_stale++;
+	return 1;
+}
+
+/* Append a received message of exactly 'nints' words to the
+ * recording (if any). This only queues the message; if the
+ * writer cannot keep up it is dropped.
+ */
+static void
+fc_rec_msg(FcomRxCtxRef rx, uint32_t *xmemp, uint32_t nints, uint32_t gid)
+{
+	__FC_LOCK_REC(rx);
+		if ( rx->rec && FCOM_ERR_NO_SPACE == fcom_rec_write(rx->rec, rx->arr_us, gid, xmemp, nints) )
+			rx->fc_stats.rec_drop++;
+	__FC_UNLOCK_REC(rx);
+}
+
+/* Process a single (complete) message/group of (at most)
+ * 'nints' 32-bit words. Blobs extending beyond that
+ * (truncated datagram) are not decoded.
+ * 
+ * RETURNS: number of blobs decoded.
+ */
+static int
+fc_process_msg(FcomRxCtxRef rx, uint32_t *xmemp, uint32_t nints)
+{
+int                i,nblobs,sz,xsz,pld;
+uint32_t           *msg = xmemp;
+uint32_t           *end = xmemp + nints;
+uint32_t           type;
+BufRef             buf,obuf,base;
 FcomID             idnt;
+uint32_t           seq, epoch;
+FcSeqGid           *g;
+int64_t            d_ns;
+FcomBlobHdr        dflt, *pdflt = 0;
 #if defined(SUPPORT_SETS)
 FcomBlobSetHdrRef  aset;
 FcomBlobSetMembRef amemb;
 FcomBlobSetMask    wanted;
 FcomBlobSetMask    me;
 #endif
-
-#ifdef ENABLE_PROFILE
-struct timespec tstmp;
+FcomProf           *prof = &rx->ctx->rx_prof;
+#if defined(SUPPORT_SYNCGET) || defined(SUPPORT_SETS)
+uint64_t           tw;
 #endif
 
 	nblobs = 0;
 
-	/* Block for a packet */
-	if ( (p = udpCommRecv(fcom_rsd, timeout_ms)) ) {
-
-			xmemp = udpCommBufPtr(p);
+			/* decode message header; compact messages carry
+			 * defaults for the blob headers.
+			 */
+			sz = 0;
+			if ( end - xmemp >= FCOM_XDR_CMSG_HDRSZ )
+				sz = fcom_xdr_dec_cmsghdr(xmemp, &dflt, &nblobs);
+			if ( sz > 0 )
+				pdflt = &dflt;
+			else if ( 0 == sz )
+				sz = fcom_xdr_dec_msghdr(xmemp, &nblobs);
+
+			if ( sz > 0 ) {
+
+				fcom_prof_stage( prof, FCOM_PROF_RX_RECV, &rx->prof_t );
+
+				rx->fc_stats.n_msg++;
+
+				/* older data must not replace newer data (if so configured) */
+				if (   nblobs > 0
+				    && 0 == fcom_xdr_peek_seq(&seq, &idnt, xmemp + sz, end - xmemp - sz, pdflt)
+				    && fc_seq_check(rx, FCOM_GET_GID(idnt), seq) ) {
+					/* datagrams are not padded; find the end of the message */
+					if ( rx->rec && (sz = fcom_xdr_msg_size(msg, nints, &idnt)) > 0 )
+						fc_rec_msg(rx, msg, sz, FCOM_GET_GID(idnt));
+					nblobs = 0;
+					goto bail;
+				}
 
-		PROFBAS(rx_prdx, p);
-		ADDPROF(rx_prdx, tstmp); 
+				for (i=0, xmemp+=sz; i < nblobs; i++) {
 
-			/* decode message header */
-			if ( (sz = fcom_xdr_dec_msghdr(xmemp, &nblobs)) > 0 ) {
+					rx->fc_stats.n_blb++;
 
-		ADDPROF(rx_prdx, tstmp); 
-				fc_stats.n_msg++;
+					if ( end - xmemp < (pdflt ? FCOM_XDR_CBLB_HDRSZ : FCOM_XDR_BLOB_HDRSZ) ) {
+						rx->fc_stats.dec_errs++;
+						goto bail;
+					}
 
-				for (i=0, xmemp+=sz; i < nblobs; i++) {
+					/* extract ID and size information up-front */
+					if ( pdflt )
+						xsz = fcom_xdr_peek_cblob(&sz, &idnt, xmemp, end - xmemp, &pld, &type, pdflt);
+					else
+						xsz = fcom_xdr_peek_size_id(&sz, &idnt, xmemp, end - xmemp, &pld, &type);
 
-					fc_stats.n_blb++;
+					fcom_prof_stage( prof, FCOM_PROF_RX_PEEK, &rx->prof_t );
 
-					/* extract ID and size information up-front */
-					xsz = fcom_xdr_peek_size_id(&sz, &idnt, xmemp);
-		ADDPROF(rx_prdx, tstmp); 
 					if ( xsz < 0 ) {
-						fc_stats.bad_blb_version++;
+						rx->fc_stats.bad_blb_version++;
+						goto bail;
+					}
+					if ( xsz > end - xmemp ) {
+						rx->fc_stats.dec_errs++;
 						goto bail;
 					}
 
+					epoch = (g = rx->seq[FCOM_GET_GID(idnt)]) ? g->epoch : 0;
+
 					/* check for this ID -- if it is not subscribed
 					 * then we can simply skip ahead.
 					 */
-					__FC_LOCK();
-						if ( (obuf = shtblFind(bTbl, idnt)) ) {
-							/* found; ID is apparently subscribed. We
-							 * allocate a buffer for the new data.
-							 */
-							buf = fc_getb(sz);
+					base = 0;
+					__FC_LOCK_RX(rx);
+						if ( (obuf = shtblFind(rx->bTbl, idnt)) ) {
+							if (   (type & FCOM_XDR_TYPE_SPARSE)
+							    && (   obuf->pld.fc_type != FCOM_EL_TYPE(type)
+							        || sz != obuf->pld.fc_nelm * FCOM_EL_SIZE(obuf->pld.fc_type) + FC_ALIGN(sizeof(FcomBlobHdr))
+							        || obuf->hdr.seqEpoch != epoch ) ) {
+								/* a sparse update needs a blob of the same
+								 * type and size to be applied to; updates
+								 * may have been lost since it was stored.
+								 */
+								rx->fc_stats.sparse_miss++;
+								obuf = 0;
+								buf  = 0;
+							} else {
+								/* found; ID is apparently subscribed. We
+								 * allocate a buffer for the new data.
+								 */
+								buf = fc_getb(rx, sz);
+								/* hold on to the data a sparse update is applied to */
+								if ( buf && (type & FCOM_XDR_TYPE_SPARSE) )
+									fc_refb( base = obuf );
+							}
 						} else {
 							/* not found; this ID is not subscribed */
 							buf = 0;
 						}
-					__FC_UNLOCK();
-		ADDPROF(rx_prdx, tstmp); 
+					__FC_UNLOCK_RX(rx);
+
+					fcom_prof_stage( prof, FCOM_PROF_RX_LOOKUP, &rx->prof_t );
 
 					if ( obuf && !buf ) {
 						/* account for failure to get a new buffer above */
-						fc_stats.no_bufs++;
+						rx->fc_stats.no_bufs++;
 					}
 
 					/* if we have no buffer (ID not subscribed or no memory)
 					 * then skip this blob.
 					 */
 					if ( buf ) {
+						/* a sparse update starts out with a copy of the current data */
+						if ( base )
+							memcpy( (void*)FC_ALIGN(&buf->pld + 1), base->pld.fc_raw, sz - FC_ALIGN(sizeof(FcomBlobHdr)) );
 						/* decode; note that we run the decoder w/o holding the lock.
 						 * Therefore it could happen that somebody unsubscribes while
 						 * we are working.
 						 */
-						if ( fcom_xdr_dec_blob( &buf->pld, sz, xmemp) > 0 ) {
-		ADDPROF(rx_prdx, tstmp); 
-							__FC_LOCK();
+						if ( ( pdflt ? fcom_xdr_dec_cblob( &buf->pld, sz, xmemp, pdflt )
+						             : fcom_xdr_dec_blob( &buf->pld, sz, xmemp ) ) > 0 ) {
+							/* applications see the plain type */
+							if ( (buf->pld.fc_type & FCOM_EL_PACKED) ) {
+								buf->pld.fc_type = FCOM_EL_TYPE(buf->pld.fc_type);
+								rx->fc_stats.n_pack++;
+								rx->fc_stats.pack_words     += pld;
+								rx->fc_stats.pack_raw_words +=
+									(sz - FC_ALIGN(sizeof(FcomBlobHdr)) + sizeof(*xmemp) - 1)/sizeof(*xmemp);
+							}
+							if ( (buf->pld.fc_type & FCOM_XDR_TYPE_SPARSE) ) {
+								buf->pld.fc_type = FCOM_EL_TYPE(buf->pld.fc_type);
+								rx->fc_stats.n_sparse++;
+							}
+							buf->hdr.rxTime   = rx->rx_time;
+							buf->hdr.seqEpoch = epoch;
+
+							fcom_prof_stage( prof, FCOM_PROF_RX_DECODE, &rx->prof_t );
+
+							__FC_LOCK_RX(rx);
 							/* have to check again if this ID is still subscribed */
 							obuf = buf;
-							if ( 0 == shtblRpl(bTbl, (SHTblEntry*)&obuf, SHTBL_ADD_FAIL) ) {
-		ADDPROF(rx_prdx, tstmp); 
+							if ( 0 == shtblRpl(rx->bTbl, (SHTblEntry*)&obuf, SHTBL_ADD_FAIL) ) {
 								/* old entry was replaced by 'buf'; 'obuf' contains
 								 * reference to old entry.
 								 *
@@ -1609,6 +2637,21 @@ struct timespec tstmp;
 								buf->hdr.subCnt      = obuf->hdr.subCnt;
 								buf->hdr.setNodeIdx  = obuf->hdr.setNodeIdx;
 								obuf->hdr.setNodeIdx = 0;
+								buf->hdr.lat         = obuf->hdr.lat;
+								obuf->hdr.lat        = 0;
+								buf->hdr.arr         = obuf->hdr.arr;
+								obuf->hdr.arr        = 0;
+								if ( buf->hdr.arr )
+									fc_arr_add( buf->hdr.arr, rx->arr_us );
+
+								/* age of the data on arrival */
+								if ( buf->hdr.rxTime && buf->pld.fc_tsHi ) {
+									d_ns =   buf->hdr.rxTime
+									       - ( (uint64_t)buf->pld.fc_tsHi * 1000000000ULL + buf->pld.fc_tsLo );
+									fc_lat_add( &rx->lat.net, d_ns );
+									if ( buf->hdr.lat )
+										fc_lat_add( &buf->hdr.lat->net, d_ns );
+								}
 
 #if defined(SUPPORT_SYNCGET)
 								buf->hdr.ptr.cond    = obuf->hdr.ptr.cond;
@@ -1616,17 +2659,17 @@ struct timespec tstmp;
 
 								if ( buf->hdr.ptr.cond ) {
 									/* post to blocked clients */
-		ADDPROF(rx_prdx, tstmp); 
+									fcom_prof_start( prof, &tw );
 									if ( pthread_cond_broadcast( buf->hdr.ptr.cond ) ) {
-										fc_stats.bad_cond_bcst++;
+										rx->fc_stats.bad_cond_bcst++;
 									}
-		ADDPROF(rx_prdx, tstmp); 
+									fcom_prof_stage( prof, FCOM_PROF_RX_WAKE, &tw );
 								}
 #endif
 #if defined(SUPPORT_SETS)
 								if ( buf->hdr.setNodeIdx ) {
-		ADDPROF(rx_prdx, tstmp); 
-									for ( amemb = setNodeTbl[buf->hdr.setNodeIdx].node;
+									fcom_prof_start( prof, &tw );
+									for ( amemb = rx->setNodeTbl[buf->hdr.setNodeIdx].node;
 									      amemb;
 									      amemb = amemb->next
 									    ) {
@@ -1635,57 +2678,668 @@ struct timespec tstmp;
 										if ( ! (aset->waitfor & me) )
 											continue; /* I'm not wanted */
 
-										/* release blob/buf already attached to the set  */
-										if ( amemb->blob )
-											fc_relb( BLOB2BUFR( amemb->blob ) );
+										/* release blob/buf already attached to the set  */
+										if ( amemb->blob )
+											fc_relb( BLOB2BUFR( amemb->blob ) );
+
+										/* attach this blob/buf and bump reference count */
+										amemb->blob     = &buf->pld;
+										fc_refb( buf );
+
+										aset->gotsofar |= me;
+
+										/* AND operation not really necessary since
+										 * all 'me's have been tested against waitfor
+										 */
+										wanted          = aset->gotsofar & aset->waitfor;
+										if (   ( aset->waitforall && (wanted == aset->waitfor) )
+										    || ( !aset->waitforall && wanted ) ) {
+											if ( pthread_cond_broadcast(&aset->cond) ) {
+												rx->fc_stats.bad_cond_bcst++;
+											} else {
+												/* Disable further updates */
+												aset->waitfor = 0;
+											}
+										}
+									}
+									fcom_prof_stage( prof, FCOM_PROF_RX_WAKE, &tw );
+								}
+#endif
+							}
+							/* in the unlikely case that the ID had been unsubscribed
+							 * since our previous check above the variable 'obuf' is
+							 * still equal to 'buf' and this call hence releases the
+							 * buffer we filled in vain...
+							 */
+							fc_relb(obuf);
+							if ( base )
+								fc_relb(base);
+							__FC_UNLOCK_RX(rx);
+
+							fcom_prof_stage( prof, FCOM_PROF_RX_PUBLISH, &rx->prof_t );
+						} else {
+							rx->fc_stats.dec_errs++;
+							__FC_LOCK_RX(rx);
+								fc_relb(buf);
+								if ( base )
+									fc_relb(base);
+							__FC_UNLOCK_RX(rx);
+						}
+					}
+					/* advance XDR stream pointer */
+					xmemp += xsz;
+				}
+
+				/* all blobs were walked, i.e., the message ends here */
+				if ( rx->rec && nblobs > 0 )
+					fc_rec_msg(rx, msg, xmemp - msg, FCOM_GET_GID(idnt));
+			} else {
+				rx->fc_stats.bad_msg_version++;
+			}
+bail:
+		return nblobs;
+}
+
+/* Check if the first fragment of a message contains
+ * a single blob with an ID nobody subscribed to.
+ */
+static int
+fc_reasm_unwanted(FcomRxCtxRef rx, uint32_t *xmemp, uint32_t len)
+{
+int    nblobs, sz;
+FcomID idnt;
+BufRef buf;
+
+	if ( len < 2 + FCOM_XDR_BLOB_HDRSZ )
+		return 0;
+
+	if ( fcom_xdr_dec_msghdr(xmemp, &nblobs) != 2 || 1 != nblobs )
+		return 0;
+
+	if ( fcom_xdr_peek_size_id(&sz, &idnt, xmemp + 2, len - 2, 0, 0) < 0 )
+		return 0;
+
+	__FC_LOCK_RX(rx);
+		buf = shtblFind(rx->bTbl, idnt);
+	__FC_UNLOCK_RX(rx);
+
+	return ! buf;
+}
+
+/* Release a reassembly slot */
+static void
+fc_reasm_drop(FcomRxCtxRef rx, FcReasm *r)
+{
+	if ( r->buf ) {
+		__FC_LOCK_RX(rx);
+			fc_relb(r->buf);
+		__FC_UNLOCK_RX(rx);
+		r->buf = 0;
+	}
+	r->nfrags = 0;
+	rx->reasm_busy--;
+}
+
+/* Drop reassemblies which did not complete in time */
+static void
+fc_reasm_expire(FcomRxCtxRef rx)
+{
+uint64_t now = fcom_now_us();
+int      i;
+
+	for ( i=0; i<FC_REASM_SLOTS; i++ ) {
+		if ( rx->reasm[i].nfrags && now - rx->reasm[i].t_start > FC_REASM_TMO_US ) {
+			if ( rx->reasm[i].buf )
+				rx->fc_stats.reasm_tmo++;
+			fc_reasm_drop(rx, &rx->reasm[i]);
+		}
+	}
+}
+
+/* Process a fragment; the payload of which is at 'xmemp'.
+ * Fragments of messages which are not wanted (single blob
+ * not subscribed, no buffer available) are just counted.
+ *
+ * RETURNS: number of blobs decoded (once the message is complete).
+ */
+static int
+fc_reasm(FcomRxCtxRef rx, FcomFragHdr *fh, uint32_t *xmemp)
+{
+FcReasm  *r, *fre, *old;
+int      i, nblobs;
+uint32_t flen = FCOM_FRAG_LEN(fh);
+
+	rx->fc_stats.n_frag++;
+
+	/* the header is consistent (fcom_xdr_dec_fraghdr()) but the
+	 * fragments must also fit into our datagrams; this bounds
+	 * the size of the message, too.
+	 */
+	if ( flen > FC_FRAG_LEN_MAX || fh->nfrags > FCOM_MSG_MAX_FRAGS ) {
+		rx->fc_stats.reasm_err++;
+		return 0;
+	}
+
+	for ( i=0, fre=old=0; i<FC_REASM_SLOTS; i++ ) {
+		r = &rx->reasm[i];
+		if ( ! r->nfrags ) {
+			if ( ! fre )
+				fre = r;
+		} else if ( r->xid == fh->xid ) {
+			break;
+		} else if ( ! old || r->t_start < old->t_start ) {
+			old = r;
+		}
+	}
+
+	if ( FC_REASM_SLOTS == i ) {
+		/* first fragment of a new message */
+		if ( ! (r = fre) ) {
+			/* all slots busy; sacrifice the oldest reassembly */
+			r = old;
+			if ( r->buf )
+				rx->fc_stats.reasm_tmo++;
+			fc_reasm_drop(rx, r);
+		}
+		rx->reasm_busy++;
+		r->xid     = fh->xid;
+		r->nints   = fh->nints;
+		r->nfrags  = fh->nfrags;
+		r->flen    = flen;
+		r->ngot    = 0;
+		r->t_start = fcom_now_us();
+		r->buf     = 0;
+		memset(r->got, 0, sizeof(r->got));
+
+		if ( 0 != fh->off || ! fc_reasm_unwanted(rx, xmemp, fh->len) ) {
+			__FC_LOCK_RX(rx);
+				r->buf = fc_getb(rx, fh->nints * sizeof(*xmemp));
+			__FC_UNLOCK_RX(rx);
+			if ( ! r->buf )
+				rx->fc_stats.no_bufs++;
+		}
+	} else if ( r->nints != fh->nints || r->nfrags != fh->nfrags || r->flen != flen ) {
+		/* fragments overlap or leave gaps */
+		rx->fc_stats.reasm_err++;
+		return 0;
+	}
+
+	if ( r->got[fh->idx/32] & (1 << (fh->idx%32)) )
+		return 0; /* duplicate */
+
+	r->got[fh->idx/32] |= (1 << (fh->idx%32));
+
+	if ( r->buf )
+		memcpy( (uint32_t*)&r->buf->pld + fh->off, xmemp, fh->len * sizeof(*xmemp) );
+
+	if ( ++r->ngot < r->nfrags )
+		return 0;
+
+	/* complete */
+	nblobs = 0;
+	if ( r->buf ) {
+		rx->fc_stats.n_reasm++;
+		nblobs = fc_process_msg(rx, (uint32_t*)&r->buf->pld, r->nints);
+	}
+	fc_reasm_drop(rx, r);
+
+	return nblobs;
+}
+
+/* Receive and process a single message/group
+ * 
+ * RETURNS: number of blobs decoded (0 if timed out).
+ */
+int
+fcom_receive(FcomCtx ctx, unsigned timeout_ms)
+{
+FcomRxCtxRef       rx = ctx->rx;
+UdpCommPkt         p;
+uint32_t           *xmemp;
+int                nblobs,st;
+FcomFragHdr        fh;
+
+	nblobs = 0;
+
+	/* Block for a packet */
+	rx->peer_ip   = 0;
+	rx->peer_port = 0;
+	p = rx->ctx->xp->recv_from(rx->ctx->rsd, timeout_ms, &rx->peer_ip, &rx->peer_port);
+
+	rx->lks_msg_ns = 0;
+
+	if ( p ) {
+
+		xmemp = udpCommBufPtr(p);
+
+		fcom_prof_start( &ctx->rx_prof, &rx->prof_t );
+
+		rx->rx_time = rx->lat_on ? fc_wallclock_ns() : 0;
+		rx->arr_us  = fcom_now_us();
+
+		if ( 0 == (st = fcom_xdr_dec_fraghdr(xmemp, &fh)) ) {
+			nblobs = fc_process_msg(rx, xmemp, UDPCOMM_PKTSZ/sizeof(*xmemp));
+		} else if ( st > 0 ) {
+			nblobs = fc_reasm(rx, &fh, xmemp + st);
+		} else if ( FCOM_ERR_BAD_VERSION == st ) {
+			rx->fc_stats.bad_msg_version++;
+		} else {
+			rx->fc_stats.reasm_err++;
+		}
+
+		udpCommFreePacket(p);
+	}
+
+	if ( rx->reasm_busy )
+		fc_reasm_expire(rx);
+
+	/* publish the counters */
+	fcom_seq_wbegin( &rx->stats_seq );
+
+	rx->fc_stats_pub = rx->fc_stats;
+
+	if ( rx->lks_msg_clr ) {
+		memset( &rx->lks_msg, 0, sizeof(rx->lks_msg) );
+		rx->lks_msg_clr = 0;
+	}
+	/* time 'fcl_tbl' was held for this message (if at all) */
+	if ( rx->lks_msg_ns )
+		fc_lat_add( &rx->lks_msg, (int64_t)rx->lks_msg_ns );
+
+	fcom_seq_wend( &rx->stats_seq );
+
+	return nblobs;
+}
+
+int
+fcomSetRxDropStale(int on)
+{
+	return fcomSetRxDropStaleCtx(fcom_dflt_ctx, on);
+}
+
+int
+fcomSetRxDropStaleCtx(FcomCtx ctx, int on)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	rx->seq_drop = !!on;
+	return 0;
+}
+
+int
+fcomSetRxLatencyStats(int on)
+{
+	return fcomSetRxLatencyStatsCtx(fcom_dflt_ctx, on);
+}
+
+int
+fcomSetRxLatencyStatsCtx(FcomCtx ctx, int on)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	rx->lat_on = !!on;
+	return 0;
+}
+
+int
+fcomGetIDLatency(FcomID idnt, FcomLatHist *p_net, FcomLatHist *p_app)
+{
+	return fcomGetIDLatencyCtx(fcom_dflt_ctx, idnt, p_net, p_app);
+}
+
+int
+fcomGetIDLatencyCtx(FcomCtx ctx, FcomID idnt, FcomLatHist *p_net, FcomLatHist *p_app)
+{
+BufRef       buf;
+int          rval = 0;
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	__FC_LOCK(rx);
+		if ( ! (buf = shtblFind( rx->bTbl, idnt )) ) {
+			rval = FCOM_ERR_NOT_SUBSCRIBED;
+		} else if ( ! buf->hdr.lat ) {
+			rval = FCOM_ERR_NO_DATA;
+		} else {
+			if ( p_net )
+				*p_net = buf->hdr.lat->net;
+			if ( p_app )
+				*p_app = buf->hdr.lat->app;
+		}
+	__FC_UNLOCK(rx);
+
+	return rval;
+}
+
+int
+fcomGetIDRate(FcomID idnt, FcomIDRate *p_rate)
+{
+	return fcomGetIDRateCtx(fcom_dflt_ctx, idnt, p_rate);
+}
+
+int
+fcomGetIDRateCtx(FcomCtx ctx, FcomID idnt, FcomIDRate *p_rate)
+{
+BufRef       buf;
+FcArrStats   arr;
+uint32_t     updCnt = 0;
+int          rval   = 0;
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx || ! p_rate )
+		return FCOM_ERR_INVALID_ARG;
+
+	__FC_LOCK(rx);
+		if ( ! (buf = shtblFind( rx->bTbl, idnt )) ) {
+			rval = FCOM_ERR_NOT_SUBSCRIBED;
+		} else {
+			updCnt = buf->hdr.updCnt;
+			if ( buf->hdr.arr )
+				arr = *buf->hdr.arr;
+			else
+				memset( &arr, 0, sizeof(arr) );
+		}
+	__FC_UNLOCK(rx);
+
+	if ( 0 == rval )
+		fc_arr_get( p_rate, &arr, updCnt, fcom_now_us() );
+
+	return rval;
+}
+
+int
+fcomGetRxBufStats(FcomBufPoolStats *p_pools, unsigned n)
+{
+	return fcomGetRxBufStatsCtx(fcom_dflt_ctx, p_pools, n);
+}
+
+int
+fcomGetRxBufStatsCtx(FcomCtx ctx, FcomBufPoolStats *p_pools, unsigned n)
+{
+int          rval;
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx || (n && ! p_pools) )
+		return FCOM_ERR_INVALID_ARG;
+
+	__FC_LOCK(rx);
+		rval = fc_pool_stats(rx, p_pools, n);
+	__FC_UNLOCK(rx);
+
+	return rval;
+}
+
+int
+fcomGetRxHoldTime(FcomLatHist *p_hist, FcomID *p_max_idnt)
+{
+	return fcomGetRxHoldTimeCtx(fcom_dflt_ctx, p_hist, p_max_idnt);
+}
+
+int
+fcomGetRxHoldTimeCtx(FcomCtx ctx, FcomLatHist *p_hist, FcomID *p_max_idnt)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx || ! p_hist )
+		return FCOM_ERR_INVALID_ARG;
+
+	__FC_LOCK(rx);
+		*p_hist = rx->hold;
+		if ( p_max_idnt )
+			*p_max_idnt = rx->hold_max_idnt;
+	__FC_UNLOCK(rx);
+
+	return 0;
+}
+
+int
+fcomSetLockStats(int on)
+{
+	return fcomSetLockStatsCtx(fcom_dflt_ctx, on);
+}
+
+int
+fcomSetLockStatsCtx(FcomCtx ctx, int on)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	__FC_LOCK_GRP(rx);
+		__FC_LOCK(rx);
+			if ( on ) {
+				/* this also discards the current hold periods */
+				memset( &rx->lks_tbl, 0, sizeof(rx->lks_tbl) );
+				memset( &rx->lks_grp, 0, sizeof(rx->lks_grp) );
+				rx->lks_msg_clr = 1;
+			}
+			rx->lks_on = !!on;
+		__FC_UNLOCK(rx);
+	__FC_UNLOCK_GRP(rx);
+
+	return 0;
+}
+
+int
+fcomGetLockStats(FcomLockStats *p_tbl, FcomLockStats *p_grp, FcomLatHist *p_rx_msg)
+{
+	return fcomGetLockStatsCtx(fcom_dflt_ctx, p_tbl, p_grp, p_rx_msg);
+}
+
+int
+fcomGetLockStatsCtx(FcomCtx ctx, FcomLockStats *p_tbl, FcomLockStats *p_grp, FcomLatHist *p_rx_msg)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+uint32_t     s0;
+unsigned     i;
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( p_grp ) {
+		__FC_LOCK_GRP(rx);
+			*p_grp = rx->lks_grp.s;
+		__FC_UNLOCK_GRP(rx);
+	}
+
+	if ( p_tbl ) {
+		__FC_LOCK(rx);
+			*p_tbl = rx->lks_tbl.s;
+		__FC_UNLOCK(rx);
+	}
+
+	if ( p_rx_msg ) {
+		for ( i=0; ; i++ ) {
+			s0        = fcom_seq_rbegin( &rx->stats_seq );
+			*p_rx_msg = rx->lks_msg;
+			if ( ! fcom_seq_rretry( &rx->stats_seq, s0, i ) )
+				break;
+		}
+	}
+
+	return 0;
+}
+
+int
+fcom_get_pool_stats(FcomCtx ctx, FcomShmPool *p_pool, unsigned max, FcomLatHist *p_hold, FcomID *p_max_idnt)
+{
+unsigned         i, n;
+FcomBufPoolStats p[NBUFKINDS];
+FcomRxCtxRef     rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return 0;
+
+	__FC_LOCK(rx);
+		n = fc_pool_stats(rx, p, NBUFKINDS);
+		*p_hold     = rx->hold;
+		*p_max_idnt = rx->hold_max_idnt;
+	__FC_UNLOCK(rx);
+
+	for ( i=0; i<n && i<max; i++ )
+		p_pool[i] = p[i];
+
+	return i;
+}
+
+int
+fcom_cycle_bufs(FcomCtx ctx, uint32_t sz, unsigned depth, unsigned n)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+BufRef       b[FCOM_CYCLE_BUFS_DEPTH_MAX];
+unsigned     i, got;
+int          rval = 0;
+
+	if ( ! rx || depth > FCOM_CYCLE_BUFS_DEPTH_MAX )
+		return FCOM_ERR_INVALID_ARG;
+
+	while ( n-- > 0 && ! rval ) {
+		__FC_LOCK(rx);
+			for ( got = 0; got < depth; got++ ) {
+				if ( ! (b[got] = fc_getb(rx, sz)) ) {
+					rval = FCOM_ERR_NO_SPACE;
+					break;
+				}
+			}
+			for ( i = 0; i < got; i++ )
+				fc_relb(b[i]);
+		__FC_UNLOCK(rx);
+	}
+
+	return rval;
+}
+
+int
+fcomRecordStart(const char *path)
+{
+	return fcomRecordStartCtx(fcom_dflt_ctx, path);
+}
+
+int
+fcomRecordStartCtx(FcomCtx ctx, const char *path)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+FcRecRef     rec, orec;
+int          rval;
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( (rval = fcom_rec_open(&rec, path)) )
+		return rval;
+
+	__FC_LOCK_REC(rx);
+		orec    = rx->rec;
+		rx->rec = rec;
+	__FC_UNLOCK_REC(rx);
+
+	if ( orec )
+		fcom_rec_close(orec);
+
+	return 0;
+}
+
+int
+fcomRecordStop(void)
+{
+	return fcomRecordStopCtx(fcom_dflt_ctx);
+}
+
+int
+fcomRecordStopCtx(FcomCtx ctx)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+FcRecRef     rec;
+
+	if ( ! rx )
+		return FCOM_ERR_INVALID_ARG;
+
+	__FC_LOCK_REC(rx);
+		rec     = rx->rec;
+		rx->rec = 0;
+	__FC_UNLOCK_REC(rx);
 
-										/* attach this blob/buf and bump reference count */
-										amemb->blob     = &buf->pld;
-										fc_refb( buf );
+	/* close outside of the lock; flushing may take a while */
+	return rec ? fcom_rec_close(rec) : FCOM_ERR_INVALID_ARG;
+}
 
-										aset->gotsofar |= me;
+int
+fcom_get_lock_stats(FcomCtx ctx, FcomLockStats *p_tbl, FcomLockStats *p_grp, FcomLatHist *p_rx_msg)
+{
+	return fcomGetLockStatsCtx(ctx, p_tbl, p_grp, p_rx_msg);
+}
 
-										/* AND operation not really necessary since
-										 * all 'me's have been tested against waitfor
-										 */
-										wanted          = aset->gotsofar & aset->waitfor;
-										if (   ( aset->waitforall && (wanted == aset->waitfor) )
-										    || ( !aset->waitforall && wanted ) ) {
-											if ( pthread_cond_broadcast(&aset->cond) ) {
-												fc_stats.bad_cond_bcst++;
-											} else {
-												/* Disable further updates */
-												aset->waitfor = 0;
-											}
-										}
-									}
-		ADDPROF(rx_prdx, tstmp); 
-								}
+/* Number of hash table slots fcom_get_id_stats() visits
+ * per acquisition of 'fcl_tbl'.
+ */
+#ifndef FC_ID_STATS_CHUNK
+#define FC_ID_STATS_CHUNK 64
 #endif
-							}
-							/* in the unlikely case that the ID had been unsubscribed
-							 * since our previous check above the variable 'obuf' is
-							 * still equal to 'buf' and this call hence releases the
-							 * buffer we filled in vain...
-							 */
-							fc_relb(obuf);
-		ADDPROF(rx_prdx, tstmp); 
-							__FC_UNLOCK();
-						} else {
-							fc_stats.dec_errs++;
-						}
-					}
-					/* advance XDR stream pointer */
-					xmemp += xsz;
-				}
-			} else {
-				fc_stats.bad_msg_version++;
-			}
-bail:
-			udpCommFreePacket(p);
+
+typedef struct FcIDStatsArg {
+	FcomShmID *ids;
+	unsigned   max;
+	unsigned   n;
+	unsigned   n_subs;
+	uint64_t   now;
+} FcIDStatsArg;
+
+static int
+fc_id_stats_1(SHTblEntry e, void *closure)
+{
+BufRef       buf = e;
+FcIDStatsArg *a  = closure;
+FcArrStats   z;
+
+	if ( a->n < a->max ) {
+		if ( ! buf->hdr.arr )
+			memset( &z, 0, sizeof(z) );
+		a->ids[a->n].idnt = buf->pld.fc_idnt;
+		a->ids[a->n].pad  = 0;
+		fc_arr_get( &a->ids[a->n].rate, buf->hdr.arr ? buf->hdr.arr : &z, buf->hdr.updCnt, a->now );
+		a->n++;
+	}
+	a->n_subs++;
+	return 0;
+}
+
+/* Walk the table in chunks so that the RX thread never has
+ * to wait for more than FC_ID_STATS_CHUNK slots to be visited.
+ */
+int
+fcom_get_id_stats(FcomCtx ctx, FcomShmID *p_ids, unsigned max, unsigned *p_subs)
+{
+FcIDStatsArg a;
+FcomRxCtxRef rx = FC_RX(ctx);
+unsigned     i, sz, used;
+
+	a.ids    = p_ids;
+	a.max    = max;
+	a.n      = 0;
+	a.n_subs = 0;
+	a.now    = fcom_now_us();
+
+	if ( rx ) {
+		shtblStats( rx->bTbl, &sz, &used );
+		for ( i = 0; i < sz; i += FC_ID_STATS_CHUNK ) {
+			__FC_LOCK(rx);
+				shtblForEachRange( rx->bTbl, i, FC_ID_STATS_CHUNK, fc_id_stats_1, &a );
+			__FC_UNLOCK(rx);
 		}
+	}
 
-		return nblobs;
+	if ( p_subs )
+		*p_subs = a.n_subs;
+	return a.n;
 }
 
 #if defined(USE_PTHREADS) || defined(USE_EPICS)
@@ -1696,23 +3350,21 @@ bail:
 #define TASKRTN_TYPE void
 #endif
 
-#ifdef USE_EPICS
-static epicsEventId fc_term_sync = 0;
-#endif
-
 /* Receiver task function which periodically polls
- * a 'termination' flag.
+ * a 'termination' flag. The argument is the RX context.
  */
 static TASKRTN_TYPE
 fc_recvr(void *arg)
 {
-	while ( fcom_recv_running ) {
-		fcom_receive(500);
+FcomRxCtxRef rx = arg;
+
+	while ( rx->running ) {
+		fcom_receive(rx->ctx, 500);
 	}
-	fcom_recv_running = 1;
+	rx->running = 1;
 
 #ifdef USE_EPICS
-	epicsEventSignal(fc_term_sync);
+	epicsEventSignal(rx->term_sync);
 #endif
 
 #ifdef USE_PTHREADS
@@ -1722,17 +3374,139 @@ fc_recvr(void *arg)
 #endif
 
 #ifdef USE_PTHREADS
-static pthread_t fc_recvr_tid;
-static int       fc_recvr_started = 0;
+/* Map FCOM_SCHED_xxx to the pthread policy.
+ *
+ * RETURNS: pthread policy or -1 if 'fcpol' is invalid.
+ */
+static int
+fc_sched_policy(int fcpol)
+{
+	switch ( fcpol ) {
+		case FCOM_SCHED_OTHER: return SCHED_OTHER;
+		case FCOM_SCHED_FIFO:  return SCHED_FIFO;
+		case FCOM_SCHED_RR:    return SCHED_RR;
+		default:
+		break;
+	}
+	return -1;
+}
+
+static const char *
+fc_sched_name(int pol)
+{
+	switch ( pol ) {
+		case SCHED_OTHER: return "OTHER";
+		case SCHED_FIFO:  return "FIFO";
+		case SCHED_RR:    return "RR";
+		default:
+		break;
+	}
+	return "???";
+}
+
+/* Convert priority in percent of the range supported
+ * by (pthread) policy 'pol' into a priority value.
+ *
+ * RETURNS: zero on success, errno on failure.
+ */
+static int
+fc_sched_prio(int pol, int prio_pcnt, int *p_prio)
+{
+int pmin, pmax;
+
+	pmin = sched_get_priority_min(pol);
+	pmax = sched_get_priority_max(pol);
+
+	if ( pmin < 0 || pmax < 0 )
+		return errno ? errno : EINVAL;
+
+	*p_prio = pmin + ((pmax - pmin) * prio_pcnt)/100;
+
+	return 0;
+}
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+/* Scan a list of CPUs ("0-3,6"); an empty
+ * or NULL list yields all CPUs.
+ *
+ * RETURNS: zero on success, FCOM_ERR_INVALID_ARG
+ *          if the list cannot be parsed.
+ */
+static int
+fc_scan_cpus(const char *str, cpu_set_t *set)
+{
+unsigned long lo, hi;
+char          *end;
+
+	CPU_ZERO(set);
+
+	if ( ! str || ! *str ) {
+		for ( lo = 0; lo < CPU_SETSIZE; lo++ )
+			CPU_SET(lo, set);
+		return 0;
+	}
+
+	while ( *str ) {
+		lo = strtoul(str, &end, 0);
+		if ( end == str )
+			return FCOM_ERR_INVALID_ARG;
+		hi  = lo;
+		str = end;
+		if ( '-' == *str ) {
+			str++;
+			hi = strtoul(str, &end, 0);
+			if ( end == str )
+				return FCOM_ERR_INVALID_ARG;
+			str = end;
+		}
+		if ( hi < lo || hi >= CPU_SETSIZE )
+			return FCOM_ERR_INVALID_ARG;
+		while ( lo <= hi )
+			CPU_SET(lo++, set);
+		if ( ',' == *str )
+			str++;
+		else if ( *str )
+			return FCOM_ERR_INVALID_ARG;
+	}
+
+	return 0;
+}
+
+/* Print a CPU set in list notation */
+static void
+fc_print_cpus(FILE *f, cpu_set_t *set)
+{
+int i, j;
+const char *sep = "";
+
+	for ( i=0; i<CPU_SETSIZE; i = j ) {
+		if ( ! CPU_ISSET(i, set) ) {
+			j = i + 1;
+			continue;
+		}
+		for ( j = i + 1; j < CPU_SETSIZE && CPU_ISSET(j, set); j++ )
+			/* nothing else to do */;
+		if ( j - 1 > i )
+			fprintf(f, "%s%i-%i", sep, i, j - 1);
+		else
+			fprintf(f, "%s%i", sep, i);
+		sep = ",";
+	}
+	fprintf(f, "\n");
+}
+#endif
 
 /* Start receiver task (PTHREAD version) */
 static void
-fc_recvr_start(int prio_pcnt)
+fc_recvr_start(FcomRxCtxRef rx, int fcpol, int prio_pcnt)
 {
-int                err, prio, pmin, pmax;
+int                err, prio, pol;
 pthread_attr_t     atts;
 const char         *msg;
 struct sched_param pri;
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+cpu_set_t          cpus;
+#endif
 
 	if ( (err = pthread_attr_init(&atts)) ) {
 		msg="pthread_attr_init";
@@ -1756,23 +3530,22 @@ struct sched_param pri;
 		goto bail;
 	}
 
-	if ( (err = pthread_attr_setschedpolicy(&atts, SCHED_FIFO)) ) {
-		msg="pthread_attr_setschedpolicy";
+	if ( (pol = fc_sched_policy(fcpol)) < 0 ) {
+		err = EINVAL;
+		msg="fc_sched_policy";
 		goto bail;
 	}
 
-	pmin = sched_get_priority_min(SCHED_FIFO);
-	pmax = sched_get_priority_max(SCHED_FIFO);
+	if ( (err = pthread_attr_setschedpolicy(&atts, pol)) ) {
+		msg="pthread_attr_setschedpolicy";
+		goto bail;
+	}
 
-	if ( pmin < 0 || pmax < 0 ) {
-		err = errno;
+	if ( (err = fc_sched_prio(pol, prio_pcnt, &prio)) ) {
 		msg="sched_get_priority_min/max";
 		goto bail;
 	}
 
-	prio = (pmax - pmin) * prio_pcnt;
-	prio = pmin + prio/100;
-
 	pri.sched_priority = prio;
 
 	if ( (err = pthread_attr_setschedparam(&atts, &pri)) ) {
@@ -1780,7 +3553,7 @@ struct sched_param pri;
 		goto bail;
 	}
 
-	if ( (err = pthread_create(&fc_recvr_tid, &atts, fc_recvr, 0)) ) {
+	if ( (err = pthread_create(&rx->tid, &atts, fc_recvr, rx)) ) {
 
 		/* if we aren't allowed to use RT scheduling then issue
 		 * a warning and try without...
@@ -1795,7 +3568,7 @@ struct sched_param pri;
 				goto bail;
 			}
 
-			err = pthread_create(&fc_recvr_tid, &atts, fc_recvr, 0);
+			err = pthread_create(&rx->tid, &atts, fc_recvr, rx);
 		}
 		if ( err ) {
 			msg="pthread_create";
@@ -1803,7 +3576,21 @@ struct sched_param pri;
 		}
 	}
 
-	fc_recvr_started = 1;
+	pthread_attr_destroy(&atts);
+
+	rx->started = 1;
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+	/* A CPU list that cannot be applied is not fatal; the
+	 * list has already been checked by fcomSetRxAffinity().
+	 */
+	if ( rx->ctx->rx_cpu_list && 0 == fc_scan_cpus(rx->ctx->rx_cpu_list, &cpus) ) {
+		if ( (err = pthread_setaffinity_np(rx->tid, sizeof(cpus), &cpus)) ) {
+			fprintf(stderr,"Warning (FCOM): unable to set RX thread CPU affinity: %s\n",
+			        strerror(err));
+		}
+	}
+#endif
 
 	return;
 
@@ -1814,67 +3601,282 @@ bail:
 
 /* Stop receiver task (PTHREAD version) */
 static void
-fc_recvr_stop()
+fc_recvr_stop(FcomRxCtxRef rx)
 {
-	if ( fc_recvr_started ) {
-		/* clear 'fcom_recv_running'; RX task will terminate
+	if ( rx->started ) {
+		/* clear 'running'; RX task will terminate
 		 * its loop when it polls this flag for the next time.
 		 */
-		fcom_recv_running = 0;
+		rx->running = 0;
 		/* block until RX task terminates */
-		pthread_join(fc_recvr_tid, 0);
-		fc_recvr_started = 0;
+		pthread_join(rx->tid, 0);
+		rx->started = 0;
 	}
 }
-#elif defined(USE_EPICS)
-static epicsThreadId fc_recvr_tid = 0;
 
-/* Starting a task is easier using the EPICS API... */
+int
+fcomSetRxSchedCtx(FcomCtx ctx, int fcpol, int prio_pcnt)
+{
+int                err, pol, prio;
+struct sched_param pri;
+FcomRxCtxRef       rx = FC_RX(ctx);
+
+	if ( ! ctx || (pol = fc_sched_policy(fcpol)) < 0 || prio_pcnt < 0 || prio_pcnt > 100 )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( rx && rx->started ) {
+		if ( (err = fc_sched_prio(pol, prio_pcnt, &prio)) )
+			return FCOM_ERR_SYS(err);
+		pri.sched_priority = prio;
+		if ( (err = pthread_setschedparam(rx->tid, pol, &pri)) )
+			return FCOM_ERR_SYS(err);
+	}
+
+	ctx->rx_sched_policy     = fcpol;
+	ctx->rx_priority_percent = prio_pcnt;
+
+	return 0;
+}
+
+int
+fcomSetRxAffinityCtx(FcomCtx ctx, const char *cpu_list)
+{
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+int          err;
+cpu_set_t    cpus;
+char         *str;
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! ctx )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( (err = fc_scan_cpus(cpu_list, &cpus)) )
+		return err;
+
+	if ( cpu_list && *cpu_list ) {
+		if ( ! (str = strdup(cpu_list)) )
+			return FCOM_ERR_NO_MEMORY;
+	} else {
+		str = 0;
+	}
+
+	if ( rx && rx->started ) {
+		if ( (err = pthread_setaffinity_np(rx->tid, sizeof(cpus), &cpus)) ) {
+			free(str);
+			return FCOM_ERR_SYS(err);
+		}
+	}
+
+	free(ctx->rx_cpu_list);
+	ctx->rx_cpu_list = str;
+
+	return 0;
+#else
+	return FCOM_ERR_UNSUPP;
+#endif
+}
+
+/* Dump effective scheduling parameters of the RX thread */
 static void
-fc_recvr_start(int prio_pcnt)
+fc_recvr_stats(FcomRxCtxRef rx, FILE *f)
 {
-int prio;
-int stacksz;
+int                err, pol;
+struct sched_param pri;
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+cpu_set_t          cpus;
+#endif
+
+	if ( ! rx->started ) {
+		fprintf(f, "  RX thread:                  NOT RUNNING\n");
+		return;
+	}
+
+	if ( (err = pthread_getschedparam(rx->tid, &pol, &pri)) ) {
+		fprintf(f, "  RX thread scheduling:       UNKNOWN (%s)\n", strerror(err));
+	} else {
+		fprintf(f, "  RX thread scheduling:       %s, priority %i (requested %s at %i%%)\n",
+		           fc_sched_name(pol), pri.sched_priority,
+		           fc_sched_name(fc_sched_policy(rx->ctx->rx_sched_policy)),
+		           rx->ctx->rx_priority_percent);
+	}
 
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+	fprintf(f, "  RX thread CPU affinity:     ");
+	if ( (err = pthread_getaffinity_np(rx->tid, sizeof(cpus), &cpus)) ) {
+		fprintf(f, "UNKNOWN (%s)\n", strerror(err));
+	} else {
+		fc_print_cpus(f, &cpus);
+	}
+#else
+	fprintf(f, "  RX thread CPU affinity:     UNSUPPORTED\n");
+#endif
+}
+#elif defined(USE_EPICS)
+/* Compute EPICS priority from percentage */
+static unsigned
+fc_epics_prio(int prio_pcnt)
+{
+int prio;
 	prio = (epicsThreadPriorityMax - epicsThreadPriorityMin) * prio_pcnt;
-	prio = prio/100 + epicsThreadPriorityMin;
+	return prio/100 + epicsThreadPriorityMin;
+}
+
+/* Starting a task is easier using the EPICS API; the
+ * EPICS API has no notion of scheduling policy, however.
+ */
+static void
+fc_recvr_start(FcomRxCtxRef rx, int fcpol, int prio_pcnt)
+{
+int stacksz;
 
 	stacksz = epicsThreadGetStackSize( epicsThreadStackMedium );
 
-	fc_recvr_tid = epicsThreadMustCreate("fcomRX", prio, stacksz, fc_recvr, 0);
+	rx->tid = epicsThreadMustCreate("fcomRX", fc_epics_prio(prio_pcnt), stacksz, fc_recvr, rx);
 }
 
 /* Stopping the task requires an extra synchronization device */
 static void
-fc_recvr_stop()
+fc_recvr_stop(FcomRxCtxRef rx)
+{
+	if ( rx->tid ) {
+		rx->term_sync = epicsEventMustCreate(epicsEventEmpty);
+		rx->running = 0;
+		epicsEventMustWait(rx->term_sync);
+		epicsEventDestroy(rx->term_sync);
+		rx->tid       = 0;
+		rx->term_sync = 0;
+	}
+}
+
+int
+fcomSetRxSchedCtx(FcomCtx ctx, int fcpol, int prio_pcnt)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! ctx || prio_pcnt < 0 || prio_pcnt > 100 )
+		return FCOM_ERR_INVALID_ARG;
+
+	/* policy cannot be selected with the EPICS API */
+	if ( FCOM_SCHED_FIFO != fcpol )
+		return FCOM_ERR_UNSUPP;
+
+	if ( rx && rx->tid )
+		epicsThreadSetPriority( rx->tid, fc_epics_prio(prio_pcnt) );
+
+	ctx->rx_priority_percent = prio_pcnt;
+
+	return 0;
+}
+
+int
+fcomSetRxAffinityCtx(FcomCtx ctx, const char *cpu_list)
+{
+	return FCOM_ERR_UNSUPP;
+}
+
+static void
+fc_recvr_stats(FcomRxCtxRef rx, FILE *f)
 {
-	if ( fc_recvr_tid ) {
-		fc_term_sync = epicsEventMustCreate(epicsEventEmpty);
-		fcom_recv_running = 0;
-		epicsEventMustWait(fc_term_sync);
-		epicsEventDestroy(fc_term_sync);
-		fc_recvr_tid = 0;
-		fc_term_sync = 0;
+	if ( ! rx->tid ) {
+		fprintf(f, "  RX thread:                  NOT RUNNING\n");
+		return;
 	}
+	fprintf(f, "  RX thread priority:         %u (EPICS)\n",
+	           epicsThreadGetPriority( rx->tid ));
+}
+#else
+int
+fcomSetRxSchedCtx(FcomCtx ctx, int fcpol, int prio_pcnt)
+{
+	return FCOM_ERR_UNSUPP;
+}
+
+int
+fcomSetRxAffinityCtx(FcomCtx ctx, const char *cpu_list)
+{
+	return FCOM_ERR_UNSUPP;
+}
+
+static void
+fc_recvr_stats(FcomRxCtxRef rx, FILE *f)
+{
+	fprintf(f, "  RX thread:                  NONE (NOT COMPILED)\n");
+}
+#endif
+
+/* Without a default context the settings are recorded
+ * and used when fcomInit() creates it.
+ */
+int
+fcomSetRxSched(int fcpol, int prio_pcnt)
+{
+	if ( fcom_dflt_ctx )
+		return fcomSetRxSchedCtx(fcom_dflt_ctx, fcpol, prio_pcnt);
+	if ( fcpol < FCOM_SCHED_OTHER || fcpol > FCOM_SCHED_RR || prio_pcnt < 0 || prio_pcnt > 100 )
+		return FCOM_ERR_INVALID_ARG;
+	fcom_rx_sched_policy     = fcpol;
+	fcom_rx_priority_percent = prio_pcnt;
+	return 0;
 }
+
+int
+fcomSetRxAffinity(const char *cpu_list)
+{
+#if defined(USE_PTHREADS) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+int       err;
+cpu_set_t cpus;
+char      *str;
+
+	if ( fcom_dflt_ctx )
+		return fcomSetRxAffinityCtx(fcom_dflt_ctx, cpu_list);
+
+	if ( (err = fc_scan_cpus(cpu_list, &cpus)) )
+		return err;
+
+	if ( cpu_list && *cpu_list ) {
+		if ( ! (str = strdup(cpu_list)) )
+			return FCOM_ERR_NO_MEMORY;
+	} else {
+		str = 0;
+	}
+
+	free(fcom_rx_cpu_list);
+	fcom_rx_cpu_list = str;
+
+	return 0;
+#else
+	return fcomSetRxAffinityCtx(fcom_dflt_ctx, cpu_list);
 #endif
+}
 
 /* FCOM Receiver initialization */
 int
-fcom_recv_init(unsigned nbufs)
+fcom_recv_init(FcomCtx ctx, unsigned nbufs)
 {
-int       i,rval;
-uintptr_t key_off,n;
+int          i,rval;
+uintptr_t    key_off,n;
+FcomRxCtxRef rx;
 
 	if ( nbufs == 0 )
 		nbufs = 1000;
 
+	if ( ! (rx = calloc(1, sizeof(*rx))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	rx->ctx     = ctx;
+	rx->running = 1;
+	memcpy(rx->fc_free, fc_free_tmpl, sizeof(rx->fc_free));
+
 	/* Create locks */
-	__FC_LOCK_CRE(tbl);
-	__FC_LOCK_CRE(grp);
+	__FC_LOCK_CRE(rx, tbl);
+	__FC_LOCK_CRE(rx, grp);
+	__FC_LOCK_CRE(rx, rec);
+
+	/* from here on fcom_recv_fini() cleans up after a failure */
+	ctx->rx = rx;
 
 	for ( n=i=0; i<NBUFKINDS; i++ ) {
-		n += fc_free[i].wght;		
+		n += rx->fc_free[i].wght;		
 	}
 
 	/* Create buffers -- it is easy to add more buffers at run-time
@@ -1882,7 +3884,7 @@ uintptr_t key_off,n;
 	 * may be time-consuming.
 	 */
 	for ( i = 0; i<NBUFKINDS; i++ ) {
-		if ( (rval = fcom_add_bufs(i, (nbufs * fc_free[i].wght)/n)) )
+		if ( (rval = fcom_add_bufs(ctx, i, (nbufs * rx->fc_free[i].wght)/n)) )
 			return rval;
 	}
 
@@ -1890,7 +3892,7 @@ uintptr_t key_off,n;
 	key_off =   (uintptr_t) &((BufRef)0)->pld.fc_idnt
               - (uintptr_t)  ((BufRef)0);
 
-	if ( ! ( bTbl = shtblCreate(4 * nbufs, (unsigned long)key_off) ) ) {
+	if ( ! ( rx->bTbl = shtblCreate(4 * nbufs, (unsigned long)key_off) ) ) {
 		fprintf(stderr,"Fatal Error: Unable to create FCOM hash table\n");
 		return FCOM_ERR_INTERNAL;
 	}
@@ -1900,84 +3902,140 @@ uintptr_t key_off,n;
 	 * since index 0 in the BufHdr is reserved (means: not member
 	 * of any set) we use this as the anchor for the free list.
 	 */
-	SET_NODE_FREE_LIST = 0;
-	for ( i = 1; i< sizeof(setNodeTbl)/sizeof(setNodeTbl[0]); i++ ) {
-		setNodeTbl[i].next = SET_NODE_FREE_LIST;
-		SET_NODE_FREE_LIST = i;
+	SET_NODE_FREE_LIST(rx) = 0;
+	for ( i = 1; i< sizeof(rx->setNodeTbl)/sizeof(rx->setNodeTbl[0]); i++ ) {
+		rx->setNodeTbl[i].next = SET_NODE_FREE_LIST(rx);
+		SET_NODE_FREE_LIST(rx) = i;
 	}
 
-	setNodeAvail = i - 1;
+	rx->setNodeAvail = i - 1;
 #endif
 
 	/* Start receiver */
 #if defined(USE_PTHREADS) || defined(USE_EPICS)
-	fc_recvr_start(fcom_rx_priority_percent);
+	fc_recvr_start(rx, ctx->rx_sched_policy, ctx->rx_priority_percent);
 #endif
 	return 0;
 }
 
 static void fc_buf_cleanup(SHTblEntry e, void *closure)
 {
-	fc_relmc(FCOM_GET_GID( ((BufRef)e)->pld.fc_idnt));
+	free( ((BufRef)e)->hdr.lat );
+	((BufRef)e)->hdr.lat = 0;
+	free( ((BufRef)e)->hdr.arr );
+	((BufRef)e)->hdr.arr = 0;
+	fc_relmc(closure, FCOM_GET_GID( ((BufRef)e)->pld.fc_idnt));
 	fc_relb(e);
 }
 
+/* Check if the application still holds references to
+ * blobs (or sets) of this context before anything is
+ * torn down so that a failed fcomDestroyContext() leaves
+ * the context intact.
+ */
+int
+fcom_recv_busy(FcomCtx ctx)
+{
+FcomRxCtxRef rx = FC_RX(ctx);
+int          rval = 0;
+
+	if ( ! rx )
+		return 0;
+
+	__FC_LOCK_GRP(rx);
+	__FC_LOCK(rx);
+		if ( rx->n_usr ) {
+			fprintf(stderr, "%"PRIu32" blob reference(s) still held\n", rx->n_usr);
+			rval = FCOM_ERR_ID_IN_USE;
+		}
+#if defined(SUPPORT_SETS)
+		if ( rx->n_set ) {
+			fprintf(stderr, "%"PRIu32" blob set(s) still allocated\n", rx->n_set);
+			rval = FCOM_ERR_ID_IN_USE;
+		}
+#endif
+	__FC_UNLOCK(rx);
+	__FC_UNLOCK_GRP(rx);
+
+	return rval;
+}
+
 /* FCOM Receiver cleanup (in reverse order) */
 int
-fcom_recv_fini()
+fcom_recv_fini(FcomCtx ctx)
 {
-int         i;
-unsigned    d;
-BufChunkRef r,p;
+int          i;
+unsigned     d;
+BufChunkRef  r,p;
+FcomRxCtxRef rx = FC_RX(ctx);
+
+	if ( ! rx )
+		return 0;
 
 	/* Stop task */
 #if defined(USE_PTHREADS) || defined(USE_EPICS)
-	fc_recvr_stop();
+	fc_recvr_stop(rx);
 #endif
 
+	/* Abandon pending reassemblies */
+	for ( i = 0; i<FC_REASM_SLOTS; i++ ) {
+		if ( rx->reasm[i].nfrags )
+			fc_reasm_drop(rx, &rx->reasm[i]);
+	}
+
 	/* Destroy hash table. shtblDestroy() scans the
 	 * entire table and calls fc_buf_cleanup() on all
 	 * non-NULL/left-over entries.
 	 */
-	if ( bTbl ) {
-		__FC_LOCK_GRP();
-		__FC_LOCK();
-		shtblDestroy(bTbl, fc_buf_cleanup, 0);
-		bTbl = 0;
-		__FC_UNLOCK();
-		__FC_UNLOCK_GRP();
+	if ( rx->bTbl ) {
+		__FC_LOCK_GRP(rx);
+		__FC_LOCK(rx);
+		shtblDestroy(rx->bTbl, fc_buf_cleanup, rx);
+		rx->bTbl = 0;
+		__FC_UNLOCK(rx);
+		__FC_UNLOCK_GRP(rx);
 	}
 
 	/* Release buffer memory - this fails if there are any
 	 * references to buffers (e.g., in the application).
 	 */
 	for ( i = 0; i<NBUFKINDS; i++ ) {
-		if ( 0 == fc_free[i].tot )
+		if ( 0 == rx->fc_free[i].tot )
 			continue;
 
-		__FC_LOCK();
-		d = fc_free[i].tot - fc_free[i].avail;
+		__FC_LOCK(rx);
+		d = rx->fc_free[i].tot - rx->fc_free[i].avail;
 		if ( 0 != d ) {
 			fprintf(stderr, 
-					"%u buffers (out of %u) of size %"PRIu16" still in use\n",
-					d, fc_free[i].tot, fc_free[i].sz);
-			__FC_UNLOCK();
+					"%u buffers (out of %u) of size %"PRIu32" still in use\n",
+					d, rx->fc_free[i].tot, rx->fc_free[i].sz);
+			__FC_UNLOCK(rx);
 			return FCOM_ERR_INTERNAL;
 		}
 
-		for ( r = fc_free[i].chunks; r; ) {
+		for ( r = rx->fc_free[i].chunks; r; ) {
 			p = r;
 			r = p->next;
 			free(p);
 		} 
-		fc_free[i].free_list = 0;
-		fc_free[i].chunks    = 0;
-		fc_free[i].tot       = 0;
-		fc_free[i].avail     = 0;
+		rx->fc_free[i].free_list = 0;
+		rx->fc_free[i].chunks    = 0;
+		rx->fc_free[i].tot       = 0;
+		rx->fc_free[i].avail     = 0;
 
-		__FC_UNLOCK();
+		__FC_UNLOCK(rx);
 	}
-	__FC_LOCK_DEL(tbl);
-	__FC_LOCK_DEL(grp);
+	for ( i = 0; i<=FCOM_GID_MAX; i++ )
+		free(rx->seq[i]);
+
+	if ( rx->rec )
+		fcom_rec_close(rx->rec);
+
+	__FC_LOCK_DEL(rx, tbl);
+	__FC_LOCK_DEL(rx, grp);
+	__FC_LOCK_DEL(rx, rec);
+
+	ctx->rx = 0;
+	free(rx);
 	return 0;
 }
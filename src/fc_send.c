@@ -15,6 +15,7 @@
  * Author: Till Straumann <strauman@slac.stanford.edu>, 2009.
  */
 
+#define _GNU_SOURCE /* for sendmmsg() */
 #define __INSIDE_FCOM__
 #include <fcom_api.h>
 #include <fcomP.h>
@@ -22,58 +23,181 @@
 #include <xdr_dec.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <string.h>
+#include <errno.h>
 
 #include <netinet/in.h> /* for htonl & friends only */
 
-#ifdef ENABLE_PROFILE
-#include <sys/time.h>
+#include <stdlib.h>
+
+#include <config.h>
+
+#ifdef HAVE_SENDMMSG
+#include <sys/socket.h>
+#endif
+
+/* Max. number of messages submitted by a single
+ * system call in fcomPutGroups().
+ */
+#define FC_BATCH_MAX 64
+
+/* The lock protecting the coalescing state */
+#ifdef USE_PTHREADS
+#include <pthread.h>
+#define __FC_TX_LOCK_DECL          pthread_mutex_t coal_lock;
+#define __FC_TX_LOCK_CRE(t)        fc_tx_lock_create(&(t)->coal_lock)
+#define __FC_TX_LOCK_DEL(t)        do { pthread_mutex_destroy( &(t)->coal_lock ); } while (0)
+#define __FC_TX_LOCK(t)            do { pthread_mutex_lock( &(t)->coal_lock );    } while (0)
+#define __FC_TX_UNLOCK(t)          do { pthread_mutex_unlock( &(t)->coal_lock );  } while (0)
+#elif defined(USE_EPICS)
+#include <epicsMutex.h>
+#define __FC_TX_LOCK_DECL          epicsMutexId coal_lock;
+#define __FC_TX_LOCK_CRE(t)        ( ((t)->coal_lock = epicsMutexCreate()) ? 0 : FCOM_ERR_NO_MEMORY )
+#define __FC_TX_LOCK_DEL(t)        do { epicsMutexDestroy( (t)->coal_lock );     } while (0)
+#define __FC_TX_LOCK(t)            do { epicsMutexMustLock( (t)->coal_lock );    } while (0)
+#define __FC_TX_UNLOCK(t)          do { epicsMutexUnlock( (t)->coal_lock );      } while (0)
+#else
+#define __FC_TX_LOCK_DECL
+#define __FC_TX_LOCK_CRE(t)        0
+#define __FC_TX_LOCK_DEL(t)        do {} while (0)
+#define __FC_TX_LOCK(t)            do {} while (0)
+#define __FC_TX_UNLOCK(t)          do {} while (0)
+#endif
+
+/* The asynchronous TX queue uses a pthread and the
+ * gcc __atomic builtins.
+ */
+#if defined(USE_PTHREADS) && defined(__ATOMIC_ACQUIRE)
+#define FC_TXQ
+#include <pthread.h>
+#include <semaphore.h>
+
+typedef struct FcTxQ *FcTxQRef;
+#endif
+
+/* Open messages are sent when their time window expires
+ * by a timer thread (only with pthreads).
+ */
+#ifdef USE_PTHREADS
+#define FC_COAL_TMR
+#include <time.h>
 #endif
 
-static struct {
-	uint32_t n_msg;
-	uint32_t n_blb;
-	uint32_t n_snderr;
-} fc_stats = {0};
+/* An open (coalescing) message; one per GID */
+typedef struct FcCoal {
+	FcomGroup     grp;          /* message under construction or NULL  */
+	uint32_t      nints;        /* 32-bit words encoded so far         */
+	uint32_t      gid;
+	uint64_t      t_open;       /* when the first blob was appended    */
+	struct FcCoal *next, *prev; /* list of open messages, oldest first */
+} FcCoal;
+
+/* All state of the sending part of a FCOM context */
+typedef struct FcomTxCtx {
+	FcomCtx ctx;
+#ifdef FC_TXQ
+	FcTxQRef txq;               /* async. submission queue (or NULL)   */
+#endif
+	FcCoal   *coal;             /* coalescing table (NULL: disabled)   */
+	FcCoal   coal_open;         /* list head of open messages          */
+	uint32_t coal_bytes;        /* size window                         */
+	uint32_t coal_usecs;        /* time window                         */
+#ifdef FC_COAL_TMR
+	pthread_cond_t coal_cnd;    /* wakes up the timer thread           */
+	pthread_t coal_tid;
+	int      coal_tmr;          /* timer thread running                */
+#endif
+	uint32_t xid;               /* ID of the last fragmented message   */
+	uint32_t seq[FCOM_GID_MAX+1]; /* last sequence number of every GID */
+	uint32_t msg_size;          /* max. size of a datagram (bytes)     */
+	int      compact;           /* use compact encoding for groups     */
+	__FC_TX_LOCK_DECL
+	FcomTxStats fc_stats; /* updated with FCOM_STAT_xxx() */
+} FcomTxCtxRec, *FcomTxCtxRef;
 
 /* We directly use udpComm packets to hold FCOM
  * groups. The low-level xdr-encoder stores
  * internal state information in the first two 32-bit
  * words which eventually hold the XDR encoded version
  * number and blob-count, respectively (see xdr_enc.c).
+ *
+ * Groups which are larger than a udpComm packet live
+ * in malloc()ed memory instead. Such 'big' groups are
+ * tagged by setting the least significant bit of the
+ * handle (packets are word-aligned; fc_alloc_group()
+ * checks this).
  */
+#define FC_GRP_BIG(g)  ( ((uintptr_t)(g)) & 1 )
+#define FC_GRP_MEM(g)  ( FC_GRP_BIG(g) ? (uint32_t*)(((uintptr_t)(g)) & ~(uintptr_t)1) \
+                                       : (uint32_t*)udpCommBufPtr((UdpCommPkt)(g)) )
 
-int
-fcomAllocGroup(FcomID id, FcomGroup *p_grp)
+static int
+fc_alloc_group(uint32_t size, uint32_t gid, int compact, FcomGroup *p_grp)
 {
-UdpCommPkt grp;
+void       *grp;
 int        rval;
 uint32_t   *xmem;
 
-	if ( FCOM_GET_MAJ(id) != FCOM_PROTO_MAJ_1 )
-		return FCOM_ERR_BAD_VERSION;
+	if ( size <= UDPCOMM_PKTSZ ) {
+		if ( ! (grp = udpCommAllocPacket()) ) {
+			return FCOM_ERR_NO_MEMORY;
+		}
 
-	if ( ! (grp = udpCommAllocPacket()) ) {
-		return FCOM_ERR_NO_MEMORY;
+		if ( ((uintptr_t)grp) & (sizeof(uint32_t)-1) ) {
+			udpCommFreePacket(grp);
+			return FCOM_ERR_INTERNAL;
+		}
+	} else {
+		if ( ! (xmem = malloc(size)) ) {
+			return FCOM_ERR_NO_MEMORY;
+		}
+		grp = (void*)((uintptr_t)xmem | 1);
 	}
 
-	if ( ((uintptr_t)grp) & (sizeof(uint32_t)-1) ) {
-		rval = FCOM_ERR_INTERNAL;
-		goto bail;
-	}
+	xmem = FC_GRP_MEM(grp);
 
-	xmem = udpCommBufPtr(grp);
+	if ( compact )
+		rval = fcom_msg_init_compact(xmem, size, gid);
+	else
+		rval = fcom_msg_init(xmem, size, gid);
 
-	if ( (rval = fcom_msg_init(xmem, UDPCOMM_PKTSZ, FCOM_GET_GID(id))) < 0 )
-		goto bail;
+	if ( rval < 0 ) {
+		fcomFreeGroup(grp);
+		return rval;
+	}
 
-	rval   = 0;
 	*p_grp = (FcomGroup)grp;
-	grp    = 0;
+	return 0;
+}
 
-bail:
-	if ( grp )
-		udpCommFreePacket(grp);
-	return rval;
+int
+fcomAllocGroup(FcomID id, FcomGroup *p_grp)
+{
+	return fcomAllocGroupSize(id, fcom_dflt_ctx && fcom_dflt_ctx->tx ? fcom_dflt_ctx->tx->msg_size : UDPCOMM_PKTSZ, p_grp);
+}
+
+int
+fcomAllocGroupCtx(FcomCtx ctx, FcomID id, FcomGroup *p_grp)
+{
+	if ( ! ctx || ! ctx->tx )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( FCOM_GET_MAJ(id) != FCOM_PROTO_MAJ_1 )
+		return FCOM_ERR_BAD_VERSION;
+
+	return fc_alloc_group(ctx->tx->msg_size, FCOM_GET_GID(id), ctx->tx->compact, p_grp);
+}
+
+int
+fcomAllocGroupSize(FcomID id, uint32_t size, FcomGroup *p_grp)
+{
+	if ( FCOM_GET_MAJ(id) != FCOM_PROTO_MAJ_1 )
+		return FCOM_ERR_BAD_VERSION;
+
+	if ( size > FCOM_MSG_SIZE_MAX )
+		return FCOM_ERR_INVALID_ARG;
+
+	return fc_alloc_group(size, FCOM_GET_GID(id), fcom_dflt_ctx && fcom_dflt_ctx->tx && fcom_dflt_ctx->tx->compact, p_grp);
 }
 
 int
@@ -82,7 +206,7 @@ fcomAddGroup(FcomGroup grp, FcomBlobRef pb)
 int      rval;
 uint32_t *xmem;
 
-	xmem = udpCommBufPtr((UdpCommPkt)grp);
+	xmem = FC_GRP_MEM(grp);
 	rval = fcom_msg_append_blob(xmem, pb);
 
 	return rval < 0 ? rval : 0;
@@ -91,181 +215,1748 @@ uint32_t *xmem;
 void
 fcomFreeGroup(FcomGroup grp)
 {
-	udpCommFreePacket((UdpCommPkt)grp);
+	if ( FC_GRP_BIG(grp) )
+		free(FC_GRP_MEM(grp));
+	else
+		udpCommFreePacket((UdpCommPkt)grp);
 }
 
+/* Account for the result of a send operation */
 static int
-sendtogid(UdpCommPkt p, uint32_t len, uint32_t gid)
+fc_sent(FcomCtx ctx, int rval)
 {
-int      rval;
-uint32_t dip;
-
-	/* Form destination IP address */
-	dip = fcom_g_prefix | htonl(gid);
-		
-	rval = udpCommSendPktTo(fcom_xsd, p, len, dip, fcom_port);
-
 	if ( rval < 0 ) {
 		rval = FCOM_ERR_SYS(-rval);
-		fc_stats.n_snderr++;
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_snderr );
 	} else {
 		rval = 0;
-		fc_stats.n_msg++;
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_msg );
 	}
 
 	return rval;
 }
 
-#ifdef ENABLE_PROFILE
-static __inline__ uint32_t 
-tvdiff(struct timeval *pa, struct timeval *pb)
+/* Number a complete message; zero is never used
+ * as a sequence number (unnumbered message).
+ */
+static void
+fc_seq_stamp(FcomCtx ctx, uint32_t *xmem, uint32_t nints, uint32_t gid)
 {
-uint32_t diff=0;
-	if ( pa->tv_usec < pb->tv_usec )
-		diff += 1000000L;
-	/* assume always < 1s */
-	diff += pa->tv_usec - pb->tv_usec;
-	return diff;
-}
+uint32_t seq;
 
-uint32_t tx_prof[20] = {0};
-int      tx_prdx     = 0;
-#define  ADDPROF(i, a, b)              \
-	do {                               \
-		gettimeofday( &a, 0 );         \
-		tx_prof[i++] = tvdiff(&a, &b); \
-		b = a;                         \
-	} while (0)
+	do {
+#ifdef __ATOMIC_RELAXED
+		seq = __atomic_add_fetch( &ctx->tx->seq[gid & FCOM_GID_MAX], 1, __ATOMIC_RELAXED );
 #else
-#define ADDPROF(i, a, b) do { } while (0)
+		seq = ++ctx->tx->seq[gid & FCOM_GID_MAX];
 #endif
+	} while ( 0 == seq );
 
-int
-fcomPutBlob(FcomBlobRef pb)
+	fcom_msg_set_seq(xmem, nints, seq);
+}
+
+/* Send (and consume) packet 'p' */
+static int
+sendtogid(FcomCtx ctx, UdpCommPkt p, uint32_t len, uint32_t gid)
 {
-UdpCommPkt     p;
-uint32_t       *xmem;
-int            rval;
-uint32_t       gid;
-#ifdef ENABLE_PROFILE
-struct timeval ta, tb;
-#endif
+uint32_t dip;
 
+	/* Form destination IP address */
+	dip = ctx->g_prefix | htonl(gid);
+		
+	return fc_sent(ctx, ctx->xp->send_pkt_to(ctx->xsd, p, len, dip, ctx->port));
+}
 
-	if ( FCOM_PROTO_MAJ_GET(pb->fc_vers) != FCOM_PROTO_VERSION_1x )
-		return FCOM_ERR_BAD_VERSION;
+/* Send buffer 'buf' to 'dip'; the caller retains ownership */
+static int
+sendbufto(FcomCtx ctx, void *buf, uint32_t len, uint32_t dip)
+{
+	return fc_sent(ctx, ctx->xp->send_to(ctx->xsd, buf, len, dip, ctx->port));
+}
 
-#ifdef ENABLE_PROFILE
-	gettimeofday( &tb, 0 );
-	tx_prdx = 0;
-#endif
+/* Send a message which exceeds a single packet in
+ * fragments. The receivers reassemble the message
+ * from the fragments (which are counted as individual
+ * messages in the statistics).
+ *
+ * RETURNS: zero on success or the status of the first
+ *          failure (no more fragments are sent then).
+ */
+static int
+fc_send_frags(FcomCtx ctx, uint32_t *xmem, uint32_t nints, uint32_t dip)
+{
+uint32_t    *buf;
+uint32_t    maxlen = ctx->tx->msg_size/sizeof(*buf) - FCOM_XDR_FRAG_HDRSZ;
+FcomFragHdr fh;
+int         rval = 0;
 
-	if ( ! (p = udpCommAllocPacket()) ) {
+	if ( (nints + maxlen - 1) / maxlen > FCOM_MSG_MAX_FRAGS )
+		return FCOM_ERR_NO_SPACE;
+
+	if ( ! (buf = malloc(ctx->tx->msg_size)) )
 		return FCOM_ERR_NO_MEMORY;
+
+#ifdef __ATOMIC_RELAXED
+	fh.xid    = __atomic_add_fetch( &ctx->tx->xid, 1, __ATOMIC_RELAXED );
+#else
+	fh.xid    = ++ctx->tx->xid;
+#endif
+	fh.nints  = nints;
+	fh.nfrags = (nints + maxlen - 1) / maxlen;
+
+	for ( fh.idx = 0, fh.off = 0; fh.off < nints; fh.idx++, fh.off += fh.len ) {
+		fh.len = nints - fh.off > maxlen ? maxlen : nints - fh.off;
+		fcom_xdr_enc_fraghdr(buf, &fh);
+		memcpy(buf + FCOM_XDR_FRAG_HDRSZ, xmem + fh.off, fh.len * sizeof(*xmem));
+		if ( (rval = sendbufto(ctx, buf, (FCOM_XDR_FRAG_HDRSZ + fh.len) * sizeof(*xmem), dip)) )
+			break;
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_frag );
 	}
+	if ( 0 == rval )
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_frag_msg );
 
-	ADDPROF(tx_prdx, ta, tb);
+	free(buf);
+	return rval;
+}
 
-	xmem = udpCommBufPtr(p);
+/* Send a (numbered) message held in 'xmem' to 'dip'; the caller
+ * retains ownership. Messages exceeding the max. datagram size are
+ * fragmented.
+ */
+static int
+fc_xmit_buf_to(FcomCtx ctx, uint32_t *xmem, uint32_t nints, uint32_t dip)
+{
+	if ( nints * sizeof(*xmem) > ctx->tx->msg_size )
+		return fc_send_frags(ctx, xmem, nints, dip);
+	return sendbufto(ctx, xmem, nints * sizeof(*xmem), dip);
+}
 
-	if ( (rval = fcom_msg_one_blob(xmem, UDPCOMM_PKTSZ, pb, &gid)) < 0 ) {
-		udpCommFreePacket(p);
-		return rval;
-	}
+/* Number and send a message held in 'xmem' to 'dip' */
+static int
+fc_send_buf_to(FcomCtx ctx, uint32_t *xmem, uint32_t nints, uint32_t gid, uint32_t dip)
+{
+	fc_seq_stamp(ctx, xmem, nints, gid);
+	return fc_xmit_buf_to(ctx, xmem, nints, dip);
+}
+
+/* Send a message held in 'xmem' to its GID */
+static int
+fc_send_buf(FcomCtx ctx, uint32_t *xmem, uint32_t nints, uint32_t gid)
+{
+	return fc_send_buf_to(ctx, xmem, nints, gid, ctx->g_prefix | htonl(gid));
+}
 
-	ADDPROF(tx_prdx, ta, tb);
+/* Send (and consume) a group which is already numbered */
+static int
+fc_xmit_group(FcomCtx ctx, FcomGroup grp, uint32_t nints, uint32_t gid)
+{
+int rval;
 
-	if ( ! FCOM_GID_VALID( gid ) ) {
-		udpCommFreePacket(p);
-		return FCOM_ERR_INVALID_ID;
+	if ( ! FC_GRP_BIG(grp) && nints * sizeof(uint32_t) <= ctx->tx->msg_size )
+		return sendtogid(ctx, (UdpCommPkt)grp, nints * sizeof(uint32_t), gid);
+
+	rval = fc_xmit_buf_to(ctx, FC_GRP_MEM(grp), nints, ctx->g_prefix | htonl(gid));
+	fcomFreeGroup(grp);
+	return rval;
+}
+
+/* Number, send (and consume) a group */
+static int
+fc_send_group(FcomCtx ctx, FcomGroup grp, uint32_t nints, uint32_t gid)
+{
+	fc_seq_stamp(ctx, FC_GRP_MEM(grp), nints, gid);
+	return fc_xmit_group(ctx, grp, nints, gid);
+}
+
+/* Send a blob which doesn't fit into a single packet */
+static int
+fc_put_large(FcomCtx ctx, FcomBlobRef pb)
+{
+uint32_t *xmem;
+uint32_t gid;
+int      sz, rval;
+
+	if ( (sz = FCOM_EL_SIZE(pb->fc_type)) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	/* message header, blob header and payload (padded) */
+	sz = (2 + FCOM_XDR_BLOB_HDRSZ) * sizeof(*xmem) + ((sz * pb->fc_nelm + 3) & ~3);
+
+	if ( ! (xmem = malloc(sz)) )
+		return FCOM_ERR_NO_MEMORY;
+
+	if ( (rval = fcom_msg_one_blob(xmem, sz, pb, &gid)) > 0 ) {
+		if ( ! FCOM_GID_VALID( gid ) ) {
+			rval = FCOM_ERR_INVALID_ID;
+		} else if ( 0 == (rval = fc_send_buf(ctx, xmem, rval, gid)) ) {
+			FCOM_STAT_INC( ctx->tx->fc_stats.n_blb );
+		}
 	}
 
-	rval = sendtogid(p, rval * sizeof(uint32_t), gid);
+	free(xmem);
+	return rval;
+}
+
+#ifdef USE_PTHREADS
+static int
+fc_tx_lock_create(pthread_mutex_t *p_l)
+{
+pthread_mutexattr_t a;
+int                 err;
+	pthread_mutexattr_init( &a );
+#ifdef HAVE_PTHREAD_PRIO_INHERIT
+	pthread_mutexattr_setprotocol( &a, PTHREAD_PRIO_INHERIT );
+#endif
+	err = pthread_mutex_init( p_l, &a );
+	pthread_mutexattr_destroy( &a );
+	return err;
+}
+#endif
+
+/*
+ * Coalescing.
+ *
+ * If enabled, blobs sent with fcomPutBlob() are not sent
+ * immediately but appended to an 'open' message for their GID.
+ * An open message is sent when the next blob would not fit
+ * into the size window, when it becomes older than the time
+ * window or when the application flushes explicitly. The time
+ * window is checked whenever a blob is put and by a timer thread
+ * which sleeps until the oldest open message expires (pthreads
+ * only).
+ *
+ * All of this state is protected by the context's 'coal_lock'.
+ */
+
+static void
+fc_coal_unlink(FcCoal *c)
+{
+	c->prev->next = c->next;
+	c->next->prev = c->prev;
+	c->next = c->prev = c;
+}
+
+/* Send an open message; coal_lock must be held */
+static int
+fc_coal_send(FcomCtx ctx, FcCoal *c)
+{
+uint32_t   nints, gid, nblobs;
+FcomGroup  g = c->grp;
+int        rval;
 
-	ADDPROF(tx_prdx, ta, tb);
+	fc_coal_unlink(c);
+	c->grp = 0;
 
-	if ( 0 == rval )
-		fc_stats.n_blb++;
+	nints = fcom_msg_end(FC_GRP_MEM(g), &gid, &nblobs);
 
+	if ( 0 == (rval = fc_send_group(ctx, g, nints, gid)) ) {
+		FCOM_STAT_ADD( ctx->tx->fc_stats.n_blb, nblobs );
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_coal_msg );
+	}
 	return rval;
 }
 
-int
-fcomPutGroup(FcomGroup group)
+/* Send all open messages (or only those which are older
+ * than the time window if 'expired' is nonzero).
+ * coal_lock must be held.
+ *
+ * RETURNS: zero or the status of the first failure.
+ */
+static int
+fc_coal_flush(FcomCtx ctx, int expired)
 {
-uint32_t nblobs;
-uint32_t gid;
-uint32_t nints;
-uint32_t *xmem;
-int      rval;
+FcomTxCtxRef tx   = ctx->tx;
+uint64_t     now  = 0;
+int          rval = 0, st;
 
-	xmem   = udpCommBufPtr((UdpCommPkt)group);
+	if ( expired ) {
+		if ( ! tx->coal_usecs )
+			return 0;
+		now = fcom_now_us();
+	}
 
-	/*
-	 * GID and total number of 32-bit words
-     * stored in 'xmem' are returned by fcom_msg_end().
-     */
-	nints = fcom_msg_end(xmem, &gid, &nblobs);
+	while ( tx->coal_open.next != &tx->coal_open ) {
+		if ( expired ) {
+			if ( now - tx->coal_open.next->t_open < tx->coal_usecs )
+				break;
+			FCOM_STAT_INC( tx->fc_stats.n_coal_tmo );
+		}
+		if ( (st = fc_coal_send(ctx, tx->coal_open.next)) && ! rval )
+			rval = st;
+	}
+	return rval;
+}
 
-	if ( ! FCOM_GID_VALID(gid) ) {
-		fcomFreeGroup(group);	
+/* Append a blob to the open message of its GID.
+ * Failures to send messages on the way are only
+ * recorded in the statistics.
+ *
+ * RETURNS: zero on success, 1 if the blob does not fit into
+ *          the size window (and must be sent individually)
+ *          or an error status < 0.
+ */
+static int
+fc_coal_put(FcomCtx ctx, FcomBlobRef pb)
+{
+FcomTxCtxRef tx = ctx->tx;
+FcCoal       *c;
+uint32_t     gid;
+int          rval = 0, st;
+
+	if ( fcom_get_gid(pb, &gid) || ! FCOM_GID_VALID(gid) )
 		return FCOM_ERR_INVALID_ID;
+
+	c = &tx->coal[gid];
+
+	__FC_TX_LOCK(tx);
+
+	fc_coal_flush(ctx, 1);
+
+	for (;;) {
+		if ( ! c->grp ) {
+			if ( (rval = fc_alloc_group(tx->coal_bytes, gid, tx->compact, &c->grp)) ) {
+				c->grp = 0;
+				break;
+			}
+			c->nints  = 2;
+			c->gid    = gid;
+			c->t_open = fcom_now_us();
+			/* append to list of open messages */
+			c->prev                  = tx->coal_open.prev;
+			c->next                  = &tx->coal_open;
+			tx->coal_open.prev->next = c;
+			tx->coal_open.prev       = c;
+#ifdef FC_COAL_TMR
+			/* the timer waits for the oldest message only */
+			if ( tx->coal_open.next == c && tx->coal_tmr )
+				pthread_cond_signal( &tx->coal_cnd );
+#endif
+		}
+
+		if ( (st = fcom_msg_append_blob(FC_GRP_MEM(c->grp), pb)) > 0 ) {
+			c->nints += st;
+			FCOM_STAT_INC( tx->fc_stats.n_coal );
+			break;
+		}
+
+		if ( FCOM_ERR_NO_SPACE != st ) {
+			rval = st;
+			break;
+		}
+
+		if ( 2 == c->nints ) {
+			/* doesn't fit into an empty message; let
+			 * the caller send the blob individually.
+			 */
+			rval = 1;
+			break;
+		}
+
+		/* message is full; send it and start a new one */
+		fc_coal_send(ctx, c);
 	}
 
-	rval = sendtogid((UdpCommPkt)group, nints * sizeof(uint32_t), gid);
-	
-	if ( 0 == rval )
-		fc_stats.n_blb += nblobs;
+	/* never leave an empty message open */
+	if ( c->grp && 2 == c->nints ) {
+		fc_coal_unlink(c);
+		fcomFreeGroup(c->grp);
+		c->grp = 0;
+	}
+
+	__FC_TX_UNLOCK(tx);
 
 	return rval;
 }
 
-/*
- * provide dummy initializer/finalizer for the initialization
- * code to know that the TX stuff was linked.
+/* Send the open message of 'gid' (if any) ahead of a message
+ * which bypasses coalescing; the older, coalesced blobs must not
+ * arrive later. Failures are only recorded in the statistics.
  */
+static void
+fc_coal_flush_gid(FcomCtx ctx, uint32_t gid)
+{
+FcomTxCtxRef tx = ctx->tx;
 
-int
-fcom_send_init()
+	if ( tx->coal ) {
+		__FC_TX_LOCK(tx);
+		if ( tx->coal && tx->coal[gid].grp )
+			fc_coal_send(ctx, &tx->coal[gid]);
+		__FC_TX_UNLOCK(tx);
+	}
+}
+
+#ifdef FC_COAL_TMR
+/* Timer thread; sends open messages once they expire */
+static void *
+fc_coal_tmr(void *arg)
 {
+FcomTxCtxRef    tx = arg;
+struct timespec t;
+uint64_t        now, exp;
+
+	__FC_TX_LOCK(tx);
+	while ( tx->coal_tmr ) {
+		if ( tx->coal_open.next == &tx->coal_open ) {
+			pthread_cond_wait( &tx->coal_cnd, &tx->coal_lock );
+			continue;
+		}
+		now = fcom_now_us();
+		exp = tx->coal_open.next->t_open + tx->coal_usecs;
+		if ( now >= exp ) {
+			/* failures are recorded in the statistics */
+			fc_coal_flush(tx->ctx, 1);
+			continue;
+		}
+		clock_gettime( CLOCK_MONOTONIC, &t );
+		exp       -= now;
+		t.tv_sec  += exp / 1000000;
+		t.tv_nsec += (exp % 1000000) * 1000;
+		if ( t.tv_nsec >= 1000000000L ) {
+			t.tv_nsec -= 1000000000L;
+			t.tv_sec++;
+		}
+		pthread_cond_timedwait( &tx->coal_cnd, &tx->coal_lock, &t );
+	}
+	__FC_TX_UNLOCK(tx);
 	return 0;
 }
 
-int
-fcom_send_fini()
+static int
+fc_coal_tmr_start(FcomTxCtxRef tx)
 {
+pthread_condattr_t catts;
+int                err;
+
+	if ( tx->coal_tmr )
+		return 0;
+
+	pthread_condattr_init( &catts );
+	pthread_condattr_setclock( &catts, CLOCK_MONOTONIC );
+	err = pthread_cond_init( &tx->coal_cnd, &catts );
+	pthread_condattr_destroy( &catts );
+	if ( err )
+		return FCOM_ERR_SYS(err);
+
+	tx->coal_tmr = 1;
+	if ( (err = pthread_create( &tx->coal_tid, 0, fc_coal_tmr, tx )) ) {
+		tx->coal_tmr = 0;
+		pthread_cond_destroy( &tx->coal_cnd );
+		return FCOM_ERR_SYS(err);
+	}
 	return 0;
 }
 
-void
-fcom_send_stats(FILE *f)
+static void
+fc_coal_tmr_stop(FcomTxCtxRef tx)
 {
-	if ( !f )
-		f = stdout;
-	fprintf(f, "FCOM Tx Statistics:\n");
-	fprintf(f, "  messages sent: %4"PRIu32"\n", fc_stats.n_msg);
-	fprintf(f, "  blobs sent:    %4"PRIu32"\n", fc_stats.n_blb);
-	fprintf(f, "  send errors:   %4"PRIu32"\n", fc_stats.n_snderr);
+	if ( ! tx->coal_tmr )
+		return;
+
+	__FC_TX_LOCK(tx);
+	tx->coal_tmr = 0;
+	pthread_cond_signal( &tx->coal_cnd );
+	__FC_TX_UNLOCK(tx);
+
+	pthread_join( tx->coal_tid, 0 );
+	pthread_cond_destroy( &tx->coal_cnd );
+}
+#endif
+
+static void
+fc_coal_destroy(FcomCtx ctx)
+{
+FcomTxCtxRef tx = ctx->tx;
+FcCoal       *c;
+
+	__FC_TX_LOCK(tx);
+	while ( (c = tx->coal_open.next) != &tx->coal_open ) {
+		fc_coal_unlink(c);
+		fcomFreeGroup(c->grp);
+		c->grp = 0;
+	}
+	free(tx->coal);
+	tx->coal = 0;
+	__FC_TX_UNLOCK(tx);
 }
 
 int
-fcom_get_tx_stat(uint32_t key, uint64_t *p_val)
+fcomSetTxCoalesce(unsigned max_bytes, unsigned max_usecs)
 {
-uint32_t v;
-		switch ( key ) {
-			case FCOM_STAT_TX_NUM_BLOBS_SENT:
-				v = fc_stats.n_blb;
-			break;
+	return fcomSetTxCoalesceCtx(fcom_dflt_ctx, max_bytes, max_usecs);
+}
 
-			case FCOM_STAT_TX_NUM_MESGS_SENT:
-				v = fc_stats.n_msg;
-			break;
+int
+fcomSetTxCoalesceCtx(FcomCtx ctx, unsigned max_bytes, unsigned max_usecs)
+{
+FcomTxCtxRef tx;
+FcCoal       *tbl;
+int          rval, i;
+#ifdef FC_COAL_TMR
+int          st;
+#endif
 
-			case FCOM_STAT_TX_ERR_SEND:
-				v = fc_stats.n_snderr;
-			break;
+	if ( ! ctx || ! (tx = ctx->tx) )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( max_bytes > tx->msg_size )
+		max_bytes = tx->msg_size;
+
+	__FC_TX_LOCK(tx);
+	rval = fc_coal_flush(ctx, 0);
+	__FC_TX_UNLOCK(tx);
+
+	if ( 0 == max_bytes ) {
+#ifdef FC_COAL_TMR
+		fc_coal_tmr_stop(tx);
+#endif
+		fc_coal_destroy(ctx);
+		return rval;
+	}
+
+	if ( max_bytes < (FCOM_XDR_BLOB_HDRSZ + 2) * sizeof(uint32_t) )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( ! tx->coal ) {
+		if ( ! (tbl = calloc(FCOM_GID_MAX + 1, sizeof(*tbl))) )
+			return FCOM_ERR_NO_MEMORY;
+		for ( i = 0; i <= FCOM_GID_MAX; i++ )
+			tbl[i].next = tbl[i].prev = &tbl[i];
+		__FC_TX_LOCK(tx);
+		tx->coal = tbl;
+		__FC_TX_UNLOCK(tx);
+	}
+
+	__FC_TX_LOCK(tx);
+	tx->coal_bytes = max_bytes;
+	tx->coal_usecs = max_usecs;
+	__FC_TX_UNLOCK(tx);
+
+#ifdef FC_COAL_TMR
+	if ( max_usecs ) {
+		if ( (st = fc_coal_tmr_start(tx)) && ! rval )
+			rval = st;
+	} else {
+		fc_coal_tmr_stop(tx);
+	}
+#endif
+
+	return rval;
+}
+
+int
+fcomFlush(void)
+{
+	return fcomFlushCtx(fcom_dflt_ctx);
+}
+
+int
+fcomFlushCtx(FcomCtx ctx)
+{
+int rval;
+
+	if ( ! ctx || ! ctx->tx )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( ! ctx->tx->coal )
+		return 0;
+
+	__FC_TX_LOCK(ctx->tx);
+	rval = fc_coal_flush(ctx, 0);
+	__FC_TX_UNLOCK(ctx->tx);
+
+	return rval;
+}
+
+int
+fcomSetTxMsgSize(unsigned bytes)
+{
+	return fcomSetTxMsgSizeCtx(fcom_dflt_ctx, bytes);
+}
+
+int
+fcomSetTxMsgSizeCtx(FcomCtx ctx, unsigned bytes)
+{
+FcomTxCtxRef tx;
+int          rval = 0;
+
+	if ( ! ctx || ! (tx = ctx->tx) )
+		return FCOM_ERR_INVALID_ARG;
+
+	/* receivers hand out datagrams of (at most) UDPCOMM_PKTSZ */
+	if ( bytes < FCOM_MSG_SIZE_MIN || bytes > UDPCOMM_PKTSZ )
+		return FCOM_ERR_INVALID_ARG;
+
+	bytes &= ~(sizeof(uint32_t) - 1);
+
+	/* open coalesced messages may exceed the new size */
+	__FC_TX_LOCK(tx);
+	if ( tx->coal ) {
+		rval = fc_coal_flush(ctx, 0);
+		if ( tx->coal_bytes > bytes )
+			tx->coal_bytes = bytes;
+	}
+	tx->msg_size = bytes;
+	__FC_TX_UNLOCK(tx);
+
+	return rval;
+}
+
+int
+fcomSetTxCompact(int on)
+{
+	return fcomSetTxCompactCtx(fcom_dflt_ctx, on);
+}
+
+int
+fcomSetTxCompactCtx(FcomCtx ctx, int on)
+{
+FcomTxCtxRef tx;
+int          rval = 0;
+
+	if ( ! ctx || ! (tx = ctx->tx) )
+		return FCOM_ERR_INVALID_ARG;
+
+	/* don't mix encodings in open coalesced messages */
+	__FC_TX_LOCK(tx);
+	if ( tx->coal )
+		rval = fc_coal_flush(ctx, 0);
+	tx->compact = !!on;
+	__FC_TX_UNLOCK(tx);
+
+	return rval;
+}
+
+int
+fcomSendMsg(void *msg, unsigned nbytes, unsigned flags)
+{
+	return fcomSendMsgCtx(fcom_dflt_ctx, msg, nbytes, flags);
+}
+
+int
+fcomSendMsgCtx(FcomCtx ctx, void *msg, unsigned nbytes, unsigned flags)
+{
+uint32_t *xmem  = msg;
+uint32_t nints  = nbytes / sizeof(*xmem);
+FcomID   idnt;
+uint32_t gid;
+
+	if ( ! ctx || ! ctx->tx || ! msg || (nbytes & (sizeof(*xmem) - 1)) )
+		return FCOM_ERR_INVALID_ARG;
+
+	/* the whole buffer must be taken up by a valid message */
+	if ( fcom_xdr_msg_size(xmem, nints, &idnt) != (int)nints )
+		return FCOM_ERR_INVALID_ARG;
+
+	gid = FCOM_GET_GID(idnt);
+
+	if ( ! FCOM_GID_VALID( gid ) )
+		return FCOM_ERR_INVALID_ID;
+
+	fc_coal_flush_gid(ctx, gid);
+
+	if ( (flags & FCOM_SEND_LOCAL) )
+		return fc_send_buf_to(ctx, xmem, nints, gid, htonl(INADDR_LOOPBACK));
+
+	return fc_send_buf(ctx, xmem, nints, gid);
+}
+
+int
+fcomPutBlob(FcomBlobRef pb)
+{
+	return fcomPutBlobCtx(fcom_dflt_ctx, pb);
+}
+
+int
+fcomPutBlobCtx(FcomCtx ctx, FcomBlobRef pb)
+{
+UdpCommPkt     p;
+uint32_t       *xmem;
+int            rval;
+uint32_t       gid;
+uint64_t       t;
+
+	if ( ! ctx || ! ctx->tx )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( FCOM_PROTO_MAJ_GET(pb->fc_vers) != FCOM_PROTO_VERSION_1x )
+		return FCOM_ERR_BAD_VERSION;
+
+	if ( ctx->tx->coal && (rval = fc_coal_put(ctx, pb)) <= 0 )
+		return rval;
+
+	fcom_prof_start( &ctx->tx_prof, &t );
+
+	if ( ! (p = udpCommAllocPacket()) ) {
+		return FCOM_ERR_NO_MEMORY;
+	}
+
+	xmem = udpCommBufPtr(p);
+
+	if ( (rval = fcom_msg_one_blob(xmem, UDPCOMM_PKTSZ, pb, &gid)) < 0 ) {
+		udpCommFreePacket(p);
+		if ( FCOM_ERR_NO_SPACE == rval )
+			rval = fc_put_large(ctx, pb);
+		return rval;
+	}
+
+	if ( ! FCOM_GID_VALID( gid ) ) {
+		udpCommFreePacket(p);
+		return FCOM_ERR_INVALID_ID;
+	}
+
+	fcom_prof_stage( &ctx->tx_prof, FCOM_PROF_TX_ENCODE, &t );
+
+	rval = fc_send_group(ctx, (FcomGroup)p, rval, gid);
+
+	fcom_prof_stage( &ctx->tx_prof, FCOM_PROF_TX_SEND, &t );
+
+	if ( 0 == rval )
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_blb );
+
+	return rval;
+}
+
+int
+fcomPutBlobSparse(FcomBlobRef pb, const FcomRange ranges[], unsigned n_ranges)
+{
+	return fcomPutBlobSparseCtx(fcom_dflt_ctx, pb, ranges, n_ranges);
+}
+
+int
+fcomPutBlobSparseCtx(FcomCtx ctx, FcomBlobRef pb, const FcomRange ranges[], unsigned n_ranges)
+{
+FcomTxCtxRef   tx;
+FcomGroup      g;
+uint32_t       gid;
+int            sz, pld, rval;
+
+	if ( ! ctx || ! (tx = ctx->tx) )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( FCOM_PROTO_MAJ_GET(pb->fc_vers) != FCOM_PROTO_VERSION_1x )
+		return FCOM_ERR_BAD_VERSION;
+
+	if ( fcom_get_gid(pb, &gid) || ! FCOM_GID_VALID(gid) )
+		return FCOM_ERR_INVALID_ID;
+
+	if ( (sz = FCOM_EL_SIZE(pb->fc_type)) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( (pld = fcom_xdr_sparse_words(FCOM_EL_TYPE(pb->fc_type), pb->fc_nelm, ranges, n_ranges)) < 0 )
+		return pld;
+
+	/* send the complete blob if that's not bigger or
+	 * if receivers wouldn't understand the update.
+	 */
+	if (   FCOM_PROTO_MIN_GET(pb->fc_vers) < FCOM_PROTO_MIN_2
+	    || (uint32_t)pld * sizeof(uint32_t) >= ((sz * pb->fc_nelm + 3) & ~3) ) {
+		if ( 0 == (rval = fcomPutBlobCtx(ctx, pb)) )
+			FCOM_STAT_INC( tx->fc_stats.n_sparse_full );
+		return rval;
+	}
+
+	fc_coal_flush_gid(ctx, gid);
+
+	/* message header, blob header and payload */
+	sz = (2 + FCOM_XDR_BLOB_HDRSZ + pld) * sizeof(uint32_t);
+
+	if ( (rval = fc_alloc_group(sz, gid, 0, &g)) )
+		return rval;
+
+	if ( (rval = fcom_msg_one_sparse(FC_GRP_MEM(g), sz, pb, ranges, n_ranges, &gid)) < 0 ) {
+		fcomFreeGroup(g);
+		return rval;
+	}
+
+	if ( 0 == (rval = fc_send_group(ctx, g, rval, gid)) ) {
+		FCOM_STAT_INC( tx->fc_stats.n_blb );
+		FCOM_STAT_INC( tx->fc_stats.n_sparse );
+	}
+
+	return rval;
+}
+
+int
+fcomPutGroup(FcomGroup group)
+{
+	return fcomPutGroupCtx(fcom_dflt_ctx, group);
+}
+
+int
+fcomPutGroupCtx(FcomCtx ctx, FcomGroup group)
+{
+uint32_t nblobs;
+uint32_t gid;
+uint32_t nints;
+uint32_t *xmem;
+int      rval;
+uint64_t t;
+
+	if ( ! ctx || ! ctx->tx ) {
+		fcomFreeGroup(group);
+		return FCOM_ERR_INVALID_ARG;
+	}
+
+	fcom_prof_start( &ctx->tx_prof, &t );
+
+	xmem   = FC_GRP_MEM(group);
+
+	/*
+	 * GID and total number of 32-bit words
+     * stored in 'xmem' are returned by fcom_msg_end().
+     */
+	nints = fcom_msg_end(xmem, &gid, &nblobs);
+
+	if ( ! FCOM_GID_VALID(gid) ) {
+		fcomFreeGroup(group);	
+		return FCOM_ERR_INVALID_ID;
+	}
+
+	fcom_prof_stage( &ctx->tx_prof, FCOM_PROF_TX_ENCODE, &t );
+
+	fc_coal_flush_gid(ctx, gid);
+
+	rval = fc_send_group(ctx, group, nints, gid);
+
+	fcom_prof_stage( &ctx->tx_prof, FCOM_PROF_TX_SEND, &t );
+	
+	if ( 0 == rval )
+		FCOM_STAT_ADD( ctx->tx->fc_stats.n_blb, nblobs );
+
+	return rval;
+}
+
+#ifdef HAVE_SENDMMSG
+/* Submit messages in batches of up to FC_BATCH_MAX with sendmmsg().
+ * This requires the udpComm socket to be a real file descriptor
+ * (which is the case for udpCommBSD).
+ *
+ * All messages are numbered (also if they cannot be sent here);
+ * the caller must send the rest with fc_xmit_group().
+ *
+ * RETURNS: number of messages which were sent or a (negative)
+ *          error status if the very first message could not be sent.
+ */
+static int
+fc_sendmmsg(FcomCtx ctx, FcomGroup groups[], uint32_t nints[], uint32_t gids[], unsigned n)
+{
+struct mmsghdr     msg[FC_BATCH_MAX];
+struct iovec       iov[FC_BATCH_MAX];
+struct sockaddr_in sin[FC_BATCH_MAX];
+unsigned           i, k, done;
+int                rval;
+
+	for ( i=0; i<n; i++ )
+		fc_seq_stamp(ctx, FC_GRP_MEM(groups[i]), nints[i], gids[i]);
+
+	for ( done = 0; done < n; done += rval ) {
+		k = n - done;
+		if ( k > FC_BATCH_MAX )
+			k = FC_BATCH_MAX;
+
+		for ( i=0; i<k; i++ ) {
+			memset( &sin[i], 0, sizeof(sin[i]) );
+			sin[i].sin_family      = AF_INET;
+			sin[i].sin_port        = htons(ctx->port);
+			sin[i].sin_addr.s_addr = ctx->g_prefix | htonl(gids[done+i]);
+
+			iov[i].iov_base        = FC_GRP_MEM(groups[done+i]);
+			iov[i].iov_len         = nints[done+i] * sizeof(uint32_t);
+
+			memset( &msg[i], 0, sizeof(msg[i]) );
+			msg[i].msg_hdr.msg_name    = &sin[i];
+			msg[i].msg_hdr.msg_namelen = sizeof(sin[i]);
+			msg[i].msg_hdr.msg_iov     = &iov[i];
+			msg[i].msg_hdr.msg_iovlen  = 1;
+		}
+
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_batch_sysc );
+
+		if ( (rval = sendmmsg(ctx->xsd, msg, k, 0)) <= 0 ) {
+			if ( 0 == done )
+				return rval < 0 ? -errno : -EIO;
+			break;
+		}
+	}
+
+	return done;
+}
+#endif
+
+int
+fcomPutGroups(FcomGroup groups[], unsigned n_groups)
+{
+	return fcomPutGroupsCtx(fcom_dflt_ctx, groups, n_groups);
+}
+
+int
+fcomPutGroupsCtx(FcomCtx ctx, FcomGroup groups[], unsigned n_groups)
+{
+uint32_t     nblobs[FC_BATCH_MAX];
+uint32_t     nints[FC_BATCH_MAX];
+uint32_t     gids[FC_BATCH_MAX];
+FcomGroup    valid[FC_BATCH_MAX];
+unsigned     i, j, k, n;
+int          rval = 0, st, stamped;
+uint32_t     *xmem;
+FcomTxCtxRef tx;
+
+	if ( ! ctx || ! (tx = ctx->tx) ) {
+		for ( i=0; i<n_groups; i++ )
+			fcomFreeGroup( groups[i] );
+		return FCOM_ERR_INVALID_ARG;
+	}
+
+	if ( 0 == n_groups )
+		return 0;
+
+	FCOM_STAT_INC( tx->fc_stats.n_batch );
+	if ( n_groups > FCOM_STAT_GET( tx->fc_stats.max_batch ) )
+		FCOM_STAT_SET( tx->fc_stats.max_batch, n_groups );
+
+	for ( i=0; i<n_groups; i+=k ) {
+		k = n_groups - i;
+		if ( k > FC_BATCH_MAX )
+			k = FC_BATCH_MAX;
+
+		/* finalize all messages of this chunk; drop the invalid ones
+		 * and send those which must be fragmented right away.
+		 */
+		for ( j=n=0; j<k; j++ ) {
+			xmem = FC_GRP_MEM(groups[i+j]);
+			nints[n] = fcom_msg_end(xmem, &gids[n], &nblobs[n]);
+			if ( ! FCOM_GID_VALID(gids[n]) ) {
+				fcomFreeGroup( groups[i+j] );
+				if ( ! rval )
+					rval = FCOM_ERR_INVALID_ID;
+				continue;
+			}
+			fc_coal_flush_gid(ctx, gids[n]);
+			if ( nints[n] * sizeof(uint32_t) > tx->msg_size ) {
+				if ( 0 == (st = fc_send_group(ctx, groups[i+j], nints[n], gids[n])) )
+					FCOM_STAT_ADD( tx->fc_stats.n_blb, nblobs[n] );
+				else if ( ! rval )
+					rval = st;
+				continue;
+			}
+			valid[n++] = groups[i+j];
+		}
+
+		j       = 0;
+		stamped = 0;
+
+#ifdef HAVE_SENDMMSG
+		if ( ctx->xp->is_sock ) {
+			stamped = 1;
+			if ( (st = fc_sendmmsg(ctx, valid, nints, gids, n)) < 0 ) {
+				/* the messages are resent individually below;
+				 * only failures there are reported.
+				 */
+				FCOM_STAT_INC( tx->fc_stats.n_snderr );
+				st = 0;
+			}
+			for ( ; j < (unsigned)st; j++ ) {
+				FCOM_STAT_INC( tx->fc_stats.n_msg );
+				FCOM_STAT_INC( tx->fc_stats.n_batch_msg );
+				FCOM_STAT_ADD( tx->fc_stats.n_blb, nblobs[j] );
+				fcomFreeGroup( valid[j] );
+			}
+		}
+#endif
+
+		/* Send whatever is left individually; this is all
+		 * of them if sendmmsg() is not available (or failed).
+		 */
+		for ( ; j < n; j++ ) {
+			FCOM_STAT_INC( tx->fc_stats.n_batch_sysc );
+			if ( stamped )
+				st = fc_xmit_group(ctx, valid[j], nints[j], gids[j]);
+			else
+				st = fc_send_group(ctx, valid[j], nints[j], gids[j]);
+			if ( 0 == st ) {
+				FCOM_STAT_INC( tx->fc_stats.n_batch_msg );
+				FCOM_STAT_ADD( tx->fc_stats.n_blb, nblobs[j] );
+			} else if ( ! rval ) {
+				rval = st;
+			}
+		}
+	}
+
+	return rval;
+}
+
+/* A prepared group keeps the encoded message along
+ * with the location of every blob in the XDR stream.
+ */
+typedef struct FcomPreparedBlob {
+	FcomBlobRef  pb;        /* application's blob                */
+	uint32_t     off;       /* offset into 'xmem' (32-bit words) */
+	FcomID       idnt;      /* prepared ID, type and count       */
+	uint8_t      type;
+	uint16_t     nelm;
+} FcomPreparedBlob;
+
+typedef struct FcomPreparedRec_ {
+	uint32_t         *xmem;     /* encoded message                   */
+	uint32_t         nints;     /* size of message in 32-bit words   */
+	uint32_t         gid;
+	unsigned         nblobs;
+	int              inflight;  /* queued for async. transmission    */
+	FcomPreparedBlob blob[];
+} FcomPreparedRec;
+
+int
+fcomPrepareGroup(FcomBlobRef p_blobs[], unsigned n_blobs, FcomPrepared *p_prep)
+{
+FcomPrepared prep;
+FcomBlob     blob;
+uint32_t     *xmem = 0;
+uint32_t     off, gid, nblobs;
+int          i, rval;
+
+	if ( ! p_blobs || ! p_prep || n_blobs < 1 )
+		return FCOM_ERR_INVALID_ARG;
+
+	for ( i=0; i<n_blobs; i++ ) {
+		if ( FCOM_PROTO_MAJ_GET(p_blobs[i]->fc_vers) != FCOM_PROTO_VERSION_1x )
+			return FCOM_ERR_BAD_VERSION;
+	}
+
+	if ( ! (prep = malloc(sizeof(*prep) + n_blobs * sizeof(prep->blob[0]))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	/* encode into a buffer of the largest datagram size any context
+	 * may use (and trim later); it is never fragmented.
+	 */
+	if ( ! (xmem = malloc(UDPCOMM_PKTSZ)) ) {
+		rval = FCOM_ERR_NO_MEMORY;
+		goto bail;
+	}
+
+	if ( (rval = fcom_msg_init(xmem, UDPCOMM_PKTSZ, FCOM_GID_ANY)) < 0 )
+		goto bail;
+
+	for ( i=0, off=rval; i<n_blobs; i++, off+=rval ) {
+		/* the payload is re-encoded in place, i.e., it must not be packed */
+		blob         = *p_blobs[i];
+		blob.fc_type = FCOM_EL_TYPE(blob.fc_type);
+		if ( (rval = fcom_msg_append_blob(xmem, &blob)) < 0 )
+			goto bail;
+		prep->blob[i].pb   = p_blobs[i];
+		prep->blob[i].off  = off;
+		prep->blob[i].idnt = p_blobs[i]->fc_idnt;
+		prep->blob[i].type = p_blobs[i]->fc_type;
+		prep->blob[i].nelm = p_blobs[i]->fc_nelm;
+	}
+
+	prep->nints  = fcom_msg_end(xmem, &gid, &nblobs);
+	prep->gid    = gid;
+	prep->nblobs = nblobs;
+	prep->xmem   = xmem;
+	prep->inflight = 0;
+
+	/* trim; failure to shrink is harmless */
+	if ( (xmem = realloc(prep->xmem, prep->nints * sizeof(*xmem))) )
+		prep->xmem = xmem;
+	xmem = prep->xmem;
+
+	if ( ! FCOM_GID_VALID(gid) ) {
+		rval = FCOM_ERR_INVALID_ID;
+		goto bail;
+	}
+
+	*p_prep = prep;
+	return 0;
+
+bail:
+	free(xmem);
+	free(prep);
+	return rval;
+}
+
+int
+fcomPrepareBlob(FcomBlobRef p_blob, FcomPrepared *p_prep)
+{
+	return fcomPrepareGroup(&p_blob, 1, p_prep);
+}
+
+int
+fcomPutPrepared(FcomPrepared prep)
+{
+	return fcomPutPreparedCtx(fcom_dflt_ctx, prep);
+}
+
+/* Patch and send a prepared group; the caller owns 'prep->xmem'
+ * (i.e., has set 'inflight' if asynchronous transmission is
+ * supported).
+ */
+static int
+fc_put_prepared(FcomCtx ctx, FcomPrepared prep)
+{
+int              i, rval;
+FcomPreparedBlob *b;
+
+	/* prepared messages are never fragmented */
+	if ( prep->nints * sizeof(*prep->xmem) > ctx->tx->msg_size )
+		return FCOM_ERR_NO_SPACE;
+
+	for ( i=0, b=prep->blob; i<prep->nblobs; i++, b++ ) {
+		/* constant parts must not have changed */
+		if (   b->pb->fc_idnt != b->idnt
+		    || b->pb->fc_type != b->type
+		    || b->pb->fc_nelm != b->nelm )
+			return FCOM_ERR_INVALID_ARG;
+
+		if ( (rval = fcom_xdr_patch_blob(prep->xmem + b->off, b->pb)) < 0 )
+			return rval;
+	}
+
+	fc_coal_flush_gid(ctx, prep->gid);
+
+	rval = fc_send_buf(ctx, prep->xmem, prep->nints, prep->gid);
+
+	if ( 0 == rval )
+		FCOM_STAT_ADD( ctx->tx->fc_stats.n_blb, prep->nblobs );
+
+	return rval;
+}
+
+int
+fcomPutPreparedCtx(FcomCtx ctx, FcomPrepared prep)
+{
+int rval;
+#ifdef FC_TXQ
+int idle = 0;
+#endif
+
+	if ( ! ctx || ! ctx->tx || ! prep )
+		return FCOM_ERR_INVALID_ARG;
+
+#ifdef FC_TXQ
+	/* the TX thread may be working on the same message */
+	if ( ! __atomic_compare_exchange_n( &prep->inflight, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+		return FCOM_ERR_ID_IN_USE;
+#endif
+
+	rval = fc_put_prepared(ctx, prep);
+
+#ifdef FC_TXQ
+	__atomic_store_n( &prep->inflight, 0, __ATOMIC_RELEASE );
+#endif
+
+	return rval;
+}
+
+void
+fcomFreePrepared(FcomPrepared prep)
+{
+	if ( prep ) {
+		free(prep->xmem);
+		free(prep);
+	}
+}
+
+/*
+ * Asynchronous transmission.
+ *
+ * Producers submit into a bounded, lock-free multi-producer/
+ * single-consumer ring (D. Vyukov's algorithm: every slot carries
+ * a sequence number which tells producers and the consumer whether
+ * the slot is free or filled). A blob is copied (header and payload)
+ * into the slot; a prepared group is only referenced. A dedicated
+ * thread drains the ring, encodes and sends.
+ *
+ * The semaphore is only used to wake up the TX thread.
+ */
+#ifdef FC_TXQ
+
+/* Max. payload of a blob that can be submitted */
+#define FC_TXQ_DATASZ (UDPCOMM_PKTSZ)
+
+typedef struct FcTxSlot {
+	unsigned long seq;
+	FcomPrepared  prep;      /* prepared group or NULL (then: blob) */
+	FcomBlob      blob;
+	double        data[(FC_TXQ_DATASZ + sizeof(double) - 1)/sizeof(double)];
+} FcTxSlot;
+
+typedef struct FcTxQ {
+	unsigned long head;      /* producers' position                 */
+	unsigned long tail;      /* consumer's position                 */
+	unsigned long mask;
+	sem_t         sem;
+	pthread_t     tid;
+	int           running;
+	FcTxSlot      *slots;
+} FcTxQ;
+
+/* Dequeue and send everything that is in the ring */
+static void
+fc_txq_drain(FcomCtx ctx, FcTxQRef q)
+{
+FcTxSlot     *slot;
+FcomPrepared prep;
+unsigned long depth;
+int          rval;
+
+	for (;;) {
+		slot = &q->slots[q->tail & q->mask];
+		if ( __atomic_load_n( &slot->seq, __ATOMIC_ACQUIRE ) != q->tail + 1 )
+			break; /* empty */
+
+		depth = __atomic_load_n( &q->head, __ATOMIC_RELAXED ) - q->tail;
+		if ( depth > FCOM_STAT_GET( ctx->tx->fc_stats.max_qdepth ) )
+			FCOM_STAT_SET( ctx->tx->fc_stats.max_qdepth, depth );
+
+		if ( (prep = slot->prep) ) {
+			rval = fc_put_prepared(ctx, prep);
+			__atomic_store_n( &prep->inflight, 0, __ATOMIC_RELEASE );
+		} else {
+			/* coalescing, fragmentation and numbering as
+			 * for a synchronous put
+			 */
+			slot->blob.fc_raw = slot->data;
+			rval = fcomPutBlobCtx(ctx, &slot->blob);
+		}
+		if ( rval )
+			FCOM_STAT_INC( ctx->tx->fc_stats.n_async_err );
+
+		/* release slot to producers */
+		__atomic_store_n( &slot->seq, q->tail + q->mask + 1, __ATOMIC_RELEASE );
+		__atomic_store_n( &q->tail, q->tail + 1, __ATOMIC_RELAXED );
+	}
+
+	/* ring is empty; send what was coalesced */
+	if ( ctx->tx->coal ) {
+		__FC_TX_LOCK(ctx->tx);
+		if ( fc_coal_flush(ctx, 0) )
+			FCOM_STAT_INC( ctx->tx->fc_stats.n_async_err );
+		__FC_TX_UNLOCK(ctx->tx);
+	}
+}
+
+static void *
+fc_txq_thread(void *arg)
+{
+FcomCtx  ctx = arg;
+FcTxQRef q   = ctx->tx->txq;
+
+	while ( __atomic_load_n( &q->running, __ATOMIC_ACQUIRE ) ) {
+		while ( sem_wait( &q->sem ) && EINTR == errno )
+			/* retry */;
+		fc_txq_drain(ctx, q);
+	}
+	/* flush what was submitted before we were stopped */
+	fc_txq_drain(ctx, q);
+	return 0;
+}
+
+/* Claim a slot.
+ *
+ * RETURNS: slot and its position (in *p_pos) or NULL if the ring is full.
+ */
+static __inline__ FcTxSlot *
+fc_txq_claim(FcTxQRef q, unsigned long *p_pos)
+{
+unsigned long pos, seq;
+FcTxSlot      *slot;
+long          dif;
+
+	pos = __atomic_load_n( &q->head, __ATOMIC_RELAXED );
+	for (;;) {
+		slot = &q->slots[pos & q->mask];
+		seq  = __atomic_load_n( &slot->seq, __ATOMIC_ACQUIRE );
+		dif  = (long)(seq - pos);
+		if ( 0 == dif ) {
+			if ( __atomic_compare_exchange_n( &q->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+				break;
+			/* 'pos' was updated by the failed CAS */
+		} else if ( dif < 0 ) {
+			return 0;
+		} else {
+			pos = __atomic_load_n( &q->head, __ATOMIC_RELAXED );
+		}
+	}
+	*p_pos = pos;
+	return slot;
+}
+
+/* Hand a filled slot to the TX thread */
+static __inline__ void
+fc_txq_publish(FcTxQRef q, FcTxSlot *slot, unsigned long pos)
+{
+	__atomic_store_n( &slot->seq, pos + 1, __ATOMIC_RELEASE );
+	sem_post( &q->sem );
+}
+
+static void
+fc_txq_destroy(FcomCtx ctx)
+{
+FcTxQRef q = ctx->tx->txq;
+
+	if ( ! q )
+		return;
+
+	__atomic_store_n( &q->running, 0, __ATOMIC_RELEASE );
+	sem_post( &q->sem );
+	pthread_join( q->tid, 0 );
+
+	ctx->tx->txq = 0;
+
+	sem_destroy( &q->sem );
+	free( q->slots );
+	free( q );
+}
+
+static int
+fc_txq_create(FcomCtx ctx, unsigned depth)
+{
+FcTxQRef      q;
+unsigned long n, i;
+int           err;
+
+	/* round up to a power of two */
+	for ( n = 2; n < depth; n <<= 1 )
+		/* nothing else to do */;
+
+	if ( ! (q = calloc(1, sizeof(*q))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	q->mask    = n - 1;
+	q->running = 1;
+
+	if ( ! (q->slots = malloc( n * sizeof(q->slots[0]) )) ) {
+		err = FCOM_ERR_NO_MEMORY;
+		goto bail;
+	}
+
+	for ( i=0; i<n; i++ )
+		q->slots[i].seq = i;
+
+	if ( sem_init( &q->sem, 0, 0 ) ) {
+		err = FCOM_ERR_SYS(errno);
+		goto bail;
+	}
+
+	ctx->tx->txq = q;
+
+	if ( (err = pthread_create( &q->tid, 0, fc_txq_thread, ctx )) ) {
+		ctx->tx->txq = 0;
+		sem_destroy( &q->sem );
+		err = FCOM_ERR_SYS(err);
+		goto bail;
+	}
+
+	return 0;
+
+bail:
+	free( q->slots );
+	free( q );
+	return err;
+}
+#endif
+
+int
+fcomSetTxAsync(unsigned queue_depth)
+{
+	return fcomSetTxAsyncCtx(fcom_dflt_ctx, queue_depth);
+}
+
+int
+fcomSetTxAsyncCtx(FcomCtx ctx, unsigned queue_depth)
+{
+#ifdef FC_TXQ
+	if ( ! ctx || ! ctx->tx )
+		return FCOM_ERR_INVALID_ARG;
+
+	fc_txq_destroy(ctx);
+
+	return queue_depth ? fc_txq_create(ctx, queue_depth) : 0;
+#else
+	return FCOM_ERR_UNSUPP;
+#endif
+}
+
+int
+fcomPutBlobAsync(FcomBlobRef pb)
+{
+	return fcomPutBlobAsyncCtx(fcom_dflt_ctx, pb);
+}
+
+int
+fcomPutBlobAsyncCtx(FcomCtx ctx, FcomBlobRef pb)
+{
+#ifdef FC_TXQ
+FcTxQRef      q;
+FcTxSlot      *slot;
+unsigned long pos;
+int           sz;
+
+	if ( ! ctx || ! ctx->tx || ! (q = ctx->tx->txq) )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( FCOM_PROTO_MAJ_GET(pb->fc_vers) != FCOM_PROTO_VERSION_1x )
+		return FCOM_ERR_BAD_VERSION;
+
+	if ( ( sz = FCOM_EL_SIZE(pb->fc_type) ) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( (sz *= pb->fc_nelm) > FC_TXQ_DATASZ )
+		return FCOM_ERR_NO_SPACE;
+
+	if ( ! (slot = fc_txq_claim(q, &pos)) ) {
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_async_drop );
+		return FCOM_ERR_NO_SPACE;
+	}
+
+	slot->prep     = 0;
+	slot->blob.hdr = pb->hdr;
+	memcpy( slot->data, pb->fc_raw, sz );
+
+	fc_txq_publish(q, slot, pos);
+
+	FCOM_STAT_INC( ctx->tx->fc_stats.n_async );
+
+	return 0;
+#else
+	return FCOM_ERR_UNSUPP;
+#endif
+}
+
+int
+fcomPutPreparedAsync(FcomPrepared prep)
+{
+	return fcomPutPreparedAsyncCtx(fcom_dflt_ctx, prep);
+}
+
+int
+fcomPutPreparedAsyncCtx(FcomCtx ctx, FcomPrepared prep)
+{
+#ifdef FC_TXQ
+FcTxQRef      q;
+FcTxSlot      *slot;
+unsigned long pos;
+int           idle = 0;
+
+	if ( ! ctx || ! ctx->tx || ! (q = ctx->tx->txq) || ! prep )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( ! __atomic_compare_exchange_n( &prep->inflight, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+		return FCOM_ERR_ID_IN_USE;
+
+	if ( ! (slot = fc_txq_claim(q, &pos)) ) {
+		__atomic_store_n( &prep->inflight, 0, __ATOMIC_RELEASE );
+		FCOM_STAT_INC( ctx->tx->fc_stats.n_async_drop );
+		return FCOM_ERR_NO_SPACE;
+	}
+
+	slot->prep = prep;
+
+	fc_txq_publish(q, slot, pos);
+
+	FCOM_STAT_INC( ctx->tx->fc_stats.n_async );
+
+	return 0;
+#else
+	return FCOM_ERR_UNSUPP;
+#endif
+}
+
+int
+fcomPreparedInFlight(FcomPrepared prep)
+{
+#ifdef FC_TXQ
+	return __atomic_load_n( &prep->inflight, __ATOMIC_ACQUIRE );
+#else
+	return 0;
+#endif
+}
+
+/*
+ * The initializer/finalizer also let the initialization
+ * code know that the TX stuff was linked.
+ */
+
+int
+fcom_send_init(FcomCtx ctx)
+{
+FcomTxCtxRef tx;
+
+	if ( ! (tx = calloc(1, sizeof(*tx))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	if ( __FC_TX_LOCK_CRE(tx) ) {
+		free(tx);
+		return FCOM_ERR_NO_MEMORY;
+	}
+
+	tx->coal_open.next = tx->coal_open.prev = &tx->coal_open;
+	tx->msg_size       = UDPCOMM_PKTSZ;
+
+	/* start transfer IDs at a random-ish value so that fragments
+	 * of different senders are unlikely to be mixed up.
+	 */
+	tx->xid = (uint32_t)fcom_now_us() ^ ((uint32_t)getpid() << 16);
+
+	tx->ctx = ctx;
+	ctx->tx = tx;
+	return 0;
+}
+
+int
+fcom_send_fini(FcomCtx ctx)
+{
+	if ( ! ctx->tx )
+		return 0;
+#ifdef FC_TXQ
+	fc_txq_destroy(ctx);
+#endif
+#ifdef FC_COAL_TMR
+	fc_coal_tmr_stop(ctx->tx);
+#endif
+	if ( ctx->tx->coal ) {
+		__FC_TX_LOCK(ctx->tx);
+		fc_coal_flush(ctx, 0);
+		__FC_TX_UNLOCK(ctx->tx);
+		fc_coal_destroy(ctx);
+	}
+	__FC_TX_LOCK_DEL(ctx->tx);
+	free(ctx->tx);
+	ctx->tx = 0;
+	return 0;
+}
+
+/* Copy the counters; each one is read atomically but
+ * senders may be updating them concurrently.
+ */
+static void
+fc_stats_get(FcomTxCtxRef tx, FcomTxStats *p_stats)
+{
+	p_stats->n_msg         = FCOM_STAT_GET( tx->fc_stats.n_msg );
+	p_stats->n_blb         = FCOM_STAT_GET( tx->fc_stats.n_blb );
+	p_stats->n_snderr      = FCOM_STAT_GET( tx->fc_stats.n_snderr );
+	p_stats->n_batch       = FCOM_STAT_GET( tx->fc_stats.n_batch );
+	p_stats->n_batch_msg   = FCOM_STAT_GET( tx->fc_stats.n_batch_msg );
+	p_stats->n_batch_sysc  = FCOM_STAT_GET( tx->fc_stats.n_batch_sysc );
+	p_stats->max_batch     = FCOM_STAT_GET( tx->fc_stats.max_batch );
+	p_stats->n_async       = FCOM_STAT_GET( tx->fc_stats.n_async );
+	p_stats->n_async_drop  = FCOM_STAT_GET( tx->fc_stats.n_async_drop );
+	p_stats->n_async_err   = FCOM_STAT_GET( tx->fc_stats.n_async_err );
+	p_stats->max_qdepth    = FCOM_STAT_GET( tx->fc_stats.max_qdepth );
+	p_stats->n_coal        = FCOM_STAT_GET( tx->fc_stats.n_coal );
+	p_stats->n_coal_msg    = FCOM_STAT_GET( tx->fc_stats.n_coal_msg );
+	p_stats->n_coal_tmo    = FCOM_STAT_GET( tx->fc_stats.n_coal_tmo );
+	p_stats->n_frag_msg    = FCOM_STAT_GET( tx->fc_stats.n_frag_msg );
+	p_stats->n_frag        = FCOM_STAT_GET( tx->fc_stats.n_frag );
+	p_stats->n_sparse      = FCOM_STAT_GET( tx->fc_stats.n_sparse );
+	p_stats->n_sparse_full = FCOM_STAT_GET( tx->fc_stats.n_sparse_full );
+	/* the encoder is shared by all contexts */
+	p_stats->n_packed      = FCOM_STAT_GET( fcom_xdr_pack_stats.n_packed   );
+	p_stats->n_pack_raw    = FCOM_STAT_GET( fcom_xdr_pack_stats.n_raw      );
+	p_stats->pack_raw_words = FCOM_STAT_GET( fcom_xdr_pack_stats.raw_words  );
+	p_stats->pack_words    = FCOM_STAT_GET( fcom_xdr_pack_stats.pack_words );
+}
+
+int
+fcom_get_tx_counters(FcomCtx ctx, FcomTxStats *p_stats)
+{
+FcomTxCtxRef tx = ctx ? ctx->tx : 0;
+
+	if ( ! tx )
+		return FCOM_ERR_INVALID_ARG;
+	fc_stats_get(tx, p_stats);
+	return 0;
+}
+
+void
+fcom_send_stats(FcomCtx ctx, FILE *f)
+{
+FcomTxCtxRef tx = ctx ? ctx->tx : 0;
+FcomTxStats  st;
+
+	if ( !f )
+		f = stdout;
+	if ( ! tx )
+		return;
+	fc_stats_get(tx, &st);
+	fprintf(f, "FCOM Tx Statistics:\n");
+	fprintf(f, "  messages sent: %4"PRIu64"\n", st.n_msg);
+	fprintf(f, "  blobs sent:    %4"PRIu64"\n", st.n_blb);
+	fprintf(f, "  send errors:   %4"PRIu64"\n", st.n_snderr);
+	fprintf(f, "  batches:       %4"PRIu64" (%"PRIu64" messages, %"PRIu64" syscalls, max. size %"PRIu64")\n",
+	           st.n_batch, st.n_batch_msg,
+	           st.n_batch_sysc, st.max_batch);
+#ifdef HAVE_SENDMMSG
+	if ( tx->ctx->xp->is_sock ) {
+	fprintf(f, "  batches use sendmmsg()\n");
+	}
+#endif
+	fprintf(f, "  transport:     %s\n", tx->ctx->xp->name);
+#ifdef FC_TXQ
+	if ( tx->txq ) {
+	fprintf(f, "  async. queue:  %4lu slots, depth %lu (max. %"PRIu64")\n",
+	           tx->txq->mask + 1,
+	           __atomic_load_n( &tx->txq->head, __ATOMIC_RELAXED )
+	           - __atomic_load_n( &tx->txq->tail, __ATOMIC_RELAXED ),
+	           st.max_qdepth);
+	}
+#endif
+	fprintf(f, "  async. submissions: %"PRIu64" (%"PRIu64" dropped, %"PRIu64" failed)\n",
+	           st.n_async, st.n_async_drop, st.n_async_err);
+	if ( tx->coal ) {
+	fprintf(f, "  coalescing:    %4"PRIu32" bytes, %"PRIu32" us\n", tx->coal_bytes, tx->coal_usecs);
+	}
+	fprintf(f, "  coalesced:     %4"PRIu64" blobs in %"PRIu64" messages (%"PRIu64" flushed by timeout)\n",
+	           st.n_coal, st.n_coal_msg, st.n_coal_tmo);
+	fprintf(f, "  max. msg size: %4"PRIu32" bytes\n", tx->msg_size);
+	fprintf(f, "  group encoding: %s\n", tx->compact ? "compact" : "standard");
+	fprintf(f, "  fragmented:    %4"PRIu64" messages (%"PRIu64" fragments)\n",
+	           st.n_frag_msg, st.n_frag);
+	fprintf(f, "  sparse updates: %"PRIu64" (%"PRIu64" sent as complete blobs)\n",
+	           st.n_sparse, st.n_sparse_full);
+	/* the encoder is shared by all contexts */
+	fprintf(f, "  packed (all contexts): %4"PRIu64" blobs (%"PRIu64" sent raw)\n",
+	           st.n_packed, st.n_pack_raw);
+	if ( st.pack_words ) {
+	fprintf(f, "  packed payload: %"PRIu64" words (raw %"PRIu64"; ratio %.2f)\n",
+	           st.pack_words, st.pack_raw_words,
+	           (double)st.pack_raw_words/(double)st.pack_words);
+	}
+}
+
+int
+fcom_get_tx_stat(FcomCtx ctx, uint32_t key, uint64_t *p_val)
+{
+uint64_t     v;
+unsigned     kind = FCOM_STAT_KIND(key);
+FcomTxCtxRef tx   = ctx ? ctx->tx : 0;
+FcomTxStats  st;
+
+		if ( ! tx )
+			return FCOM_ERR_INVALID_ARG;
+
+		fc_stats_get(tx, &st);
+
+		switch ( key & ~kind ) {
+			case FCOM_STAT_TX_NUM_BLOBS_SENT:
+				v = st.n_blb;
+			break;
+
+			case FCOM_STAT_TX_NUM_MESGS_SENT:
+				v = st.n_msg;
+			break;
+
+			case FCOM_STAT_TX_ERR_SEND:
+				v = st.n_snderr;
+			break;
+
+			case FCOM_STAT_TX_NUM_BATCHES:
+				v = st.n_batch;
+			break;
+
+			case FCOM_STAT_TX_NUM_BATCH_MESGS:
+				v = st.n_batch_msg;
+			break;
+
+			case FCOM_STAT_TX_NUM_BATCH_SYSCALLS:
+				v = st.n_batch_sysc;
+			break;
+
+			case FCOM_STAT_TX_MAX_BATCH:
+				v = st.max_batch;
+			break;
+
+			case FCOM_STAT_TX_NUM_ASYNC:
+				v = st.n_async;
+			break;
+
+			case FCOM_STAT_TX_ERR_ASYNC_DROP:
+				v = st.n_async_drop;
+			break;
+
+			case FCOM_STAT_TX_ERR_ASYNC:
+				v = st.n_async_err;
+			break;
+
+			case FCOM_STAT_TX_ASYNC_QDEPTH:
+#ifdef FC_TXQ
+				v = tx->txq ?   __atomic_load_n( &tx->txq->head, __ATOMIC_RELAXED )
+				              - __atomic_load_n( &tx->txq->tail, __ATOMIC_RELAXED ) : 0;
+#else
+				v = 0;
+#endif
+			break;
+
+			case FCOM_STAT_TX_ASYNC_QDEPTH_MAX:
+				v = st.max_qdepth;
+			break;
+
+			case FCOM_STAT_TX_NUM_COALESCED:
+				v = st.n_coal;
+			break;
+
+			case FCOM_STAT_TX_NUM_COALESCED_MESGS:
+				v = st.n_coal_msg;
+			break;
+
+			case FCOM_STAT_TX_NUM_COALESCE_TMO:
+				v = st.n_coal_tmo;
+			break;
+
+			case FCOM_STAT_TX_NUM_FRAG_MESGS:
+				v = st.n_frag_msg;
+			break;
+
+			case FCOM_STAT_TX_NUM_FRAGS:
+				v = st.n_frag;
+			break;
+
+			case FCOM_STAT_TX_NUM_PACKED:
+				v = st.n_packed;
+			break;
+
+			case FCOM_STAT_TX_NUM_PACK_RAW:
+				v = st.n_pack_raw;
+			break;
+
+			case FCOM_STAT_TX_PACK_RAW_WORDS:
+				v = st.pack_raw_words;
+			break;
+
+			case FCOM_STAT_TX_PACK_WORDS:
+				v = st.pack_words;
+			break;
+
+			case FCOM_STAT_TX_NUM_SPARSE:
+				v = st.n_sparse;
+			break;
+
+			case FCOM_STAT_TX_NUM_SPARSE_FULL:
+				v = st.n_sparse_full;
+			break;
+
+			case FCOM_STAT_TX_PROF_NUM(0):
+				return fcom_prof_get( &ctx->tx_prof, kind, FCOM_PROF_NUM, p_val );
+
+			case FCOM_STAT_TX_PROF_MIN_NS(0):
+				return fcom_prof_get( &ctx->tx_prof, kind, FCOM_PROF_MIN, p_val );
+
+			case FCOM_STAT_TX_PROF_AVG_NS(0):
+				return fcom_prof_get( &ctx->tx_prof, kind, FCOM_PROF_AVG, p_val );
+
+			case FCOM_STAT_TX_PROF_MAX_NS(0):
+				return fcom_prof_get( &ctx->tx_prof, kind, FCOM_PROF_MAX, p_val );
+
+			case FCOM_STAT_TX_PROF_P50_NS(0):
+				return fcom_prof_get( &ctx->tx_prof, kind, FCOM_PROF_P50, p_val );
+
+			case FCOM_STAT_TX_PROF_P99_NS(0):
+				return fcom_prof_get( &ctx->tx_prof, kind, FCOM_PROF_P99, p_val );
 
 			default:
+				/* counters used to be 32-bit; accept the old keys */
+				if ( FCOM_STAT_IS_32(key) )
+					return fcom_get_tx_stat(ctx, key | (4<<24), p_val);
 			return FCOM_ERR_UNSUPP;
 		}
 		*p_val = v;
@@ -0,0 +1,316 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+
+/* Publish statistics in a shared-memory segment (see fcom_shm.h).
+ *
+ * A thread periodically collects all statistics into a private
+ * copy of the segment and then copies it into the shared segment
+ * under the segment's sequence lock. Monitors thus never see a
+ * partial update and the time spent with the sequence lock held
+ * is that of a memcpy().
+ */
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+#include <fcom_shm.h>
+#include <fcomP.h>
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(USE_PTHREADS) && defined(_POSIX_SHARED_MEMORY_OBJECTS) && _POSIX_SHARED_MEMORY_OBJECTS > 0
+#define FC_SHM
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+#endif
+
+/* More IDs than can ever be subscribed */
+#define FC_SHM_IDS_MAX 65536
+
+#ifdef FC_SHM
+
+typedef struct FcShm {
+	FcomCtx          ctx;
+	char            *name;
+	FcomShmHdr      *hdr;      /* the shared segment              */
+	FcomShmHdr      *stage;    /* private copy being collected    */
+	size_t           size;
+	unsigned         period_ms;
+	int              running;  /* protected by 'mtx'              */
+	pthread_mutex_t  mtx;
+	pthread_cond_t   cnd;
+	pthread_t        tid;
+} FcShm, *FcShmRef;
+
+/* Collect and publish one update */
+static void
+fc_shm_update(FcShmRef s)
+{
+FcomShmHdr     *st   = s->stage;
+unsigned        subs = 0;
+size_t          off  = offsetof(FcomShmHdr, flags);
+struct timeval  now;
+
+	fcomGetStatsSnapshotCtx( s->ctx, &st->rx, &st->tx );
+
+	st->n_pools = fcom_get_pool_stats ? fcom_get_pool_stats( s->ctx, st->pool, FCOM_SHM_POOLS_MAX, &st->hold, &st->hold_max_idnt ) : 0;
+	if ( fcom_get_lock_stats )
+		fcom_get_lock_stats( s->ctx, &st->lock_tbl, &st->lock_grp, &st->lock_rx_msg );
+	st->n_ids   = fcom_get_id_stats   ? fcom_get_id_stats( s->ctx, FCOM_SHM_ID(st, 0), st->max_ids, &subs ) : 0;
+	st->n_subs  = subs;
+
+	gettimeofday( &now, 0 );
+	st->time_us = (uint64_t)now.tv_sec * 1000000ULL + now.tv_usec;
+	st->n_upd++;
+
+	/* the ID records directly follow the header */
+	fcom_seq_wbegin( &s->hdr->seq );
+		memcpy( (char*)s->hdr + off, (char*)st + off, st->hdr_size - off + st->n_ids * st->id_size );
+	fcom_seq_wend( &s->hdr->seq );
+}
+
+static void *
+fc_shm_thread(void *arg)
+{
+FcShmRef        s = arg;
+struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+
+	pthread_mutex_lock( &s->mtx );
+	while ( s->running ) {
+		pthread_mutex_unlock( &s->mtx );
+
+		fc_shm_update( s );
+
+		t.tv_sec  += s->period_ms / 1000;
+		t.tv_nsec += (s->period_ms % 1000) * 1000000L;
+		if ( t.tv_nsec >= 1000000000L ) {
+			t.tv_nsec -= 1000000000L;
+			t.tv_sec++;
+		}
+
+		pthread_mutex_lock( &s->mtx );
+		while ( s->running && ETIMEDOUT != pthread_cond_timedwait( &s->cnd, &s->mtx, &t ) )
+			/* nothing else to do */;
+	}
+	pthread_mutex_unlock( &s->mtx );
+
+	return 0;
+}
+
+/* Release everything; the thread must not be running */
+static void
+fc_shm_free(FcShmRef s)
+{
+	if ( s->hdr ) {
+		munmap( s->hdr, s->size );
+		shm_unlink( s->name );
+	}
+	free( s->stage );
+	free( s->name );
+	free( s );
+}
+
+/* Check if segment 'name' is not (or no longer) used
+ * by a live process.
+ */
+static int
+fc_shm_stale(const char *name)
+{
+int         fd;
+int         rval = 1;
+struct stat sb;
+FcomShmHdr *h;
+
+	if ( (fd = shm_open( name, O_RDONLY, 0 )) < 0 )
+		return 0;
+	if ( 0 == fstat( fd, &sb ) && sb.st_size >= sizeof(*h) ) {
+		h = mmap( 0, sizeof(*h), PROT_READ, MAP_SHARED, fd, 0 );
+		if ( MAP_FAILED != h ) {
+			if ( FCOM_SHM_MAGIC == h->magic && (pid_t)h->pid != getpid() ) {
+				rval = kill( (pid_t)h->pid, 0 ) && ESRCH == errno;
+			}
+			munmap( h, sizeof(*h) );
+		}
+	}
+	close( fd );
+	return rval;
+}
+
+static int
+fc_shm_create(FcomCtx ctx, const char *name, unsigned period_ms, unsigned max_ids)
+{
+FcShmRef            s;
+int                 fd;
+int                 err;
+void               *p;
+pthread_attr_t      atts;
+pthread_condattr_t  catts;
+struct sched_param  param;
+
+	if ( max_ids > FC_SHM_IDS_MAX )
+		return FCOM_ERR_INVALID_ARG;
+
+	if ( ! (s = calloc(1, sizeof(*s))) )
+		return FCOM_ERR_NO_MEMORY;
+
+	s->ctx       = ctx;
+	s->period_ms = period_ms;
+	s->running   = 1;
+	s->size      = sizeof(FcomShmHdr) + max_ids * sizeof(FcomShmID);
+
+	if (   ! (s->name  = strdup( name ))
+	    || ! (s->stage = calloc(1, s->size)) ) {
+		fc_shm_free( s );
+		return FCOM_ERR_NO_MEMORY;
+	}
+
+	s->stage->magic     = FCOM_SHM_MAGIC;
+	s->stage->version   = FCOM_SHM_VERSION;
+	s->stage->hdr_size  = sizeof(FcomShmHdr);
+	s->stage->id_size   = sizeof(FcomShmID);
+	s->stage->seg_size  = s->size;
+	s->stage->max_ids   = max_ids;
+	s->stage->pid       = getpid();
+	s->stage->period_ms = period_ms;
+	s->stage->flags     = (ctx->rx ? FCOM_SHM_HAVE_RX : 0) | (ctx->tx ? FCOM_SHM_HAVE_TX : 0);
+
+	fd = shm_open( name, O_CREAT | O_EXCL | O_RDWR, 0644 );
+	if ( fd < 0 && EEXIST == errno && fc_shm_stale( name ) ) {
+		/* left behind by a process which is gone */
+		shm_unlink( name );
+		fd = shm_open( name, O_CREAT | O_EXCL | O_RDWR, 0644 );
+	}
+	if ( fd < 0 ) {
+		err = FCOM_ERR_SYS(errno);
+		fc_shm_free( s );
+		return err;
+	}
+
+	if ( ftruncate( fd, s->size ) ) {
+		err = FCOM_ERR_SYS(errno);
+		close( fd );
+		shm_unlink( name );
+		fc_shm_free( s );
+		return err;
+	}
+
+	p = mmap( 0, s->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( MAP_FAILED == p ) {
+		err = FCOM_ERR_SYS(errno);
+		shm_unlink( name );
+		fc_shm_free( s );
+		return err;
+	}
+	s->hdr = p;
+
+	/* readers retry while 'seq' is odd */
+	s->hdr->seq = 1;
+	memcpy( s->hdr, s->stage, offsetof(FcomShmHdr, seq) );
+	fcom_seq_wend( &s->hdr->seq );
+
+	pthread_condattr_init( &catts );
+	pthread_condattr_setclock( &catts, CLOCK_MONOTONIC );
+	err = pthread_cond_init( &s->cnd, &catts );
+	pthread_condattr_destroy( &catts );
+	if ( err ) {
+		fc_shm_free( s );
+		return FCOM_ERR_SYS(err);
+	}
+	pthread_mutex_init( &s->mtx, 0 );
+
+	/* The publisher must not compete with the RX thread
+	 * (or the application) which may both run at real-time
+	 * priority.
+	 */
+	pthread_attr_init( &atts );
+	pthread_attr_setinheritsched( &atts, PTHREAD_EXPLICIT_SCHED );
+	pthread_attr_setschedpolicy( &atts, SCHED_OTHER );
+	param.sched_priority = 0;
+	pthread_attr_setschedparam( &atts, &param );
+	if ( (err = pthread_create( &s->tid, &atts, fc_shm_thread, s )) ) {
+		err = pthread_create( &s->tid, 0, fc_shm_thread, s );
+	}
+	pthread_attr_destroy( &atts );
+
+	if ( err ) {
+		pthread_mutex_destroy( &s->mtx );
+		pthread_cond_destroy( &s->cnd );
+		fc_shm_free( s );
+		return FCOM_ERR_SYS(err);
+	}
+
+	ctx->shm = s;
+
+	return 0;
+}
+
+void
+fcom_shm_fini(FcomCtx ctx)
+{
+FcShmRef s;
+
+	if ( ! ctx || ! (s = ctx->shm) )
+		return;
+
+	pthread_mutex_lock( &s->mtx );
+		s->running = 0;
+		pthread_cond_signal( &s->cnd );
+	pthread_mutex_unlock( &s->mtx );
+
+	pthread_join( s->tid, 0 );
+
+	ctx->shm = 0;
+
+	pthread_mutex_destroy( &s->mtx );
+	pthread_cond_destroy( &s->cnd );
+	fc_shm_free( s );
+}
+
+#else
+
+void
+fcom_shm_fini(FcomCtx ctx)
+{
+}
+
+#endif
+
+int
+fcomShmPublishCtx(FcomCtx ctx, const char *name, unsigned period_ms, unsigned max_ids)
+{
+#ifdef FC_SHM
+	if ( ! ctx )
+		return FCOM_ERR_INVALID_ARG;
+
+	fcom_shm_fini( ctx );
+
+	if ( 0 == period_ms )
+		return 0;
+
+	return fc_shm_create( ctx, name ? name : FCOM_SHM_NAME_DFLT, period_ms, max_ids );
+#else
+	return FCOM_ERR_UNSUPP;
+#endif
+}
+
+int
+fcomShmPublish(const char *name, unsigned period_ms, unsigned max_ids)
+{
+	return fcomShmPublishCtx(fcom_dflt_ctx, name, period_ms, max_ids);
+}
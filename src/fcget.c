@@ -28,7 +28,7 @@
 static void
 usage(char *nm)
 {
-	fprintf(stderr,"Usage: %s [-ahvs] [-t <timeout_ms>] [-p <fcom_mc_prefix>] [-i <fcom_mc_IF>] [-b bufs] blob_id {blob_id}\n", nm);
+	fprintf(stderr,"Usage: %s [-ahvs] [-t <timeout_ms>] [-p <fcom_mc_prefix>] [-i <fcom_mc_IF>] [-b bufs] [-w <file>] blob_id {blob_id}\n", nm);
 	fprintf(stderr,"  Options:\n");
 	fprintf(stderr,"       -h print this message\n");
 	fprintf(stderr,"       -a enforce asynchronous 'get'\n");
@@ -40,6 +40,7 @@ usage(char *nm)
 	fprintf(stderr,"       -i <fcom_mc_IF>. IF (dot-address) on which to listen for FCOM\n");
 	fprintf(stderr,"       -v verbose mode.\n");
 	fprintf(stderr,"       -s dump statistics before terminating.\n");
+	fprintf(stderr,"       -w <file> record all messages received (for 'fcomreplay').\n");
 	fprintf(stderr,"  Environment:\n");
 	fprintf(stderr,"       FCOM_MC_PREFIX defines multicast prefix (overridden by -p)\n");
 	fprintf(stderr,"       FCOM_MC_IFADDR defines address of IF to be listened on\n");
@@ -66,9 +67,10 @@ int             nids    = 0;
 int             nsubs   = 0;
 int             stats   = 0;
 int             bufs    = 10;
+char            *recf   = 0;
 int             i;
 
-	while ( (ch = getopt(argc, argv, "ab:hp:st:v")) >= 0 ) {
+	while ( (ch = getopt(argc, argv, "ab:hp:st:vw:")) >= 0 ) {
 		switch (ch) {
 			case 'h':
 				rval = 0;
@@ -111,6 +113,10 @@ int             i;
 			case 'v':
 				level = 1;
 			break;
+
+			case 'w':
+				recf = optarg;
+			break;
 		}
 	}
 
@@ -164,6 +170,11 @@ int             i;
 		goto bail;
 	}
 
+	if ( recf && (st = fcomRecordStart( recf )) ) {
+		fprintf(stderr,"Unable to start recording: %s\n", fcomStrerror(st));
+		goto bail;
+	}
+
 	if ( nids > 1 )
 		async = 1;
 
@@ -229,6 +240,9 @@ int             i;
 
 bail:
 
+	if ( recf && (st = fcomRecordStop()) >= 0 )
+		fprintf(stderr,"%d messages recorded\n", st);
+
 	if ( stats )
 		fcomDumpStats(stdout);
 
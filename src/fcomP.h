@@ -30,7 +30,12 @@
 
 #include <stdio.h>
 #include <fcom_api.h>
+#include <fcom_shm.h>
 #include <udpComm.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <fc_prof.h>
 
 /* We align all data to 16-bytes (just in case someone wants to
  * vectorize access to FCOM data)
@@ -40,21 +45,85 @@
 #define FC_ALIGN(ptr) ((((uintptr_t)(ptr)) + FC_ALIGN_MSK) & ~((uintptr_t)FC_ALIGN_MSK))
 
 
-/* Mcast group prefix in network byte order */
-extern uint32_t fcom_g_prefix;
+/* Transport. All datagrams are sent and received through
+ * these operations which have the semantics of the udpComm
+ * routines of the same name (descriptors are returned by
+ * 'socket'; errors are negative 'errno' values). Packets
+ * handed out by 'recv_from' (and consumed by 'send_pkt_to')
+ * are udpComm packets in any case.
+ */
+typedef struct FcomXport {
+	const char  *name;
+	/* descriptors are sockets (sendmmsg() may be used) */
+	int          is_sock;
+	int        (*socket)(int port);
+	int        (*close)(int sd);
+	UdpCommPkt (*recv_from)(int sd, int timeout_ms, uint32_t *p_peer_ip, uint16_t *p_peer_port);
+	int        (*send_to)(int sd, void *buf, int len, uint32_t dipaddr, int dport);
+	int        (*send_pkt_to)(int sd, UdpCommPkt pkt, int len, uint32_t dipaddr, int dport);
+	int        (*join_mcast)(int sd, uint32_t mcaddr);
+	int        (*leave_mcast)(int sd, uint32_t mcaddr);
+} FcomXport;
+
+/* udpComm (default) */
+extern const FcomXport fcom_xport_udp;
+
+/* In-process loopback ("loop:" prefix; see fc_loop.c) */
+extern const FcomXport fcom_xport_loop;
+
+#define FCOM_XPORT_LOOP_PREFIX "loop:"
 
-/* Our port */
-extern int      fcom_port;
+/* A FCOM context; holds everything that used to be
+ * global state. The RX and TX parts keep their private
+ * state in separate objects (defined in fc_recv.c
+ * and fc_send.c, respectively).
+ */
+typedef struct FcomCtxRec_ {
+	/* Mcast group prefix in network byte order */
+	uint32_t          g_prefix;
+	/* Our port */
+	int               port;
+	/* Transport */
+	const FcomXport  *xp;
+	/* Our socket (transmission) */
+	int               xsd;
+	/* Our socket (reception)    */
+	int               rsd;
+	/* RX thread priority (pthread) */
+	int               rx_priority_percent;
+	/* RX thread scheduling policy (FCOM_SCHED_xxx) */
+	int               rx_sched_policy;
+	/* RX thread CPU list (NULL: no restriction) */
+	char             *rx_cpu_list;
+	/* Private state of the RX and TX parts (NULL if not linked/enabled) */
+	struct FcomRxCtx *rx;
+	struct FcomTxCtx *tx;
+	/* Stage profiles (FCOM_PROF_RX_xxx, FCOM_PROF_TX_xxx) */
+	FcomProf          rx_prof;
+	FcomProf          tx_prof;
+	/* Statistics segment publisher (NULL if not publishing) */
+	struct FcShm     *shm;
+} FcomCtxRec;
+
+/* The context created by fcomInit() and used by
+ * all API routines which take no explicit context.
+ */
+extern FcomCtx  fcom_dflt_ctx;
 
-/* Our socket (transmission) */
-extern int      fcom_xsd;
-/* Our socket (reception)    */
-extern int      fcom_rsd;
+/* Defaults for the RX thread parameters of new contexts */
 
 /* RX thread priority (pthread) */
 extern int      fcom_rx_priority_percent;
 
-/* Clean up and terminate FCOM (undocumented; for testing only) */
+/* RX thread scheduling policy (FCOM_SCHED_xxx) */
+extern int      fcom_rx_sched_policy;
+
+/* RX thread CPU list (NULL: no restriction) */
+extern char    *fcom_rx_cpu_list;
+
+/* Clean up and terminate FCOM, i.e., destroy the
+ * default context (undocumented; for testing only)
+ */
 int
 fcom_exit(void);
 
@@ -75,16 +144,133 @@ int fcom_get_gid(FcomBlobRef pb, uint32_t *p_gid)
 	return -1;
 }
 
+/* Monotonic time in microseconds */
+static __inline__
+uint64_t fcom_now_us(void)
+{
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0 && defined(CLOCK_MONOTONIC)
+struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+#else
+struct timeval  now;
+	gettimeofday( &now, 0 );
+	return (uint64_t)now.tv_sec * 1000000ULL + now.tv_usec;
+#endif
+}
+
+/* Monotonic time in nanoseconds */
+static __inline__
+uint64_t fcom_now_ns(void)
+{
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0 && defined(CLOCK_MONOTONIC)
+struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#else
+	return fcom_now_us() * 1000ULL;
+#endif
+}
+
+/* Statistics counters (64-bit).
+ *
+ * Counters which are written by a single thread (RX) are
+ * incremented normally; readers use a sequence lock (see
+ * below) in order to obtain consistent (and untorn) values.
+ *
+ * Counters which are written by multiple threads (TX) are
+ * updated atomically if the CPU supports lock-free 64-bit
+ * atomics. Otherwise updates may occasionally be lost
+ * (the counters are informational only).
+ */
+#if defined(__ATOMIC_RELAXED) && defined(__GCC_ATOMIC_LLONG_LOCK_FREE) && 2 == __GCC_ATOMIC_LLONG_LOCK_FREE
+#define FCOM_STAT_ADD(c, n) ((void)__atomic_add_fetch( &(c), (n), __ATOMIC_RELAXED ))
+#define FCOM_STAT_SET(c, v) __atomic_store_n( &(c), (v), __ATOMIC_RELAXED )
+#define FCOM_STAT_GET(c)    __atomic_load_n( &(c), __ATOMIC_RELAXED )
+#else
+#define FCOM_STAT_ADD(c, n) ((void)((c) += (n)))
+#define FCOM_STAT_SET(c, v) ((c) = (v))
+#define FCOM_STAT_GET(c)    (c)
+#endif
+#define FCOM_STAT_INC(c)    FCOM_STAT_ADD(c, 1)
+
+/* Sequence lock; one writer, any number of readers
+ * which retry if they raced with the writer:
+ *
+ *   fcom_seq_wbegin(&s);  update...;  fcom_seq_wend(&s);
+ *
+ *   for ( i=0; ; i++ ) {
+ *     s0 = fcom_seq_rbegin(&s);  copy...;
+ *     if ( ! fcom_seq_rretry(&s, s0, i) ) break;
+ *   }
+ *
+ * Readers never spin on the writer; a reader which keeps
+ * failing sleeps between attempts so that a writer of
+ * lower priority can complete (uniprocessor).
+ */
+static __inline__ void
+fcom_seq_wbegin(volatile uint32_t *s)
+{
+	*s = *s + 1;
+#ifdef __ATOMIC_RELEASE
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+#endif
+}
+
+static __inline__ void
+fcom_seq_wend(volatile uint32_t *s)
+{
+#ifdef __ATOMIC_RELEASE
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+#endif
+	*s = *s + 1;
+}
+
+static __inline__ uint32_t
+fcom_seq_rbegin(volatile uint32_t *s)
+{
+uint32_t s0 = *s;
+#ifdef __ATOMIC_ACQUIRE
+	__atomic_thread_fence( __ATOMIC_ACQUIRE );
+#endif
+	return s0;
+}
+
+static __inline__ int
+fcom_seq_rretry(volatile uint32_t *s, uint32_t s0, unsigned attempt)
+{
+#ifdef __ATOMIC_ACQUIRE
+	__atomic_thread_fence( __ATOMIC_ACQUIRE );
+#endif
+	if ( ! (s0 & 1) && *s == s0 )
+		return 0;
+	if ( attempt >= 3 )
+		usleep( 100 );
+	return 1;
+}
+
 /* Find 1-based position of most non-zero bit in x.
  * E.g., fcom_nzbits(0x15) -> 5.
  */
 int
 fcom_nzbits(uint32_t x);
 
-extern int fcom_recv_fini()               __attribute__((weak));
-extern int fcom_recv_init(unsigned nbufs) __attribute__((weak));
-extern int fcom_send_fini()               __attribute__((weak));
-extern int fcom_send_init()               __attribute__((weak));
+/* Create/destroy the RX and TX parts of a context.
+ * The 'fini' routines may be called after a failed
+ * or partial 'init' (and when 'init' never ran).
+ * 'fcom_recv_busy()' returns FCOM_ERR_ID_IN_USE while the
+ * application holds blobs or blob sets of the RX part; it
+ * is checked before anything is torn down.
+ */
+extern int fcom_recv_fini(FcomCtx ctx)                 __attribute__((weak));
+extern int fcom_recv_busy(FcomCtx ctx)                 __attribute__((weak));
+extern int fcom_recv_init(FcomCtx ctx, unsigned nbufs) __attribute__((weak));
+extern int fcom_send_fini(FcomCtx ctx)                 __attribute__((weak));
+extern int fcom_send_init(FcomCtx ctx)                 __attribute__((weak));
+
+/* Stop publishing statistics (fcomShmPublishCtx()) */
+void
+fcom_shm_fini(FcomCtx ctx);
 
 /* Block (for at most timeout_ms milliseconds)
  * for a single message to arrive. Dispatch the
@@ -94,19 +280,19 @@ extern int fcom_send_init()               __attribute__((weak));
  * RETURNS: # of blobs received (0 if timeout)
  */
 int
-fcom_receive(unsigned timeout_ms);
+fcom_receive(FcomCtx ctx, unsigned timeout_ms);
 
 /* Dump FCOM RX statistics to file 'f'.
  * 'stdout' is used if f = NULL.
  */
 extern void
-fcom_recv_stats(FILE *f)                  __attribute__((weak));
+fcom_recv_stats(FcomCtx ctx, FILE *f)     __attribute__((weak));
 
 /* Dump FCOM TX statistics to file 'f'.
  * 'stdout' is used if f = NULL.
  */
 extern void
-fcom_send_stats(FILE *f)                  __attribute__((weak));
+fcom_send_stats(FcomCtx ctx, FILE *f)     __attribute__((weak));
 
 /* Read/write a ASCII file (stdio) defining a sequence of
  * blobs and convert to/from C-representation.
@@ -131,9 +317,9 @@ fcom_send_stats(FILE *f)                  __attribute__((weak));
  *    'st' , number
  *    'ty' , type , count
  *
- *  type:  '1'..'5' 
+ *  type:  '1'..'9' 
  *
- *  (representing FCOM_EL_FLT .. FCOM_EL_UINT8)
+ *  (representing FCOM_EL_FLOAT .. FCOM_EL_UINT64)
  *
  *  count: number
  *
@@ -178,21 +364,188 @@ fcom_get_blob_from_file(FILE *f, FcomBlobRef pb, int avail);
 int
 fcom_put_blob_to_file(FILE *f, FcomBlobRef pb);
 
+/* BINARY FILE FORMAT
+ *
+ *  Parsing the ASCII format is slow; large test vectors
+ *  may instead be stored in a binary file which is memory-
+ *  mapped when read, i.e., blobs are handed out without
+ *  copying or converting any data.
+ *
+ *  file:   FcomBinFileHdr , { record } , index
+ *
+ *  record: FcomBinRecHdr , payload , padding
+ *
+ *  index:  'n_blobs' uint64_t file offsets of the records
+ *
+ *  All members are stored in the byte order of the host which
+ *  wrote the file (a reader detects and rejects a file of the
+ *  other endianness). Records and payloads start at multiples
+ *  of FCOM_BINF_ALIGN. The index and 'n_blobs'/'idx_off' are
+ *  written when the file is closed; if they are missing (the
+ *  writer died) a reader rebuilds the index from the records.
+ */
+
+#define FCOM_BINF_MAGIC     0x46434246 /* 'FCBF' */
+#define FCOM_BINF_VERSION   1
+#define FCOM_BINF_ALIGN     16
+
+typedef struct FcomBinFileHdr {
+	uint32_t    magic;     /* FCOM_BINF_MAGIC                      */
+	uint32_t    version;   /* FCOM_BINF_VERSION                    */
+	uint32_t    hdr_size;  /* offset of the first record           */
+	uint32_t    n_blobs;   /* # of records (0 if no index)         */
+	uint64_t    idx_off;   /* offset of the index (0: none)        */
+	uint64_t    reserved;
+} FcomBinFileHdr;
+
+typedef struct FcomBinRecHdr {
+	uint32_t    rec_size;  /* size of the record incl. padding     */
+	uint32_t    pld_size;  /* size of the payload (bytes)          */
+	FcomBlobHdr blob;      /* blob header; payload follows         */
+} FcomBinRecHdr;
+
+typedef struct FcomBinFile_ *FcomBinFileRef;
+
+/* Create binary file 'path' for writing.
+ *
+ * RETURNS: zero on success, negative error status otherwise.
+ */
+int
+fcom_binf_create(FcomBinFileRef *p_bf, const char *path);
+
+/* Append a blob to a file created with fcom_binf_create().
+ *
+ * RETURNS: zero on success, negative error status otherwise.
+ */
+int
+fcom_put_blob_to_binf(FcomBinFileRef bf, FcomBlobRef pb);
+
+/* Open (map) binary file 'path' for reading.
+ *
+ * RETURNS: zero on success, negative error status otherwise
+ *          (FCOM_ERR_BAD_VERSION if 'path' is not a binary
+ *          blob file or of the wrong endianness).
+ */
+int
+fcom_binf_open(FcomBinFileRef *p_bf, const char *path);
+
+/* RETURNS: number of blobs in a file opened for reading. */
+int
+fcom_binf_count(FcomBinFileRef bf);
+
+/* Retrieve blob number 'i' of a file opened for reading.
+ * The header is copied into *pb; the data reference points
+ * into the mapped file and remains valid until the file is
+ * closed. The data must not be modified.
+ *
+ * RETURNS: zero on success, negative error status otherwise.
+ */
+int
+fcom_get_blob_from_binf(FcomBinFileRef bf, unsigned i, FcomBlobRef pb);
+
+/* Close a binary file. A file opened for writing is completed
+ * (index) first.
+ *
+ * RETURNS: number of blobs in the file or a negative error status
+ *          (e.g., if writing failed).
+ */
+int
+fcom_binf_close(FcomBinFileRef bf);
+
 /* Get RX and TX statistic, respectively. */
 extern int
-fcom_get_rx_stat(uint32_t key, uint64_t *p_val)
+fcom_get_rx_stat(FcomCtx ctx, uint32_t key, uint64_t *p_val)
+__attribute__((weak));
+
+extern int
+fcom_get_tx_stat(FcomCtx ctx, uint32_t key, uint64_t *p_val)
+__attribute__((weak));
+
+/* Get a consistent copy of the RX and TX counters, respectively.
+ *
+ * RETURNS: zero on success, FCOM_ERR_INVALID_ARG if the
+ *          context has no RX or TX part.
+ */
+extern int
+fcom_get_rx_counters(FcomCtx ctx, FcomRxStats *p_stats)
+__attribute__((weak));
+
+extern int
+fcom_get_tx_counters(FcomCtx ctx, FcomTxStats *p_stats)
+__attribute__((weak));
+
+/* Get the state of (at most 'max') RX buffer pools and
+ * the hold-time histogram (fcomGetRxHoldTime()).
+ *
+ * RETURNS: number of pools stored in 'p_pool'.
+ */
+extern int
+fcom_get_pool_stats(FcomCtx ctx, FcomShmPool *p_pool, unsigned max, FcomLatHist *p_hold, FcomID *p_max_idnt)
 __attribute__((weak));
 
+/* Get the update rates of (at most 'max') subscribed IDs;
+ * the total number of subscribed IDs is returned in '*p_subs'.
+ *
+ * RETURNS: number of records stored in 'p_ids'.
+ */
 extern int
-fcom_get_tx_stat(uint32_t key, uint64_t *p_val)
+fcom_get_id_stats(FcomCtx ctx, FcomShmID *p_ids, unsigned max, unsigned *p_subs)
 __attribute__((weak));
 
+/* Get the lock statistics (fcomGetLockStats()).
+ *
+ * RETURNS: zero on success, FCOM_ERR_INVALID_ARG if the
+ *          context has no RX part.
+ */
+extern int
+fcom_get_lock_stats(FcomCtx ctx, FcomLockStats *p_tbl, FcomLockStats *p_grp, FcomLatHist *p_rx_msg)
+__attribute__((weak));
+
+/* Recording of received messages (fc_rec.c); the caller
+ * serializes access to a recording. With pthreads the file
+ * is written by a separate thread.
+ */
+typedef struct FcRec *FcRecRef;
+
+int
+fcom_rec_open(FcRecRef *p_rec, const char *path);
+
+/* Append message 'xmem' of 'nints' 32-bit words which arrived
+ * at 't_us' (fcom_now_us()).
+ *
+ * RETURNS: zero on success, FCOM_ERR_NO_SPACE if the message
+ *          was dropped (the writer is behind) or the first
+ *          write error.
+ */
+int
+fcom_rec_write(FcRecRef rec, uint64_t t_us, uint32_t gid, const uint32_t *xmem, uint32_t nints);
+
+/* Write what is still queued and close the file.
+ *
+ * RETURNS: number of messages recorded or the first write error
+ */
+int
+fcom_rec_close(FcRecRef rec);
+
 /* Add more buffers of a given kind at run-time
  * This routine is thread safe.
  *
  * RETURNS: zero on error, nonzero on failure.
  */
 int
-fcom_add_bufs(unsigned kind, unsigned num_bufs);
+fcom_add_bufs(FcomCtx ctx, unsigned kind, unsigned num_bufs);
+
+/* Obtain 'depth' RX buffers of (payload) size 'sz' and
+ * release them again; repeat 'n' times. The table lock is
+ * held for each round (like the RX thread does while it
+ * processes a message). For benchmarking the buffer pools.
+ *
+ * RETURNS: zero on success, FCOM_ERR_NO_SPACE if not enough
+ *          buffers were available or FCOM_ERR_INVALID_ARG.
+ */
+#define FCOM_CYCLE_BUFS_DEPTH_MAX 64
+
+int
+fcom_cycle_bufs(FcomCtx ctx, uint32_t sz, unsigned depth, unsigned n);
 
 #endif
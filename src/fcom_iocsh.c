@@ -11,6 +11,7 @@
 #include <registry.h>
 #include <epicsExport.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <fcom_api.h>
 
@@ -59,6 +60,35 @@ _fcomDumpStatsFunc(const iocshArgBuf *args)
 	fcomDumpStats(stdout);
 }
 
+static const struct iocshArg _fcomDumpIDStatsArgs[] = {
+	{
+	"FCOM ID",
+	iocshArgInt
+	},
+	{
+	"level",
+	iocshArgInt
+	},
+};
+
+static const struct iocshArg *_fcomDumpIDStatsArgsp[] = {
+	&_fcomDumpIDStatsArgs[0],
+	&_fcomDumpIDStatsArgs[1],
+	0
+};
+
+struct iocshFuncDef _fcomDumpIDStatsDesc = {
+	"fcomDumpIDStats",
+	2,
+	_fcomDumpIDStatsArgsp
+};
+
+static void
+_fcomDumpIDStatsFunc(const iocshArgBuf *args)
+{
+	fcomDumpIDStats((FcomID)args[0].ival, args[1].ival, stdout);
+}
+
 static const struct iocshArg _fcomStrerrorArgs[] = {
 	{
 	"error code",
@@ -84,13 +114,279 @@ _fcomStrerrorFunc(const iocshArgBuf *args)
 	fprintf(stderr,"%s\n",fcomStrerror(args[0].ival));
 }
 
+static const struct iocshArg _fcomSetRxSchedArgs[] = {
+	{
+	"policy <fifo|rr|other>",
+	iocshArgString
+	},
+	{
+	"priority <percent>",
+	iocshArgInt
+	},
+};
+
+static const struct iocshArg *_fcomSetRxSchedArgsp[] = {
+	&_fcomSetRxSchedArgs[0],
+	&_fcomSetRxSchedArgs[1],
+	0
+};
+
+struct iocshFuncDef _fcomSetRxSchedDesc = {
+	"fcomSetRxSched",
+	2,
+	_fcomSetRxSchedArgsp
+};
+
+static void
+_fcomSetRxSchedFunc(const iocshArgBuf *args)
+{
+int         pol;
+int         st;
+const char *nm = args[0].sval;
+
+	if ( ! nm || ! strcmp(nm, "fifo") ) {
+		pol = FCOM_SCHED_FIFO;
+	} else if ( ! strcmp(nm, "rr") ) {
+		pol = FCOM_SCHED_RR;
+	} else if ( ! strcmp(nm, "other") ) {
+		pol = FCOM_SCHED_OTHER;
+	} else {
+		fprintf(stderr,"Unknown policy '%s' (use fifo, rr or other)\n", nm);
+		return;
+	}
+	if ( (st = fcomSetRxSched(pol, args[1].ival)) )
+		fprintf(stderr,"fcomSetRxSched failed: %s\n", fcomStrerror(st));
+}
+
+static const struct iocshArg _fcomSetRxAffinityArgs[] = {
+	{
+	"CPU list <e.g., 0-3,6>",
+	iocshArgString
+	},
+};
+
+static const struct iocshArg *_fcomSetRxAffinityArgsp[] = {
+	&_fcomSetRxAffinityArgs[0],
+	0
+};
+
+struct iocshFuncDef _fcomSetRxAffinityDesc = {
+	"fcomSetRxAffinity",
+	1,
+	_fcomSetRxAffinityArgsp
+};
+
+static void
+_fcomSetRxAffinityFunc(const iocshArgBuf *args)
+{
+int st;
+	if ( (st = fcomSetRxAffinity(args[0].sval)) )
+		fprintf(stderr,"fcomSetRxAffinity failed: %s\n", fcomStrerror(st));
+}
+
+static const struct iocshArg _fcomSetProfilingArgs[] = {
+	{
+	"on <0|1>",
+	iocshArgInt
+	},
+};
+
+static const struct iocshArg *_fcomSetProfilingArgsp[] = {
+	&_fcomSetProfilingArgs[0],
+	0
+};
+
+struct iocshFuncDef _fcomSetProfilingDesc = {
+	"fcomSetProfiling",
+	1,
+	_fcomSetProfilingArgsp
+};
+
+static void
+_fcomSetProfilingFunc(const iocshArgBuf *args)
+{
+int st;
+	if ( (st = fcomSetProfiling(args[0].ival)) )
+		fprintf(stderr,"fcomSetProfiling failed: %s\n", fcomStrerror(st));
+}
+
+static const struct iocshArg _fcomSetLockStatsArgs[] = {
+	{
+	"on <0|1>",
+	iocshArgInt
+	},
+};
+
+static const struct iocshArg *_fcomSetLockStatsArgsp[] = {
+	&_fcomSetLockStatsArgs[0],
+	0
+};
+
+struct iocshFuncDef _fcomSetLockStatsDesc = {
+	"fcomSetLockStats",
+	1,
+	_fcomSetLockStatsArgsp
+};
+
+static void
+_fcomSetLockStatsFunc(const iocshArgBuf *args)
+{
+int st;
+	if ( (st = fcomSetLockStats(args[0].ival)) )
+		fprintf(stderr,"fcomSetLockStats failed: %s\n", fcomStrerror(st));
+}
+
+static const struct iocshArg *_fcomDumpProfileArgsp[] = {
+	0
+};
+
+struct iocshFuncDef _fcomDumpProfileDesc = {
+	"fcomDumpProfile",
+	0,
+	_fcomDumpProfileArgsp
+};
+
+static void
+_fcomDumpProfileFunc(const iocshArgBuf *args)
+{
+	fcomDumpProfile(stdout);
+}
+
+static const struct iocshArg _fcomShmPublishArgs[] = {
+	{
+	"segment name (default /fcom-stats)",
+	iocshArgString
+	},
+	{
+	"period_ms (0: stop)",
+	iocshArgInt
+	},
+	{
+	"max. # of IDs",
+	iocshArgInt
+	},
+};
+
+static const struct iocshArg *_fcomShmPublishArgsp[] = {
+	&_fcomShmPublishArgs[0],
+	&_fcomShmPublishArgs[1],
+	&_fcomShmPublishArgs[2],
+	0
+};
+
+struct iocshFuncDef _fcomShmPublishDesc = {
+	"fcomShmPublish",
+	3,
+	_fcomShmPublishArgsp
+};
+
+static void
+_fcomShmPublishFunc(const iocshArgBuf *args)
+{
+int st;
+	if ( args[1].ival < 0 || args[2].ival < 0 ) {
+		fprintf(stderr,"fcomShmPublish: invalid argument\n");
+		return;
+	}
+	if ( (st = fcomShmPublish(args[0].sval, args[1].ival, args[2].ival)) )
+		fprintf(stderr,"fcomShmPublish failed: %s\n", fcomStrerror(st));
+}
+
+static const struct iocshArg _fcomRecordStartArgs[] = {
+	{
+	"file name",
+	iocshArgString
+	},
+};
+
+static const struct iocshArg *_fcomRecordStartArgsp[] = {
+	&_fcomRecordStartArgs[0],
+	0
+};
+
+struct iocshFuncDef _fcomRecordStartDesc = {
+	"fcomRecordStart",
+	1,
+	_fcomRecordStartArgsp
+};
+
+static void
+_fcomRecordStartFunc(const iocshArgBuf *args)
+{
+int st;
+	if ( (st = fcomRecordStart(args[0].sval)) )
+		fprintf(stderr,"fcomRecordStart failed: %s\n", fcomStrerror(st));
+}
+
+static const struct iocshArg *_fcomRecordStopArgsp[] = {
+	0
+};
+
+struct iocshFuncDef _fcomRecordStopDesc = {
+	"fcomRecordStop",
+	0,
+	_fcomRecordStopArgsp
+};
+
+static void
+_fcomRecordStopFunc(const iocshArgBuf *args)
+{
+int st;
+	if ( (st = fcomRecordStop()) < 0 )
+		fprintf(stderr,"fcomRecordStop failed: %s\n", fcomStrerror(st));
+	else
+		printf("%d messages recorded\n", st);
+}
+
+static const struct iocshArg _fcomReplayArgs[] = {
+	{
+	"file name",
+	iocshArgString
+	},
+	{
+	"flags (1: fast, 2: local)",
+	iocshArgInt
+	},
+};
+
+static const struct iocshArg *_fcomReplayArgsp[] = {
+	&_fcomReplayArgs[0],
+	&_fcomReplayArgs[1],
+	0
+};
+
+struct iocshFuncDef _fcomReplayDesc = {
+	"fcomReplay",
+	2,
+	_fcomReplayArgsp
+};
+
+static void
+_fcomReplayFunc(const iocshArgBuf *args)
+{
+int st;
+	if ( (st = fcomReplay(args[0].sval, args[1].ival)) < 0 )
+		fprintf(stderr,"fcomReplay failed: %s\n", fcomStrerror(st));
+	else
+		printf("%d messages replayed\n", st);
+}
 
 static void
 fcomRegistrar(void)
 {
 	iocshRegister(&_fcomInitDesc,      _fcomInitFunc);
 	iocshRegister(&_fcomDumpStatsDesc, _fcomDumpStatsFunc);
+	iocshRegister(&_fcomDumpIDStatsDesc, _fcomDumpIDStatsFunc);
 	iocshRegister(&_fcomStrerrorDesc,  _fcomStrerrorFunc);
+	iocshRegister(&_fcomSetRxSchedDesc,    _fcomSetRxSchedFunc);
+	iocshRegister(&_fcomSetRxAffinityDesc, _fcomSetRxAffinityFunc);
+	iocshRegister(&_fcomSetProfilingDesc,  _fcomSetProfilingFunc);
+	iocshRegister(&_fcomDumpProfileDesc,   _fcomDumpProfileFunc);
+	iocshRegister(&_fcomSetLockStatsDesc,  _fcomSetLockStatsFunc);
+	iocshRegister(&_fcomShmPublishDesc,    _fcomShmPublishFunc);
+	iocshRegister(&_fcomRecordStartDesc,   _fcomRecordStartFunc);
+	iocshRegister(&_fcomRecordStopDesc,    _fcomRecordStopFunc);
+	iocshRegister(&_fcomReplayDesc,        _fcomReplayFunc);
 }
 
 epicsExportRegistrar(fcomRegistrar);
@@ -25,12 +25,10 @@ extern "C" {
 /* $Id: fcom_proto.x,v 1.1.1.1 2009/07/28 17:57:06 strauman Exp $ */
 #include <stdint.h>
 #include <fcom_api.h>
-/* For testing purposes we want a second minor version */
-#ifndef FCOM_PROTO_VERSION_12
-#define FCOM_PROTO_VERSION_12 FCOM_PROTO_CAT(FCOM_PROTO_MAJ_1,2)
-#endif
-/* No point in transporting 16-bit integers.
- * XDR demands that these be encoded in 4 bytes
+/* XDR demands that 16-bit integers be encoded in 4 bytes;
+ * FCOM packs two of them into a 32-bit word instead. There
+ * is no way to express this in XDR language -- the filters
+ * for the 16-bit arrays are hand-coded (prototst.c).
  */
 
 enum FcomVersion {
@@ -46,6 +44,10 @@ enum FcomType {
 	FCOM_T_UINT32 = FCOM_EL_UINT32,
 	FCOM_T_INT32 = FCOM_EL_INT32,
 	FCOM_T_INT8 = FCOM_EL_INT8,
+	FCOM_T_INT16 = FCOM_EL_INT16,
+	FCOM_T_UINT16 = FCOM_EL_UINT16,
+	FCOM_T_INT64 = FCOM_EL_INT64,
+	FCOM_T_UINT64 = FCOM_EL_UINT64,
 };
 typedef enum FcomType FcomType;
 
@@ -74,6 +76,29 @@ typedef struct {
 	double *FcomDouble_val;
 } FcomDouble;
 
+typedef struct {
+	u_int FcomInt64_len;
+	quad_t *FcomInt64_val;
+} FcomInt64;
+
+typedef struct {
+	u_int FcomUint64_len;
+	u_quad_t *FcomUint64_val;
+} FcomUint64;
+
+typedef struct {
+ u_int FcomInt16_len;
+ int16_t *FcomInt16_val;
+} FcomInt16;
+
+typedef struct {
+ u_int FcomUint16_len;
+ uint16_t *FcomUint16_val;
+} FcomUint16;
+
+extern bool_t xdr_FcomInt16 (XDR *, FcomInt16*);
+extern bool_t xdr_FcomUint16 (XDR *, FcomUint16*);
+
 struct FcomIt {
 	FcomType _type;
 	union {
@@ -82,6 +107,10 @@ struct FcomIt {
 		FcomFloat _fc_flt;
 		FcomDouble _fc_dbl;
 		FcomInt8 _fc_i08;
+		FcomInt16 _fc_i16;
+		FcomUint16 _fc_u16;
+		FcomInt64 _fc_i64;
+		FcomUint64 _fc_u64;
 	} FcomIt_u;
 };
 typedef struct FcomIt FcomIt;
@@ -127,6 +156,10 @@ typedef struct FcomMsg_XDR_ FcomMsg_XDR_;
 #define fcx_i08 data.FcomIt_u._fc_i08.FcomInt8_val
 #define fcx_flt data.FcomIt_u._fc_flt.FcomFloat_val
 #define fcx_dbl data.FcomIt_u._fc_dbl.FcomDouble_val
+#define fcx_i16 data.FcomIt_u._fc_i16.FcomInt16_val
+#define fcx_u16 data.FcomIt_u._fc_u16.FcomUint16_val
+#define fcx_i64 data.FcomIt_u._fc_i64.FcomInt64_val
+#define fcx_u64 data.FcomIt_u._fc_u64.FcomUint64_val
 
 /* the xdr functions */
 
@@ -138,6 +171,8 @@ extern  bool_t xdr_FcomInt32 (XDR *, FcomInt32*);
 extern  bool_t xdr_FcomInt8 (XDR *, FcomInt8*);
 extern  bool_t xdr_FcomFloat (XDR *, FcomFloat*);
 extern  bool_t xdr_FcomDouble (XDR *, FcomDouble*);
+extern  bool_t xdr_FcomInt64 (XDR *, FcomInt64*);
+extern  bool_t xdr_FcomUint64 (XDR *, FcomUint64*);
 extern  bool_t xdr_FcomIt (XDR *, FcomIt*);
 extern  bool_t xdr_FcomBlobV1_XDR_ (XDR *, FcomBlobV1_XDR_*);
 extern  bool_t xdr_FcomBlob_XDR_ (XDR *, FcomBlob_XDR_*);
@@ -151,6 +186,8 @@ extern bool_t xdr_FcomInt32 ();
 extern bool_t xdr_FcomInt8 ();
 extern bool_t xdr_FcomFloat ();
 extern bool_t xdr_FcomDouble ();
+extern bool_t xdr_FcomInt64 ();
+extern bool_t xdr_FcomUint64 ();
 extern bool_t xdr_FcomIt ();
 extern bool_t xdr_FcomBlobV1_XDR_ ();
 extern bool_t xdr_FcomBlob_XDR_ ();
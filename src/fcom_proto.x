@@ -14,18 +14,16 @@
 #ifdef RPC_HDR
 %#include <stdint.h>
 %#include <fcom_api.h>
-%/* For testing purposes we want a second minor version */
-%#ifndef FCOM_PROTO_VERSION_12
-%#define FCOM_PROTO_VERSION_12 FCOM_PROTO_CAT(FCOM_PROTO_MAJ_1,2)
-%#endif
 #endif
 
 #ifdef RPC_XDR
 %#define xdr_uint32_t xdr_u_int
 #endif
 
-%/* No point in transporting 16-bit integers.
-% * XDR demands that these be encoded in 4 bytes
+%/* XDR demands that 16-bit integers be encoded in 4 bytes;
+% * FCOM packs two of them into a 32-bit word instead. There
+% * is no way to express this in XDR language -- the filters
+% * for the 16-bit arrays are hand-coded (prototst.c).
 % */
 
 enum FcomVersion {
@@ -39,7 +37,11 @@ enum FcomType {
 	FCOM_T_DOUBLE = FCOM_EL_DOUBLE,
 	FCOM_T_UINT32 = FCOM_EL_UINT32,
 	FCOM_T_INT32  = FCOM_EL_INT32,
-	FCOM_T_INT8   = FCOM_EL_INT8
+	FCOM_T_INT8   = FCOM_EL_INT8,
+	FCOM_T_INT16  = FCOM_EL_INT16,
+	FCOM_T_UINT16 = FCOM_EL_UINT16,
+	FCOM_T_INT64  = FCOM_EL_INT64,
+	FCOM_T_UINT64 = FCOM_EL_UINT64
 };
 
 /* This is the definition of a data item/array;
@@ -69,6 +71,23 @@ typedef int32_t    FcomInt32 <>;
 typedef opaque     FcomInt8  <>;
 typedef float      FcomFloat <>;
 typedef double     FcomDouble<>;
+typedef hyper          FcomInt64 <>;
+typedef unsigned hyper FcomUint64<>;
+#if defined(RPC_HDR)
+%
+%typedef struct {
+%	u_int FcomInt16_len;
+%	int16_t *FcomInt16_val;
+%} FcomInt16;
+%
+%typedef struct {
+%	u_int FcomUint16_len;
+%	uint16_t *FcomUint16_val;
+%} FcomUint16;
+%
+%extern bool_t xdr_FcomInt16 (XDR *, FcomInt16*);
+%extern bool_t xdr_FcomUint16 (XDR *, FcomUint16*);
+#endif
 #elif defined(RPC_HDR)
 %
 %typedef struct FcomUint32 {
@@ -96,6 +115,26 @@ typedef double     FcomDouble<>;
 %    double   FcomDouble_val[];
 %} FcomDouble;
 % 
+%typedef struct FcomInt16 {
+%    uint32_t FcomInt16_len;
+%    int16_t  FcomInt16_val[];
+%} FcomInt16;
+% 
+%typedef struct FcomUint16 {
+%    uint32_t FcomUint16_len;
+%    uint16_t FcomUint16_val[];
+%} FcomUint16;
+% 
+%typedef struct FcomInt64 {
+%    uint32_t FcomInt64_len;
+%    int64_t  FcomInt64_val[];
+%} FcomInt64;
+% 
+%typedef struct FcomUint64 {
+%    uint32_t FcomUint64_len;
+%    uint64_t FcomUint64_val[];
+%} FcomUint64;
+% 
 #endif
 
 union FcomIt switch ( FcomType _type ) {
@@ -109,6 +148,14 @@ union FcomIt switch ( FcomType _type ) {
 		FcomDouble  _fc_dbl;
 	case FCOM_T_INT8:
 		FcomInt8    _fc_i08;
+	case FCOM_T_INT16:
+		FcomInt16   _fc_i16;
+	case FCOM_T_UINT16:
+		FcomUint16  _fc_u16;
+	case FCOM_T_INT64:
+		FcomInt64   _fc_i64;
+	case FCOM_T_UINT64:
+		FcomUint64  _fc_u64;
 };
 
 struct FcomBlobV1_XDR_ {
@@ -147,4 +194,8 @@ union FcomMsg_XDR_ switch (FcomVersion vers) {
 %#define fcx_i08   data.FcomIt_u._fc_i08.FcomInt8_val
 %#define fcx_flt   data.FcomIt_u._fc_flt.FcomFloat_val
 %#define fcx_dbl   data.FcomIt_u._fc_dbl.FcomDouble_val
+%#define fcx_i16   data.FcomIt_u._fc_i16.FcomInt16_val
+%#define fcx_u16   data.FcomIt_u._fc_u16.FcomUint16_val
+%#define fcx_i64   data.FcomIt_u._fc_i64.FcomInt64_val
+%#define fcx_u64   data.FcomIt_u._fc_u64.FcomUint64_val
 #endif
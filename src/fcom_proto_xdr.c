@@ -15,8 +15,10 @@
 #include "fcom_proto.h"
 /* $Id: fcom_proto.x,v 1.1.1.1 2009/07/28 17:57:06 strauman Exp $ */
 #define xdr_uint32_t xdr_u_int
-/* No point in transporting 16-bit integers.
- * XDR demands that these be encoded in 4 bytes
+/* XDR demands that 16-bit integers be encoded in 4 bytes;
+ * FCOM packs two of them into a 32-bit word instead. There
+ * is no way to express this in XDR language -- the filters
+ * for the 16-bit arrays are hand-coded (prototst.c).
  */
 
 bool_t
@@ -93,6 +95,28 @@ xdr_FcomDouble (XDR *xdrs, FcomDouble *objp)
 	return TRUE;
 }
 
+bool_t
+xdr_FcomInt64 (XDR *xdrs, FcomInt64 *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_array (xdrs, (char **)&objp->FcomInt64_val, (u_int *) &objp->FcomInt64_len, ~0,
+		sizeof (quad_t), (xdrproc_t) xdr_quad_t))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_FcomUint64 (XDR *xdrs, FcomUint64 *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_array (xdrs, (char **)&objp->FcomUint64_val, (u_int *) &objp->FcomUint64_len, ~0,
+		sizeof (u_quad_t), (xdrproc_t) xdr_u_quad_t))
+		 return FALSE;
+	return TRUE;
+}
+
 bool_t
 xdr_FcomIt (XDR *xdrs, FcomIt *objp)
 {
@@ -121,6 +145,22 @@ xdr_FcomIt (XDR *xdrs, FcomIt *objp)
 		 if (!xdr_FcomInt8 (xdrs, &objp->FcomIt_u._fc_i08))
 			 return FALSE;
 		break;
+	case FCOM_T_INT16:
+		 if (!xdr_FcomInt16 (xdrs, &objp->FcomIt_u._fc_i16))
+			 return FALSE;
+		break;
+	case FCOM_T_UINT16:
+		 if (!xdr_FcomUint16 (xdrs, &objp->FcomIt_u._fc_u16))
+			 return FALSE;
+		break;
+	case FCOM_T_INT64:
+		 if (!xdr_FcomInt64 (xdrs, &objp->FcomIt_u._fc_i64))
+			 return FALSE;
+		break;
+	case FCOM_T_UINT64:
+		 if (!xdr_FcomUint64 (xdrs, &objp->FcomIt_u._fc_u64))
+			 return FALSE;
+		break;
 	default:
 		return FALSE;
 	}
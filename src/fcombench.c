@@ -0,0 +1,497 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+
+/* Micro-benchmarks of the FCOM primitives on the hot path:
+ *
+ *   enc     fcom_xdr_enc_blob()       per element type and length
+ *   dec     fcom_xdr_dec_blob()       per element type and length
+ *   grp     fcom_msg_init()/fcom_msg_append_blob()/fcom_msg_end()
+ *   cgrp    same, compact encoding
+ *   find    shtblFind() of present keys at various load factors
+ *   miss    shtblFind() of absent keys
+ *   rpl     shtblRpl() of present keys
+ *   buf     fc_getb()/fc_relb() (fcom_cycle_bufs()); needs an RX context
+ *
+ * Every measurement is repeated with an increasing number of
+ * iterations until it takes at least the minimal time (-t).
+ *
+ * With '-c' one CSV line is printed per measurement:
+ *
+ *   bench,type,nelm,param,ns_per_op,gb_per_s
+ *
+ * 'param' is the number of blobs per message (grp, cgrp), the
+ * load factor in percent (find, miss, rpl) or the number of
+ * buffers held at once (buf). 'ns_per_op' is per blob, lookup or
+ * buffer; 'gb_per_s' is payload throughput (empty if meaningless).
+ *
+ * See also 'fcomctst' (specialized fixed-shape codecs).
+ */
+
+#define MAIN_NAME fcombench
+#include "mainwrap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+#include <fcomP.h>
+#include <xdr_dec.h>
+#include <shtbl.h>
+
+/* Large enough for a blob of 4096 doubles; fcom_msg_init()
+ * takes a 16-bit size.
+ */
+#define XMEMSZ   65532
+#define NELM_MAX 4096
+#define GRP_MAX  32
+
+static unsigned     min_ms = 200;
+static int          csv    = 0;
+static const char  *filter = 0;
+
+static uint32_t     xmem[XMEMSZ/sizeof(uint32_t)];
+static uint64_t     dmem[(XMEMSZ + sizeof(FcomBlob) + FC_ALIGNMENT)/sizeof(uint64_t)];
+static uint64_t     data[NELM_MAX];
+
+static volatile uintptr_t sink;
+
+static const struct {
+	const char *nm;
+	uint8_t     type;
+} types[] = {
+	{ "float",  FCOM_EL_FLOAT  },
+	{ "double", FCOM_EL_DOUBLE },
+	{ "uint32", FCOM_EL_UINT32 },
+	{ "int32",  FCOM_EL_INT32  },
+	{ "int8",   FCOM_EL_INT8   },
+	{ "int16",  FCOM_EL_INT16  },
+	{ "uint16", FCOM_EL_UINT16 },
+	{ "int64",  FCOM_EL_INT64  },
+	{ "uint64", FCOM_EL_UINT64 },
+};
+
+static const unsigned lens[]  = { 1, 16, 256, NELM_MAX };
+static const unsigned grps[]  = { 1, 8, GRP_MAX };
+static const unsigned loads[] = { 25, 50, 75, 90 };
+static const unsigned bufsz[] = { 16, 256, 1024 };
+static const unsigned depth[] = { 1, 16 };
+
+#define NumberOf(a) (sizeof(a)/sizeof((a)[0]))
+
+typedef int (*BenchFn)(void *arg, unsigned long n);
+
+/* Run 'fn' with an increasing number of iterations until it
+ * takes at least 'min_ms'.
+ *
+ * RETURNS: ns per iteration or a negative value if 'fn' failed.
+ */
+static double
+measure(BenchFn fn, void *arg)
+{
+unsigned long n   = 1;
+uint64_t      tgt = (uint64_t)min_ms * 1000000ULL;
+uint64_t      t;
+
+	for (;;) {
+		t = fcom_now_ns();
+		if ( fn(arg, n) )
+			return -1.;
+		t = fcom_now_ns() - t;
+		if ( t >= tgt )
+			return (double)t / (double)n;
+		/* extrapolate once the run is long enough to be timed */
+		n = t > tgt/16 ? (unsigned long)((double)n * tgt / t * 1.1) + 1 : n * 16;
+	}
+}
+
+static void
+header(void)
+{
+	if ( csv )
+		printf("bench,type,nelm,param,ns_per_op,gb_per_s\n");
+	else
+		printf("%-6s %-7s %6s %6s %12s %10s\n", "bench", "type", "nelm", "param", "ns/op", "GB/s");
+}
+
+/* Print result; 'bytes' is the payload per operation */
+static void
+report(const char *bench, const char *type, unsigned nelm, unsigned param, double ns, double bytes)
+{
+	if ( ns < 0. ) {
+		fprintf(stderr,"%s %s %u %u: FAILED\n", bench, type, nelm, param);
+		return;
+	}
+	if ( csv ) {
+		printf("%s,%s,%u,%u,%.2f,", bench, type, nelm, param, ns);
+		if ( bytes > 0. )
+			printf("%.4f", bytes / ns);
+		printf("\n");
+	} else {
+		printf("%-6s %-7s %6u %6u %12.2f ", bench, type, nelm, param, ns);
+		if ( bytes > 0. )
+			printf("%10.4f", bytes / ns);
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+/* Is 'bench' in the comma-separated list given with '-b'? */
+static int
+selected(const char *bench)
+{
+const char *p;
+size_t      l = strlen(bench);
+
+	if ( ! filter )
+		return 1;
+
+	for ( p = filter; (p = strstr(p, bench)); p += l ) {
+		if ( (p == filter || ',' == p[-1]) && (! p[l] || ',' == p[l]) )
+			return 1;
+	}
+	return 0;
+}
+
+static void
+mkblob(FcomBlobRef pb, uint8_t type, unsigned nelm, FcomID idnt)
+{
+	memset(pb, 0, sizeof(*pb));
+	pb->fc_vers = FCOM_PROTO_VERSION;
+	pb->fc_idnt = idnt;
+	pb->fc_type = type;
+	pb->fc_nelm = nelm;
+	pb->fc_raw  = data;
+}
+
+/* CODEC *************************************************************/
+
+static int
+b_enc(void *arg, unsigned long n)
+{
+FcomBlobRef pb = arg;
+uint32_t    gid;
+
+	while ( n-- > 0 ) {
+		if ( fcom_xdr_enc_blob(xmem, pb, sizeof(xmem), &gid) < 0 )
+			return -1;
+	}
+	return 0;
+}
+
+static int
+b_dec(void *arg, unsigned long n)
+{
+	while ( n-- > 0 ) {
+		if ( fcom_xdr_dec_blob((FcomBlobRef)dmem, sizeof(dmem), xmem) < 0 )
+			return -1;
+	}
+	return 0;
+}
+
+static void
+bench_codec(void)
+{
+unsigned i, j;
+FcomBlob b;
+double   ns;
+uint32_t gid;
+
+	for ( i=0; i<NumberOf(types); i++ ) {
+		for ( j=0; j<NumberOf(lens); j++ ) {
+			mkblob(&b, types[i].type, lens[j], FCOM_MAKE_ID(FCOM_GID_MIN, FCOM_SID_MIN));
+			if ( selected("enc") ) {
+				ns = measure(b_enc, &b);
+				report("enc", types[i].nm, lens[j], 0, ns, (double)FCOM_EL_SIZE(b.fc_type) * lens[j]);
+			}
+			if ( selected("dec") ) {
+				if ( fcom_xdr_enc_blob(xmem, &b, sizeof(xmem), &gid) < 0 )
+					ns = -1.;
+				else
+					ns = measure(b_dec, 0);
+				report("dec", types[i].nm, lens[j], 0, ns, (double)FCOM_EL_SIZE(b.fc_type) * lens[j]);
+			}
+		}
+	}
+}
+
+/* GROUPS ************************************************************/
+
+typedef struct GrpArg {
+	FcomBlob  b[GRP_MAX];
+	unsigned  nblobs;
+	int       compact;
+} GrpArg;
+
+static int
+b_grp(void *arg, unsigned long n)
+{
+GrpArg   *g = arg;
+unsigned i;
+uint32_t gid, nblobs;
+
+	while ( n-- > 0 ) {
+		if ( (g->compact ? fcom_msg_init_compact(xmem, sizeof(xmem), FCOM_GID_ANY)
+		                 : fcom_msg_init(xmem, sizeof(xmem), FCOM_GID_ANY)) < 0 )
+			return -1;
+		for ( i=0; i<g->nblobs; i++ ) {
+			if ( fcom_msg_append_blob(xmem, &g->b[i]) < 0 )
+				return -1;
+		}
+		fcom_msg_end(xmem, &gid, &nblobs);
+	}
+	return 0;
+}
+
+static void
+bench_grp(void)
+{
+GrpArg   g;
+unsigned i, j;
+double   ns;
+
+	for ( i=0; i<GRP_MAX; i++ )
+		mkblob(&g.b[i], FCOM_EL_FLOAT, 4, FCOM_MAKE_ID(FCOM_GID_MIN, FCOM_SID_MIN + i));
+
+	for ( g.compact = 0; g.compact < 2; g.compact++ ) {
+		if ( ! selected(g.compact ? "cgrp" : "grp") )
+			continue;
+		for ( j=0; j<NumberOf(grps); j++ ) {
+			g.nblobs = grps[j];
+			ns = measure(b_grp, &g);
+			report(g.compact ? "cgrp" : "grp", "float", 4, g.nblobs, ns < 0. ? ns : ns/g.nblobs, 4*sizeof(float));
+		}
+	}
+}
+
+/* HASH TABLE ********************************************************/
+
+typedef struct TblEnt {
+	SHTblKey  key;
+} TblEnt;
+
+typedef struct TblArg {
+	SHTbl     t;
+	TblEnt   *ents;
+	unsigned  n;
+	SHTblKey *miss;
+} TblArg;
+
+#define TBL_SIZE 4096 /* largest table shtbl supports */
+
+/* IDs spread over a few GIDs like in a real system */
+static SHTblKey
+tblkey(unsigned i)
+{
+	return FCOM_MAKE_ID(FCOM_GID_MIN + (i & 15), FCOM_SID_MIN + (i >> 4));
+}
+
+static int
+b_find(void *arg, unsigned long n)
+{
+TblArg   *a = arg;
+unsigned i  = 0;
+
+	while ( n-- > 0 ) {
+		if ( ! shtblFind(a->t, a->ents[i].key) )
+			return -1;
+		if ( ++i == a->n )
+			i = 0;
+	}
+	return 0;
+}
+
+static int
+b_miss(void *arg, unsigned long n)
+{
+TblArg   *a = arg;
+unsigned i  = 0;
+
+	while ( n-- > 0 ) {
+		sink += (uintptr_t)shtblFind(a->t, a->miss[i]);
+		if ( ++i == a->n )
+			i = 0;
+	}
+	return 0;
+}
+
+static int
+b_rpl(void *arg, unsigned long n)
+{
+TblArg     *a = arg;
+unsigned   i  = 0;
+SHTblEntry e;
+
+	while ( n-- > 0 ) {
+		e = &a->ents[i];
+		if ( shtblRpl(a->t, &e, SHTBL_ADD_FAIL) )
+			return -1;
+		if ( ++i == a->n )
+			i = 0;
+	}
+	return 0;
+}
+
+static void
+bench_tbl(void)
+{
+TblArg   a;
+unsigned i, j;
+
+	a.ents = malloc( TBL_SIZE * sizeof(*a.ents) );
+	a.miss = malloc( TBL_SIZE * sizeof(*a.miss) );
+	if ( ! a.ents || ! a.miss ) {
+		fprintf(stderr,"No memory\n");
+		goto bail;
+	}
+
+	for ( j=0; j<NumberOf(loads); j++ ) {
+		if ( ! (a.t = shtblCreate(TBL_SIZE, 0)) ) {
+			fprintf(stderr,"shtblCreate failed\n");
+			goto bail;
+		}
+		a.n = TBL_SIZE * loads[j] / 100;
+		for ( i=0; i<a.n; i++ ) {
+			a.ents[i].key = tblkey(i);
+			a.miss[i]     = tblkey(i + a.n);
+			if ( shtblAdd(a.t, &a.ents[i]) ) {
+				fprintf(stderr,"shtblAdd failed\n");
+				shtblDestroy(a.t, 0, 0);
+				goto bail;
+			}
+		}
+		if ( selected("find") )
+			report("find", "-", 0, loads[j], measure(b_find, &a), 0.);
+		if ( selected("miss") )
+			report("miss", "-", 0, loads[j], measure(b_miss, &a), 0.);
+		if ( selected("rpl") )
+			report("rpl",  "-", 0, loads[j], measure(b_rpl,  &a), 0.);
+		shtblDestroy(a.t, 0, 0);
+	}
+
+bail:
+	free(a.ents);
+	free(a.miss);
+}
+
+/* BUFFERS ***********************************************************/
+
+typedef struct BufArg {
+	FcomCtx   ctx;
+	uint32_t  sz;
+	unsigned  depth;
+} BufArg;
+
+static int
+b_buf(void *arg, unsigned long n)
+{
+BufArg *a = arg;
+
+	return fcom_cycle_bufs(a->ctx, a->sz, a->depth, n);
+}
+
+static void
+bench_buf(const char *prefix)
+{
+BufArg   a;
+unsigned i, j;
+int      st;
+double   ns;
+
+	fcom_silent_mode = 1;
+	if ( (st = fcomCreateContext(prefix, 512, &a.ctx)) ) {
+		fprintf(stderr,"Skipping 'buf': unable to create RX context: %s\n", fcomStrerror(st));
+		return;
+	}
+
+	for ( i=0; i<NumberOf(bufsz); i++ ) {
+		for ( j=0; j<NumberOf(depth); j++ ) {
+			a.sz    = bufsz[i];
+			a.depth = depth[j];
+			ns      = measure(b_buf, &a);
+			report("buf", "-", a.sz, a.depth, ns < 0. ? ns : ns/a.depth, 0.);
+		}
+	}
+
+	fcomDestroyContext(a.ctx);
+}
+
+static void
+usage(char *nm)
+{
+	fprintf(stderr,"Usage: %s [-hc] [-t <min_ms>] [-b <benchmarks>] [-p <fcom_mc_prefix>]\n", nm);
+	fprintf(stderr,"  Options:\n");
+	fprintf(stderr,"       -h print this message\n");
+	fprintf(stderr,"       -c CSV output (machine-readable)\n");
+	fprintf(stderr,"       -t <min_ms> min. duration of each measurement; default=%u\n", min_ms);
+	fprintf(stderr,"       -b <benchmarks> run only these, e.g., 'enc,dec'; one of\n");
+	fprintf(stderr,"          enc, dec, grp, cgrp, find, miss, rpl, buf (default: all)\n");
+	fprintf(stderr,"       -p <fcom_mc_prefix> for the RX context used by 'buf'\n");
+	fprintf(stderr,"  Environment:\n");
+	fprintf(stderr,"       FCOM_MC_PREFIX defines multicast prefix (overridden by -p)\n");
+}
+
+int
+main(int argc, char **argv)
+{
+int   ch;
+char *prefix = 0;
+int   i;
+GETOPTSTAT_DECL;
+
+	while ( (ch = getopt(argc, argv, "b:chp:t:")) >= 0 ) {
+		switch ( ch ) {
+			case 'h':
+				usage(argv[0]);
+			return 0;
+
+			default:
+				usage(argv[0]);
+			return 1;
+
+			case 'b':
+				filter = optarg;
+			break;
+
+			case 'c':
+				csv = 1;
+			break;
+
+			case 'p':
+				prefix = optarg;
+			break;
+
+			case 't':
+				if ( 1 != sscanf(optarg, "%u", &min_ms) || 0 == min_ms ) {
+					fprintf(stderr,"Invalid arg to -t: must be a positive number\n");
+					return 1;
+				}
+			break;
+		}
+	}
+
+	if ( !prefix && !(prefix = getenv("FCOM_MC_PREFIX")) )
+		prefix = "239.255.0.0";
+
+	for ( i=0; i<NumberOf(data); i++ )
+		data[i] = 0x0123456789abcdefULL * (i + 1);
+
+	header();
+
+	bench_codec();
+	bench_grp();
+	bench_tbl();
+	if ( selected("buf") )
+		bench_buf(prefix);
+
+	return 0;
+}
@@ -0,0 +1,188 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'fcom', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+/* Benchmark for the specialized (fixed shape) XDR decoders
+ *
+ * Encodes a group of blobs of a given shape into a message
+ * (like fcomPutGroup() does) and decodes it (like the receiver
+ * does for subscribed IDs), once with the generic decoder and
+ * once with the specialized ones. The decoded data are verified
+ * against the original.
+ *
+ * Prints, for every shape, the time per blob (in ns) spent
+ * decoding with either decoder (the best of NREPS alternating
+ * runs, to suppress scheduling noise).
+ */
+
+#define MAIN_NAME fcomctst
+#include "mainwrap.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+#include <fcomP.h>
+
+#include <xdr_dec.h>
+#include <xdr_fixed.h>
+
+/* blobs per message */
+#define NBLOBS 16
+
+/* runs of either codec; the fastest counts */
+#define NREPS  5
+
+#define MSGSZ  ((FCOM_XDR_BLOB_HDRSZ + 2*FCOM_XDR_FIXED_MAX) * NBLOBS * 4 + 64)
+
+typedef struct Shape {
+	const char *nm;
+	uint8_t     type;
+	uint16_t    nelm;
+} Shape;
+
+static Shape shapes[] = {
+	{ "uint32", FCOM_EL_UINT32,  1 },
+	{ "float",  FCOM_EL_FLOAT,   2 },
+	{ "float",  FCOM_EL_FLOAT,   4 },
+	{ "double", FCOM_EL_DOUBLE,  1 },
+	{ "double", FCOM_EL_DOUBLE,  4 },
+	{ "int32",  FCOM_EL_INT32,   8 },
+	{ "int16",  FCOM_EL_INT16,   5 },
+	{ "int8",   FCOM_EL_INT8,    6 },
+	{ "int64",  FCOM_EL_INT64,   2 },
+	{ "float",  FCOM_EL_FLOAT,  16 },
+};
+
+/* room for the largest shape */
+typedef union Store {
+	FcomBlob blob;
+	uint8_t  raw[sizeof(FcomBlob) + 16 + FCOM_XDR_FIXED_MAX * sizeof(uint64_t)];
+} Store;
+
+/* RETURNS: time per blob (ns) or a negative value on failure */
+static double
+run(Shape *s, unsigned niter, uint32_t *xdr, Store *out)
+{
+static Store in[NBLOBS];
+unsigned     it, i, nblobs;
+uint32_t     gid;
+int          sz, hsz;
+uint64_t     t0, t1;
+uint8_t     *d;
+
+	/* same data for either codec */
+	srand( 1 );
+	for ( i=0; i<NBLOBS; i++ ) {
+		memset( &in[i], 0, sizeof(in[i]) );
+		in[i].blob.fc_vers = FCOM_PROTO_VERSION;
+		in[i].blob.fc_idnt = FCOM_MAKE_ID(FCOM_GID_MIN, FCOM_SID_MIN + i);
+		in[i].blob.fc_type = s->type;
+		in[i].blob.fc_nelm = s->nelm;
+		in[i].blob.fc_raw  = (void*)FC_ALIGN(&in[i].blob + 1);
+		for ( d = in[i].blob.fc_raw, sz=0; sz < s->nelm * FCOM_EL_SIZE(s->type); sz++ )
+			d[sz] = rand();
+	}
+
+	fcom_msg_init(xdr, MSGSZ, FCOM_GID_MIN);
+	for ( i=0; i<NBLOBS; i++ ) {
+		if ( (sz = fcom_msg_append_blob(xdr, &in[i].blob)) < 0 ) {
+			fprintf(stderr,"Encoding failed: %s\n", fcomStrerror(sz));
+			return -1.;
+		}
+	}
+	fcom_msg_end(xdr, &gid, &nblobs);
+
+	t0 = fcom_now_us();
+	for ( it=0; it<niter; it++ ) {
+		hsz = fcom_xdr_dec_msghdr(xdr, (int*)&nblobs);
+		for ( i=0, sz=hsz; i<nblobs; i++ ) {
+			hsz = fcom_xdr_dec_blob(&out[i].blob, sizeof(out[i]), xdr + sz);
+			if ( hsz < 0 ) {
+				fprintf(stderr,"Decoding failed: %s\n", fcomStrerror(hsz));
+				return -1.;
+			}
+			sz += hsz;
+		}
+	}
+	t1 = fcom_now_us();
+
+	for ( i=0; i<NBLOBS; i++ ) {
+		if ( memcmp( in[i].blob.fc_raw, out[i].blob.fc_raw, s->nelm * FCOM_EL_SIZE(s->type) ) ) {
+			fprintf(stderr,"Data mismatch (blob %u)\n", i);
+			return -1.;
+		}
+	}
+	return 1000.0 * (double)(t1 - t0) / (double)niter / NBLOBS;
+}
+
+int
+main(int argc, char **argv)
+{
+unsigned    niter = 100000;
+unsigned    i, k;
+int         opt;
+int         rval = 1;
+uint32_t   *xdr     = malloc(MSGSZ);
+Store      *out     = malloc(sizeof(*out) * NBLOBS);
+double      gen = 0., fix = 0., ns;
+GETOPTSTAT_DECL;
+
+	while ( (opt = getopt(argc, argv, "hn:")) > 0 ) {
+		switch ( opt ) {
+			case 'n':
+				if ( 1 != sscanf(optarg, "%u", &niter) || 0 == niter ) {
+					fprintf(stderr,"Positive number expected as '-n' argument\n");
+					goto bail;
+				}
+			break;
+
+			case 'h':
+			default:
+				fprintf(stderr,"Usage: %s [-n <iterations>]\n", argv[0]);
+				rval = 'h' == opt ? 0 : 1;
+			goto bail;
+		}
+	}
+
+	if ( ! xdr || ! out ) {
+		fprintf(stderr,"No memory\n");
+		goto bail;
+	}
+
+	printf("%-6s %5s  %12s %12s %8s\n",
+		"type", "nelm", "dec generic", "dec fixed", "speedup");
+	for ( i=0; i<sizeof(shapes)/sizeof(shapes[0]); i++ ) {
+		for ( k=0; k<NREPS; k++ ) {
+			fcom_xdr_fixed_enable = 0;
+			if ( (ns = run( &shapes[i], niter, xdr, out )) < 0. )
+				goto bail;
+			if ( 0 == k || ns < gen )
+				gen = ns;
+			fcom_xdr_fixed_enable = 1;
+			if ( (ns = run( &shapes[i], niter, xdr, out )) < 0. )
+				goto bail;
+			if ( 0 == k || ns < fix )
+				fix = ns;
+		}
+		printf("%-6s %5u  %9.1f ns %9.1f ns %7.2fx\n",
+			shapes[i].nm, shapes[i].nelm,
+			gen, fix, fix > 0. ? gen / fix : 0.);
+	}
+
+	rval = 0;
+
+bail:
+	fcom_xdr_fixed_enable = 1;
+	free(xdr);
+	free(out);
+	return rval;
+}
@@ -0,0 +1,517 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+/* Self-test of the receive path
+ *
+ * A sender and a receiver context are connected by the
+ * in-process loopback transport ("loop:"). Besides regular
+ * puts a third context injects hand-made datagrams (e.g.,
+ * malformed or overlapping fragments, messages with gaps in
+ * their sequence numbers) which are then processed by the
+ * receiver's RX thread (fcom_receive()). The results are
+ * checked by reading the blobs back and by the RX statistics.
+ *
+ * Prints one line per test and exits with a nonzero status
+ * if any of them failed.
+ */
+
+#define MAIN_NAME fcomltst
+#include "mainwrap.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+#include <fcomP.h>
+
+#include <xdr_dec.h>
+
+#define GROUP   "loop:239.255.0.0:4590"
+
+#define GID     15
+#define ID_DATA FCOM_MAKE_ID(GID, 100)
+#define ID_SYNC FCOM_MAKE_ID(GID, 101)
+#define ID_SPRS FCOM_MAKE_ID(GID, 102)
+
+/* elements of the (fragmented) test blob */
+#define NELM    1000
+
+/* payload of the fragments we cut (32-bit words) */
+#define FLEN    300
+
+/* elements of the blob receiving sparse updates and
+ * the range these update
+ */
+#define SPRS_NELM  100
+#define SPRS_START 10
+#define SPRS_COUNT 5
+
+/* recording made by the record/replay test */
+#define REC_PATH   "/tmp/fcomltst.rec"
+
+static FcomCtx  rctx, tctx, xctx;
+static uint32_t sync_cnt;
+
+/* encoded test message */
+static uint32_t *msg;
+static uint32_t msg_nints;
+
+/* Wait until the RX thread has processed everything sent
+ * so far: send a blob and wait for it to show up (the
+ * loopback transport preserves the order).
+ */
+static int
+rx_sync(void)
+{
+FcomBlob    b;
+FcomBlobRef p;
+uint32_t    v = ++sync_cnt;
+int         i, st;
+
+	memset( &b, 0, sizeof(b) );
+	b.fc_vers = FCOM_PROTO_VERSION;
+	b.fc_idnt = ID_SYNC;
+	b.fc_type = FCOM_EL_UINT32;
+	b.fc_nelm = 1;
+	b.fc_u32  = &v;
+
+	if ( (st = fcomPutBlobCtx( tctx, &b )) ) {
+		fprintf(stderr,"Sending sync. blob failed: %s\n", fcomStrerror(st));
+		return st;
+	}
+
+	for ( i=0; i<1000; i++ ) {
+		if ( 0 == fcomGetBlobCtx( rctx, ID_SYNC, &p, 0 ) ) {
+			st = p->fc_u32[0] == v;
+			fcomReleaseBlob( &p );
+			if ( st )
+				return 0;
+		}
+		usleep(1000);
+	}
+	fprintf(stderr,"Receiver did not catch up\n");
+	return FCOM_ERR_TIMEDOUT;
+}
+
+/* Send a raw datagram to the test GID */
+static int
+xmit(uint32_t *buf, uint32_t nints)
+{
+int st;
+
+	st = xctx->xp->send_to( xctx->xsd, buf, nints * sizeof(*buf), xctx->g_prefix | htonl(GID), xctx->port );
+	return st < 0 ? st : 0;
+}
+
+/* Send a fragment with (possibly bogus) header values;
+ * the payload is taken from the test message (if the
+ * header refers to it).
+ */
+static int
+xmit_frag(uint32_t xid, uint32_t nints, uint32_t off, uint32_t len, unsigned idx, unsigned nfrags)
+{
+uint32_t    buf[UDPCOMM_PKTSZ/sizeof(uint32_t)];
+FcomFragHdr fh;
+uint32_t    max = sizeof(buf)/sizeof(buf[0]) - FCOM_XDR_FRAG_HDRSZ;
+
+	fh.xid    = xid;
+	fh.nints  = nints;
+	fh.off    = off;
+	fh.len    = len;
+	fh.idx    = idx;
+	fh.nfrags = nfrags;
+	fcom_xdr_enc_fraghdr( buf, &fh );
+	/* what doesn't fit is simply not sent */
+	if ( len > max )
+		len = max;
+	memset( buf + FCOM_XDR_FRAG_HDRSZ, 0, len * sizeof(*buf) );
+	if ( off < msg_nints )
+		memcpy( buf + FCOM_XDR_FRAG_HDRSZ, msg + off, (len < msg_nints - off ? len : msg_nints - off) * sizeof(*buf) );
+	return xmit( buf, FCOM_XDR_FRAG_HDRSZ + len );
+}
+
+/* Set up the test blob with values 'v + i' */
+static void
+mkblob(FcomBlobRef pb, uint32_t *data, uint32_t v)
+{
+int i;
+
+	for ( i=0; i<NELM; i++ )
+		data[i] = v + i;
+
+	memset( pb, 0, sizeof(*pb) );
+	pb->fc_vers = FCOM_PROTO_VERSION;
+	pb->fc_idnt = ID_DATA;
+	pb->fc_type = FCOM_EL_UINT32;
+	pb->fc_nelm = NELM;
+	pb->fc_u32  = data;
+}
+
+/* Encode a message holding the test blob into 'msg' */
+static uint32_t
+mkmsg(uint32_t *data, uint32_t v)
+{
+FcomBlob b;
+uint32_t gid, nblobs;
+
+	mkblob( &b, data, v );
+	if ( fcom_msg_init( msg, FCOM_MSG_SIZE_MAX, FCOM_GID_ANY ) < 0 || fcom_msg_append_blob( msg, &b ) < 0 )
+		return 0;
+	return fcom_msg_end( msg, &gid, &nblobs );
+}
+
+/* Check the test blob; returns nonzero if it doesn't hold 'v + i' */
+static int
+chkdata(uint32_t v)
+{
+FcomBlobRef p;
+int         i, st;
+
+	if ( (st = fcomGetBlobCtx( rctx, ID_DATA, &p, 0 )) ) {
+		fprintf(stderr,"No test blob: %s\n", fcomStrerror(st));
+		return st;
+	}
+	for ( i=0, st=0; i<p->fc_nelm && ! st; i++ ) {
+		if ( p->fc_u32[i] != v + i ) {
+			fprintf(stderr,"Element %u is %"PRIu32" (expected %"PRIu32")\n", i, p->fc_u32[i], v + i);
+			st = -1;
+		}
+	}
+	if ( ! st && NELM != p->fc_nelm ) {
+		fprintf(stderr,"Test blob has %u elements\n", p->fc_nelm);
+		st = -1;
+	}
+	fcomReleaseBlob( &p );
+	return st;
+}
+
+/* Send the sparse test blob (values 'v + i') with sequence
+ * number 'seq'; either complete or as a sparse update.
+ */
+static int
+xmit_sprs(uint32_t seq, uint32_t v, int sparse)
+{
+uint32_t  buf[UDPCOMM_PKTSZ/sizeof(uint32_t)];
+uint32_t  data[SPRS_NELM];
+FcomBlob  b;
+FcomRange r;
+uint32_t  gid;
+int       i, nints;
+
+	for ( i=0; i<SPRS_NELM; i++ )
+		data[i] = v + i;
+
+	memset( &b, 0, sizeof(b) );
+	b.fc_vers = FCOM_PROTO_VERSION;
+	b.fc_idnt = ID_SPRS;
+	b.fc_type = FCOM_EL_UINT32;
+	b.fc_nelm = SPRS_NELM;
+	b.fc_u32  = data;
+
+	r.start   = SPRS_START;
+	r.count   = SPRS_COUNT;
+
+	if ( sparse )
+		nints = fcom_msg_one_sparse( buf, sizeof(buf), &b, &r, 1, &gid );
+	else
+		nints = fcom_msg_one_blob( buf, sizeof(buf), &b, &gid );
+
+	if ( nints < 0 || fcom_msg_set_seq( buf, nints, seq ) ) {
+		fprintf(stderr,"Encoding sparse test message failed\n");
+		return -1;
+	}
+	return xmit( buf, nints );
+}
+
+/* Check the sparse test blob; the updated range must hold
+ * 'v_rng + i', the other elements 'v + i'.
+ */
+static int
+chksprs(uint32_t v, uint32_t v_rng)
+{
+FcomBlobRef p;
+uint32_t    e;
+int         i, st;
+
+	if ( (st = fcomGetBlobCtx( rctx, ID_SPRS, &p, 0 )) ) {
+		fprintf(stderr,"No sparse test blob: %s\n", fcomStrerror(st));
+		return st;
+	}
+	for ( i=0, st=0; i<p->fc_nelm && ! st; i++ ) {
+		e = ( i >= SPRS_START && i < SPRS_START + SPRS_COUNT ? v_rng : v ) + i;
+		if ( p->fc_u32[i] != e ) {
+			fprintf(stderr,"Element %u is %"PRIu32" (expected %"PRIu32")\n", i, p->fc_u32[i], e);
+			st = -1;
+		}
+	}
+	fcomReleaseBlob( &p );
+	return st;
+}
+
+static int
+rxstats(FcomRxStats *p_st)
+{
+	return fcomGetStatsSnapshotCtx( rctx, p_st, 0 );
+}
+
+/* Fragments which are malformed or don't fit together
+ * must be rejected without touching anything; the valid
+ * ones must still be reassembled correctly (out of order,
+ * with duplicates).
+ */
+static int
+tst_reasm(void)
+{
+uint32_t    *data = malloc( NELM * sizeof(*data) );
+uint32_t    nints, xid = 0x1000;
+FcomRxStats st0, st1;
+FcomBlob    b;
+int         rval  = -1;
+
+	msg = malloc( FCOM_MSG_SIZE_MAX );
+
+	if ( ! msg || ! data ) {
+		fprintf(stderr,"No memory\n");
+		goto bail;
+	}
+
+	if ( ! (msg_nints = nints = mkmsg( data, 1 )) ) {
+		fprintf(stderr,"Encoding test message failed\n");
+		goto bail;
+	}
+
+	/* the good message below is cut into 4 fragments */
+	if ( (nints + FLEN - 1)/FLEN != 4 ) {
+		fprintf(stderr,"Unexpected test message size\n");
+		goto bail;
+	}
+
+	if ( rx_sync() || rxstats( &st0 ) )
+		goto bail;
+
+	/* a huge message (the buffer size must not wrap) */
+	xmit_frag( ++xid, 0x40000010, 0, 0x40000010, 0, 1 );
+	/* a single fragment with an offset */
+	xmit_frag( ++xid, 0x40000010, 0x3ffffff0, 0x20, 0, 1 );
+	/* fragment longer than a datagram */
+	xmit_frag( ++xid, 4*FLEN, 0, 2*FLEN, 0, 2 );
+	/* # of fragments doesn't match the length */
+	xmit_frag( ++xid, nints, 0, FLEN, 0, (nints + FLEN - 1)/FLEN + 1 );
+	/* offset doesn't match the index */
+	xmit_frag( ++xid, nints, FLEN/2, FLEN, 1, (nints + FLEN - 1)/FLEN );
+	/* zero length */
+	xmit_frag( ++xid, nints, 0, 0, 0, 1 );
+
+	/* a good message, last fragment first, then interleaved with
+	 * duplicates and fragments that overlap (a consistent header
+	 * but cut at a different length).
+	 */
+	++xid;
+	xmit_frag( xid, nints, 3*FLEN, nints - 3*FLEN, 3, 4 );
+	xmit_frag( xid, nints, 0, FLEN, 0, 4 );
+	xmit_frag( xid, nints, 0, FLEN, 0, 4 );
+	xmit_frag( xid, nints, FLEN + 10, FLEN + 10, 1, 4 );
+	xmit_frag( xid, nints, FLEN, FLEN, 1, 4 );
+	xmit_frag( xid, nints, 2*FLEN, FLEN, 2, 4 );
+
+	if ( rx_sync() || rxstats( &st1 ) )
+		goto bail;
+
+	if ( 1 != st1.n_reasm - st0.n_reasm ) {
+		fprintf(stderr,"%"PRIu64" messages reassembled (expected 1)\n", st1.n_reasm - st0.n_reasm);
+		goto bail;
+	}
+	/* 6 bad headers, 1 inconsistent fragment */
+	if ( 7 != st1.reasm_err - st0.reasm_err ) {
+		fprintf(stderr,"%"PRIu64" fragments rejected (expected 7)\n", st1.reasm_err - st0.reasm_err);
+		goto bail;
+	}
+	if ( chkdata( 1 ) )
+		goto bail;
+
+	/* a regular (fragmented) put still gets through */
+	mkblob( &b, data, 7 );
+	if ( fcomPutBlobCtx( tctx, &b ) || rx_sync() || chkdata( 7 ) )
+		goto bail;
+
+	rval = 0;
+
+bail:
+	free( msg );
+	msg       = 0;
+	msg_nints = 0;
+	free( data );
+	return rval;
+}
+
+/* Sparse updates are applied to the complete blob as long
+ * as no message was lost; after a gap they are dropped
+ * until the next complete blob arrives.
+ */
+static int
+tst_sparse(void)
+{
+FcomRxStats st0, st1;
+
+	if ( rx_sync() || rxstats( &st0 ) )
+		return -1;
+
+	if (   xmit_sprs( 1, 100, 0 ) || rx_sync() || chksprs( 100, 100 )
+	    || xmit_sprs( 2, 200, 1 ) || rx_sync() || chksprs( 100, 200 ) )
+		return -1;
+
+	/* message #3 is lost */
+	if (   xmit_sprs( 4, 300, 1 ) || rx_sync() || chksprs( 100, 200 )
+	    || xmit_sprs( 5, 400, 1 ) || rx_sync() || chksprs( 100, 200 ) )
+		return -1;
+
+	if (   xmit_sprs( 6, 500, 0 ) || rx_sync() || chksprs( 500, 500 )
+	    || xmit_sprs( 7, 600, 1 ) || rx_sync() || chksprs( 500, 600 ) )
+		return -1;
+
+	if ( rxstats( &st1 ) )
+		return -1;
+
+	if (   2 != st1.n_sparse    - st0.n_sparse
+	    || 2 != st1.sparse_miss - st0.sparse_miss
+	    || 1 != st1.seq_gaps    - st0.seq_gaps ) {
+		fprintf(stderr,"Sparse updates: %"PRIu64" applied, %"PRIu64" dropped, %"PRIu64" gaps (expected 2, 2, 1)\n",
+			st1.n_sparse - st0.n_sparse, st1.sparse_miss - st0.sparse_miss, st1.seq_gaps - st0.seq_gaps);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Every message received while recording ends up in the
+ * file (none dropped) and replaying restores the data.
+ */
+static int
+tst_record(void)
+{
+uint32_t    *data = malloc( NELM * sizeof(*data) );
+FcomRxStats st0, st1;
+FcomBlob    b;
+int         i, n;
+int         rval  = -1;
+
+	if ( ! data ) {
+		fprintf(stderr,"No memory\n");
+		return -1;
+	}
+
+	if ( rx_sync() || rxstats( &st0 ) )
+		goto bail;
+
+	if ( (n = fcomRecordStartCtx( rctx, REC_PATH )) ) {
+		fprintf(stderr,"Starting the recording failed: %s\n", fcomStrerror(n));
+		goto bail;
+	}
+
+	for ( i=0; i<10; i++ ) {
+		mkblob( &b, data, 20 + i );
+		if ( fcomPutBlobCtx( tctx, &b ) )
+			break;
+	}
+
+	/* a failure still stops the recording */
+	i = ( i < 10 || rx_sync() || rxstats( &st1 ) );
+
+	if ( (n = fcomRecordStopCtx( rctx )) < 0 ) {
+		fprintf(stderr,"Recording failed: %s\n", fcomStrerror(n));
+		goto bail;
+	}
+	if ( i )
+		goto bail;
+
+	if ( n != st1.n_msg - st0.n_msg || st1.rec_drop != st0.rec_drop ) {
+		fprintf(stderr,"%d messages recorded, %"PRIu64" received, %"PRIu64" dropped\n",
+			n, st1.n_msg - st0.n_msg, st1.rec_drop - st0.rec_drop);
+		goto bail;
+	}
+
+	mkblob( &b, data, 99 );
+	if ( fcomPutBlobCtx( tctx, &b ) || rx_sync() || chkdata( 99 ) )
+		goto bail;
+
+	if ( (i = fcomReplayCtx( tctx, REC_PATH, FCOM_REPLAY_FAST )) != n ) {
+		fprintf(stderr,"Replay returned %d (expected %d)\n", i, n);
+		goto bail;
+	}
+
+	if ( rx_sync() || chkdata( 29 ) )
+		goto bail;
+
+	rval = 0;
+
+bail:
+	remove( REC_PATH );
+	free( data );
+	return rval;
+}
+
+static struct {
+	const char *nm;
+	int       (*fn)(void);
+} tests[] = {
+	{ "reassembly",     tst_reasm  },
+	{ "sparse updates", tst_sparse },
+	{ "record/replay",  tst_record },
+};
+
+int
+main(int argc, char **argv)
+{
+int      st, i;
+int      rval = 1;
+unsigned fails = 0;
+
+	rctx = tctx = xctx = 0;
+
+	if (   (st = fcomCreateContext( GROUP, 64, &rctx ))
+	    || (st = fcomCreateContext( GROUP,  0, &tctx ))
+	    || (st = fcomCreateContext( GROUP,  0, &xctx )) ) {
+		fprintf(stderr,"Creating contexts failed: %s\n", fcomStrerror(st));
+		goto bail;
+	}
+
+	if (   (st = fcomAddRxBufsCtx( rctx, 6000, 8 ))
+	    || (st = fcomSubscribeCtx( rctx, ID_DATA, 0 ))
+	    || (st = fcomSubscribeCtx( rctx, ID_SYNC, 0 ))
+	    || (st = fcomSubscribeCtx( rctx, ID_SPRS, 0 )) ) {
+		fprintf(stderr,"Setting up the receiver failed: %s\n", fcomStrerror(st));
+		goto bail;
+	}
+
+	for ( i=0; i<sizeof(tests)/sizeof(tests[0]); i++ ) {
+		st = tests[i].fn();
+		printf("%-20s %s\n", tests[i].nm, st ? "FAILED" : "passed");
+		if ( st )
+			fails++;
+	}
+
+	rval = fails ? 1 : 0;
+
+bail:
+	if ( rctx ) {
+		fcomUnsubscribeCtx( rctx, ID_DATA );
+		fcomUnsubscribeCtx( rctx, ID_SYNC );
+		fcomUnsubscribeCtx( rctx, ID_SPRS );
+		fcomDestroyContext( rctx );
+	}
+	if ( tctx )
+		fcomDestroyContext( tctx );
+	if ( xctx )
+		fcomDestroyContext( xctx );
+	return rval;
+}
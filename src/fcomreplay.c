@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+
+/* Replay a recording made with fcomRecordStart() (or 'fcget -w') */
+
+#include <fcom_api.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fcomP.h> /* for fcom_silent_mode which is not really public */
+
+static void
+usage(char *nm)
+{
+	fprintf(stderr,"Usage: %s [-hals] [-n <count>] [-p <fcom_mc_prefix>] <file>\n", nm);
+	fprintf(stderr,"  Options:\n");
+	fprintf(stderr,"       -h print this message\n");
+	fprintf(stderr,"       -a replay as fast as possible (default: with\n");
+	fprintf(stderr,"          the recorded timing)\n");
+	fprintf(stderr,"       -l inject into receivers on this host only\n");
+	fprintf(stderr,"          (unicast to the loopback address)\n");
+	fprintf(stderr,"       -n <count> replay the recording <count> times; default=1\n");
+	fprintf(stderr,"       -p <fcom_mc_prefix>. Multicast prefix for FCOM\n");
+	fprintf(stderr,"       -s dump statistics before terminating.\n");
+	fprintf(stderr,"  Environment:\n");
+	fprintf(stderr,"       FCOM_MC_PREFIX defines multicast prefix (overridden by -p)\n");
+}
+
+int
+main(int argc, char **argv)
+{
+int             ch;
+int             rval    = 1;
+int             st;
+char            *prefix = 0;
+unsigned        flags   = 0;
+int             stats   = 0;
+unsigned        count   = 1;
+unsigned        i;
+unsigned long   tot     = 0;
+
+	while ( (ch = getopt(argc, argv, "ahln:p:s")) >= 0 ) {
+		switch (ch) {
+			case 'h':
+				rval = 0;
+			default:
+				usage(argv[0]);
+				return rval;
+
+			case 'a':
+				flags |= FCOM_REPLAY_FAST;
+			break;
+
+			case 'l':
+				flags |= FCOM_REPLAY_LOCAL;
+			break;
+
+			case 'n':
+				if ( 1 != sscanf(optarg, "%u", &count) ) {
+					fprintf(stderr,"Invalid arg to -n: must be a number\n");
+					usage(argv[0]);
+					return 1;
+				}
+			break;
+
+			case 'p':
+				prefix = optarg;
+			break;
+
+			case 's':
+				stats = 1;
+			break;
+		}
+	}
+
+	if ( optind != argc - 1 ) {
+		fprintf(stderr,"Missing file name\n");
+		usage(argv[0]);
+		return 1;
+	}
+
+	if ( !prefix && !(prefix = getenv("FCOM_MC_PREFIX")) ) {
+		fprintf(stderr,"Missing FCOM multicast prefix. Use '-p' option of define FCOM_MC_PREFIX env-var\n");
+		return 1;
+	}
+
+	fcom_silent_mode = 1;
+	/* transmitter only */
+	if ( (st = fcomInit( prefix, 0 )) ) {
+		fprintf(stderr,"Unable to initialize FCOM: %s\n", fcomStrerror(st));
+		return 1;
+	}
+
+	for ( i=0; i<count; i++ ) {
+		if ( (st = fcomReplay( argv[optind], flags )) < 0 ) {
+			fprintf(stderr,"fcomReplay failed: %s\n", fcomStrerror(st));
+			goto bail;
+		}
+		tot += st;
+	}
+
+	printf("%lu messages replayed\n", tot);
+
+	rval = 0;
+
+bail:
+	if ( stats )
+		fcomDumpStats(stdout);
+
+	return rval;
+}
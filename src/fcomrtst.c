@@ -155,7 +155,7 @@ FILE        *nof  = 0;
 #endif
 
 #if !defined(USE_EPICS) && !defined(USE_PTHREADS)
-	for ( i=0; i<nids && (got = fcom_receive(tout)); i+=got)
+	for ( i=0; i<nids && (got = fcom_receive(fcom_dflt_ctx, tout)); i+=got)
 		/* do nothing else */;
 #else
 	if ( !have_sync ) {
@@ -189,7 +189,7 @@ FILE        *nof  = 0;
 	if ( outfile )
 		fprintf(outfile,"EF 0\n");
 
-	fcom_recv_stats(stderr);
+	fcom_recv_stats(fcom_dflt_ctx, stderr);
 
 	for ( i=0; i<nids; i++) {
 		if ( (st=fcomUnsubscribe(ids[i])) ) {
@@ -200,7 +200,7 @@ FILE        *nof  = 0;
 
 bail:
 	if ( rval )
-		fcom_recv_stats(stderr);
+		fcom_recv_stats(fcom_dflt_ctx, stderr);
 	fcom_exit();
 	free(pb);
 	if ( nif )
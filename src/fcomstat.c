@@ -0,0 +1,419 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the
+// top-level directory of this distribution and at:
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html.
+// No part of 'fcom', including this file,
+// may be copied, modified, propagated, or distributed except according to
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+
+/* Read the statistics segment published by fcomShmPublish()
+ * (see fcom_shm.h) and print it in text exposition format
+ * (one 'name{labels} value' line per metric) or as a compact
+ * line of rates per interval.
+ *
+ * This program does not link FCOM and never interacts with
+ * the publishing process.
+ */
+
+#include <fcom_api.h>
+#include <fcom_shm.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct Metric {
+	const char *name;
+	size_t      off;
+	const char *type;
+	const char *help;
+} Metric;
+
+#define RXM(f, t, h) { "fcom_rx_" #f, offsetof(FcomRxStats, f), t, h }
+#define TXM(f, t, h) { "fcom_tx_" #f, offsetof(FcomTxStats, f), t, h }
+
+static const Metric rx_metrics[] = {
+	RXM( n_msg,           "counter", "Messages received" ),
+	RXM( n_blb,           "counter", "Blobs received" ),
+	RXM( bad_msg_version, "counter", "Messages with unsupported version" ),
+	RXM( bad_blb_version, "counter", "Blobs with unsupported version" ),
+	RXM( no_bufs,         "counter", "Failed buffer allocations" ),
+	RXM( dec_errs,        "counter", "XDR decoding errors" ),
+	RXM( bad_cond_bcst,   "counter", "Failed syncget or set member broadcasts" ),
+	RXM( n_frag,          "counter", "Fragments received" ),
+	RXM( n_reasm,         "counter", "Messages reassembled" ),
+	RXM( reasm_tmo,       "counter", "Incomplete reassemblies dropped" ),
+	RXM( reasm_err,       "counter", "Inconsistent fragments" ),
+	RXM( n_pack,          "counter", "Packed blobs decoded" ),
+	RXM( pack_raw_words,  "counter", "Raw size of packed blobs (words)" ),
+	RXM( pack_words,      "counter", "Packed size of packed blobs (words)" ),
+	RXM( n_sparse,        "counter", "Sparse updates applied" ),
+	RXM( sparse_miss,     "counter", "Sparse updates dropped" ),
+	RXM( seq_gaps,        "counter", "Messages missing in sequence" ),
+	RXM( seq_dups,        "counter", "Duplicate messages" ),
+	RXM( seq_reord,       "counter", "Messages out of order" ),
+	RXM( seq_stale,       "counter", "Stale messages" ),
+	RXM( rec_drop,        "counter", "Messages not recorded" ),
+};
+
+static const Metric tx_metrics[] = {
+	TXM( n_msg,           "counter", "Messages sent" ),
+	TXM( n_blb,           "counter", "Blobs sent" ),
+	TXM( n_snderr,        "counter", "Send errors" ),
+	TXM( n_batch,         "counter", "Batches sent" ),
+	TXM( n_batch_msg,     "counter", "Messages sent in batches" ),
+	TXM( n_batch_sysc,    "counter", "System calls used for batches" ),
+	TXM( max_batch,       "gauge",   "Largest batch" ),
+	TXM( n_async,         "counter", "Asynchronous submissions" ),
+	TXM( n_async_drop,    "counter", "Asynchronous submissions dropped" ),
+	TXM( n_async_err,     "counter", "Asynchronous submissions failed" ),
+	TXM( max_qdepth,      "gauge",   "Asynchronous queue high-water mark" ),
+	TXM( n_coal,          "counter", "Blobs coalesced" ),
+	TXM( n_coal_msg,      "counter", "Messages built by coalescing" ),
+	TXM( n_coal_tmo,      "counter", "Coalesced messages flushed by timeout" ),
+	TXM( n_frag_msg,      "counter", "Messages sent in fragments" ),
+	TXM( n_frag,          "counter", "Fragments sent" ),
+	TXM( n_sparse,        "counter", "Sparse updates sent" ),
+	TXM( n_sparse_full,   "counter", "Sparse updates sent as complete blobs" ),
+	TXM( n_packed,        "counter", "Blobs packed (process-wide)" ),
+	TXM( n_pack_raw,      "counter", "Blobs requesting packing sent raw (process-wide)" ),
+	TXM( pack_raw_words,  "counter", "Raw size of packed blobs (words, process-wide)" ),
+	TXM( pack_words,      "counter", "Packed size of packed blobs (words, process-wide)" ),
+};
+
+#define NumberOf(a) (sizeof(a)/sizeof((a)[0]))
+
+static void
+usage(char *nm)
+{
+	fprintf(stderr,"Usage: %s [-hw] [-s <segment>] [-i <interval_ms>] [-n <count>]\n", nm);
+	fprintf(stderr,"  Options:\n");
+	fprintf(stderr,"       -h print this message\n");
+	fprintf(stderr,"       -s <segment> name of the statistics segment (default: %s)\n", FCOM_SHM_NAME_DFLT);
+	fprintf(stderr,"       -i <interval_ms> repeat every <interval_ms> (default: print once)\n");
+	fprintf(stderr,"       -n <count> stop after <count> samples (lines with -w)\n");
+	fprintf(stderr,"       -w print one line of rates per interval instead of all metrics\n");
+	fprintf(stderr,"          (default interval: 1000 ms)\n");
+}
+
+/* Obtain a consistent copy of the segment (malloced, to be freed
+ * by the caller).
+ *
+ * RETURNS: copy or NULL on error (message printed).
+ */
+static FcomShmHdr *
+snapshot(const char *name)
+{
+int         fd, i;
+struct stat sb;
+FcomShmHdr *h, *c = 0;
+uint32_t    s0;
+size_t      sz;
+
+	if ( (fd = shm_open( name, O_RDONLY, 0 )) < 0 ) {
+		fprintf(stderr,"Unable to open segment '%s': %s\n", name, strerror(errno));
+		return 0;
+	}
+	if ( fstat( fd, &sb ) || (sz = sb.st_size) < sizeof(*h) ) {
+		fprintf(stderr,"Segment '%s' too small\n", name);
+		close( fd );
+		return 0;
+	}
+	h = mmap( 0, sz, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( MAP_FAILED == h ) {
+		fprintf(stderr,"Unable to map segment '%s': %s\n", name, strerror(errno));
+		return 0;
+	}
+
+	if (    FCOM_SHM_MAGIC   != h->magic
+	     || FCOM_SHM_VERSION != h->version
+	     || h->hdr_size < sizeof(FcomShmHdr)
+	     || h->id_size  < sizeof(FcomShmID)
+	     || h->seg_size > sz ) {
+		fprintf(stderr,"Segment '%s' has no (or an incompatible) FCOM statistics layout\n", name);
+		goto bail;
+	}
+
+	if ( ! (c = malloc( sz )) ) {
+		fprintf(stderr,"No memory\n");
+		goto bail;
+	}
+
+	for ( i=0; i<1000; i++ ) {
+		s0 = __atomic_load_n( &h->seq, __ATOMIC_ACQUIRE );
+		if ( ! (s0 & 1) ) {
+			memcpy( c, h, sz );
+			__atomic_thread_fence( __ATOMIC_ACQUIRE );
+			if ( __atomic_load_n( &h->seq, __ATOMIC_RELAXED ) == s0 ) {
+				munmap( h, sz );
+				return c;
+			}
+		}
+		usleep( 100 );
+	}
+	fprintf(stderr,"Unable to obtain a consistent copy of '%s'\n", name);
+
+bail:
+	free( c );
+	munmap( h, sz );
+	return 0;
+}
+
+static void
+prm(const char *name, const char *type, const char *help)
+{
+	printf("# HELP %s %s\n", name, help);
+	printf("# TYPE %s %s\n", name, type);
+}
+
+/* Print a FcomLatHist as a histogram (cumulative buckets);
+ * 'lbl' are additional labels (e.g., 'lock="tbl",') or "".
+ * The HELP and TYPE lines are omitted if 'help' is NULL.
+ */
+static void
+print_hist(const char *name, const char *help, const char *lbl, FcomLatHist *l)
+{
+int      i;
+uint64_t cum = 0;
+int      n   = (int)strlen(lbl) - 1;
+
+	if ( help )
+		prm(name, "histogram", help);
+	for ( i=0; i<FCOM_LAT_BINS - 1; i++ ) {
+		cum += l->bin[i];
+		printf("%s_bucket{%sle=\"%lu\"} %"PRIu64"\n", name, lbl, 1UL << i, cum);
+	}
+	cum += l->bin[i];
+	printf("%s_bucket{%sle=\"+Inf\"} %"PRIu64"\n", name, lbl, cum);
+	/* drop the trailing ',' */
+	if ( n > 0 ) {
+		printf("%s_sum{%.*s} %"PRIu64"\n", name, n, lbl, l->sum_us);
+		printf("%s_count{%.*s} %"PRIu32"\n", name, n, lbl, l->count);
+	} else {
+		printf("%s_sum %"PRIu64"\n", name, l->sum_us);
+		printf("%s_count %"PRIu32"\n", name, l->count);
+	}
+}
+
+static void
+print_metrics(FcomShmHdr *h)
+{
+unsigned   i;
+FcomShmID *id;
+int        up;
+
+	up = ! ( kill( (pid_t)h->pid, 0 ) && ESRCH == errno );
+
+	prm("fcom_publisher_up", "gauge", "Publishing process is alive");
+	printf("fcom_publisher_up{pid=\"%"PRIu32"\"} %d\n", h->pid, up);
+	prm("fcom_shm_updates", "counter", "Updates published");
+	printf("fcom_shm_updates %"PRIu64"\n", h->n_upd);
+	prm("fcom_shm_time_seconds", "gauge", "Time of the last update");
+	printf("fcom_shm_time_seconds %.6f\n", (double)h->time_us/1.0E6);
+
+	if ( (h->flags & FCOM_SHM_HAVE_RX) ) {
+		for ( i=0; i<NumberOf(rx_metrics); i++ ) {
+			prm( rx_metrics[i].name, rx_metrics[i].type, rx_metrics[i].help );
+			printf("%s %"PRIu64"\n", rx_metrics[i].name, *(uint64_t*)((char*)&h->rx + rx_metrics[i].off));
+		}
+
+		prm("fcom_pool_buffers", "gauge", "Buffers in the pool");
+		for ( i=0; i<h->n_pools && i<FCOM_SHM_POOLS_MAX; i++ )
+			printf("fcom_pool_buffers{size=\"%"PRIu32"\"} %"PRIu32"\n", h->pool[i].size, h->pool[i].tot);
+		prm("fcom_pool_available", "gauge", "Buffers available in the pool");
+		for ( i=0; i<h->n_pools && i<FCOM_SHM_POOLS_MAX; i++ )
+			printf("fcom_pool_available{size=\"%"PRIu32"\"} %"PRIu32"\n", h->pool[i].size, h->pool[i].avail);
+		prm("fcom_pool_max_used", "gauge", "High-water mark of buffers in use");
+		for ( i=0; i<h->n_pools && i<FCOM_SHM_POOLS_MAX; i++ )
+			printf("fcom_pool_max_used{size=\"%"PRIu32"\"} %"PRIu32"\n", h->pool[i].size, h->pool[i].max_used);
+		prm("fcom_pool_allocs", "counter", "Buffers allocated from the pool");
+		for ( i=0; i<h->n_pools && i<FCOM_SHM_POOLS_MAX; i++ )
+			printf("fcom_pool_allocs{size=\"%"PRIu32"\"} %"PRIu64"\n", h->pool[i].size, h->pool[i].n_alloc);
+		prm("fcom_pool_fallbacks", "counter", "Requests for this size served by a larger pool");
+		for ( i=0; i<h->n_pools && i<FCOM_SHM_POOLS_MAX; i++ )
+			printf("fcom_pool_fallbacks{size=\"%"PRIu32"\"} %"PRIu64"\n", h->pool[i].size, h->pool[i].n_fallback);
+		prm("fcom_pool_failures", "counter", "Requests for this size which failed");
+		for ( i=0; i<h->n_pools && i<FCOM_SHM_POOLS_MAX; i++ )
+			printf("fcom_pool_failures{size=\"%"PRIu32"\"} %"PRIu64"\n", h->pool[i].size, h->pool[i].n_fail);
+
+		print_hist("fcom_hold_time_us", "Time blobs are held (fcomGetBlob to fcomReleaseBlob)", "", &h->hold);
+		prm("fcom_hold_time_max_us", "gauge", "Longest time a blob was held");
+		printf("fcom_hold_time_max_us{id=\"0x%08"PRIx32"\"} %"PRIu32"\n", h->hold_max_idnt, h->hold.max_us);
+
+		prm("fcom_lock_acquisitions", "counter", "Mutex acquisitions (if lock statistics are enabled)");
+		printf("fcom_lock_acquisitions{lock=\"tbl\"} %"PRIu64"\n", h->lock_tbl.n_acq);
+		printf("fcom_lock_acquisitions{lock=\"grp\"} %"PRIu64"\n", h->lock_grp.n_acq);
+		prm("fcom_lock_contended", "counter", "Mutex acquisitions which found the mutex busy");
+		printf("fcom_lock_contended{lock=\"tbl\"} %"PRIu64"\n", h->lock_tbl.n_cont);
+		printf("fcom_lock_contended{lock=\"grp\"} %"PRIu64"\n", h->lock_grp.n_cont);
+		print_hist("fcom_lock_wait_us", "Time spent waiting for a busy mutex", "lock=\"tbl\",", &h->lock_tbl.wait);
+		print_hist("fcom_lock_wait_us", 0,                                     "lock=\"grp\",", &h->lock_grp.wait);
+		print_hist("fcom_lock_hold_us", "Time a mutex was held",               "lock=\"tbl\",", &h->lock_tbl.hold);
+		print_hist("fcom_lock_hold_us", 0,                                     "lock=\"grp\",", &h->lock_grp.hold);
+		print_hist("fcom_rx_msg_lock_hold_us", "Time the RX thread held the 'tbl' mutex per message", "", &h->lock_rx_msg);
+
+		prm("fcom_subscribed_ids", "gauge", "Subscribed IDs");
+		printf("fcom_subscribed_ids %"PRIu32"\n", h->n_subs);
+
+#define IDLBL "{id=\"0x%08"PRIx32"\",gid=\"%"PRIu32"\",sid=\"%"PRIu32"\"}"
+#define IDARG(id) (id)->idnt, (uint32_t)FCOM_GET_GID((id)->idnt), (uint32_t)FCOM_GET_SID((id)->idnt)
+		prm("fcom_id_updates", "counter", "Updates received");
+		for ( i=0; i<h->n_ids; i++ ) {
+			id = FCOM_SHM_ID(h, i);
+			printf("fcom_id_updates"IDLBL" %"PRIu32"\n", IDARG(id), id->rate.updates);
+		}
+		prm("fcom_id_rate_hz", "gauge", "Recent update rate");
+		for ( i=0; i<h->n_ids; i++ ) {
+			id = FCOM_SHM_ID(h, i);
+			printf("fcom_id_rate_hz"IDLBL" %.3f\n", IDARG(id), id->rate.rate_hz);
+		}
+		prm("fcom_id_interval_mean_us", "gauge", "Mean inter-arrival time");
+		for ( i=0; i<h->n_ids; i++ ) {
+			id = FCOM_SHM_ID(h, i);
+			printf("fcom_id_interval_mean_us"IDLBL" %.1f\n", IDARG(id), id->rate.mean_us);
+		}
+		prm("fcom_id_interval_stddev_us", "gauge", "Inter-arrival jitter (std. deviation)");
+		for ( i=0; i<h->n_ids; i++ ) {
+			id = FCOM_SHM_ID(h, i);
+			printf("fcom_id_interval_stddev_us"IDLBL" %.1f\n", IDARG(id), id->rate.stddev_us);
+		}
+		prm("fcom_id_interval_max_us", "gauge", "Longest inter-arrival time");
+		for ( i=0; i<h->n_ids; i++ ) {
+			id = FCOM_SHM_ID(h, i);
+			printf("fcom_id_interval_max_us"IDLBL" %"PRIu32"\n", IDARG(id), id->rate.max_us);
+		}
+		prm("fcom_id_age_us", "gauge", "Time since the last update");
+		for ( i=0; i<h->n_ids; i++ ) {
+			id = FCOM_SHM_ID(h, i);
+			printf("fcom_id_age_us"IDLBL" %"PRIu64"\n", IDARG(id), id->rate.age_us);
+		}
+	}
+
+	if ( (h->flags & FCOM_SHM_HAVE_TX) ) {
+		for ( i=0; i<NumberOf(tx_metrics); i++ ) {
+			prm( tx_metrics[i].name, tx_metrics[i].type, tx_metrics[i].help );
+			printf("%s %"PRIu64"\n", tx_metrics[i].name, *(uint64_t*)((char*)&h->tx + tx_metrics[i].off));
+		}
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+/* Rate of counter 'f' between two snapshots */
+#define RATE(o, n, f) ( (double)((n)->f - (o)->f) / dt )
+
+static void
+print_rates(FcomShmHdr *o, FcomShmHdr *n, int hdr)
+{
+double   dt;
+unsigned i;
+uint32_t avail = 0;
+
+	if ( hdr ) {
+		printf("%12s %10s %10s %8s %8s %10s %10s %8s %6s\n",
+		       "time", "rx msg/s", "rx blb/s", "nobuf", "gaps",
+		       "tx msg/s", "tx blb/s", "snderr", "bufs");
+	}
+	if ( n->time_us <= o->time_us )
+		return;
+	dt = (double)(n->time_us - o->time_us)/1.0E6;
+	for ( i=0; i<n->n_pools && i<FCOM_SHM_POOLS_MAX; i++ )
+		avail += n->pool[i].avail;
+	printf("%12.3f %10.1f %10.1f %8"PRIu64" %8"PRIu64" %10.1f %10.1f %8"PRIu64" %6"PRIu32"\n",
+	       (double)n->time_us/1.0E6,
+	       RATE(o, n, rx.n_msg), RATE(o, n, rx.n_blb),
+	       n->rx.no_bufs - o->rx.no_bufs, n->rx.seq_gaps - o->rx.seq_gaps,
+	       RATE(o, n, tx.n_msg), RATE(o, n, tx.n_blb),
+	       n->tx.n_snderr - o->tx.n_snderr, avail);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv)
+{
+int         ch;
+const char *name     = FCOM_SHM_NAME_DFLT;
+unsigned    intvl_ms = 0;
+unsigned    count    = 0;
+unsigned    n;
+int         watch    = 0;
+FcomShmHdr *o = 0, *h;
+
+	while ( (ch = getopt(argc, argv, "hi:n:s:w")) >= 0 ) {
+		switch (ch) {
+			case 'h':
+				usage(argv[0]);
+				return 0;
+			default:
+				usage(argv[0]);
+				return 1;
+
+			case 'i':
+				if ( 1 != sscanf(optarg, "%u", &intvl_ms) || 0 == intvl_ms ) {
+					fprintf(stderr,"Invalid 'interval_ms' argument\n");
+					usage(argv[0]);
+					return 1;
+				}
+			break;
+
+			case 'n':
+				if ( 1 != sscanf(optarg, "%u", &count) ) {
+					fprintf(stderr,"Invalid 'count' argument\n");
+					usage(argv[0]);
+					return 1;
+				}
+			break;
+
+			case 's':
+				name = optarg;
+			break;
+
+			case 'w':
+				watch = 1;
+			break;
+		}
+	}
+
+	if ( watch && ! intvl_ms )
+		intvl_ms = 1000;
+
+	/* print once unless an interval is given */
+	if ( ! intvl_ms && ! count && ! watch )
+		count = 1;
+
+	/* rates need one more sample than lines printed */
+	for ( n = 0; ! count || n < count + watch; n++ ) {
+		if ( n )
+			usleep( intvl_ms * 1000 );
+
+		if ( ! (h = snapshot( name )) ) {
+			free( o );
+			return 1;
+		}
+
+		if ( watch ) {
+			if ( o )
+				print_rates( o, h, 0 == (n - 1) % 20 );
+			free( o );
+			o = h;
+		} else {
+			print_metrics( h );
+			free( h );
+		}
+	}
+
+	free( o );
+
+	return 0;
+}
@@ -18,10 +18,15 @@
  * are assembled into groups. When a different GID is encountered
  * the previous group is terminated and sent off.
  * If a group has only a single member then fcomPutBlob() is used.
+ *
+ * With '-b <file>' the blobs are taken from a binary blob file
+ * (see <fcomP.h>) instead; '-w <file>' converts the definitions
+ * read from stdin into such a file (nothing is sent).
  */
 #include <stdio.h>
 #include <inttypes.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <fcom_api.h>
 #include <fcomP.h>
@@ -46,6 +51,75 @@ int st;
 	}
 }
 
+static void
+usage(char *nm)
+{
+	fprintf(stderr,"Usage: %s [-h] [-b <binfile> [-n <count>]] [-w <binfile>]\n", nm);
+	fprintf(stderr,"  Options:\n");
+	fprintf(stderr,"       -h print this message\n");
+	fprintf(stderr,"       -b <binfile> send blobs from binary file (default: ASCII from stdin)\n");
+	fprintf(stderr,"       -n <count> send contents of <binfile> <count> times; default=1\n");
+	fprintf(stderr,"       -w <binfile> convert ASCII from stdin to binary file; send nothing\n");
+}
+
+/* Convert blob definitions from ASCII file 'f' into binary file 'path' */
+static int
+convert(FILE *f, const char *path)
+{
+FcomBinFileRef bf;
+FcomBlobRef    pb = malloc(BLOBSZ);
+int            err, st;
+
+	if ( ! pb ) {
+		fprintf(stderr,"No memory\n");
+		return 1;
+	}
+
+	if ( (st = fcom_binf_create(&bf, path)) ) {
+		fprintf(stderr,"Unable to create %s: %s\n", path, fcomStrerror(st));
+		free(pb);
+		return 1;
+	}
+
+	while ( (err = fcom_get_blob_from_file(f, pb, BLOBSZ)) > 0 ) {
+		if ( (st = fcom_put_blob_to_binf(bf, pb)) ) {
+			fprintf(stderr,"Writing %s failed: %s\n", path, fcomStrerror(st));
+			break;
+		}
+	}
+
+	if ( err < 0 ) {
+		fprintf(stderr,"get_blob_from_file failed (check file syntax)\n");
+	}
+
+	if ( (st = fcom_binf_close(bf)) < 0 ) {
+		fprintf(stderr,"Writing %s failed: %s\n", path, fcomStrerror(st));
+	} else {
+		fprintf(stderr,"%i blobs written to %s\n", st, path);
+	}
+	free(pb);
+	return st < 0 || err < 0;
+}
+
+/* Fetch the next blob from the binary file (if any) or from 'f'.
+ *
+ * RETURNS: > 0 on success, zero at the end, < 0 on error.
+ */
+static int
+next_blob(FILE *f, FcomBinFileRef bf, unsigned *p_i, unsigned n, FcomBlobRef pb)
+{
+int st;
+
+	if ( ! bf )
+		return fcom_get_blob_from_file(f, pb, BLOBSZ);
+
+	if ( *p_i >= n )
+		return 0;
+
+	st = fcom_get_blob_from_binf(bf, (*p_i)++ % fcom_binf_count(bf), pb);
+	return st ? st : 1;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -58,6 +132,45 @@ int         err,nmb;
 FILE        *infile = stdin;
 FcomGroup   g = 0;
 char        *prefix;
+int         ch;
+char        *binf   = 0;
+FcomBinFileRef bf   = 0;
+unsigned    count   = 1;
+unsigned    i       = 0, nbin = 0;
+
+	while ( (ch = getopt(argc, argv, "b:hn:w:")) >= 0 ) {
+		switch ( ch ) {
+			case 'h':
+				usage(argv[0]);
+			return 0;
+
+			default:
+				usage(argv[0]);
+			return 1;
+
+			case 'b':
+				binf = optarg;
+			break;
+
+			case 'n':
+				if ( 1 != sscanf(optarg, "%u", &count) ) {
+					fprintf(stderr,"Invalid arg to -n: must be a number\n");
+					return 1;
+				}
+			break;
+
+			case 'w':
+				return convert(infile, optarg);
+		}
+	}
+
+	if ( binf ) {
+		if ( (st = fcom_binf_open(&bf, binf)) ) {
+			fprintf(stderr,"Unable to open %s: %s\n", binf, fcomStrerror(st));
+			return 1;
+		}
+		nbin = fcom_binf_count(bf) * count;
+	}
 
 	if ( ! (prefix = getenv("FCOM_MC_PREFIX")) )
 		prefix = "239.255.0.0";
@@ -70,7 +183,7 @@ char        *prefix;
 	nmb          = 0;
 	pbl->fc_idnt = 0;
 
-	while ( (err = fcom_get_blob_from_file(infile, pb, BLOBSZ)) > 0 ) {
+	while ( (err = next_blob(infile, bf, &i, nbin, pb)) > 0 ) {
 
 		if ( FCOM_GET_GID(pb->fc_idnt) != FCOM_GET_GID(pbl->fc_idnt) ) {
 
@@ -99,7 +212,10 @@ char        *prefix;
 	}
 
 	if ( err < 0 ) {
-		fprintf(stderr,"get_blob_from_file failed (check file syntax)\n");
+		if ( bf )
+			fprintf(stderr,"get_blob_from_binf failed: %s\n", fcomStrerror(err));
+		else
+			fprintf(stderr,"get_blob_from_file failed (check file syntax)\n");
 	}
 
 	wrapgrp(g, pbl, nmb);
@@ -110,6 +226,8 @@ char        *prefix;
 bail:
 	fcomFreeGroup(g);
 	fcom_exit();
+	if ( bf )
+		fcom_binf_close(bf);
 	free(pb);
 	return rval;
 }
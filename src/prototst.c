@@ -35,6 +35,59 @@
 
 #include <rpc/xdr.h>
 
+/* XDR filter for the packed 16-bit arrays (two elements per
+ * 32-bit word; the first one in the more significant half)
+ * which cannot be expressed in XDR language.
+ */
+static bool_t
+xdr_fcom16(XDR *xdrs, u_int *p_len, uint16_t **p_val)
+{
+u_int i, w = 0;
+
+	if ( ! xdr_u_int(xdrs, p_len) )
+		return FALSE;
+
+	switch ( xdrs->x_op ) {
+		case XDR_FREE:
+			free( *p_val );
+			*p_val = 0;
+		return TRUE;
+
+		case XDR_DECODE:
+			/* one extra element so that we may always store pairs */
+			if ( ! *p_val && ! (*p_val = calloc(*p_len + 1, sizeof(**p_val))) )
+				return FALSE;
+		break;
+
+		default:
+		break;
+	}
+
+	for ( i=0; i<*p_len; i+=2 ) {
+		if ( XDR_ENCODE == xdrs->x_op )
+			w = ((u_int)(*p_val)[i] << 16) | ( i+1 < *p_len ? (*p_val)[i+1] : 0 );
+		if ( ! xdr_u_int(xdrs, &w) )
+			return FALSE;
+		if ( XDR_DECODE == xdrs->x_op ) {
+			(*p_val)[i  ] = w >> 16;
+			(*p_val)[i+1] = w;
+		}
+	}
+	return TRUE;
+}
+
+bool_t
+xdr_FcomInt16(XDR *xdrs, FcomInt16 *objp)
+{
+	return xdr_fcom16(xdrs, &objp->FcomInt16_len, (uint16_t**)&objp->FcomInt16_val);
+}
+
+bool_t
+xdr_FcomUint16(XDR *xdrs, FcomUint16 *objp)
+{
+	return xdr_fcom16(xdrs, &objp->FcomUint16_len, &objp->FcomUint16_val);
+}
+
 static int
 fldcmp(const char *nm, uint32_t a, uint32_t b)
 {
@@ -95,6 +148,22 @@ int             sz;
 			sz = sizeof(int8_t);   pd = pbv1->fc_i08; pdx = pbxv1->fcx_i08;
 		break;
 
+		case FCOM_EL_INT16:
+			sz = sizeof(int16_t);  pd = pbv1->fc_i16; pdx = pbxv1->fcx_i16;
+		break;
+
+		case FCOM_EL_UINT16:
+			sz = sizeof(uint16_t); pd = pbv1->fc_u16; pdx = pbxv1->fcx_u16;
+		break;
+
+		case FCOM_EL_INT64:
+			sz = sizeof(int64_t);  pd = pbv1->fc_i64; pdx = pbxv1->fcx_i64;
+		break;
+
+		case FCOM_EL_UINT64:
+			sz = sizeof(uint64_t); pd = pbv1->fc_u64; pdx = pbxv1->fcx_u64;
+		break;
+
 
 		default:
 			fprintf(stderr,"blobcmp: bad element type %i\n" ,pbv1->fc_type);
@@ -318,6 +318,33 @@ shtblStats(SHTbl shtbl, unsigned *p_size, unsigned *p_used)
 	*p_used = shtbl->nentries;
 }
 
+/*
+ * Execute 'fn' on every entry (in no particular order)
+ * until it returns nonzero.
+ */
+int
+shtblForEach(SHTbl shtbl, int (*fn)(SHTblEntry, void*), void *closure)
+{
+	return shtblForEachRange(shtbl, 0, shtbl->sz, fn, closure);
+}
+
+int
+shtblForEachRange(SHTbl shtbl, unsigned first, unsigned n_slots, int (*fn)(SHTblEntry, void*), void *closure)
+{
+unsigned i,end;
+int      rval = 0;
+	end = first + n_slots;
+	if ( end > (unsigned)shtbl->sz || end < first )
+		end = shtbl->sz;
+	__SHTBL_LOCK(shtbl);
+		for ( i=first; i<end && !rval; i++ ) {
+			if ( shtbl->e[i] )
+				rval = fn(shtbl->e[i], closure);
+		}
+	__SHTBL_UNLOCK(shtbl);
+	return rval;
+}
+
 #ifdef TESTING
 #include <stdio.h>
 #include <string.h>
@@ -108,6 +108,30 @@ shtblDel(SHTbl shtbl, SHTblEntry entry);
 void
 shtblStats(SHTbl shtbl, unsigned *p_size, unsigned *p_used);
 
+/*
+ * Execute 'fn' on every entry (in no particular order);
+ * iteration stops when 'fn' returns nonzero. The table
+ * must not be modified from 'fn'.
+ *
+ * RETURNS: value returned by the last call to 'fn'
+ *          (zero if 'fn' was never called).
+ */
+int
+shtblForEach(SHTbl shtbl, int (*fn)(SHTblEntry, void *closure), void *closure);
+
+/*
+ * Like shtblForEach() but only visit the 'n_slots' slots
+ * starting at 'first' (0 <= slot < size, see shtblStats()).
+ * This allows for walking a table in chunks while releasing
+ * a lock in between; since removing an entry may move others,
+ * entries can then be missed or visited twice.
+ *
+ * RETURNS: value returned by the last call to 'fn'
+ *          (zero if 'fn' was never called).
+ */
+int
+shtblForEachRange(SHTbl shtbl, unsigned first, unsigned n_slots, int (*fn)(SHTblEntry, void *closure), void *closure);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,11 +21,74 @@
 #include <fcomP.h>
 
 #include <xdr_dec.h>
+#include <xdr_fixed.h>
 
 #include <xdr_swpP.h>
 
+/* Number of 32-bit words occupied by the XDR-encoded
+ * payload at 'xdr'; 'avail' is the number of words
+ * available.
+ */
+static int
+fc_xdr_pld_words(uint32_t type, uint32_t nelm, uint32_t *xdr, int avail)
+{
+uint32_t n, r, i;
+int      w;
+
+	if ( (type & FCOM_XDR_TYPE_SPARSE) ) {
+		if ( (type & FCOM_EL_PACKED) )
+			return FCOM_ERR_INVALID_TYPE;
+		/* # of ranges followed by the ranges */
+		if ( avail < 1 || (n = SWAPU32(xdr[0])) >= (uint32_t)avail )
+			return FCOM_ERR_NO_SPACE;
+		for ( i=1, w=1+n; i<=n; i++ ) {
+			r = SWAPU32(xdr[i]);
+			if ( 0 == (r & 0xffff) || (r >> 16) + (r & 0xffff) > nelm )
+				return FCOM_ERR_INVALID_COUNT;
+			if ( (w += fc_xdr_pld_words(FCOM_EL_TYPE(type), r & 0xffff, 0, 0)) > avail )
+				return FCOM_ERR_NO_SPACE;
+		}
+		return w;
+	}
+
+	if ( (type & FCOM_EL_PACKED) ) {
+		/* length is encoded in the first word */
+		if ( avail < 1 )
+			return FCOM_ERR_NO_SPACE;
+		if ( (nelm = SWAPU32(xdr[0])) >= FCOM_MSG_SIZE_MAX/sizeof(*xdr) )
+			return FCOM_ERR_INVALID_COUNT;
+		return 1 + nelm;
+	}
+
+	switch ( FCOM_EL_TYPE(type) ) {
+		case FCOM_EL_DOUBLE:
+		case FCOM_EL_INT64:
+		case FCOM_EL_UINT64:
+			nelm *= 2;
+		break;
+
+		case FCOM_EL_INT16:
+		case FCOM_EL_UINT16:
+			nelm = (nelm + 1)/2;
+		break;
+
+		case FCOM_EL_INT8:
+			nelm = (nelm + 3)/4;
+		break;
+
+		default:
+		/* includes:
+		case FCOM_EL_FLOAT:
+		case FCOM_EL_UINT32:
+		case FCOM_EL_INT32:
+		*/
+		break;
+	}
+	return nelm;
+}
+
 int
-fcom_xdr_peek_size_id(int *p_sz, FcomID *p_id, uint32_t *xdr)
+fcom_xdr_peek_size_id(int *p_sz, FcomID *p_id, uint32_t *xdr, int avail, int *p_pld, uint32_t *p_type)
 {
 uint32_t type;
 uint32_t nelm;
@@ -45,42 +108,117 @@ int      sz;
 		/* compute total size in bytes of C-representation
 		 * and # of 32-bit words in the XDR stream.
 		 */
-		if ( (sz = FCOM_EL_SIZE(type)) < 0 )
+		if ( (sz = FCOM_XDR_EL_SIZE(type)) < 0 )
+			return FCOM_ERR_INVALID_TYPE;
+
+		if ( FCOM_PROTO_MIN_GET(vers) < FCOM_EL_MIN_VERS(type) )
 			return FCOM_ERR_INVALID_TYPE;
 
 		*p_sz = nelm * sz + FC_ALIGN(sizeof(FcomBlobHdr));
 
-		switch ( type ) {
-			case FCOM_EL_DOUBLE:
-				nelm *= 2;
-			break;
-
-			case FCOM_EL_INT8:
-				nelm = (nelm + 3)/4;
-			break;
-
-			default:
-			/* includes:
-			case FCOM_EL_FLOAT:
-			case FCOM_EL_UINT32:
-			case FCOM_EL_INT32:
-			*/
-			break;
-		}
-		return nelm + 8;
+		if ( (sz = fc_xdr_pld_words(type, nelm, xdr + FCOM_XDR_BLOB_HDRSZ, avail - FCOM_XDR_BLOB_HDRSZ)) < 0 )
+			return sz;
+
+		if ( p_pld )
+			*p_pld = sz;
+		if ( p_type )
+			*p_type = type;
+
+		return sz + FCOM_XDR_BLOB_HDRSZ;
 	}
 	return FCOM_ERR_BAD_VERSION;
 }
 
+int
+fcom_xdr_dec_data(void *data, uint8_t type, uint16_t nelm, uint32_t *xdr)
+{
+int          sz;
+#ifndef __BIG_ENDIAN__
+register int i;
+#endif
+const FcomXdrFixed *fx;
+
+	if ( (type & FCOM_XDR_TYPE_SPARSE) )
+		return fcom_xdr_dec_sparse(data, type, nelm, xdr);
+
+	if ( ( sz = FCOM_EL_SIZE(type) ) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( (type & FCOM_EL_PACKED) )
+		return fcom_xdr_dec_packed(data, type, nelm, xdr);
+
+	/* fixed shape; skip the generic code */
+	if ( (fx = fcom_xdr_fixed_find(type, nelm)) )
+		return fx->dec(data, xdr);
+
+	sz *= nelm;
+
+#ifdef __BIG_ENDIAN__
+	memcpy( data, xdr, sz );
+#else
+	switch ( type ) {
+		case FCOM_EL_UINT32:
+		case FCOM_EL_INT32:
+		case FCOM_EL_FLOAT:
+		{
+		uint32_t *p_u32 = data;
+			for ( i=0; i<nelm; i++ ) {
+				p_u32[i] = SWAPU32(xdr[i]);
+			}
+		}
+		break;
+
+		case FCOM_EL_INT8:
+			memcpy( data, xdr, sz );
+		break;
+
+		case FCOM_EL_DOUBLE:
+		{
+		double *p_dbl = data;
+			for ( i=0; i<nelm*2; i+=2 ) {
+				union {
+					double   d;
+					uint32_t l[2];
+				} d_u;
+				d_u.l[0] =  SWAPU32(xdr[i+1]);
+				d_u.l[1] =  SWAPU32(xdr[i  ]);
+				p_dbl[i/2] = d_u.d;
+			}
+		}
+		break;
+
+		case FCOM_EL_INT64:
+		case FCOM_EL_UINT64:
+		{
+		uint64_t *p_u64 = data;
+			for ( i=0; i<nelm; i++ ) {
+				p_u64[i] =   ((uint64_t)SWAPU32(xdr[2*i]) << 32)
+				           | SWAPU32(xdr[2*i+1]);
+			}
+		}
+		break;
+
+		case FCOM_EL_INT16:
+		case FCOM_EL_UINT16:
+		{
+		uint16_t *p_u16 = data;
+			/* two per word; the first one in the more significant half */
+			for ( i=0; i<nelm; i++ ) {
+				p_u16[i] = SWAPU32(xdr[i/2]) >> ( (i & 1) ? 0 : 16 );
+			}
+		}
+		break;
+	}
+#endif
+	return (sz+sizeof(*xdr)-1)/sizeof(*xdr);
+}
+
 /* Decode a blob from a XDR stream in memory */
 
 int
 fcom_xdr_dec_blob(FcomBlobRef pb, int avail, uint32_t *xdr)
 {
 register int sz    = 0;
-#ifndef __BIG_ENDIAN__
-register int i;
-#endif
 uint32_t     *xdro = xdr;
 
 #if 0 /* Disable for now */
@@ -120,7 +258,10 @@ uint32_t     *xdro = xdr;
 			pbv1->fc_type = SWAPU32(*xdr++);
 			pbv1->fc_nelm = SWAPU32(*xdr++);
 
-			if ( ( sz = FCOM_EL_SIZE(pbv1->fc_type) ) < 0 )
+			if ( ( sz = FCOM_XDR_EL_SIZE(pbv1->fc_type) ) < 0 )
+				return FCOM_ERR_INVALID_TYPE;
+
+			if ( FCOM_PROTO_MIN_GET(pbv1->fc_vers) < FCOM_EL_MIN_VERS(pbv1->fc_type) )
 				return FCOM_ERR_INVALID_TYPE;
 
 			sz *= pbv1->fc_nelm;
@@ -128,36 +269,9 @@ uint32_t     *xdro = xdr;
 			if ( (avail -= sz) < 0 )
 				return FCOM_ERR_NO_SPACE;
 
-#ifdef __BIG_ENDIAN__
-			memcpy( pbv1->fc_raw, xdr, sz );
-#else
-			switch (pbv1->fc_type) {
-				case FCOM_EL_UINT32:
-				case FCOM_EL_INT32:
-				case FCOM_EL_FLOAT:
-					for ( i=0; i<pbv1->fc_nelm; i++ ) {
-						pbv1->fc_u32[i] = SWAPU32(xdr[i]);
-					}
-				break;
-
-				case FCOM_EL_INT8:
-					memcpy( pbv1->fc_raw, xdr, sz );
-				break;
-
-				case FCOM_EL_DOUBLE:
-					for ( i=0; i<pbv1->fc_nelm*2; i+=2 ) {
-						union {
-							double   d;
-							uint32_t l[2];
-						} d_u;
-						d_u.l[0] =  SWAPU32(xdr[i+1]);
-						d_u.l[1] =  SWAPU32(xdr[i  ]);
-						pbv1->fc_dbl[i/2] = d_u.d;
-					}
-				break;
-			}
-#endif
-			xdr += (sz+sizeof(*xdr)-1)/sizeof(*xdr);
+			if ( (sz = fcom_xdr_dec_data(pbv1->fc_raw, pbv1->fc_type, pbv1->fc_nelm, xdr)) < 0 )
+				return sz;
+			xdr += sz;
 		}
 		return xdr - xdro;
 	}
@@ -178,3 +292,379 @@ fcom_xdr_dec_msghdr(uint32_t *xdrmem, int *p_nblobs)
 	}
 	return FCOM_ERR_BAD_VERSION;
 }
+
+int
+fcom_xdr_dec_fraghdr(uint32_t *xdrmem, FcomFragHdr *p_hdr)
+{
+uint32_t vers = SWAPU32(xdrmem[FCOM_XDR_FRAG_VERS]);
+uint32_t idx, flen;
+
+	if ( ! (vers & FCOM_MSG_FLAG_FRAG) )
+		return 0;
+
+	if ( ! FCOM_PROTO_MATCH( vers & ~FCOM_MSG_FLAG_FRAG, FCOM_PROTO_VERSION_1x ) )
+		return FCOM_ERR_BAD_VERSION;
+
+	p_hdr->xid    = SWAPU32(xdrmem[FCOM_XDR_FRAG_XID]);
+	p_hdr->nints  = SWAPU32(xdrmem[FCOM_XDR_FRAG_NINTS]);
+	p_hdr->off    = SWAPU32(xdrmem[FCOM_XDR_FRAG_OFF]);
+	p_hdr->len    = SWAPU32(xdrmem[FCOM_XDR_FRAG_LEN]);
+	idx           = SWAPU32(xdrmem[FCOM_XDR_FRAG_IDX]);
+	p_hdr->idx    = idx >> 16;
+	p_hdr->nfrags = idx & 0xffff;
+
+	if (   p_hdr->idx >= p_hdr->nfrags
+	    || p_hdr->off >= p_hdr->nints
+	    || p_hdr->len >  p_hdr->nints - p_hdr->off
+	    || 0 == p_hdr->len )
+		return FCOM_ERR_INVALID_ARG;
+
+	/* all fragments but the last one have the same length and
+	 * fragment 'idx' starts at 'idx' times that length.
+	 */
+	flen = FCOM_FRAG_LEN(p_hdr);
+	if (   0 == flen
+	    || ( p_hdr->idx ? p_hdr->off % p_hdr->idx : p_hdr->off )
+	    || p_hdr->len != ( flen < p_hdr->nints - p_hdr->off ? flen : p_hdr->nints - p_hdr->off )
+	    || p_hdr->nfrags != (p_hdr->nints - 1) / flen + 1 )
+		return FCOM_ERR_INVALID_ARG;
+
+	return FCOM_XDR_FRAG_HDRSZ;
+}
+
+int
+fcom_xdr_dec_cmsghdr(uint32_t *xdrmem, FcomBlobHdr *p_dflt, int *p_nblobs)
+{
+uint32_t vers = SWAPU32(xdrmem[FCOM_XDR_CMSG_VERS]);
+
+	if ( ! (vers & FCOM_MSG_FLAG_COMPACT) )
+		return 0;
+
+	vers &= ~FCOM_MSG_FLAG_COMPACT;
+
+	if ( ! FCOM_PROTO_MATCH( vers, FCOM_PROTO_VERSION_1x ) )
+		return FCOM_ERR_BAD_VERSION;
+
+	*p_nblobs     = SWAPU32(xdrmem[FCOM_XDR_CMSG_NBLB]);
+
+	p_dflt->vers  = vers;
+	p_dflt->idnt  = 0;
+	p_dflt->res3  = 0;
+	p_dflt->nelm  = 0;
+	p_dflt->tsHi  = SWAPU32(xdrmem[FCOM_XDR_CMSG_TSHI]);
+	p_dflt->tsLo  = SWAPU32(xdrmem[FCOM_XDR_CMSG_TSLO]);
+	p_dflt->stat  = SWAPU32(xdrmem[FCOM_XDR_CMSG_STAT]);
+	p_dflt->type  = SWAPU32(xdrmem[FCOM_XDR_CMSG_TYPE]);
+
+	return FCOM_XDR_CMSG_HDRSZ;
+}
+
+/* Decode the header of a compact blob into *p_hdr
+ * (which holds the defaults on entry).
+ *
+ * RETURNS: number of 32-bit words decoded or
+ *          FCOM_ERR_NO_SPACE if more than 'avail'
+ *          words would have to be read.
+ */
+static int
+fc_xdr_dec_cblob_hdr(FcomBlobHdr *p_hdr, uint32_t *xdr, int avail)
+{
+uint32_t *xdro = xdr;
+uint32_t  flgs;
+
+	if ( (avail -= FCOM_XDR_CBLB_HDRSZ) < 0 )
+		return FCOM_ERR_NO_SPACE;
+
+	p_hdr->idnt = SWAPU32(*xdr++);
+	flgs        = SWAPU32(*xdr++);
+	p_hdr->nelm = flgs & 0xffff;
+	flgs      >>= 16;
+
+	/* count the words holding overridden fields */
+	avail -=   !!(flgs & FCOM_XDR_CBLB_F_VERS) + !!(flgs & FCOM_XDR_CBLB_F_RES3)
+	         + 2*!!(flgs & FCOM_XDR_CBLB_F_TS) + !!(flgs & FCOM_XDR_CBLB_F_STAT)
+	         + !!(flgs & FCOM_XDR_CBLB_F_TYPE);
+	if ( avail < 0 )
+		return FCOM_ERR_NO_SPACE;
+
+	if ( (flgs & FCOM_XDR_CBLB_F_VERS) )
+		p_hdr->vers = SWAPU32(*xdr++);
+	if ( (flgs & FCOM_XDR_CBLB_F_RES3) )
+		p_hdr->res3 = SWAPU32(*xdr++);
+	if ( (flgs & FCOM_XDR_CBLB_F_TS) ) {
+		p_hdr->tsHi = SWAPU32(*xdr++);
+		p_hdr->tsLo = SWAPU32(*xdr++);
+	}
+	if ( (flgs & FCOM_XDR_CBLB_F_STAT) )
+		p_hdr->stat = SWAPU32(*xdr++);
+	if ( (flgs & FCOM_XDR_CBLB_F_TYPE) )
+		p_hdr->type = SWAPU32(*xdr++);
+
+	return xdr - xdro;
+}
+
+int
+fcom_xdr_peek_cblob(int *p_sz, FcomID *p_id, uint32_t *xdr, int avail, int *p_pld, uint32_t *p_type, FcomBlobHdr *p_dflt)
+{
+FcomBlobHdr hdr = *p_dflt;
+int         hsz, sz;
+
+	if ( (hsz = fc_xdr_dec_cblob_hdr(&hdr, xdr, avail)) < 0 )
+		return hsz;
+
+	if ( ! FCOM_PROTO_MATCH(hdr.vers, FCOM_PROTO_VERSION_1x) )
+		return FCOM_ERR_BAD_VERSION;
+
+	if ( (sz = FCOM_XDR_EL_SIZE(hdr.type)) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( FCOM_PROTO_MIN_GET(hdr.vers) < FCOM_EL_MIN_VERS(hdr.type) )
+		return FCOM_ERR_INVALID_TYPE;
+
+	*p_id = hdr.idnt;
+
+	*p_sz = sz * hdr.nelm + FC_ALIGN(sizeof(FcomBlobHdr));
+
+	if ( (sz = fc_xdr_pld_words(hdr.type, hdr.nelm, xdr + hsz, avail - hsz)) < 0 )
+		return sz;
+
+	if ( p_pld )
+		*p_pld = sz;
+	if ( p_type )
+		*p_type = hdr.type;
+
+	return hsz + sz;
+}
+
+int
+fcom_xdr_dec_cblob(FcomBlobRef pb, int avail, uint32_t *xdr, FcomBlobHdr *p_dflt)
+{
+int hsz, sz;
+
+	if ( (avail -= sizeof(*pb)) < 0 )
+		return FCOM_ERR_NO_SPACE;
+
+	pb->hdr = *p_dflt;
+
+	/* the header has been checked against the message size by the caller */
+	if ( (hsz = fc_xdr_dec_cblob_hdr(&pb->hdr, xdr, FCOM_XDR_BLOB_HDRSZ)) < 0 )
+		return hsz;
+
+	if ( ! FCOM_PROTO_MATCH(pb->fc_vers, FCOM_PROTO_VERSION_1x) )
+		return FCOM_ERR_BAD_VERSION;
+
+	pb->fc_raw = (void*)FC_ALIGN(pb+1);
+	avail     -= (uintptr_t)pb->fc_raw - (uintptr_t)(pb+1);
+
+	if ( ( sz = FCOM_XDR_EL_SIZE(pb->fc_type) ) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( FCOM_PROTO_MIN_GET(pb->fc_vers) < FCOM_EL_MIN_VERS(pb->fc_type) )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( (avail -= sz * pb->fc_nelm) < 0 )
+		return FCOM_ERR_NO_SPACE;
+
+	if ( (sz = fcom_xdr_dec_data(pb->fc_raw, pb->fc_type, pb->fc_nelm, xdr + hsz)) < 0 )
+		return sz;
+
+	return hsz + sz;
+}
+
+int
+fcom_xdr_msg_size(uint32_t *xdrmem, uint32_t nints, FcomID *p_id)
+{
+FcomBlobHdr dflt, *pdflt = 0;
+int         nblobs, i, sz, xsz, pld;
+int         off;
+uint32_t    type;
+FcomID      idnt;
+
+	off = 0;
+	if ( nints >= FCOM_XDR_CMSG_HDRSZ )
+		off = fcom_xdr_dec_cmsghdr(xdrmem, &dflt, &nblobs);
+	if ( off > 0 ) {
+		pdflt = &dflt;
+	} else if ( 0 == off ) {
+		if ( nints < 2 )
+			return FCOM_ERR_NO_SPACE;
+		off = fcom_xdr_dec_msghdr(xdrmem, &nblobs);
+	}
+	if ( off < 0 )
+		return off;
+
+	if ( nblobs <= 0 )
+		return FCOM_ERR_INVALID_COUNT;
+
+	for ( i=0; i<nblobs; i++, off += xsz ) {
+		if ( (int)nints - off < (pdflt ? FCOM_XDR_CBLB_HDRSZ : FCOM_XDR_BLOB_HDRSZ) )
+			return FCOM_ERR_NO_SPACE;
+		if ( pdflt )
+			xsz = fcom_xdr_peek_cblob(&sz, &idnt, xdrmem + off, nints - off, &pld, &type, pdflt);
+		else
+			xsz = fcom_xdr_peek_size_id(&sz, &idnt, xdrmem + off, nints - off, &pld, &type);
+		if ( xsz < 0 )
+			return xsz;
+		if ( xsz > (int)nints - off )
+			return FCOM_ERR_NO_SPACE;
+		if ( 0 == i && p_id )
+			*p_id = idnt;
+	}
+
+	return off;
+}
+
+int
+fcom_xdr_peek_seq(uint32_t *p_seq, FcomID *p_id, uint32_t *xdr, int avail, FcomBlobHdr *p_dflt)
+{
+FcomBlobHdr hdr;
+int         st;
+
+	if ( p_dflt ) {
+		hdr = *p_dflt;
+		if ( (st = fc_xdr_dec_cblob_hdr(&hdr, xdr, avail)) < 0 )
+			return st;
+		*p_seq = hdr.res3;
+		*p_id  = hdr.idnt;
+	} else {
+		if ( avail < FCOM_XDR_BLOB_HDRSZ )
+			return FCOM_ERR_NO_SPACE;
+		*p_seq = SWAPU32(xdr[FCOM_XDR_BLOB_RES3]);
+		*p_id  = SWAPU32(xdr[FCOM_XDR_BLOB_IDNT]);
+	}
+	return 0;
+}
+
+/* Bit-unpacker; the caller must make sure that
+ * there is enough input.
+ */
+typedef struct FcUnpacker {
+	uint32_t *xdr;
+	uint64_t  acc;
+	int       nb;
+} FcUnpacker;
+
+static __inline__ uint32_t
+fc_unpack_get(FcUnpacker *u, int w)
+{
+uint32_t v;
+
+	if ( u->nb < w ) {
+		u->acc |= (uint64_t)SWAPU32(*u->xdr++) << u->nb;
+		u->nb  += 32;
+	}
+	v       = (uint32_t)(u->acc & ((((uint64_t)1) << w) - 1));
+	u->acc >>= w;
+	u->nb   -= w;
+	return v;
+}
+
+int
+fcom_xdr_dec_packed(void *data, uint8_t type, uint16_t nelm, uint32_t *xdr)
+{
+int        esz, nblk, b, n, i, w;
+uint32_t   *wid, *end;
+FcUnpacker u;
+
+	type = FCOM_EL_TYPE(type);
+
+	if ( (esz = FCOM_EL_SIZE(type)) < (int)sizeof(*xdr) )
+		return FCOM_ERR_INVALID_TYPE;
+
+	end   = xdr + 1 + SWAPU32(xdr[0]);
+	nblk  = (nelm + FCOM_XDR_PACK_BLK - 1)/FCOM_XDR_PACK_BLK;
+	wid   = xdr + 1;
+	u.xdr = wid + (nblk + 3)/4;
+	u.acc = 0;
+	u.nb  = 0;
+
+	if ( u.xdr > end )
+		return FCOM_ERR_INVALID_COUNT;
+
+	for ( b=0; b<nelm; b+=FCOM_XDR_PACK_BLK ) {
+		n = nelm - b < FCOM_XDR_PACK_BLK ? nelm - b : FCOM_XDR_PACK_BLK;
+		w = (SWAPU32(wid[b/FCOM_XDR_PACK_BLK/4]) >> (24 - 8*((b/FCOM_XDR_PACK_BLK) & 3))) & 0xff;
+
+		/* a block of width 'w' occupies 'w' words */
+		if ( w > 8*esz || u.xdr + w > end )
+			return FCOM_ERR_INVALID_COUNT;
+
+		if ( sizeof(uint32_t) == esz ) {
+			uint32_t *x = (uint32_t*)data + b;
+			uint32_t r[FCOM_XDR_PACK_BLK];
+			uint32_t prev = b ? x[-1] : 0;
+
+			for ( i=0; i<FCOM_XDR_PACK_BLK; i++ )
+				r[i] = fc_unpack_get( &u, w );
+
+			if ( FCOM_EL_FLOAT == type ) {
+				for ( i=0; i<n; i++ )
+					x[i] = prev = prev ^ r[i];
+			} else {
+				for ( i=0; i<n; i++ )
+					x[i] = prev = prev + ((r[i] >> 1) ^ -(r[i] & 1));
+			}
+		} else {
+			uint8_t  *x = (uint8_t*)data + b*sizeof(uint64_t);
+			uint64_t v[FCOM_XDR_PACK_BLK];
+			uint64_t r[FCOM_XDR_PACK_BLK];
+			uint64_t prev = 0;
+
+			if ( b )
+				memcpy( &prev, x - sizeof(prev), sizeof(prev) );
+
+			if ( w <= 32 ) {
+				for ( i=0; i<FCOM_XDR_PACK_BLK; i++ )
+					r[i] = fc_unpack_get( &u, w );
+			} else {
+				for ( i=0; i<FCOM_XDR_PACK_BLK; i++ ) {
+					r[i]  = fc_unpack_get( &u, 32 );
+					r[i] |= (uint64_t)fc_unpack_get( &u, w - 32 ) << 32;
+				}
+			}
+
+			if ( FCOM_EL_DOUBLE == type ) {
+				for ( i=0; i<n; i++ )
+					v[i] = prev = prev ^ r[i];
+			} else {
+				for ( i=0; i<n; i++ )
+					v[i] = prev = prev + ((r[i] >> 1) ^ -(r[i] & 1));
+			}
+			/* avoid aliasing issues (double) */
+			memcpy( x, v, n*sizeof(v[0]) );
+		}
+	}
+
+	if ( u.xdr != end )
+		return FCOM_ERR_INVALID_COUNT;
+
+	return end - xdr;
+}
+
+int
+fcom_xdr_dec_sparse(void *data, uint8_t type, uint16_t nelm, uint32_t *xdr)
+{
+uint32_t *xdro = xdr;
+uint32_t *rng;
+uint32_t n, r, i;
+int      sz, w;
+
+	if ( (type & FCOM_EL_PACKED) || (sz = FCOM_XDR_EL_SIZE(type)) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	n    = SWAPU32(*xdr++);
+	rng  = xdr;
+	xdr += n;
+
+	for ( i=0; i<n; i++ ) {
+		r = SWAPU32(rng[i]);
+		if ( 0 == (r & 0xffff) || (r >> 16) + (r & 0xffff) > nelm )
+			return FCOM_ERR_INVALID_COUNT;
+		w = fcom_xdr_dec_data((uint8_t*)data + sz * (r >> 16), FCOM_EL_TYPE(type), r & 0xffff, xdr);
+		if ( w < 0 )
+			return w;
+		xdr += w;
+	}
+
+	return xdr - xdro;
+}
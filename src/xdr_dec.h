@@ -43,19 +43,155 @@ fcom_xdr_dec_blob(FcomBlobRef pb, int avail, uint32_t *xdr);
 int
 fcom_xdr_enc_blob(uint32_t *xdr, FcomBlobRef pb, int avail, uint32_t *p_gid);
 
+/* Layout of a XDR-encoded V1 blob header (indices of
+ * 32-bit words) followed by the payload.
+ */
+#define FCOM_XDR_BLOB_VERS  0
+#define FCOM_XDR_BLOB_IDNT  1
+#define FCOM_XDR_BLOB_RES3  2
+#define FCOM_XDR_BLOB_TSHI  3
+#define FCOM_XDR_BLOB_TSLO  4
+#define FCOM_XDR_BLOB_STAT  5
+#define FCOM_XDR_BLOB_TYPE  6
+#define FCOM_XDR_BLOB_NELM  7
+#define FCOM_XDR_BLOB_HDRSZ 8
+
+/* Encode 'nelm' elements of 'type' from 'data' into
+ * an XDR stream. The caller is responsible for checking
+ * that enough space is available.
+ *
+ * RETURNS: number of 32-bit words encoded or
+ *          FCOM_ERR_INVALID_TYPE.
+ */
+int
+fcom_xdr_enc_data(uint32_t *xdr, uint8_t type, uint16_t nelm, void *data);
+
+/* Decode 'nelm' elements of 'type' from an XDR stream
+ * into 'data'. The caller is responsible for checking
+ * that enough space is available.
+ *
+ * RETURNS: number of 32-bit words decoded or
+ *          FCOM_ERR_INVALID_TYPE.
+ */
+int
+fcom_xdr_dec_data(void *data, uint8_t type, uint16_t nelm, uint32_t *xdr);
+
+/* A 'packed' payload (FCOM_EL_PACKED set in the XDR type
+ * word) consists of
+ *  - the number of 32-bit words that follow
+ *  - the bit widths of blocks of FCOM_XDR_PACK_BLK residuals;
+ *    one byte per block, four per word (first block in the
+ *    most significant byte).
+ *  - the residuals of each block packed into 'width' words
+ *    (least significant bit first).
+ * A residual is the XOR of the bit patterns of successive
+ * elements (float, double) or the zig-zag encoded difference
+ * of successive elements (integers). The first element is
+ * coded against zero. Only 32- and 64-bit types are packed.
+ */
+#define FCOM_XDR_PACK_BLK     32
+/* Don't bother packing fewer elements */
+#define FCOM_XDR_PACK_MIN     64
+
+/* Encode 'nelm' elements of 'type' from 'data' as a packed
+ * payload occupying at most 'avail' 32-bit words.
+ *
+ * RETURNS: number of 32-bit words encoded or zero if the
+ *          type cannot be packed or packing doesn't pay off
+ *          (the payload must then be encoded raw).
+ */
+int
+fcom_xdr_enc_packed(uint32_t *xdr, uint8_t type, uint16_t nelm, void *data, int avail);
+
+/* Decode a packed payload. The length (first word) must
+ * have been checked against the available space by the
+ * caller (fcom_xdr_peek_size_id()).
+ *
+ * RETURNS: number of 32-bit words decoded or an error
+ *          code < 0 if the payload is inconsistent.
+ */
+int
+fcom_xdr_dec_packed(void *data, uint8_t type, uint16_t nelm, uint32_t *xdr);
+
+/* Statistics of the packing encoder; these are process-wide
+ * since the encoder is shared by all contexts. Word counts
+ * refer to the payload only.
+ */
+typedef struct FcomXdrPackStats {
+	uint64_t n_packed;      /* # of blobs packed                         */
+	uint64_t n_raw;         /* # of blobs requesting packing sent raw    */
+	uint64_t raw_words;     /* raw size of the packed blobs              */
+	uint64_t pack_words;    /* packed size of the packed blobs           */
+} FcomXdrPackStats;
+
+extern FcomXdrPackStats fcom_xdr_pack_stats;
+
+/* A 'sparse' payload (FCOM_XDR_TYPE_SPARSE set in the XDR
+ * type word; the element count is that of the complete
+ * array) consists of
+ *  - the number of ranges
+ *  - one word per range: index of the first element (hi
+ *    16 bits) and number of elements (lo 16 bits)
+ *  - the elements of each range (every range is padded
+ *    to a multiple of 32-bit words).
+ * Sparse payloads are never packed. The flag is only used
+ * on the wire; receivers apply the ranges to a copy of the
+ * blob they hold.
+ */
+#define FCOM_XDR_TYPE_SPARSE  0x20
+
+/* Element size for a XDR type word (-1 if invalid) */
+#define FCOM_XDR_EL_SIZE(t)   FCOM_EL_SIZE((t) & ~FCOM_XDR_TYPE_SPARSE)
+
+/* Compute the size of the sparse payload holding 'n_rng'
+ * ranges of a blob of 'nelm' elements of 'type'.
+ *
+ * RETURNS: number of 32-bit words or an error status < 0
+ *          (FCOM_ERR_INVALID_COUNT if a range is empty or
+ *          exceeds 'nelm').
+ */
+int
+fcom_xdr_sparse_words(uint8_t type, uint16_t nelm, const FcomRange *rng, unsigned n_rng);
+
+/* Apply a sparse payload to 'data' which holds 'nelm'
+ * elements. The size of the payload must have been
+ * checked against the available space by the caller
+ * (fcom_xdr_peek_size_id()).
+ *
+ * RETURNS: number of 32-bit words decoded or an error
+ *          code < 0 if the payload is inconsistent.
+ */
+int
+fcom_xdr_dec_sparse(void *data, uint8_t type, uint16_t nelm, uint32_t *xdr);
+
+/* Re-encode timestamp, status and payload of a blob
+ * that has been encoded by fcom_xdr_enc_blob() at 'xdr'
+ * before. ID, type and element count of 'pb' MUST match
+ * the encoded blob (this is not checked).
+ *
+ * RETURNS: number of 32-bit words occupied by the blob
+ *          or FCOM_ERR_INVALID_TYPE.
+ */
+int
+fcom_xdr_patch_blob(uint32_t *xdr, FcomBlobRef pb);
+
 /* Peek at some parameters in a XDR encoded blob:
  *  - protocol version. If no match with a known/supported
  *    version is found then FCOM_ERR_BAD_VERSION is returned.
  *  - ID; returned in *p_id.
  *  - type and element count.
  * The total size of the C-representation of the blob is computed
- * and returned in *p_sz.
+ * and returned in *p_sz. The number of 32-bit words occupied by
+ * the payload is returned in *p_pld and the XDR type word (with
+ * flags) in *p_type (if p_pld and p_type are not NULL).
+ * 'avail' is the number of 32-bit words available in 'xdr'
+ * (only the header is checked against 'avail').
  *
  * RETURNS: number of 32-bit words in 'xdr' occupied by the blob
  *          (success) or an error code < 0 on failure.
  */
 int
-fcom_xdr_peek_size_id(int *p_sz, FcomID *p_id, uint32_t *xdr);
+fcom_xdr_peek_size_id(int *p_sz, FcomID *p_id, uint32_t *xdr, int avail, int *p_pld, uint32_t *p_type);
 
 /********************************************
  * 'Messages' are XDR encoded 'FcomGroup's. *
@@ -84,6 +220,12 @@ fcom_xdr_dec_msghdr(uint32_t *xdrmem, int *p_nblobs);
 int
 fcom_msg_init(uint32_t *xdrmem, uint16_t size, uint32_t gid);
 
+/* Same as fcom_msg_init() but use the 'compact' encoding
+ * (see below) for this message.
+ */
+int
+fcom_msg_init_compact(uint32_t *xdrmem, uint16_t size, uint32_t gid);
+
 /* Append a blob to the message. 'xdrmem' must be the
  * same pointer that had been passed to fcom_msg_init()
  * previously. 'Write-pointer' state information is
@@ -122,6 +264,187 @@ fcom_msg_end(uint32_t *xdrmem, uint32_t *p_gid, uint32_t *p_nblobs);
  *          or error status < 0 on failure.
  */
 int
-fcom_msg_one_blob(uint32_t *xdrmem, uint16_t sz, FcomBlobRef pb, uint32_t *p_gid);
+fcom_msg_one_blob(uint32_t *xdrmem, uint32_t sz, FcomBlobRef pb, uint32_t *p_gid);
+
+/* Same as fcom_msg_one_blob() but encode a sparse update
+ * consisting of 'n_rng' ranges of 'pb'.
+ *
+ * RETURNS: Number of 32-bit words encoded in 'xdrmem' on success
+ *          or error status < 0 on failure (FCOM_ERR_BAD_VERSION
+ *          if the minor version of 'pb' is less than 2).
+ */
+int
+fcom_msg_one_sparse(uint32_t *xdrmem, uint32_t sz, FcomBlobRef pb, const FcomRange *rng, unsigned n_rng, uint32_t *p_gid);
+
+/********************************************
+ * Messages which exceed a single datagram  *
+ * are sent as a sequence of 'fragments'.   *
+ ********************************************/
+
+/* A fragment carries a flag in the version word so
+ * that receivers which don't know about fragments
+ * reject it (bad message version).
+ */
+#define FCOM_MSG_FLAG_FRAG    0x100
+
+/* Layout of the fragment header (indices of 32-bit words):
+ *  - version | FCOM_MSG_FLAG_FRAG
+ *  - transfer ID (identifies the fragmented message)
+ *  - total size of the (reassembled) message
+ *  - offset of this fragment's payload in the message
+ *  - size of this fragment's payload
+ *  - fragment index (hi 16 bits) and # of fragments (lo)
+ * Sizes and offset are in 32-bit words. The payload
+ * follows the header.
+ */
+#define FCOM_XDR_FRAG_VERS    0
+#define FCOM_XDR_FRAG_XID     1
+#define FCOM_XDR_FRAG_NINTS   2
+#define FCOM_XDR_FRAG_OFF     3
+#define FCOM_XDR_FRAG_LEN     4
+#define FCOM_XDR_FRAG_IDX     5
+#define FCOM_XDR_FRAG_HDRSZ   6
+
+/* Max. number of fragments of a single message */
+#define FCOM_MSG_MAX_FRAGS    1024
+
+typedef struct FcomFragHdr {
+	uint32_t xid;
+	uint32_t nints;
+	uint32_t off;
+	uint32_t len;
+	uint16_t idx;
+	uint16_t nfrags;
+} FcomFragHdr;
+
+/* Encode a fragment header into 'xdrmem'.
+ *
+ * RETURNS: number of 32-bit words encoded
+ *          (FCOM_XDR_FRAG_HDRSZ).
+ */
+int
+fcom_xdr_enc_fraghdr(uint32_t *xdrmem, FcomFragHdr *p_hdr);
+
+/* Length of the fragments (but the last one) of a message */
+#define FCOM_FRAG_LEN(fh) ( (fh)->idx ? (fh)->off / (fh)->idx : (fh)->len )
+
+/* Decode a fragment header. Values are checked for
+ * consistency (payload within the message, index less
+ * than the # of fragments, offset and length matching
+ * the index and the # of fragments the message is cut
+ * into). Limits of the receiver (datagram size, max.
+ * # of fragments) are NOT checked.
+ *
+ * RETURNS: number of 32-bit words decoded, zero if
+ *          'xdrmem' holds an ordinary (not fragmented)
+ *          message or a negative error status.
+ */
+int
+fcom_xdr_dec_fraghdr(uint32_t *xdrmem, FcomFragHdr *p_hdr);
+
+/********************************************
+ * 'Compact' messages hoist timestamp,      *
+ * status and type into the message header. *
+ ********************************************/
+
+/* Flag in the version word of a compact message; receivers
+ * which don't know about compact messages reject it (bad
+ * message version).
+ */
+#define FCOM_MSG_FLAG_COMPACT 0x200
+
+/* Layout of the compact message header (indices of 32-bit
+ * words). Timestamp, status and type are the defaults for
+ * all blobs in the message; the blob version defaults to
+ * the message version.
+ */
+#define FCOM_XDR_CMSG_VERS    0
+#define FCOM_XDR_CMSG_NBLB    1
+#define FCOM_XDR_CMSG_TSHI    2
+#define FCOM_XDR_CMSG_TSLO    3
+#define FCOM_XDR_CMSG_STAT    4
+#define FCOM_XDR_CMSG_TYPE    5
+#define FCOM_XDR_CMSG_HDRSZ   6
+
+/* A compact blob consists of
+ *  - ID
+ *  - flags (hi 16 bits) and element count (lo 16 bits)
+ *  - the values of all fields which differ from the
+ *    defaults (as indicated by the flags) in the
+ *    order version, res3, tsHi, tsLo, status, type.
+ *  - payload
+ */
+#define FCOM_XDR_CBLB_IDNT    0
+#define FCOM_XDR_CBLB_NELM    1
+#define FCOM_XDR_CBLB_HDRSZ   2
+
+#define FCOM_XDR_CBLB_F_VERS  0x0001
+#define FCOM_XDR_CBLB_F_RES3  0x0002
+#define FCOM_XDR_CBLB_F_TS    0x0004
+#define FCOM_XDR_CBLB_F_STAT  0x0008
+#define FCOM_XDR_CBLB_F_TYPE  0x0010
+
+/* Decode the header of a compact message; the defaults
+ * are stored in *p_dflt.
+ *
+ * RETURNS: number of 32-bit words decoded, zero if
+ *          'xdrmem' holds an ordinary message or a
+ *          negative error status.
+ */
+int
+fcom_xdr_dec_cmsghdr(uint32_t *xdrmem, FcomBlobHdr *p_dflt, int *p_nblobs);
+
+/* Same as fcom_xdr_peek_size_id() for a compact blob. Pass
+ * the message defaults in *p_dflt and the number of 32-bit
+ * words available in 'xdr' in 'avail' (only the header is
+ * checked against 'avail').
+ */
+int
+fcom_xdr_peek_cblob(int *p_sz, FcomID *p_id, uint32_t *xdr, int avail, int *p_pld, uint32_t *p_type, FcomBlobHdr *p_dflt);
+
+/* Same as fcom_xdr_dec_blob() for a compact blob. Pass the
+ * message defaults in *p_dflt.
+ */
+int
+fcom_xdr_dec_cblob(FcomBlobRef pb, int avail, uint32_t *xdr, FcomBlobHdr *p_dflt);
+
+/* Determine the size of a complete (ordinary or compact;
+ * not fragmented) message by walking the blob headers. At
+ * most 'nints' 32-bit words are examined. The ID of the first
+ * blob is stored in *p_id (unless NULL).
+ *
+ * RETURNS: number of 32-bit words occupied by the message
+ *          or a negative error status (FCOM_ERR_NO_SPACE if
+ *          the message exceeds 'nints', FCOM_ERR_INVALID_COUNT
+ *          if it holds no blob).
+ */
+int
+fcom_xdr_msg_size(uint32_t *xdrmem, uint32_t nints, FcomID *p_id);
+
+/********************************************
+ * Senders number the messages of each GID; *
+ * the sequence number is stored in 'res3'  *
+ * of the first blob of a message.          *
+ ********************************************/
+
+/* Store sequence number 'seq' in a complete message
+ * (see fcom_msg_end()) of 'nints' 32-bit words. The first
+ * blob of a compact message always carries a 'res3' field.
+ *
+ * RETURNS: zero on success, nonzero if the message holds
+ *          no blob.
+ */
+int
+fcom_msg_set_seq(uint32_t *xdrmem, uint32_t nints, uint32_t seq);
+
+/* Peek at the sequence number and ID of the first blob of
+ * a message at 'xdr'. Pass the defaults of a compact message
+ * in *p_dflt (NULL for an ordinary message).
+ *
+ * RETURNS: zero on success or FCOM_ERR_NO_SPACE if the blob
+ *          header exceeds 'avail' 32-bit words.
+ */
+int
+fcom_xdr_peek_seq(uint32_t *p_seq, FcomID *p_id, uint32_t *xdr, int avail, FcomBlobHdr *p_dflt);
 
 #endif
@@ -18,15 +18,280 @@
 #include <string.h>
 #define __INSIDE_FCOM__
 #include <fcom_api.h>
+#include <fcomP.h>
 
 #include <xdr_dec.h>
 
 #include <xdr_swpP.h>
 
+FcomXdrPackStats fcom_xdr_pack_stats = { 0 };
+
+int
+fcom_xdr_enc_data(uint32_t *xdr, uint8_t type, uint16_t nelm, void *data)
+{
+register int i;
+int          sz;
+uint32_t     *xdro = xdr;
+
+	if ( ( sz = FCOM_EL_SIZE(type) ) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	sz *= nelm;
+
+#ifndef __BIG_ENDIAN__
+	switch ( FCOM_EL_TYPE(type) ) {
+		case FCOM_EL_UINT32:
+		case FCOM_EL_INT32:
+		case FCOM_EL_FLOAT:
+		{
+		uint32_t *p_u32 = data;
+
+			for ( i=0; i<nelm; i++ ) {
+				xdr[i] = SWAPU32(p_u32[i]);
+			}
+			xdr += i;
+		}
+		break;
+
+		case FCOM_EL_INT8:
+#endif
+			/* On BE architectures this is executed for all types */
+		{
+		int8_t *p_i08 = data;
+
+			memcpy( xdr, p_i08, sz );
+			xdr += sz/sizeof(*xdr);
+			/* pad with zeroes */
+			if ( (i = sz - (sz/sizeof(*xdr))*sizeof(*xdr)) > 0 ) {
+				memset( (void*)xdr + i, 0, sizeof(*xdr) - i );
+				xdr++;
+			}
+		}
+#ifndef __BIG_ENDIAN__
+		break;
+
+		case FCOM_EL_DOUBLE:
+		{
+		double *p_dbl = data;
+			for ( i=0; i<nelm*2; i+=2 ) {
+				union {
+					double   d;
+					uint32_t l[2];
+				} d_u;
+				d_u.d = p_dbl[i/2];
+				xdr[i+1] = SWAPU32(d_u.l[0]);
+				xdr[i  ] = SWAPU32(d_u.l[1]);
+			}
+			xdr += i;
+		}
+		break;
+
+		case FCOM_EL_INT64:
+		case FCOM_EL_UINT64:
+		{
+		uint64_t *p_u64 = data;
+			for ( i=0; i<nelm; i++ ) {
+				xdr[2*i  ] = SWAPU32((uint32_t)(p_u64[i] >> 32));
+				xdr[2*i+1] = SWAPU32((uint32_t)(p_u64[i]      ));
+			}
+			xdr += 2*i;
+		}
+		break;
+
+		case FCOM_EL_INT16:
+		case FCOM_EL_UINT16:
+		{
+		uint16_t *p_u16 = data;
+			/* two per word; the first one in the more significant half */
+			for ( i=0; i<nelm-1; i+=2 ) {
+				*xdr++ = SWAPU32( ((uint32_t)p_u16[i] << 16) | p_u16[i+1] );
+			}
+			if ( i < nelm ) {
+				*xdr++ = SWAPU32( (uint32_t)p_u16[i] << 16 );
+			}
+		}
+		break;
+	}
+#endif
+	return xdr - xdro;
+}
+
+/* Bit-packer; the caller must make sure that 'v' fits
+ * into 'w' bits and that there is room for the output.
+ */
+typedef struct FcPacker {
+	uint32_t *xdr;
+	uint64_t  acc;
+	int       nb;
+} FcPacker;
+
+static __inline__ void
+fc_pack_put(FcPacker *p, uint32_t v, int w)
+{
+	p->acc |= (uint64_t)v << p->nb;
+	if ( (p->nb += w) >= 32 ) {
+		*p->xdr++ = SWAPU32((uint32_t)p->acc);
+		p->acc  >>= 32;
+		p->nb    -= 32;
+	}
+}
+
+int
+fcom_xdr_enc_packed(uint32_t *xdr, uint8_t type, uint16_t nelm, void *data, int avail)
+{
+int      esz, nblk, lim, b, n, i, w;
+uint32_t *wid, *end;
+FcPacker p;
+
+	type = FCOM_EL_TYPE(type);
+
+	if ( (esz = FCOM_EL_SIZE(type)) < (int)sizeof(*xdr) || nelm < FCOM_XDR_PACK_MIN )
+		return 0;
+
+	/* it must save at least 1/8 of the raw payload */
+	lim  = nelm * (esz/sizeof(*xdr));
+	lim -= lim/8;
+	if ( lim > avail )
+		lim = avail;
+	end  = xdr + lim;
+
+	nblk  = (nelm + FCOM_XDR_PACK_BLK - 1)/FCOM_XDR_PACK_BLK;
+	wid   = xdr + 1;
+	p.xdr = wid + (nblk + 3)/4;
+	p.acc = 0;
+	p.nb  = 0;
+
+	if ( p.xdr >= end )
+		return 0;
+
+	/* collect widths in host byte order */
+	memset( wid, 0, (p.xdr - wid) * sizeof(*wid) );
+
+	/* A block of FCOM_XDR_PACK_BLK (32) residuals of
+	 * width 'w' occupies exactly 'w' words.
+	 */
+	if ( sizeof(uint32_t) == esz ) {
+		uint32_t *x    = data;
+		uint32_t prev  = 0, m;
+		uint32_t r[FCOM_XDR_PACK_BLK];
+
+		for ( b=0; b<nelm; b+=FCOM_XDR_PACK_BLK, x+=FCOM_XDR_PACK_BLK ) {
+			n = nelm - b < FCOM_XDR_PACK_BLK ? nelm - b : FCOM_XDR_PACK_BLK;
+			if ( FCOM_EL_FLOAT == type ) {
+				r[0] = x[0] ^ prev;
+				for ( i=1; i<n; i++ )
+					r[i] = x[i] ^ x[i-1];
+			} else {
+				r[0] = x[0] - prev;
+				for ( i=1; i<n; i++ )
+					r[i] = x[i] - x[i-1];
+				for ( i=0; i<n; i++ )
+					r[i] = (r[i] << 1) ^ (uint32_t)((int32_t)r[i] >> 31);
+			}
+			prev = x[n-1];
+			for ( m=0, i=0; i<n; i++ )
+				m |= r[i];
+			for ( ; i<FCOM_XDR_PACK_BLK; i++ )
+				r[i] = 0;
+
+			w = fcom_nzbits(m);
+			if ( p.xdr + w > end )
+				return 0;
+			wid[b/FCOM_XDR_PACK_BLK/4] |= w << (24 - 8*((b/FCOM_XDR_PACK_BLK) & 3));
+
+			for ( i=0; i<FCOM_XDR_PACK_BLK; i++ )
+				fc_pack_put( &p, r[i], w );
+		}
+	} else {
+		uint8_t  *x    = data;
+		uint64_t prev  = 0, m;
+		uint64_t v[FCOM_XDR_PACK_BLK];
+		uint64_t r[FCOM_XDR_PACK_BLK];
+
+		for ( b=0; b<nelm; b+=FCOM_XDR_PACK_BLK ) {
+			n = nelm - b < FCOM_XDR_PACK_BLK ? nelm - b : FCOM_XDR_PACK_BLK;
+			/* avoid aliasing issues (double) */
+			memcpy( v, x + b*sizeof(v[0]), n*sizeof(v[0]) );
+			if ( FCOM_EL_DOUBLE == type ) {
+				r[0] = v[0] ^ prev;
+				for ( i=1; i<n; i++ )
+					r[i] = v[i] ^ v[i-1];
+			} else {
+				r[0] = v[0] - prev;
+				for ( i=1; i<n; i++ )
+					r[i] = v[i] - v[i-1];
+				for ( i=0; i<n; i++ )
+					r[i] = (r[i] << 1) ^ (uint64_t)((int64_t)r[i] >> 63);
+			}
+			prev = v[n-1];
+			for ( m=0, i=0; i<n; i++ )
+				m |= r[i];
+			for ( ; i<FCOM_XDR_PACK_BLK; i++ )
+				r[i] = 0;
+
+			w = (m >> 32) ? 32 + fcom_nzbits(m >> 32) : fcom_nzbits(m);
+			if ( p.xdr + w > end )
+				return 0;
+			wid[b/FCOM_XDR_PACK_BLK/4] |= w << (24 - 8*((b/FCOM_XDR_PACK_BLK) & 3));
+
+			if ( w <= 32 ) {
+				for ( i=0; i<FCOM_XDR_PACK_BLK; i++ )
+					fc_pack_put( &p, (uint32_t)r[i], w );
+			} else {
+				for ( i=0; i<FCOM_XDR_PACK_BLK; i++ ) {
+					fc_pack_put( &p, (uint32_t)r[i],         32 );
+					fc_pack_put( &p, (uint32_t)(r[i] >> 32), w - 32 );
+				}
+			}
+		}
+	}
+
+	for ( i=0; i<(nblk + 3)/4; i++ )
+		wid[i] = SWAPU32(wid[i]);
+
+	xdr[0] = SWAPU32(p.xdr - xdr - 1);
+
+	return p.xdr - xdr;
+}
+
+/* Try to pack the payload of 'pb' (if requested) into
+ * at most 'avail' bytes at 'xdr'.
+ *
+ * RETURNS: number of 32-bit words encoded or zero if
+ *          the payload must be encoded raw.
+ */
+static int
+fc_xdr_try_pack(uint32_t *xdr, FcomBlobRef pb, int avail)
+{
+	if ( ! (pb->fc_type & FCOM_EL_PACKED) )
+		return 0;
+
+	/* old receivers must be able to tell */
+	if ( FCOM_PROTO_MIN_GET(pb->fc_vers) < FCOM_PROTO_MIN_2 )
+		return 0;
+
+	return fcom_xdr_enc_packed(xdr, pb->fc_type, pb->fc_nelm, pb->fc_raw, avail/(int)sizeof(*xdr));
+}
+
+/* Account for a blob which was encoded successfully
+ * with a packed payload of 'pld' words (zero if raw).
+ */
+static void
+fc_xdr_pack_account(FcomBlobRef pb, int pld)
+{
+	if ( pld > 0 ) {
+		FCOM_STAT_INC( fcom_xdr_pack_stats.n_packed );
+		FCOM_STAT_ADD( fcom_xdr_pack_stats.raw_words,  (FCOM_EL_SIZE(pb->fc_type) * pb->fc_nelm)/sizeof(uint32_t) );
+		FCOM_STAT_ADD( fcom_xdr_pack_stats.pack_words, pld );
+	} else if ( (pb->fc_type & FCOM_EL_PACKED) ) {
+		FCOM_STAT_INC( fcom_xdr_pack_stats.n_raw );
+	}
+}
+
 int
 fcom_xdr_enc_blob(uint32_t *xdr, FcomBlobRef pb, int avail, uint32_t *p_gid)
 {
-register int sz = 0, i;
+register int sz = 0;
 uint32_t     *xdro = xdr;
 
 #if 0 /* Disable for now */
@@ -69,73 +334,56 @@ uint32_t     *xdro = xdr;
 			*xdr++ = SWAPU32(pbv1->fc_tsHi);
 			*xdr++ = SWAPU32(pbv1->fc_tsLo);
 			*xdr++ = SWAPU32(pbv1->fc_stat);
-			*xdr++ = SWAPU32(pbv1->fc_type);
+			*xdr++ = SWAPU32(FCOM_EL_TYPE(pbv1->fc_type));
 			*xdr++ = SWAPU32(pbv1->fc_nelm);
 
 			if ( ( sz = FCOM_EL_SIZE(pbv1->fc_type) ) < 0 )
 				return FCOM_ERR_INVALID_TYPE;
 
-			sz *= pbv1->fc_nelm;
+			/* receivers of an older minor version must be able to tell */
+			if ( FCOM_PROTO_MIN_GET(pbv1->fc_vers) < FCOM_EL_MIN_VERS(pbv1->fc_type) )
+				return FCOM_ERR_BAD_VERSION;
+
+			if ( (sz = fc_xdr_try_pack(xdr, pbv1, avail)) > 0 ) {
+				xdro[FCOM_XDR_BLOB_TYPE] = SWAPU32(FCOM_EL_TYPE(pbv1->fc_type) | FCOM_EL_PACKED);
+				fc_xdr_pack_account(pbv1, sz);
+				return xdr + sz - xdro;
+			}
+
+			sz = FCOM_EL_SIZE(pbv1->fc_type);
+
+			/* the XDR stream is padded to a multiple of 32-bit words */
+			sz  = (sz * pbv1->fc_nelm + sizeof(*xdr) - 1) & ~(sizeof(*xdr) - 1);
 
 			if ( (avail -= sz) < 0 )
 				return FCOM_ERR_NO_SPACE;
 
-#ifndef __BIG_ENDIAN__
-			switch (pbv1->fc_type) {
-				case FCOM_EL_UINT32:
-				case FCOM_EL_INT32:
-				case FCOM_EL_FLOAT:
-				{
-				uint32_t *p_u32 = pbv1->fc_u32;
-
-					for ( i=0; i<pbv1->fc_nelm; i++ ) {
-						xdr[i] = SWAPU32(p_u32[i]);
-					}
-					xdr += i;
-				}
-				break;
-
-				case FCOM_EL_INT8:
-#endif
-					/* On BE architectures this is executed for all types */
-				{
-				int8_t *p_i08 = pbv1->fc_i08;
-
-					memcpy( xdr, p_i08, sz );
-					xdr += sz/sizeof(*xdr);
-					/* pad with zeroes */
-					if ( (i = sz - (sz/sizeof(*xdr))*sizeof(*xdr)) > 0 ) {
-						memset( (void*)xdr + i, 0, sizeof(*xdr) - i );
-						xdr++;
-					}
-					sz += i;
-				}
-#ifndef __BIG_ENDIAN__
-				break;
-
-				case FCOM_EL_DOUBLE:
-				{
-				double *p_dbl = pbv1->fc_dbl;
-					for ( i=0; i<pbv1->fc_nelm*2; i+=2 ) {
-						union {
-							double   d;
-							uint32_t l[2];
-						} d_u;
-						d_u.d = p_dbl[i/2];
-						xdr[i+1] = SWAPU32(d_u.l[0]);
-						xdr[i  ] = SWAPU32(d_u.l[1]);
-					}
-					xdr += i;
-				}
-				break;
-			}
-#endif
+			xdr += fcom_xdr_enc_data(xdr, pbv1->fc_type, pbv1->fc_nelm, pbv1->fc_raw);
+			fc_xdr_pack_account(pbv1, 0);
 		}
 		return xdr - xdro;
 	}
 	return FCOM_ERR_BAD_VERSION;
 }
 
+/* Patch the variable parts of a blob which has previously
+ * been encoded by fcom_xdr_enc_blob() at 'xdr'.
+ */
+int
+fcom_xdr_patch_blob(uint32_t *xdr, FcomBlobRef pb)
+{
+int rval;
+
+	xdr[FCOM_XDR_BLOB_TSHI] = SWAPU32(pb->fc_tsHi);
+	xdr[FCOM_XDR_BLOB_TSLO] = SWAPU32(pb->fc_tsLo);
+	xdr[FCOM_XDR_BLOB_STAT] = SWAPU32(pb->fc_stat);
+
+	/* prepared blobs are never packed */
+	rval = fcom_xdr_enc_data(xdr + FCOM_XDR_BLOB_HDRSZ, FCOM_EL_TYPE(pb->fc_type), pb->fc_nelm, pb->fc_raw);
+
+	return rval < 0 ? rval : rval + FCOM_XDR_BLOB_HDRSZ;
+}
+
 /* Initialize 'message' / 'FcomGroup'.
  * We maintain internal state information in the
  * first two 32-bit words which eventually hold
@@ -154,11 +402,21 @@ uint32_t     *xdro = xdr;
  *
  * To avoid c99 aliasing issues we explicitly encode
  * the 16-bit quantities into 32-bit words.
+ *
+ * The size (in words) never exceeds 15 bits; the most
+ * significant bit of the size field flags a 'compact'
+ * message. A compact message stores the defaults for
+ * timestamp, status and type (taken from the first
+ * blob) in their final (XDR encoded) form right after
+ * the state information.
  */
+#define MSG_FLG_COMPACT 0x8000U
+
 #define MSG_GET_GID(x) ((x)[1]>>16)
 #define MSG_GET_IDX(x) ((x)[1] & 0xffff)
-#define MSG_GET_SIZ(x) ((x)[0]>>16)
+#define MSG_GET_SIZ(x) (((x)[0]>>16) & ~MSG_FLG_COMPACT)
 #define MSG_GET_NBL(x) ((x)[0] & 0xffff)
+#define MSG_IS_CMPCT(x) ((x)[0] & (MSG_FLG_COMPACT << 16))
 
 #define MSG_SET(x,size,gid,n_blobs,idx)       \
 	do { (x)[0] = ((size) << 16) | (n_blobs); \
@@ -199,6 +457,139 @@ uint16_t idx  = 2, n_blobs = 0;
 	return 2;
 }
 
+int
+fcom_msg_init_compact(uint32_t *xdrmem, uint16_t size, uint32_t gid)
+{
+uint16_t idx  = FCOM_XDR_CMSG_HDRSZ, n_blobs = 0;
+int      i;
+
+	if ( ! FCOM_GID_VALID(gid) && FCOM_GID_ANY != gid )
+		return FCOM_ERR_INVALID_ID;
+
+	if ( size < FCOM_XDR_CMSG_HDRSZ*sizeof(*xdrmem) ) {
+		return FCOM_ERR_NO_SPACE;
+	}
+
+	size     /= sizeof(*xdrmem);
+	MSG_SET(xdrmem, size | MSG_FLG_COMPACT, gid, n_blobs, idx);
+
+	/* defaults are set when the first blob is appended */
+	for ( i = 2; i < FCOM_XDR_CMSG_HDRSZ; i++ )
+		xdrmem[i] = 0;
+
+	return FCOM_XDR_CMSG_HDRSZ;
+}
+
+/* Flags of a compact blob of 'type' (which may differ from
+ * the blob's type in the packing flag); 'dflt' points to the
+ * defaults in the message header. The first blob of a message
+ * always carries 'res3' (which holds the sequence number).
+ */
+static uint32_t
+fc_xdr_cblob_flags(FcomBlobRef pb, uint32_t type, uint32_t *dflt, int first)
+{
+uint32_t flgs = 0;
+
+	if ( pb->fc_vers != FCOM_PROTO_VERSION )
+		flgs |= FCOM_XDR_CBLB_F_VERS;
+	if ( pb->fc_res3 || first )
+		flgs |= FCOM_XDR_CBLB_F_RES3;
+	if (   SWAPU32(pb->fc_tsHi) != dflt[FCOM_XDR_CMSG_TSHI - 2]
+	    || SWAPU32(pb->fc_tsLo) != dflt[FCOM_XDR_CMSG_TSLO - 2] )
+		flgs |= FCOM_XDR_CBLB_F_TS;
+	if ( SWAPU32(pb->fc_stat) != dflt[FCOM_XDR_CMSG_STAT - 2] )
+		flgs |= FCOM_XDR_CBLB_F_STAT;
+	if ( SWAPU32(type) != dflt[FCOM_XDR_CMSG_TYPE - 2] )
+		flgs |= FCOM_XDR_CBLB_F_TYPE;
+
+	return flgs;
+}
+
+/* Number of header words of a compact blob */
+static int
+fc_xdr_cblob_hdrsz(uint32_t flgs)
+{
+	return   FCOM_XDR_CBLB_HDRSZ
+	       + !!(flgs & FCOM_XDR_CBLB_F_VERS) + !!(flgs & FCOM_XDR_CBLB_F_RES3)
+	       + 2*!!(flgs & FCOM_XDR_CBLB_F_TS) + !!(flgs & FCOM_XDR_CBLB_F_STAT)
+	       + !!(flgs & FCOM_XDR_CBLB_F_TYPE);
+}
+
+/* Encode a blob into a compact message; 'dflt' points
+ * to the defaults in the message header.
+ */
+static int
+fc_xdr_enc_cblob(uint32_t *xdr, FcomBlobRef pb, int avail, uint32_t *dflt, int first, uint32_t *p_gid)
+{
+uint32_t *xdro = xdr;
+uint32_t  flgs = 0;
+uint32_t  type;
+int       sz, hsz, pld = 0;
+
+	if ( FCOM_PROTO_MAJ_GET(pb->fc_vers) != FCOM_PROTO_VERSION_1x )
+		return FCOM_ERR_BAD_VERSION;
+
+	/* make sure version encoded in ID matches fc_vers */
+	if ( FCOM_PROTO_MAJ_1 != FCOM_GET_MAJ(pb->fc_idnt) )
+		return FCOM_ERR_BAD_VERSION;
+
+	if ( ! FCOM_ID_VALID(pb->fc_idnt) )
+		return FCOM_ERR_INVALID_ID;
+
+	if ( ( sz = FCOM_EL_SIZE(pb->fc_type) ) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	if ( FCOM_PROTO_MIN_GET(pb->fc_vers) < FCOM_EL_MIN_VERS(pb->fc_type) )
+		return FCOM_ERR_BAD_VERSION;
+
+	type = FCOM_EL_TYPE(pb->fc_type);
+
+	/* the header is written once we know whether the payload
+	 * could be packed.
+	 */
+	if ( (pb->fc_type & FCOM_EL_PACKED) ) {
+		flgs = fc_xdr_cblob_flags(pb, type | FCOM_EL_PACKED, dflt, first);
+		hsz  = fc_xdr_cblob_hdrsz(flgs);
+		if ( (pld = fc_xdr_try_pack(xdr + hsz, pb, avail - hsz * (int)sizeof(*xdr))) > 0 )
+			type |= FCOM_EL_PACKED;
+	}
+
+	if ( pld <= 0 ) {
+		flgs = fc_xdr_cblob_flags(pb, type, dflt, first);
+		hsz  = fc_xdr_cblob_hdrsz(flgs);
+
+		/* header, overridden fields and padded payload */
+		avail -= hsz * sizeof(*xdr);
+		avail -= (sz * pb->fc_nelm + sizeof(*xdr) - 1) & ~(sizeof(*xdr) - 1);
+
+		if ( avail < 0 )
+			return FCOM_ERR_NO_SPACE;
+
+		pld = fcom_xdr_enc_data(xdr + hsz, type, pb->fc_nelm, pb->fc_raw);
+	}
+
+	fc_xdr_pack_account(pb, (type & FCOM_EL_PACKED) ? pld : 0);
+
+	*p_gid = FCOM_GET_GID(pb->fc_idnt);
+
+	*xdr++ = SWAPU32(pb->fc_idnt);
+	*xdr++ = SWAPU32((flgs << 16) | pb->fc_nelm);
+	if ( (flgs & FCOM_XDR_CBLB_F_VERS) )
+		*xdr++ = SWAPU32(pb->fc_vers);
+	if ( (flgs & FCOM_XDR_CBLB_F_RES3) )
+		*xdr++ = SWAPU32(pb->fc_res3);
+	if ( (flgs & FCOM_XDR_CBLB_F_TS) ) {
+		*xdr++ = SWAPU32(pb->fc_tsHi);
+		*xdr++ = SWAPU32(pb->fc_tsLo);
+	}
+	if ( (flgs & FCOM_XDR_CBLB_F_STAT) )
+		*xdr++ = SWAPU32(pb->fc_stat);
+	if ( (flgs & FCOM_XDR_CBLB_F_TYPE) )
+		*xdr++ = SWAPU32(type);
+
+	return xdr + pld - xdro;
+}
+
 int
 fcom_msg_append_blob(uint32_t *xdrmem, FcomBlobRef pb)
 {
@@ -211,7 +602,22 @@ uint32_t gid, ogid;
     sz   = MSG_GET_SIZ(xdrmem);
 
 	/* encode blob at xdrmem+idx, remaining size is (sz-idx)*4 */
-	rval = fcom_xdr_enc_blob(xdrmem + idx, pb, (sz-idx) * sizeof(*xdrmem), &gid);
+	if ( MSG_IS_CMPCT(xdrmem) ) {
+		if ( 0 == MSG_GET_NBL(xdrmem) ) {
+			/* first blob defines the defaults */
+			xdrmem[FCOM_XDR_CMSG_TSHI] = SWAPU32(pb->fc_tsHi);
+			xdrmem[FCOM_XDR_CMSG_TSLO] = SWAPU32(pb->fc_tsLo);
+			xdrmem[FCOM_XDR_CMSG_STAT] = SWAPU32(pb->fc_stat);
+			xdrmem[FCOM_XDR_CMSG_TYPE] = SWAPU32(pb->fc_type);
+		}
+		rval = fc_xdr_enc_cblob(xdrmem + idx, pb, (sz-idx) * sizeof(*xdrmem), xdrmem + 2, 0 == MSG_GET_NBL(xdrmem), &gid);
+	} else {
+		rval = fcom_xdr_enc_blob(xdrmem + idx, pb, (sz-idx) * sizeof(*xdrmem), &gid);
+	}
+
+	/* 'gid' is not valid if encoding failed */
+	if ( rval < 0 )
+		return rval;
 
 	/* retrieve GID from xdrmem */
 	ogid = MSG_GET_GID(xdrmem);
@@ -246,7 +652,10 @@ uint32_t gid  = MSG_GET_GID(xdrmem);
 
 
 	/* store protocol version and blob count in XDR stream head */
-	xdrmem[0] = SWAPU32(FCOM_PROTO_VERSION_11);
+	if ( MSG_IS_CMPCT(xdrmem) )
+		xdrmem[0] = SWAPU32(FCOM_PROTO_VERSION | FCOM_MSG_FLAG_COMPACT);
+	else
+		xdrmem[0] = SWAPU32(FCOM_PROTO_VERSION_11);
 	xdrmem[1] = SWAPU32(nblb);
 	/* xdrmem now holds a properly encoded 'message' (FcomGroup) */
 
@@ -263,7 +672,7 @@ uint32_t gid  = MSG_GET_GID(xdrmem);
 
 /* Compact encoder for a message holding only a single blob */
 int
-fcom_msg_one_blob(uint32_t *xdrmem, uint16_t sz, FcomBlobRef pb, uint32_t *p_gid)
+fcom_msg_one_blob(uint32_t *xdrmem, uint32_t sz, FcomBlobRef pb, uint32_t *p_gid)
 {
 int s = sz - 2*sizeof(*xdrmem);
 int rval;
@@ -284,3 +693,101 @@ int rval;
 	/* return total amount of xdrmem written (# of 32-bit words) */
 	return rval;
 }
+
+int
+fcom_xdr_sparse_words(uint8_t type, uint16_t nelm, const FcomRange *rng, unsigned n_rng)
+{
+uint64_t w;
+unsigned i;
+int      sz;
+
+	if ( (sz = FCOM_EL_SIZE(type)) < 0 )
+		return FCOM_ERR_INVALID_TYPE;
+
+	/* # of ranges, the ranges and their (padded) elements */
+	for ( i=0, w=1+(uint64_t)n_rng; i<n_rng; i++ ) {
+		if ( 0 == rng[i].count || (uint32_t)rng[i].start + rng[i].count > nelm )
+			return FCOM_ERR_INVALID_COUNT;
+		w += (sz * rng[i].count + sizeof(uint32_t) - 1)/sizeof(uint32_t);
+	}
+
+	return w > FCOM_MSG_MAX_FRAGS * FCOM_MSG_SIZE_MAX / sizeof(uint32_t) ? FCOM_ERR_NO_SPACE : (int)w;
+}
+
+int
+fcom_msg_one_sparse(uint32_t *xdrmem, uint32_t sz, FcomBlobRef pb, const FcomRange *rng, unsigned n_rng, uint32_t *p_gid)
+{
+FcomBlob  hdr;
+uint32_t  *xdr;
+unsigned  i;
+int       pld, esz, rval;
+
+	if ( FCOM_PROTO_MIN_GET(pb->fc_vers) < FCOM_PROTO_MIN_2 )
+		return FCOM_ERR_BAD_VERSION;
+
+	if ( (pld = fcom_xdr_sparse_words(FCOM_EL_TYPE(pb->fc_type), pb->fc_nelm, rng, n_rng)) < 0 )
+		return pld;
+
+	/* encode message and blob header for an empty array;
+	 * then fix up type and element count.
+	 */
+	hdr         = *pb;
+	hdr.fc_type = FCOM_EL_TYPE(pb->fc_type);
+	hdr.fc_nelm = 0;
+
+	if ( (rval = fcom_msg_one_blob(xdrmem, sz, &hdr, p_gid)) < 0 )
+		return rval;
+
+	if ( (rval + pld) * sizeof(*xdrmem) > sz )
+		return FCOM_ERR_NO_SPACE;
+
+	xdr = xdrmem + 2;
+	xdr[FCOM_XDR_BLOB_TYPE] = SWAPU32(hdr.fc_type | FCOM_XDR_TYPE_SPARSE);
+	xdr[FCOM_XDR_BLOB_NELM] = SWAPU32(pb->fc_nelm);
+	xdr += FCOM_XDR_BLOB_HDRSZ;
+
+	*xdr++ = SWAPU32(n_rng);
+	for ( i=0; i<n_rng; i++ )
+		*xdr++ = SWAPU32(((uint32_t)rng[i].start << 16) | rng[i].count);
+
+	esz = FCOM_EL_SIZE(hdr.fc_type);
+	for ( i=0; i<n_rng; i++ )
+		xdr += fcom_xdr_enc_data(xdr, hdr.fc_type, rng[i].count, (uint8_t*)pb->fc_raw + esz * rng[i].start);
+
+	return xdr - xdrmem;
+}
+
+int
+fcom_msg_set_seq(uint32_t *xdrmem, uint32_t nints, uint32_t seq)
+{
+uint32_t idx, flgs;
+
+	if ( (SWAPU32(xdrmem[0]) & FCOM_MSG_FLAG_COMPACT) ) {
+		if ( nints < FCOM_XDR_CMSG_HDRSZ + FCOM_XDR_CBLB_HDRSZ || 0 == xdrmem[FCOM_XDR_CMSG_NBLB] )
+			return -1;
+		flgs = SWAPU32(xdrmem[FCOM_XDR_CMSG_HDRSZ + FCOM_XDR_CBLB_NELM]) >> 16;
+		if ( ! (flgs & FCOM_XDR_CBLB_F_RES3) )
+			return -1;
+		/* 'res3' follows the (optional) version */
+		idx  = FCOM_XDR_CMSG_HDRSZ + FCOM_XDR_CBLB_HDRSZ + !!(flgs & FCOM_XDR_CBLB_F_VERS);
+	} else {
+		if ( nints < 2 + FCOM_XDR_BLOB_HDRSZ || 0 == xdrmem[1] )
+			return -1;
+		idx  = 2 + FCOM_XDR_BLOB_RES3;
+	}
+
+	xdrmem[idx] = SWAPU32(seq);
+	return 0;
+}
+
+int
+fcom_xdr_enc_fraghdr(uint32_t *xdrmem, FcomFragHdr *p_hdr)
+{
+	xdrmem[FCOM_XDR_FRAG_VERS]  = SWAPU32(FCOM_PROTO_VERSION_11 | FCOM_MSG_FLAG_FRAG);
+	xdrmem[FCOM_XDR_FRAG_XID]   = SWAPU32(p_hdr->xid);
+	xdrmem[FCOM_XDR_FRAG_NINTS] = SWAPU32(p_hdr->nints);
+	xdrmem[FCOM_XDR_FRAG_OFF]   = SWAPU32(p_hdr->off);
+	xdrmem[FCOM_XDR_FRAG_LEN]   = SWAPU32(p_hdr->len);
+	xdrmem[FCOM_XDR_FRAG_IDX]   = SWAPU32(((uint32_t)p_hdr->idx << 16) | p_hdr->nfrags);
+	return FCOM_XDR_FRAG_HDRSZ;
+}
@@ -0,0 +1,31 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'fcom', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+/* FCOM XDR decoders for fixed blob shapes (see xdr_fixed.h) */
+
+#include <xdr_fixed.h>
+
+int fcom_xdr_fixed_enable = 1;
+
+FC_XDR_FIXED_ALL(FC_XDR_FIXED_W32)
+FC_XDR_FIXED_ALL(FC_XDR_FIXED_W64)
+FC_XDR_FIXED_ALL(FC_XDR_FIXED_W16)
+FC_XDR_FIXED_ALL(FC_XDR_FIXED_W8)
+
+const FcomXdrFixed fcom_xdr_fixed_tbl[FCOM_EL_INVAL][FCOM_XDR_FIXED_MAX + 1] = {
+	[FCOM_EL_FLOAT ] = FC_XDR_FIXED_ROW(w32),
+	[FCOM_EL_DOUBLE] = FC_XDR_FIXED_ROW(w64),
+	[FCOM_EL_UINT32] = FC_XDR_FIXED_ROW(w32),
+	[FCOM_EL_INT32 ] = FC_XDR_FIXED_ROW(w32),
+	[FCOM_EL_INT8  ] = FC_XDR_FIXED_ROW(w8),
+	[FCOM_EL_INT16 ] = FC_XDR_FIXED_ROW(w16),
+	[FCOM_EL_UINT16] = FC_XDR_FIXED_ROW(w16),
+	[FCOM_EL_INT64 ] = FC_XDR_FIXED_ROW(w64),
+	[FCOM_EL_UINT64] = FC_XDR_FIXED_ROW(w64),
+};
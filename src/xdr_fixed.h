@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////////
+// This file is part of 'fcom'.
+// It is subject to the license terms in the LICENSE.txt file found in the 
+// top-level directory of this distribution and at: 
+//    https://confluence.slac.stanford.edu/display/ppareg/LICENSE.html. 
+// No part of 'fcom', including this file, 
+// may be copied, modified, propagated, or distributed except according to 
+// the terms contained in the LICENSE.txt file.
+//////////////////////////////////////////////////////////////////////////////
+#ifndef FCOM_XDR_FIXED_H
+#define FCOM_XDR_FIXED_H
+
+/* Decoders specialized for fixed blob shapes.
+ *
+ * Most IDs carry the same element type and count in
+ * every update. For small counts the generic decoder spends
+ * a good part of its time dispatching on the type and
+ * running a loop of unknown length. The macros below
+ * generate a decoder for a given word layout and element
+ * count; since the count is a compile-time constant the
+ * compiler emits straight-line code.
+ *
+ * A table of decoders for all types and counts up to
+ * FCOM_XDR_FIXED_MAX is instantiated in xdr_fixed.c.
+ * fcom_xdr_dec_data() consults it first, i.e., blobs
+ * decoded for subscribers use the specialized code w/o
+ * any change to the API or wire format.
+ *
+ * There are no specialized encoders: fcomctst showed
+ * no consistent gain over the generic encoder (whose
+ * cost is dominated by the blob header).
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define __INSIDE_FCOM__
+#include <fcom_api.h>
+
+#include <xdr_swpP.h>
+
+/* Largest element count with a specialized codec */
+#define FCOM_XDR_FIXED_MAX 16
+
+typedef struct FcomXdrFixed {
+	/* RETURN: number of 32-bit words decoded */
+	int (*dec)(void *data, const uint32_t *xdr);
+} FcomXdrFixed;
+
+extern const FcomXdrFixed fcom_xdr_fixed_tbl[FCOM_EL_INVAL][FCOM_XDR_FIXED_MAX + 1];
+
+/* Nonzero (default) enables the specialized decoders
+ * (may be cleared for benchmarking/debugging).
+ */
+extern int fcom_xdr_fixed_enable;
+
+/* Find the decoder for 'nelm' elements of 'type'.
+ * Types with flags (packed, sparse) are never specialized.
+ *
+ * RETURNS: codec or NULL (use the generic code).
+ */
+static __inline__ const FcomXdrFixed *
+fcom_xdr_fixed_find(uint8_t type, uint16_t nelm)
+{
+#ifdef __BIG_ENDIAN__
+	/* nothing to gain; the generic code just copies */
+	return 0;
+#else
+	if ( type >= FCOM_EL_INVAL || nelm > FCOM_XDR_FIXED_MAX || ! fcom_xdr_fixed_enable )
+		return 0;
+	return fcom_xdr_fixed_tbl[type][nelm].dec ? &fcom_xdr_fixed_tbl[type][nelm] : 0;
+#endif
+}
+
+#if defined(__GNUC__) && ( 8 <= __GNUC__ )
+#define FC_XDR_UNROLL _Pragma("GCC unroll 16")
+#else
+#define FC_XDR_UNROLL
+#endif
+
+/* Decoder 'templates'; each one defines
+ *
+ *   fc_xdr_dec_<layout>_<n>()
+ *
+ * for one of the word layouts used by the generic code.
+ */
+
+/* One element per word (FLOAT, INT32, UINT32) */
+#define FC_XDR_FIXED_W32(n)                                             \
+static int fc_xdr_dec_w32_##n(void *data, const uint32_t *xdr)          \
+{                                                                       \
+uint32_t *p = data;                                                     \
+int       i;                                                            \
+	FC_XDR_UNROLL                                                       \
+	for ( i=0; i<n; i++ )                                               \
+		p[i] = SWAPU32(xdr[i]);                                         \
+	return n;                                                           \
+}
+
+/* One element per two words, most significant first
+ * (DOUBLE, INT64, UINT64)
+ */
+#define FC_XDR_FIXED_W64(n)                                             \
+static int fc_xdr_dec_w64_##n(void *data, const uint32_t *xdr)          \
+{                                                                       \
+uint64_t v;                                                             \
+int      i;                                                             \
+	FC_XDR_UNROLL                                                       \
+	for ( i=0; i<n; i++ ) {                                             \
+		v = ((uint64_t)SWAPU32(xdr[2*i]) << 32) | SWAPU32(xdr[2*i+1]);  \
+		memcpy( (uint8_t*)data + i*sizeof(v), &v, sizeof(v) );          \
+	}                                                                   \
+	return 2*n;                                                         \
+}
+
+/* Two elements per word, the first one in the more
+ * significant half (INT16, UINT16)
+ */
+#define FC_XDR_FIXED_W16(n)                                             \
+static int fc_xdr_dec_w16_##n(void *data, const uint32_t *xdr)          \
+{                                                                       \
+uint16_t *p = data;                                                     \
+int       i;                                                            \
+	FC_XDR_UNROLL                                                       \
+	for ( i=0; i<n; i++ )                                               \
+		p[i] = SWAPU32(xdr[i/2]) >> ( (i & 1) ? 0 : 16 );               \
+	return ((n)+1)/2;                                                   \
+}
+
+/* Bytes, zero-padded to a word boundary (INT8) */
+#define FC_XDR_FIXED_W8(n)                                              \
+static int fc_xdr_dec_w8_##n(void *data, const uint32_t *xdr)           \
+{                                                                       \
+	memcpy( data, xdr, n );                                             \
+	return ((n)+3)/4;                                                   \
+}
+
+/* Instantiate a template for all counts 1..FCOM_XDR_FIXED_MAX */
+#define FC_XDR_FIXED_ALL(tmpl) \
+	tmpl(1)  tmpl(2)  tmpl(3)  tmpl(4)  tmpl(5)  tmpl(6)  tmpl(7)  tmpl(8) \
+	tmpl(9)  tmpl(10) tmpl(11) tmpl(12) tmpl(13) tmpl(14) tmpl(15) tmpl(16)
+
+/* Table row for a layout; index 0 (no elements) is left
+ * to the generic code.
+ */
+#define FC_XDR_FIXED_ENT(l,n) { fc_xdr_dec_##l##_##n }
+#define FC_XDR_FIXED_ROW(l) {                                            \
+	{ 0 },                                                               \
+	FC_XDR_FIXED_ENT(l,1),  FC_XDR_FIXED_ENT(l,2),  FC_XDR_FIXED_ENT(l,3),  \
+	FC_XDR_FIXED_ENT(l,4),  FC_XDR_FIXED_ENT(l,5),  FC_XDR_FIXED_ENT(l,6),  \
+	FC_XDR_FIXED_ENT(l,7),  FC_XDR_FIXED_ENT(l,8),  FC_XDR_FIXED_ENT(l,9),  \
+	FC_XDR_FIXED_ENT(l,10), FC_XDR_FIXED_ENT(l,11), FC_XDR_FIXED_ENT(l,12), \
+	FC_XDR_FIXED_ENT(l,13), FC_XDR_FIXED_ENT(l,14), FC_XDR_FIXED_ENT(l,15), \
+	FC_XDR_FIXED_ENT(l,16)                                               \
+}
+
+#endif